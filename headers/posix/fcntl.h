@@ -78,6 +78,14 @@
 #define POSIX_FADV_DONTNEED		4	/* expect no access in the near future */
 #define POSIX_FADV_NOREUSE		5	/* expect access only once */
 
+#ifdef _DEFAULT_SOURCE
+/* splice() flags; they are hints only */
+#define SPLICE_F_MOVE		0x01
+#define SPLICE_F_NONBLOCK	0x02
+#define SPLICE_F_MORE		0x04
+#define SPLICE_F_GIFT		0x08
+#endif
+
 /* advisory file locking */
 
 struct flock {
@@ -104,6 +112,11 @@ extern int	fcntl(int fd, int op, ...);
 extern int	posix_fadvise(int fd, off_t offset, off_t len, int advice);
 extern int	posix_fallocate(int fd, off_t offset, off_t len);
 
+#ifdef _DEFAULT_SOURCE
+extern ssize_t	splice(int inFD, off_t *inOffset, int outFD, off_t *outOffset,
+					size_t length, unsigned int flags);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
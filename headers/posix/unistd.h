@@ -399,6 +399,11 @@ extern ssize_t  write_pos(int fd, off_t pos, const void *buffer,size_t count);
 extern ssize_t	pwrite(int fd, const void *buffer, size_t count, off_t pos);
 extern off_t	lseek(int fd, off_t offset, int whence);
 
+#ifdef _DEFAULT_SOURCE
+extern ssize_t	copy_file_range(int inFD, off_t *inOffset, int outFD,
+					off_t *outOffset, size_t length, unsigned int flags);
+#endif
+
 extern void		sync(void);
 extern int		fsync(int fd);
 extern int		fdatasync(int fd);
@@ -20,12 +20,14 @@
 // are.
 
 #ifdef FS_SHELL
+#	include <algorithm>
 #	include <new>
 
 #	include "fssh_api_wrapper.h"
 #	include "fssh_auto_deleter.h"
 #else
 #	include <dirent.h>
+#	include <stdio.h>
 #	include <stdlib.h>
 #	include <string.h>
 
@@ -44,6 +46,7 @@
 #endif	// !FS_SHELL
 
 #include <file_systems/QueryParserUtils.h>
+#include <file_systems/QueryStatistics.h>
 
 
 //#define DEBUG_QUERY
@@ -78,6 +81,14 @@ template<typename QueryPolicy> class Term;
 template<typename QueryPolicy> class Query;
 
 
+// The planner only intersects with equations that don't match more entries
+// than this, and only if they match at most kFilterCostFactor as many entries
+// as the equation whose index is iterated: reading an index entry is much
+// cheaper than loading a node, but not free.
+static const int32 kMaxFilterEntries = 65536;
+static const int64 kFilterCostFactor = 16;
+
+
 enum ops {
 	OP_NONE,
 
@@ -108,6 +119,45 @@ union value {
 };
 
 
+/*!	A set of node IDs. The IDs are added in any order; once Sort() has been
+	called, the set can be searched, intersected, and merged in linear time.
+*/
+class NodeIDSet {
+public:
+							NodeIDSet()
+								:
+								fIDs(NULL),
+								fCount(0),
+								fCapacity(0)
+							{
+							}
+
+							~NodeIDSet()
+							{
+								free(fIDs);
+							}
+
+			int32			Count() const { return fCount; }
+			void			MakeEmpty() { fCount = 0; }
+
+	inline	status_t		Add(ino_t id, int32 maxCount);
+	inline	void			Sort();
+	inline	bool			Contains(ino_t id) const;
+
+	inline	void			IntersectWith(const NodeIDSet& other);
+	inline	status_t		MergeWith(const NodeIDSet& other,
+								int32 maxCount);
+
+private:
+	inline	status_t		_Resize(int32 capacity);
+
+private:
+			ino_t*			fIDs;
+			int32			fCount;
+			int32			fCapacity;
+};
+
+
 template<typename QueryPolicy>
 class Query {
 public:
@@ -146,7 +196,10 @@ public:
 			uint32			Flags() const
 								{ return fFlags; }
 
+			status_t		Explain(char* buffer, size_t size);
+
 private:
+			void			_EstimateCardinalities();
 			status_t		_GetNextEntry(struct dirent* dirent, size_t size);
 			void			_EvaluateLiveUpdate(Entry* entry, Node* node,
 								const char* attribute, int32 type,
@@ -163,6 +216,9 @@ private:
 			IndexIterator*	fIterator;
 			Index			fIndex;
 			Stack<Equation<QueryPolicy>*> fStack;
+			NodeIDSet		fReturned;
+			NodeIDSet		fReturnedByCurrent;
+			bool			fDeduplicate;
 
 			uint32			fFlags;
 			port_id			fPort;
@@ -256,11 +312,24 @@ public:
 							IndexIterator** iterator, bool queryNonIndexed);
 			status_t	GetNextMatching(Context* context,
 							IndexIterator* iterator, struct dirent* dirent,
-							size_t bufferSize);
+							size_t bufferSize, const NodeIDSet* exclude);
 
 	virtual	void		CalculateScore(Index &index);
 	virtual	int32		Score() const { return fScore; }
 
+			void		EstimateCardinality(Index& index,
+							IndexStatistics& statistics);
+			int64		Estimate() const { return fEstimate; }
+
+			void		ResetPlan();
+			void		PlanFilters();
+			int32		CountFilters() const
+							{ return fFilterEquations.CountItems(); }
+			Equation<QueryPolicy>* FilterAt(int32 index)
+							{ return fFilterEquations.Array()[index]; }
+
+			void		Describe(char* buffer, size_t size);
+
 	virtual	bool		NeedsEntry();
 
 #ifdef DEBUG_QUERY
@@ -276,6 +345,17 @@ private:
 			bool		CompareTo(const uint8* value, size_t size);
 			uint8*		Value() const { return (uint8*)&fValue; }
 
+			status_t	_NextMatchingKey(IndexIterator* iterator,
+							bool* _truncatedKey = NULL);
+			status_t	_BuildStatistics(Index& index,
+							IndexStatistics& statistics);
+			int64		_Estimate(const IndexStatistics& statistics);
+			bool		_CanFilterFor(const Equation<QueryPolicy>* driver)
+							const;
+			status_t	_CollectNodeIDs(Context* context, Index& index,
+							NodeIDSet& set);
+			void		_BuildFilter(Context* context, Index& index);
+
 			char*		fAttribute;
 			char*		fString;
 			union value<QueryPolicy> fValue;
@@ -285,6 +365,15 @@ private:
 
 			int32		fScore;
 			bool		fHasIndex;
+
+			// query plan
+			int64		fEstimate;
+			int64		fIndexEntries;
+			Stack<Equation<QueryPolicy>*> fFilterEquations;
+			NodeIDSet*	fFilter;
+			bool		fFilterBuilt;
+			bool		fFiltering;
+			Equation<QueryPolicy>* fCoveredBy;
 };
 
 
@@ -366,6 +455,110 @@ private:
 //	#pragma mark -
 
 
+status_t
+NodeIDSet::Add(ino_t id, int32 maxCount)
+{
+	if (fCount == fCapacity) {
+		if (fCount >= maxCount)
+			return B_BUFFER_OVERFLOW;
+
+		status_t status = _Resize(
+			std::min(std::max(fCapacity * 2, (int32)256), maxCount));
+		if (status != B_OK)
+			return status;
+	}
+
+	fIDs[fCount++] = id;
+	return B_OK;
+}
+
+
+/*!	Sorts the IDs, and removes duplicates. */
+void
+NodeIDSet::Sort()
+{
+	if (fCount == 0)
+		return;
+
+	std::sort(fIDs, fIDs + fCount);
+	fCount = std::unique(fIDs, fIDs + fCount) - fIDs;
+}
+
+
+bool
+NodeIDSet::Contains(ino_t id) const
+{
+	return std::binary_search(fIDs, fIDs + fCount, id);
+}
+
+
+/*!	Removes all IDs that aren't in \a other. Both sets must be sorted. */
+void
+NodeIDSet::IntersectWith(const NodeIDSet& other)
+{
+	int32 count = 0;
+	int32 otherIndex = 0;
+	for (int32 i = 0; i < fCount && otherIndex < other.fCount; i++) {
+		while (otherIndex < other.fCount && other.fIDs[otherIndex] < fIDs[i])
+			otherIndex++;
+		if (otherIndex < other.fCount && other.fIDs[otherIndex] == fIDs[i])
+			fIDs[count++] = fIDs[i];
+	}
+	fCount = count;
+}
+
+
+/*!	Adds all IDs of \a other to this set. Both sets must be sorted, and will
+	stay so.
+*/
+status_t
+NodeIDSet::MergeWith(const NodeIDSet& other, int32 maxCount)
+{
+	if (other.fCount == 0)
+		return B_OK;
+
+	int32 capacity = fCount + other.fCount;
+	if (capacity > maxCount)
+		return B_BUFFER_OVERFLOW;
+	if (capacity > fCapacity) {
+		status_t status = _Resize(capacity);
+		if (status != B_OK)
+			return status;
+	}
+
+	// merge from the back, so that we don't need a second array
+	int32 index = fCount - 1;
+	int32 otherIndex = other.fCount - 1;
+	int32 target = capacity - 1;
+	while (otherIndex >= 0) {
+		if (index >= 0 && fIDs[index] > other.fIDs[otherIndex])
+			fIDs[target--] = fIDs[index--];
+		else
+			fIDs[target--] = other.fIDs[otherIndex--];
+	}
+	fCount = capacity;
+
+	fCount = std::unique(fIDs, fIDs + fCount) - fIDs;
+	return B_OK;
+}
+
+
+status_t
+NodeIDSet::_Resize(int32 capacity)
+{
+	ino_t* ids = (ino_t*)realloc(fIDs, capacity * sizeof(ino_t));
+	if (ids == NULL)
+		return B_NO_MEMORY;
+
+	fIDs = ids;
+	fCapacity = capacity;
+	return B_OK;
+}
+
+
+//	#pragma mark -
+
+
 template<typename QueryPolicy>
 Equation<QueryPolicy>::Equation(const char** expr)
 	:
@@ -375,7 +568,14 @@ Equation<QueryPolicy>::Equation(const char** expr)
 	fType(0),
 	fSize(0),
 	fIsPattern(false),
-	fScore(INT32_MAX)
+	fScore(INT32_MAX),
+	fHasIndex(false),
+	fEstimate(-1),
+	fIndexEntries(-1),
+	fFilter(NULL),
+	fFilterBuilt(false),
+	fFiltering(false),
+	fCoveredBy(NULL)
 {
 	const char* string = *expr;
 	const char* start = string;
@@ -504,6 +704,7 @@ Equation<QueryPolicy>::~Equation()
 {
 	free(fAttribute);
 	free(fString);
+	delete fFilter;
 }
 
 
@@ -714,6 +915,13 @@ status_t
 Equation<QueryPolicy>::Match(Entry* entry, Node* node,
 	const char* attributeName, int32 type, const uint8* key, size_t size)
 {
+	// the filter of the equation whose index is being iterated only let
+	// entries through that match this equation
+	if (attributeName == NULL && fCoveredBy != NULL
+		&& fCoveredBy->fFiltering) {
+		return MATCH_OK;
+	}
+
 	// get a pointer to the attribute in question
 	NodeHolder nodeHolder;
 	union value<QueryPolicy> value;
@@ -807,11 +1015,308 @@ Equation<QueryPolicy>::CalculateScore(Index &index)
 }
 
 
+/*!	Replaces the score from CalculateScore() with an estimate of the number
+	of entries that match, computed from the statistics of the index.
+	\a statistics is used as a buffer for them.
+*/
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::EstimateCardinality(Index& index,
+	IndexStatistics& statistics)
+{
+	if (fScore == INT32_MAX
+		|| QueryPolicy::IndexSetTo(index, fAttribute) != B_OK) {
+		return;
+	}
+
+	if (Term<QueryPolicy>::fOp == OP_UNEQUAL) {
+		// this will always scan the whole name index, instead
+		fScore = INT32_MAX - 1;
+		return;
+	}
+
+	// The index keeps the statistics up to date as it changes, so they only
+	// have to be built the first time, and after a lot of changes.
+	if (QueryPolicy::IndexGetStatistics(index, statistics) != B_OK
+		|| statistics.IsStale(fType)) {
+		if (_BuildStatistics(index, statistics) != B_OK)
+			return;
+
+		QueryPolicy::IndexSetStatistics(index, statistics);
+	}
+
+	fEstimate = _Estimate(statistics);
+	fIndexEntries = statistics.EntryCount();
+	fScore = (int32)std::min(fEstimate, (int64)INT32_MAX - 1);
+}
+
+
+/*!	Feeds all keys of the index to \a statistics. The value must already
+	have been converted to the type of the index.
+*/
 template<typename QueryPolicy>
 status_t
-Equation<QueryPolicy>::PrepareQuery(Context* /*context*/, Index& index,
+Equation<QueryPolicy>::_BuildStatistics(Index& index,
+	IndexStatistics& statistics)
+{
+	IndexIterator* iterator = QueryPolicy::IndexCreateIterator(index);
+	if (iterator == NULL)
+		return B_NO_MEMORY;
+
+	// Duplicates of a key don't necessarily come with the key, so we keep
+	// the last two keys around.
+	union value<QueryPolicy>* keys = (union value<QueryPolicy>*)malloc(
+		sizeof(union value<QueryPolicy>) * 2);
+	if (keys == NULL) {
+		QueryPolicy::IndexIteratorDelete(iterator);
+		return B_NO_MEMORY;
+	}
+
+	statistics.Reset(fType);
+
+	int32 current = 0;
+	size_t lastLength = 0;
+	bool first = true;
+	while (true) {
+		size_t keyLength;
+		size_t duplicate = 0;
+		status_t status = QueryPolicy::IndexIteratorFetchNextEntry(iterator,
+			&keys[current], &keyLength, sizeof(union value<QueryPolicy>),
+			&duplicate);
+		if (status != B_OK)
+			break;
+
+		if (duplicate >= 2) {
+			statistics.AddKey(&keys[1 - current], lastLength, false);
+			continue;
+		}
+
+		bool isNewKey = first || compareKeys(fType, &keys[current], keyLength,
+			&keys[1 - current], lastLength) != 0;
+		statistics.AddKey(&keys[current], keyLength, isNewKey);
+
+		lastLength = keyLength;
+		current = 1 - current;
+		first = false;
+	}
+
+	free(keys);
+	QueryPolicy::IndexIteratorDelete(iterator);
+
+	statistics.Finish();
+	return B_OK;
+}
+
+
+template<typename QueryPolicy>
+int64
+Equation<QueryPolicy>::_Estimate(const IndexStatistics& statistics)
+{
+	const int64 entries = statistics.EntryCount();
+
+	switch (Term<QueryPolicy>::fOp) {
+		case OP_EQUAL:
+			if (fIsPattern) {
+				return statistics.EstimatePrefix(fValue.String,
+					std::max(getFirstPatternSymbol(fValue.String), (int32)0));
+			}
+			return statistics.EstimateEqual(Value(), fSize);
+		case OP_LESS_THAN:
+			return statistics.EstimateLess(Value(), fSize, false);
+		case OP_LESS_THAN_OR_EQUAL:
+			return statistics.EstimateLess(Value(), fSize, true);
+		case OP_GREATER_THAN:
+			return entries - statistics.EstimateLess(Value(), fSize, true);
+		case OP_GREATER_THAN_OR_EQUAL:
+			return entries - statistics.EstimateLess(Value(), fSize, false);
+	}
+
+	return entries;
+}
+
+
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::ResetPlan()
+{
+	fFilterEquations.MakeEmpty();
+	delete fFilter;
+	fFilter = NULL;
+	fFilterBuilt = false;
+	fFiltering = false;
+	fCoveredBy = NULL;
+}
+
+
+/*!	Chooses the equations whose index entries are intersected to filter the
+	entries of this equation's index, before they are loaded. Only equations
+	that have to match as well, because they are joined to this one by "&&"
+	operators, are considered.
+*/
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::PlanFilters()
+{
+	Term<QueryPolicy>* top = this;
+	while (top->Parent() != NULL && top->Parent()->Op() == OP_AND)
+		top = top->Parent();
+
+	Stack<Term<QueryPolicy>*> stack;
+	stack.Push(top);
+
+	Term<QueryPolicy>* term;
+	while (stack.Pop(&term)) {
+		if (term->Op() == OP_AND) {
+			Operator<QueryPolicy>* op = (Operator<QueryPolicy>*)term;
+			stack.Push(op->Left());
+			stack.Push(op->Right());
+		} else if (term->Op() > OP_EQUATION && term != this) {
+			Equation<QueryPolicy>* equation = (Equation<QueryPolicy>*)term;
+			if (equation->_CanFilterFor(this))
+				fFilterEquations.Push(equation);
+		}
+	}
+
+	// the smallest sets go first
+	Equation<QueryPolicy>** filters = fFilterEquations.Array();
+	std::sort(filters, filters + fFilterEquations.CountItems(),
+		[](Equation<QueryPolicy>* a, Equation<QueryPolicy>* b) {
+			return a->fEstimate < b->fEstimate;
+		});
+}
+
+
+template<typename QueryPolicy>
+bool
+Equation<QueryPolicy>::_CanFilterFor(const Equation<QueryPolicy>* driver) const
+{
+	if (fEstimate < 0 || Term<QueryPolicy>::fOp == OP_UNEQUAL
+		|| fEstimate > kMaxFilterEntries) {
+		return false;
+	}
+
+	return driver->fEstimate < 0
+		|| fEstimate <= driver->fEstimate * kFilterCostFactor;
+}
+
+
+/*!	Adds the IDs of all nodes whose index entries match the equation to
+	\a set, without loading them.
+	Fails with \c B_NOT_SUPPORTED if the index keys cannot tell exactly which
+	nodes match, because they may be truncated.
+*/
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::_CollectNodeIDs(Context* context, Index& index,
+	NodeIDSet& set)
+{
+	IndexIterator* iterator = NULL;
+	status_t status = PrepareQuery(context, index, &iterator, false);
+	if (iterator == NULL)
+		return status != B_OK ? status : B_ERROR;
+
+	// A value at least as long as the index keys can hold could differ from
+	// a key only beyond what the index stored.
+	if (fSize >= QueryPolicy::kMaxIndexKeyLength - 1)
+		status = B_NOT_SUPPORTED;
+
+	if (status == B_OK || status == B_ENTRY_NOT_FOUND) {
+		bool truncatedKey = false;
+		while ((status = _NextMatchingKey(iterator, &truncatedKey)) == B_OK
+				&& !truncatedKey) {
+			status = set.Add(QueryPolicy::IndexIteratorGetNodeID(iterator),
+				kMaxFilterEntries);
+			if (status != B_OK)
+				break;
+		}
+		if (truncatedKey)
+			status = B_NOT_SUPPORTED;
+		else if (status == B_ENTRY_NOT_FOUND)
+			status = B_OK;
+	}
+
+	QueryPolicy::IndexIteratorDelete(iterator);
+	return status;
+}
+
+
+/*!	Intersects the node IDs matching the equations chosen by PlanFilters().
+	Equations whose IDs could not be collected are just left out, as they
+	are still checked for every entry.
+*/
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::_BuildFilter(Context* context, Index& index)
+{
+	if (fFilterBuilt)
+		return;
+	fFilterBuilt = true;
+
+	for (int32 i = 0; i < fFilterEquations.CountItems(); i++) {
+		Equation<QueryPolicy>* equation = fFilterEquations.Array()[i];
+
+		NodeIDSet* set = new(std::nothrow) NodeIDSet;
+		if (set == NULL)
+			break;
+
+		if (equation->_CollectNodeIDs(context, index, *set) != B_OK) {
+			delete set;
+			continue;
+		}
+
+		set->Sort();
+		if (fFilter == NULL)
+			fFilter = set;
+		else {
+			fFilter->IntersectWith(*set);
+			delete set;
+		}
+
+		equation->fCoveredBy = this;
+
+		if (fFilter->Count() == 0)
+			break;
+	}
+}
+
+
+template<typename QueryPolicy>
+void
+Equation<QueryPolicy>::Describe(char* buffer, size_t size)
+{
+	const char* symbol = "?";
+	switch (Term<QueryPolicy>::fOp) {
+		case OP_EQUAL: symbol = "=="; break;
+		case OP_UNEQUAL: symbol = "!="; break;
+		case OP_GREATER_THAN: symbol = ">"; break;
+		case OP_GREATER_THAN_OR_EQUAL: symbol = ">="; break;
+		case OP_LESS_THAN: symbol = "<"; break;
+		case OP_LESS_THAN_OR_EQUAL: symbol = "<="; break;
+	}
+
+	if (Term<QueryPolicy>::fOp == OP_UNEQUAL || fScore == INT32_MAX) {
+		snprintf(buffer, size, "%s %s \"%s\" (scans the name index)",
+			fAttribute, symbol, fString);
+	} else if (fEstimate >= 0) {
+		snprintf(buffer, size, "%s %s \"%s\" (index, ~%" B_PRId64 " of %"
+			B_PRId64 " entries)", fAttribute, symbol, fString, fEstimate,
+			fIndexEntries);
+	} else {
+		snprintf(buffer, size, "%s %s \"%s\" (index, score %" B_PRId32 ")",
+			fAttribute, symbol, fString, fScore);
+	}
+}
+
+
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::PrepareQuery(Context* context, Index& index,
 	IndexIterator** iterator, bool queryNonIndexed)
 {
+	// this uses the index for the other equations, so it has to be done
+	// first
+	_BuildFilter(context, index);
+
 	status_t status = QueryPolicy::IndexSetTo(index, fAttribute);
 
 	// if we should query attributes without an index, we can just proceed here
@@ -900,13 +1405,17 @@ Equation<QueryPolicy>::PrepareQuery(Context* /*context*/, Index& index,
 }
 
 
+/*!	Advances the iterator to the next index entry whose key matches the
+	equation. Returns \c B_ENTRY_NOT_FOUND if there is none.
+	If \a _truncatedKey is given, it is set to \c true once a key has been
+	looked at that may have been truncated by the index.
+*/
 template<typename QueryPolicy>
 status_t
-Equation<QueryPolicy>::GetNextMatching(Context* context,
-	IndexIterator* iterator, struct dirent* dirent, size_t bufferSize)
+Equation<QueryPolicy>::_NextMatchingKey(IndexIterator* iterator,
+	bool* _truncatedKey)
 {
 	while (true) {
-		NodeHolder nodeHolder;
 		union value<QueryPolicy> indexValue;
 		size_t keyLength;
 		size_t duplicate = 0;
@@ -916,6 +1425,11 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 		if (status != B_OK)
 			return status;
 
+		if (_truncatedKey != NULL
+			&& keyLength >= QueryPolicy::kMaxIndexKeyLength - 1) {
+			*_truncatedKey = true;
+		}
+
 		// only compare against the index entry when this is the correct
 		// index for the equation
 		if (fHasIndex && duplicate < 2 && !CompareTo((uint8*)&indexValue, keyLength)) {
@@ -933,6 +1447,34 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 			continue;
 		}
 
+		return B_OK;
+	}
+}
+
+
+template<typename QueryPolicy>
+status_t
+Equation<QueryPolicy>::GetNextMatching(Context* context,
+	IndexIterator* iterator, struct dirent* dirent, size_t bufferSize,
+	const NodeIDSet* exclude)
+{
+	while (true) {
+		NodeHolder nodeHolder;
+
+		status_t status = _NextMatchingKey(iterator);
+		if (status != B_OK)
+			return status;
+
+		// Sort out the entries the query plan already knows about before
+		// loading them.
+		if (fFilter != NULL || exclude != NULL) {
+			ino_t id = QueryPolicy::IndexIteratorGetNodeID(iterator);
+			if ((fFilter != NULL && !fFilter->Contains(id))
+				|| (exclude != NULL && exclude->Contains(id))) {
+				continue;
+			}
+		}
+
 		Entry* entry = NULL;
 		status = QueryPolicy::IndexIteratorGetEntry(context, iterator,
 			nodeHolder, &entry);
@@ -959,6 +1501,9 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 		if (!fHasIndex)
 			status = Match(entry, QueryPolicy::EntryGetNode(entry));
 
+		// the equations our filter covers don't need to be checked again
+		fFiltering = fFilter != NULL;
+
 		while (term != NULL && status == MATCH_OK) {
 			Operator<QueryPolicy>* parent
 				= (Operator<QueryPolicy>*)term->Parent();
@@ -985,6 +1530,8 @@ Equation<QueryPolicy>::GetNextMatching(Context* context,
 			term = (Term<QueryPolicy>*)parent;
 		}
 
+		fFiltering = false;
+
 		if (status == MATCH_OK) {
 			ssize_t nameLength = QueryPolicy::EntryGetName(entry,
 				dirent->d_name,
@@ -1429,6 +1976,7 @@ Query<QueryPolicy>::Query(Context* context, Expression<QueryPolicy>* expression,
 	fCurrent(NULL),
 	fIterator(NULL),
 	fIndex(context),
+	fDeduplicate(false),
 	fFlags(flags),
 	fPort(port),
 	fToken(token),
@@ -1442,6 +1990,7 @@ Query<QueryPolicy>::Query(Context* context, Expression<QueryPolicy>* expression,
 
 	// create index on the stack and delete it afterwards
 	fExpression->Root()->CalculateScore(fIndex);
+	_EstimateCardinalities();
 	QueryPolicy::IndexUnset(fIndex);
 
 	fNeedsEntry = fExpression->Root()->NeedsEntry();
@@ -1527,10 +2076,117 @@ Query<QueryPolicy>::Rewind()
 			QUERY_FATAL("Unknown term on stack or stack error\n");
 	}
 
+	// forget the previous plan
+	stack.Push(fExpression->Root());
+	while (stack.Pop(&term)) {
+		if (term->Op() < OP_EQUATION) {
+			Operator<QueryPolicy>* op = (Operator<QueryPolicy>*)term;
+			stack.Push(op->Left());
+			stack.Push(op->Right());
+		} else
+			((Equation<QueryPolicy>*)term)->ResetPlan();
+	}
+
+	for (int32 i = 0; i < fStack.CountItems(); i++)
+		fStack.Array()[i]->PlanFilters();
+
+	// With more than one equation to iterate, an entry may match several
+	// of them; we remember which ones were returned to only do so once.
+	fReturned.MakeEmpty();
+	fReturnedByCurrent.MakeEmpty();
+	fDeduplicate = fStack.CountItems() > 1;
+
 	return B_OK;
 }
 
 
+/*!	Writes a description of how the query is going to be evaluated to
+	\a buffer: the equations whose index is iterated, and the ones whose
+	index entries are intersected with them.
+*/
+template<typename QueryPolicy>
+status_t
+Query<QueryPolicy>::Explain(char* buffer, size_t size)
+{
+	if (buffer == NULL || size == 0)
+		return B_BAD_VALUE;
+
+	buffer[0] = '\0';
+	size_t length = 0;
+	char description[512];
+
+	// the stack is evaluated from its top
+	for (int32 i = fStack.CountItems() - 1; i >= 0; i--) {
+		Equation<QueryPolicy>* equation = fStack.Array()[i];
+
+		equation->Describe(description, sizeof(description));
+		length += snprintf(buffer + length, size - length, "iterate %s\n",
+			description);
+		if (length >= size)
+			return B_BUFFER_OVERFLOW;
+
+		for (int32 j = 0; j < equation->CountFilters(); j++) {
+			equation->FilterAt(j)->Describe(description, sizeof(description));
+			length += snprintf(buffer + length, size - length,
+				"  intersect %s\n", description);
+			if (length >= size)
+				return B_BUFFER_OVERFLOW;
+		}
+	}
+
+	if (fStack.CountItems() > 1) {
+		length += snprintf(buffer + length, size - length,
+			"merge by node ID\n");
+		if (length >= size)
+			return B_BUFFER_OVERFLOW;
+	}
+
+	return B_OK;
+}
+
+
+/*!	When there is more than one index the query could use, the heuristic
+	scores are replaced by estimates computed from statistics of the
+	indices, so that the planner can pick the most selective one, and decide
+	which of the others are worth intersecting with it.
+*/
+template<typename QueryPolicy>
+void
+Query<QueryPolicy>::_EstimateCardinalities()
+{
+	Stack<Equation<QueryPolicy>*> equations;
+	Stack<Term<QueryPolicy>*> stack;
+	stack.Push(fExpression->Root());
+
+	int32 indexed = 0;
+	Term<QueryPolicy>* term;
+	while (stack.Pop(&term)) {
+		if (term->Op() < OP_EQUATION) {
+			Operator<QueryPolicy>* op = (Operator<QueryPolicy>*)term;
+			stack.Push(op->Left());
+			stack.Push(op->Right());
+		} else {
+			equations.Push((Equation<QueryPolicy>*)term);
+			if (term->Score() < INT32_MAX && term->Op() != OP_UNEQUAL)
+				indexed++;
+		}
+	}
+
+	if (indexed < 2)
+		return;
+
+	IndexStatistics* statistics = new(std::nothrow) IndexStatistics;
+	if (statistics == NULL)
+		return;
+
+	Equation<QueryPolicy>* equation;
+	while (equations.Pop(&equation))
+		equation->EstimateCardinality(fIndex, *statistics);
+
+	delete statistics;
+}
+
+
 template<typename QueryPolicy>
 status_t
 Query<QueryPolicy>::GetNextEntry(struct dirent* dirent, size_t size)
@@ -1695,12 +2351,28 @@ Query<QueryPolicy>::_GetNextEntry(struct dirent* dirent, size_t size)
 			QUERY_RETURN_ERROR(B_ERROR);
 
 		status_t status = fCurrent->GetNextMatching(fContext, fIterator, dirent,
-			size);
+			size, fDeduplicate && fReturned.Count() > 0 ? &fReturned : NULL);
 		if (status != B_OK) {
 			QueryPolicy::IndexIteratorDelete(fIterator);
 			fIterator = NULL;
 			fCurrent = NULL;
+
+			if (fDeduplicate) {
+				// merge the entries of this equation with the previous ones
+				fReturnedByCurrent.Sort();
+				if (fReturned.MergeWith(fReturnedByCurrent, kMaxFilterEntries)
+						!= B_OK) {
+					fDeduplicate = false;
+				}
+				fReturnedByCurrent.MakeEmpty();
+			}
 		} else {
+			if (fDeduplicate && fReturnedByCurrent.Add(dirent->d_ino,
+					kMaxFilterEntries) != B_OK) {
+				// too many to remember
+				fDeduplicate = false;
+			}
+
 			// only return if we have another entry
 			return B_OK;
 		}
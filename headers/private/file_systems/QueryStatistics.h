@@ -0,0 +1,335 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _FILE_SYSTEMS_QUERY_STATISTICS_H
+#define _FILE_SYSTEMS_QUERY_STATISTICS_H
+
+
+/*!	Index statistics used by the query planner. */
+
+
+#ifdef FS_SHELL
+#	include "fssh_api_wrapper.h"
+#else
+#	include <string.h>
+
+#	include <SupportDefs.h>
+#	include <TypeConstants.h>
+#endif	// !FS_SHELL
+
+#include <file_systems/QueryParserUtils.h>
+
+
+namespace QueryParser {
+
+
+/*!	Cardinality and value distribution of an index.
+
+	The statistics are gathered by feeding all keys of the index in order to
+	AddKey(). They keep every n-th key as a sample, doubling n whenever the
+	sample array fills up, so that in the end the samples split the index
+	into between kBucketCount and twice as many buckets holding the same
+	number of entries each (an equi-depth histogram).
+	Afterwards, the index reports its changes via KeyAdded() and
+	KeyRemoved(), which keep the number of entries of each bucket up to date;
+	only the bucket boundaries, and the number of distinct keys, age.
+	Only the first kMaxKeyLength bytes of a key are kept; longer string keys
+	are therefore estimated by their prefix.
+*/
+class IndexStatistics {
+public:
+	static	const int32			kBucketCount = 32;
+	static	const size_t		kMaxKeyLength = 32;
+
+public:
+								IndexStatistics()
+								{
+									Reset(0);
+								}
+
+			void				Reset(type_code type)
+								{
+									fType = type;
+									fValid = false;
+									fEntryCount = 0;
+									fDistinctCount = 0;
+									fStride = 1;
+									fNextSample = 0;
+									fSampleCount = 0;
+									fBuildEntryCount = 0;
+									fChangeCount = 0;
+								}
+
+			void				AddKey(const void* key, size_t length,
+									bool isNewKey);
+			void				Finish();
+
+			void				KeyAdded(const void* key, size_t length);
+			void				KeyRemoved(const void* key, size_t length);
+
+			bool				IsValid() const		{ return fValid; }
+			bool				IsStale(type_code type) const;
+
+			type_code			Type() const		{ return fType; }
+			int64				EntryCount() const	{ return fEntryCount; }
+			int64				DistinctCount() const
+									{ return fDistinctCount; }
+			int32				SampleCount() const	{ return fSampleCount; }
+
+			int64				EstimateEqual(const void* key,
+									size_t length) const;
+			int64				EstimateLess(const void* key, size_t length,
+									bool orEqual) const;
+			int64				EstimatePrefix(const char* prefix,
+									size_t length) const;
+
+private:
+			struct Sample {
+				union {
+					int64		alignment;
+					uint8		key[kMaxKeyLength];
+				};
+				uint16			length;
+			};
+
+			int32				_CountSamplesBelow(const void* key,
+									size_t length, bool orEqual) const;
+			int32				_BucketFor(const void* key,
+									size_t length) const;
+			int64				_EntriesBelow(int32 samples) const;
+
+private:
+			type_code			fType;
+			bool				fValid;
+			int64				fEntryCount;
+			int64				fDistinctCount;
+			int64				fStride;
+			int64				fNextSample;
+			int32				fSampleCount;
+			int64				fBuildEntryCount;
+			int64				fChangeCount;
+			Sample				fSamples[kBucketCount * 2];
+			int64				fBucketEntries[kBucketCount * 2];
+};
+
+
+inline void
+IndexStatistics::AddKey(const void* key, size_t length, bool isNewKey)
+{
+	if (fEntryCount == fNextSample) {
+		Sample& sample = fSamples[fSampleCount++];
+		sample.length = length < kMaxKeyLength ? length : kMaxKeyLength;
+		memset(sample.key, 0, sizeof(sample.key));
+		memcpy(sample.key, key, sample.length);
+
+		if (fSampleCount == kBucketCount * 2) {
+			// keep every other sample
+			for (int32 i = 1; i < kBucketCount; i++)
+				fSamples[i] = fSamples[i * 2];
+			fSampleCount = kBucketCount;
+			fStride *= 2;
+		}
+		fNextSample = fSampleCount * fStride;
+	}
+
+	fEntryCount++;
+	if (isNewKey)
+		fDistinctCount++;
+}
+
+
+/*!	Is called after the last key has been added. Every sample starts a
+	bucket of fStride entries, except for the last one, which holds the rest.
+*/
+inline void
+IndexStatistics::Finish()
+{
+	for (int32 i = 0; i < fSampleCount; i++)
+		fBucketEntries[i] = fStride;
+	if (fSampleCount > 0) {
+		fBucketEntries[fSampleCount - 1]
+			= fEntryCount - (fSampleCount - 1) * fStride;
+	}
+
+	fBuildEntryCount = fEntryCount;
+	fChangeCount = 0;
+	fValid = true;
+}
+
+
+inline void
+IndexStatistics::KeyAdded(const void* key, size_t length)
+{
+	if (!fValid)
+		return;
+
+	int32 bucket = _BucketFor(key, length);
+	if (bucket >= 0)
+		fBucketEntries[bucket]++;
+
+	fEntryCount++;
+	if (fDistinctCount == 0)
+		fDistinctCount = 1;
+	fChangeCount++;
+}
+
+
+inline void
+IndexStatistics::KeyRemoved(const void* key, size_t length)
+{
+	if (!fValid)
+		return;
+
+	int32 bucket = _BucketFor(key, length);
+	if (bucket >= 0 && fBucketEntries[bucket] > 0)
+		fBucketEntries[bucket]--;
+
+	if (fEntryCount > 0)
+		fEntryCount--;
+	if (fDistinctCount > fEntryCount)
+		fDistinctCount = fEntryCount;
+	fChangeCount++;
+}
+
+
+/*!	Since the bucket sizes are kept up to date, the statistics only need to
+	be rebuilt when the index changed so much that the bucket boundaries no
+	longer split it well. Waiting for as many changes as half the entries the
+	statistics were built from means that rebuilding them costs at most a
+	few index entries read per change.
+*/
+inline bool
+IndexStatistics::IsStale(type_code type) const
+{
+	if (!fValid || type != fType)
+		return true;
+
+	return fChangeCount > (fBuildEntryCount + kBucketCount) / 2;
+}
+
+
+/*!	Returns the number of samples that are less than (or equal to, if
+	\a orEqual is \c true) the given key.
+*/
+inline int32
+IndexStatistics::_CountSamplesBelow(const void* key, size_t length,
+	bool orEqual) const
+{
+	union {
+		int64	alignment;
+		uint8	buffer[kMaxKeyLength];
+	} truncated;
+	if (length > kMaxKeyLength)
+		length = kMaxKeyLength;
+	memset(truncated.buffer, 0, sizeof(truncated.buffer));
+	memcpy(truncated.buffer, key, length);
+
+	// the samples are sorted, so we can use a binary search
+	int32 lower = 0;
+	int32 upper = fSampleCount;
+	while (lower < upper) {
+		int32 middle = (lower + upper) / 2;
+		int compare = compareKeys(fType, fSamples[middle].key,
+			fSamples[middle].length, truncated.buffer, length);
+		if (compare < 0 || (orEqual && compare == 0))
+			lower = middle + 1;
+		else
+			upper = middle;
+	}
+
+	return lower;
+}
+
+
+/*!	Returns the bucket a key added to or removed from the index belongs
+	to, or -1 if there is none yet.
+*/
+inline int32
+IndexStatistics::_BucketFor(const void* key, size_t length) const
+{
+	if (fSampleCount == 0)
+		return -1;
+
+	int32 samples = _CountSamplesBelow(key, length, true);
+	return samples > 0 ? samples - 1 : 0;
+}
+
+
+/*!	Estimates the number of entries in front of the key that is greater
+	than the given number of samples. The key lies somewhere in the bucket
+	of the last sample below it; we assume its middle.
+*/
+inline int64
+IndexStatistics::_EntriesBelow(int32 samples) const
+{
+	if (samples == 0)
+		return 0;
+
+	int64 entries = 0;
+	for (int32 i = 0; i < samples - 1; i++)
+		entries += fBucketEntries[i];
+
+	return entries + (fBucketEntries[samples - 1] + 1) / 2;
+}
+
+
+inline int64
+IndexStatistics::EstimateLess(const void* key, size_t length,
+	bool orEqual) const
+{
+	return _EntriesBelow(_CountSamplesBelow(key, length, orEqual));
+}
+
+
+inline int64
+IndexStatistics::EstimateEqual(const void* key, size_t length) const
+{
+	if (fDistinctCount == 0)
+		return 0;
+
+	// Assume the keys are evenly distributed, unless the key is frequent
+	// enough to show up in several samples.
+	int64 estimate = (fEntryCount + fDistinctCount - 1) / fDistinctCount;
+
+	int32 first = _CountSamplesBelow(key, length, false);
+	int32 last = _CountSamplesBelow(key, length, true);
+	if (last - first > 1) {
+		int64 entries = 0;
+		for (int32 i = first; i < last; i++)
+			entries += fBucketEntries[i];
+		if (entries > estimate)
+			estimate = entries;
+	}
+
+	return estimate;
+}
+
+
+/*!	Estimates the number of string keys that start with the given prefix.
+*/
+inline int64
+IndexStatistics::EstimatePrefix(const char* prefix, size_t length) const
+{
+	if (length == 0)
+		return fEntryCount;
+	if (length > kMaxKeyLength)
+		length = kMaxKeyLength;
+
+	// All keys with the prefix are less than the prefix with its last
+	// character incremented.
+	char end[kMaxKeyLength];
+	memcpy(end, prefix, length);
+	if ((uint8)end[length - 1] == 0xff)
+		return fEntryCount - EstimateLess(prefix, length, false);
+	end[length - 1]++;
+
+	return EstimateLess(end, length, false)
+		- EstimateLess(prefix, length, false);
+}
+
+
+}	// namespace QueryParser
+
+
+#endif	// _FILE_SYSTEMS_QUERY_STATISTICS_H
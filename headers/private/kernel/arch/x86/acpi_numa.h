@@ -0,0 +1,12 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_ARCH_x86_ACPI_NUMA_H
+#define _KERNEL_ARCH_x86_ACPI_NUMA_H
+
+#include <SupportDefs.h>
+
+void acpi_numa_init();
+
+#endif // _KERNEL_ARCH_x86_ACPI_NUMA_H
@@ -14,6 +14,7 @@
 #include <thread_types.h>
 
 
+struct scheduler_core_stats;
 struct scheduling_analysis;
 struct SchedulerListener;
 
@@ -88,6 +89,7 @@ void scheduler_init(void);
 status_t scheduler_loadavg_init();
 void scheduler_enable_scheduling(void);
 void scheduler_update_policy(void);
+void scheduler_update_numa_topology(void);
 
 bigtime_t _user_estimate_max_scheduling_latency(thread_id thread);
 status_t _user_analyze_scheduling(bigtime_t from, bigtime_t until, void* buffer,
@@ -95,6 +97,8 @@ status_t _user_analyze_scheduling(bigtime_t from, bigtime_t until, void* buffer,
 
 status_t _user_set_scheduler_mode(int32 mode);
 int32 _user_get_scheduler_mode(void);
+ssize_t _user_get_scheduler_core_stats(struct scheduler_core_stats* stats,
+	size_t size);
 
 status_t _user_get_loadavg(struct loadavg* info, size_t size);
 
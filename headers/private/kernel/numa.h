@@ -0,0 +1,44 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_NUMA_H
+#define _KERNEL_NUMA_H
+
+
+#include <SupportDefs.h>
+
+
+#define NUMA_MAX_NODES			8
+#define NUMA_LOCAL_DISTANCE		10
+	// distance of a node to itself, as defined by the ACPI SLIT
+#define NUMA_REMOTE_DISTANCE	20
+	// distance assumed between different nodes, if the firmware doesn't say
+
+
+typedef struct numa_memory_range {
+	phys_addr_t	start;
+	phys_addr_t	end;
+	int32		node;
+} numa_memory_range;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+status_t numa_set_topology(int32 nodeCount, const numa_memory_range* ranges,
+	int32 rangeCount, const int32* cpuNodes, const uint8* distances);
+
+int32 numa_node_count(void);
+int32 numa_cpu_node(int32 cpu);
+int32 numa_physical_page_node(phys_addr_t pageNumber);
+int32 numa_node_distance(int32 from, int32 to);
+const int32* numa_nodes_by_distance(int32 node);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/* _KERNEL_NUMA_H */
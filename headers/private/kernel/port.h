@@ -10,6 +10,7 @@
 #include <iovec.h>
 
 struct kernel_args;
+struct port_stats;
 struct select_info;
 
 
@@ -70,6 +71,8 @@ status_t	_user_writev_port_etc(port_id id, int32 msgCode,
 status_t	_user_get_port_message_info_etc(port_id port,
 				port_message_info *info, size_t infoSize, uint32 flags,
 				bigtime_t timeout);
+status_t	_user_get_port_stats(port_id port, struct port_stats *stats,
+				size_t statsSize);
 
 #ifdef __cplusplus
 }
@@ -13,15 +13,31 @@
 
 struct DepotMagazine;
 
+typedef struct object_depot_stats {
+	uint64	hits;				// objects obtained from a magazine
+	uint64	misses;				// obtains that had to go to the slab
+	uint64	stores;				// objects stored in a magazine
+	uint64	store_misses;		// stores that had to go to the slab
+	uint64	exchanges;			// magazines exchanged with the depot
+	uint64	contention;			// retried depot stack operations
+	uint32	magazine_capacity;
+	uint32	full_magazines;
+} object_depot_stats;
+
 typedef struct object_depot {
 	rw_lock					outer_lock;
-	spinlock				inner_lock;
-	DepotMagazine*			full;
-	DepotMagazine*			empty;
-	size_t					full_count;
-	size_t					empty_count;
+	int64					full;
+	int64					empty;
+		// lock-free stacks of DepotMagazines, the pointer is tagged with a
+		// generation count
+	int32					full_count;
+	int32					empty_count;
 	size_t					max_count;
 	size_t					magazine_capacity;
+	size_t					min_magazine_capacity;
+	size_t					max_magazine_capacity;
+	int32					contention;
+	int32					magazine_allocations;
 	struct depot_cpu_store*	stores;
 	void*					cookie;
 
@@ -45,6 +61,8 @@ void object_depot_store(object_depot* depot, void* object, uint32 flags);
 
 void object_depot_make_empty(object_depot* depot, uint32 flags);
 
+void object_depot_get_stats(object_depot* depot, object_depot_stats* stats);
+
 #if PARANOID_KERNEL_FREE
 bool object_depot_contains_object(object_depot* depot, void* object);
 #endif
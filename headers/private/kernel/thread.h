@@ -83,6 +83,7 @@ void thread_at_kernel_entry(bigtime_t now);
 void thread_at_kernel_exit(void);
 void thread_at_kernel_exit_no_signals(void);
 void thread_reset_for_exec(void);
+void thread_publish_cpu_time(Thread* thread);
 
 status_t thread_init(struct kernel_args *args);
 status_t thread_preboot_init_percpu(struct kernel_args *args, int32 cpuNum);
@@ -285,6 +285,11 @@ struct Thread : TeamThreadIteratorEntry<thread_id>, KernelReferenceable {
 	} msg;	// write_sem/read_sem are protected by fLock when accessed by
 			// others, the other fields are protected by write_sem/read_sem
 
+	struct {
+		int32		count;		// contended PI user mutexes owned
+		int32		priority;	// priority before the first boost
+	} user_mutex_pi;	// protected by the user mutex PI lock
+
 	void			(*fault_handler)(void);
 	jmp_buf			fault_handler_state;
 	int16			page_faults_allowed;
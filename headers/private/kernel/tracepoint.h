@@ -0,0 +1,40 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _KERNEL_TRACEPOINT_H
+#define _KERNEL_TRACEPOINT_H
+
+
+#include <sys/cdefs.h>
+
+#include <OS.h>
+
+#include <tracepoint_defs.h>
+
+
+/*!	Records an event in the tracepoint ring of the current CPU, if its
+	category is being recorded. Costs a single load and branch otherwise.
+*/
+#define TRACEPOINT(category, event, arg0, arg1) \
+	do { \
+		if (__builtin_expect((gTracepointCategories & (category)) != 0, 0)) { \
+			tracepoint_record_event((event), (uint64)(arg0), \
+				(uint64)(arg1)); \
+		} \
+	} while (0)
+
+
+__BEGIN_DECLS
+
+extern uint32 gTracepointCategories;
+
+void tracepoint_record_event(uint16 event, uint64 arg0, uint64 arg1);
+
+status_t _user_tracepoint_start(struct tracepoint_parameters* parameters);
+status_t _user_tracepoint_stop(void);
+
+__END_DECLS
+
+
+#endif	/* _KERNEL_TRACEPOINT_H */
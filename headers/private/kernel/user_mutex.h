@@ -23,6 +23,8 @@ status_t	_user_mutex_lock(int32* mutex, const char* name, uint32 flags,
 status_t	_user_mutex_unblock(int32* mutex, uint32 flags);
 status_t	_user_mutex_switch_lock(int32* fromMutex, uint32 fromFlags,
 				int32* toMutex, const char* name, uint32 toFlags, bigtime_t timeout);
+status_t	_user_mutex_requeue(int32* fromMutex, uint32 fromFlags,
+				int32* toMutex, uint32 toFlags);
 status_t	_user_mutex_sem_acquire(int32* sem, const char* name, uint32 flags,
 				bigtime_t timeout);
 status_t	_user_mutex_sem_release(int32* sem, uint32 flags);
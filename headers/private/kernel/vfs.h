@@ -31,6 +31,10 @@
 
 #define B_UNMOUNT_BUSY_PARTITION	0x80000000
 
+/* ioctl sent to the file system of a regular file before the file is mapped
+   shared and possibly writable, see vfs_prepare_writable_mapping() */
+#define B_PREPARE_WRITABLE_MAPPING	0x80000001
+
 struct attr_info;
 struct file_descriptor;
 struct generic_io_vec;
@@ -99,6 +103,7 @@ void		vfs_put_vnode(struct vnode *vnode);
 void		vfs_acquire_vnode(struct vnode *vnode);
 status_t	vfs_get_cookie_from_fd(int fd, void **_cookie);
 bool		vfs_can_page(struct vnode *vnode, void *cookie);
+status_t	vfs_prepare_writable_mapping(int fd, bool kernel);
 status_t	vfs_read_pages(struct vnode *vnode, void *cookie, off_t pos,
 				const struct generic_io_vec *vecs, size_t count, uint32 flags,
 				generic_size_t *_numBytes);
@@ -245,6 +250,10 @@ ssize_t		_user_readv(int fd, off_t pos, const iovec *vecs, size_t count);
 ssize_t		_user_write(int fd, off_t pos, const void *buffer,
 				size_t bufferSize);
 ssize_t		_user_writev(int fd, off_t pos, const iovec *vecs, size_t count);
+ssize_t		_user_splice(int inFD, off_t *inOffset, int outFD,
+				off_t *outOffset, size_t length, uint32 flags);
+ssize_t		_user_copy_file_range(int inFD, off_t *inOffset, int outFD,
+				off_t *outOffset, size_t length, uint32 flags);
 status_t	_user_ioctl(int fd, uint32 cmd, void *data, size_t length);
 ssize_t		_user_read_dir(int fd, struct dirent *buffer, size_t bufferSize,
 				uint32 maxCount);
@@ -18,6 +18,9 @@
 struct kernel_args;
 struct vm_page_reservation;
 
+extern int32 gMappedLargePagesCount;
+extern int32 gSplitLargePagesCount;
+
 
 struct VMTranslationMap {
 			struct ReverseMappingInfoCallback;
@@ -39,6 +42,12 @@ public:
 									vm_page_reservation* reservation) = 0;
 	virtual	status_t			Unmap(addr_t start, addr_t end) = 0;
 
+	virtual	size_t				LargePageSize() const;
+	virtual	status_t			MapLargePage(addr_t virtualAddress,
+									phys_addr_t physicalAddress,
+									uint32 attributes, uint32 memoryType,
+									vm_page_reservation* reservation);
+
 	virtual	status_t			DebugMarkRangePresent(addr_t start, addr_t end,
 									bool markPresent);
 
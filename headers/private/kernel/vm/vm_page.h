@@ -39,6 +39,7 @@ void vm_page_init_num_pages(struct kernel_args *args);
 status_t vm_page_init(struct kernel_args *args);
 status_t vm_page_init_post_area(struct kernel_args *args);
 status_t vm_page_init_post_thread(struct kernel_args *args);
+void vm_page_init_numa(void);
 
 status_t vm_mark_page_inuse(page_num_t page);
 status_t vm_mark_page_range_inuse(page_num_t startPage, page_num_t length);
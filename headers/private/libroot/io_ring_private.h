@@ -0,0 +1,171 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _LIBROOT_IO_RING_PRIVATE_H
+#define _LIBROOT_IO_RING_PRIVATE_H
+
+
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <OS.h>
+#include <io_ring_defs.h>
+
+
+typedef struct io_ring {
+	int				fd;
+	area_id			area;
+	io_ring_header*	header;
+	io_ring_sqe*	submissions;
+	io_ring_cqe*	completions;
+	uint32			submission_mask;
+	uint32			completion_mask;
+	uint32			submission_tail;	/* including unsubmitted entries */
+} io_ring;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+status_t	io_ring_init(io_ring* ring, uint32 entries);
+void		io_ring_destroy(io_ring* ring);
+
+io_ring_sqe* io_ring_get_sqe(io_ring* ring);
+int32		io_ring_submit(io_ring* ring);
+int32		io_ring_submit_and_wait(io_ring* ring, uint32 wait);
+
+status_t	io_ring_peek_cqe(io_ring* ring, io_ring_cqe** _completion);
+status_t	io_ring_wait_cqe(io_ring* ring, io_ring_cqe** _completion,
+				uint32 flags, bigtime_t timeout);
+void		io_ring_cqe_seen(io_ring* ring, io_ring_cqe* completion);
+
+
+static inline void
+io_ring_prep_rw(io_ring_sqe* entry, uint8 op, int fd, const void* address,
+	uint32 length, off_t offset)
+{
+	memset(entry, 0, sizeof(io_ring_sqe));
+	entry->op = op;
+	entry->fd = fd;
+	entry->address = (addr_t)address;
+	entry->length = length;
+	entry->offset = offset;
+}
+
+
+static inline void
+io_ring_prep_nop(io_ring_sqe* entry)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_NOP, -1, NULL, 0, 0);
+}
+
+
+static inline void
+io_ring_prep_read(io_ring_sqe* entry, int fd, void* buffer, uint32 length,
+	off_t offset)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_READ, fd, buffer, length, offset);
+}
+
+
+static inline void
+io_ring_prep_write(io_ring_sqe* entry, int fd, const void* buffer,
+	uint32 length, off_t offset)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_WRITE, fd, buffer, length, offset);
+}
+
+
+static inline void
+io_ring_prep_readv(io_ring_sqe* entry, int fd, const struct iovec* vecs,
+	uint32 count, off_t offset)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_READV, fd, vecs, count, offset);
+}
+
+
+static inline void
+io_ring_prep_writev(io_ring_sqe* entry, int fd, const struct iovec* vecs,
+	uint32 count, off_t offset)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_WRITEV, fd, vecs, count, offset);
+}
+
+
+static inline void
+io_ring_prep_fsync(io_ring_sqe* entry, int fd, uint32 flags)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_FSYNC, fd, NULL, 0, 0);
+	entry->op_flags = flags;
+}
+
+
+static inline void
+io_ring_prep_openat(io_ring_sqe* entry, int dirFD, const char* path,
+	int openMode, mode_t permissions)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_OPENAT, dirFD, path, permissions, 0);
+	entry->op_flags = openMode;
+}
+
+
+static inline void
+io_ring_prep_close(io_ring_sqe* entry, int fd)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_CLOSE, fd, NULL, 0, 0);
+}
+
+
+static inline void
+io_ring_prep_accept(io_ring_sqe* entry, int fd, struct sockaddr* address,
+	socklen_t* _addressLength, int flags)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_ACCEPT, fd, address, 0, 0);
+	entry->address2 = (addr_t)_addressLength;
+	entry->op_flags = flags;
+}
+
+
+static inline void
+io_ring_prep_connect(io_ring_sqe* entry, int fd,
+	const struct sockaddr* address, socklen_t addressLength)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_CONNECT, fd, address, addressLength, 0);
+}
+
+
+static inline void
+io_ring_prep_send(io_ring_sqe* entry, int fd, const void* buffer,
+	uint32 length, int flags)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_SEND, fd, buffer, length, 0);
+	entry->op_flags = flags;
+}
+
+
+static inline void
+io_ring_prep_recv(io_ring_sqe* entry, int fd, void* buffer, uint32 length,
+	int flags)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_RECV, fd, buffer, length, 0);
+	entry->op_flags = flags;
+}
+
+
+static inline void
+io_ring_prep_timeout(io_ring_sqe* entry, bigtime_t timeout)
+{
+	io_ring_prep_rw(entry, IO_RING_OP_TIMEOUT, -1, NULL, 0, timeout);
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif	/* _LIBROOT_IO_RING_PRIVATE_H */
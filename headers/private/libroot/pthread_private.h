@@ -20,7 +20,8 @@
 #define THREAD_CANCEL_ASYNCHRONOUS	0x10
 
 // _pthread_mutex::flags values
-#define MUTEX_FLAG_SHARED	0x80000000
+#define MUTEX_FLAG_SHARED		0x80000000
+#define MUTEX_FLAG_PRIO_INHERIT	0x40000000
 
 
 struct thread_creation_attributes;
@@ -38,6 +39,7 @@ typedef struct _pthread_condattr {
 typedef struct _pthread_mutexattr {
 	int32		type;
 	bool		process_shared;
+	int32		protocol;
 } pthread_mutexattr;
 
 typedef struct _pthread_barrierattr {
@@ -152,6 +152,11 @@ typedef struct image_t {
 	// thread-local storage
 	unsigned			dso_tls_id;
 
+	// identifies the file the image has been loaded from
+	dev_t				device;
+	ino_t				node;
+	bigtime_t			modification_time;
+
 #ifdef __cplusplus
 	elf_sym*			(*find_undefined_symbol)(struct image_t* rootImage,
 							struct image_t* image,
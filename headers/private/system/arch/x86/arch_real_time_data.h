@@ -13,7 +13,7 @@
 struct arch_real_time_data {
 	bigtime_t	system_time_offset;
 	uint32		system_time_conversion_factor;
-	uint32		_padding;
+	int32		version;		// odd while system_time_offset is updated
 };
 
 #endif	/* _KERNEL_ARCH_REAL_TIME_DATA_H */
@@ -31,6 +31,7 @@
 #define kSystemAddonsDirectory 			"/boot/system/add-ons"
 #define kSystemAppsDirectory 			"/boot/system/apps"
 #define kSystemBinDirectory 			"/boot/system/bin"
+#define kSystemCacheDirectory 			"/boot/system/cache"
 #define kSystemDataDirectory 			"/boot/system/data"
 #define kSystemDevelopDirectory 		"/boot/system/develop"
 #define kSystemLibDirectory 			"/boot/system/lib"
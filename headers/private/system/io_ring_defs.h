@@ -0,0 +1,90 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_IO_RING_DEFS_H
+#define _SYSTEM_IO_RING_DEFS_H
+
+
+#include <OS.h>
+
+
+#define IO_RING_MAX_ENTRIES		4096
+
+
+/* operations */
+enum {
+	IO_RING_OP_NOP			= 0,
+	IO_RING_OP_READ,		/* fd, address, length, offset */
+	IO_RING_OP_WRITE,		/* fd, address, length, offset */
+	IO_RING_OP_READV,		/* fd, address (iovec*), length (count), offset */
+	IO_RING_OP_WRITEV,		/* fd, address (iovec*), length (count), offset */
+	IO_RING_OP_FSYNC,		/* fd, op_flags (IO_RING_FSYNC_*) */
+	IO_RING_OP_OPENAT,		/* fd (dir), address (path), op_flags (open mode),
+							   length (permissions) */
+	IO_RING_OP_CLOSE,		/* fd */
+	IO_RING_OP_ACCEPT,		/* fd, address (sockaddr*), address2 (socklen_t*),
+							   op_flags (SOCK_*) */
+	IO_RING_OP_CONNECT,		/* fd, address (sockaddr*), length */
+	IO_RING_OP_SEND,		/* fd, address, length, op_flags (MSG_*) */
+	IO_RING_OP_RECV,		/* fd, address, length, op_flags (MSG_*) */
+	IO_RING_OP_TIMEOUT,		/* offset (relative timeout in microseconds) */
+
+	IO_RING_OP_COUNT
+};
+
+/* io_ring_sqe::flags */
+#define IO_RING_SQE_ASYNC		0x01	/* always execute in a worker thread */
+
+/* io_ring_sqe::op_flags for IO_RING_OP_FSYNC */
+#define IO_RING_FSYNC_DATASYNC	0x01
+
+/* _kern_io_ring_enter() flags, in addition to B_{RELATIVE,ABSOLUTE}_TIMEOUT */
+#define IO_RING_ENTER_WAIT		0x10000000
+
+
+/* submission queue entry */
+typedef struct io_ring_sqe {
+	uint8		op;
+	uint8		flags;
+	uint16		reserved;
+	int32		fd;
+	int64		offset;			/* -1 for the current file position */
+	uint64		address;
+	uint64		address2;
+	uint32		length;
+	uint32		op_flags;
+	uint64		user_data;
+} io_ring_sqe;
+
+/* completion queue entry */
+typedef struct io_ring_cqe {
+	uint64		user_data;
+	int64		result;			/* as returned by the equivalent syscall */
+} io_ring_cqe;
+
+
+/* The shared memory starts with this header, the entries follow at the given
+   offsets. The kernel only writes sq_head and cq_tail, userland only sq_tail
+   and cq_head; all of them must be accessed atomically. */
+typedef struct io_ring_header {
+	uint32		sq_head;
+	uint32		sq_tail;
+	uint32		cq_head;
+	uint32		cq_tail;
+	uint32		sq_entries;
+	uint32		cq_entries;
+	uint32		sq_offset;
+	uint32		cq_offset;
+	uint32		dropped;		/* completions lost to a full queue */
+	uint32		reserved[7];
+} io_ring_header;
+
+
+typedef struct io_ring_params {
+	area_id		area;			/* the userland clone of the ring memory */
+	void*		address;
+} io_ring_params;
+
+
+#endif	/* _SYSTEM_IO_RING_DEFS_H */
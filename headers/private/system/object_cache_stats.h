@@ -0,0 +1,47 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_OBJECT_CACHE_STATS_H
+#define _SYSTEM_OBJECT_CACHE_STATS_H
+
+#include <OS.h>
+
+
+#define OBJECT_CACHE_SYSCALLS		"object caches"
+#define GET_OBJECT_CACHE_STATS		0x01
+
+
+typedef struct object_cache_stats {
+	char		name[32];
+	uint64		object_size;
+	uint64		used_objects;
+	uint64		total_objects;
+	uint64		usage;				/* memory used by the slabs */
+
+	/* per-CPU magazine layer */
+	uint64		depot_hits;			/* allocations served by a magazine */
+	uint64		depot_misses;		/* allocations that went to the slabs */
+	uint64		depot_stores;		/* frees that went into a magazine */
+	uint64		depot_store_misses;	/* frees that went to the slabs */
+	uint64		magazine_exchanges;	/* magazines exchanged with the depot */
+	uint64		depot_contention;	/* retried depot operations */
+	uint32		magazine_capacity;
+	uint32		full_magazines;
+
+	/* slab layer */
+	uint64		slab_allocations;
+	uint64		slab_frees;
+	uint64		contended_locks;
+	bigtime_t	lock_wait_time;
+} object_cache_stats;
+
+
+typedef struct object_cache_stats_request {
+	object_cache_stats*	stats;
+	uint32				count;
+		/* in: the number of entries in stats, out: the number of caches */
+} object_cache_stats_request;
+
+
+#endif	/* _SYSTEM_OBJECT_CACHE_STATS_H */
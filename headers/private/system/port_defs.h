@@ -0,0 +1,22 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_PORT_DEFS_H
+#define _SYSTEM_PORT_DEFS_H
+
+
+#include <SupportDefs.h>
+
+
+typedef struct port_stats {
+	uint64	bytes_written;
+	uint64	bytes_read;
+	uint32	shared_messages;	// messages read from the writer's pages
+	uint32	read_waits;			// times a reader had to wait for a message
+	uint32	write_waits;		// times a writer had to wait for a free slot
+	uint32	lock_contention;	// times the port's lock was already held
+} port_stats;
+
+
+#endif	/* _SYSTEM_PORT_DEFS_H */
@@ -68,4 +68,16 @@ struct loadavg {
 };
 
 
+struct scheduler_core_stats {
+	int32		core;
+	int32		package;
+	int32		cpu_count;
+	int32		queue_depth;		// threads waiting in the core's run queue
+	int32		load;				// 0 - 1000
+	int64		steals;				// threads taken from other cores
+	int64		stolen;				// threads taken by other cores
+	int64		cache_hot_skips;	// threads not taken, their cache was hot
+};
+
+
 #endif	/* _SYSTEM_SCHEDULER_DEFS_H */
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_SPAWN_DEFS_H
+#define _SYSTEM_SPAWN_DEFS_H
+
+
+#include <signal.h>
+
+#include <SupportDefs.h>
+
+
+#define MAX_SPAWN_ARGS_SIZE		(64 * 1024)
+
+enum {
+	SPAWN_FILE_ACTION_OPEN		= 0,
+	SPAWN_FILE_ACTION_CLOSE,
+	SPAWN_FILE_ACTION_DUP2,
+	SPAWN_FILE_ACTION_CHDIR,
+	SPAWN_FILE_ACTION_FCHDIR
+};
+
+typedef struct spawn_file_action {
+	int32	type;
+	int32	fd;
+	int32	source_fd;		// SPAWN_FILE_ACTION_DUP2
+	int32	open_mode;		// SPAWN_FILE_ACTION_OPEN
+	mode_t	permissions;	// SPAWN_FILE_ACTION_OPEN
+	uint32	path_offset;	// from the start of the spawn_args block
+} spawn_file_action;
+
+/*!	The posix_spawn() attributes and file actions in a form the kernel can
+	apply to the new team before its image is loaded. The paths of the file
+	actions follow the action array; the whole block is \c size bytes long.
+*/
+typedef struct spawn_args {
+	uint32				size;
+	uint32				flags;			// POSIX_SPAWN_* flags
+	pid_t				process_group;
+	sigset_t			signal_mask;
+	sigset_t			default_signals;
+	uint32				action_count;
+	spawn_file_action	actions[0];
+} spawn_args;
+
+
+#endif	/* _SYSTEM_SPAWN_DEFS_H */
@@ -28,19 +28,24 @@ struct fd_info;
 struct fd_set;
 struct fs_info;
 struct iovec;
+struct io_ring_params;
 struct loadavg;
 struct msqid_ds;
 struct net_stat;
 struct pollfd;
+struct port_stats;
 struct rlimit;
+struct scheduler_core_stats;
 struct scheduling_analysis;
 struct _sem_t;
 struct sembuf;
 union semun;
 struct sigaction;
 struct signal_frame_data;
+struct spawn_args;
 struct stat;
 struct system_profiler_parameters;
+struct tracepoint_parameters;
 struct user_timer_info;
 
 struct disk_device_job_progress_info;
@@ -82,6 +87,11 @@ extern status_t		_kern_event_queue_select(int queue,
 extern ssize_t		_kern_event_queue_wait(int queue, struct event_wait_info* infos,
 						int numInfos, uint32 flags, bigtime_t timeout);
 
+extern int			_kern_io_ring_create(uint32 entries, uint32 flags,
+						struct io_ring_params* params);
+extern int32		_kern_io_ring_enter(int ring, uint32 submit, uint32 wait,
+						uint32 flags, bigtime_t timeout);
+
 /* user mutex functions */
 extern status_t		_kern_mutex_lock(int32* mutex, const char* name,
 						uint32 flags, bigtime_t timeout);
@@ -89,6 +99,8 @@ extern status_t		_kern_mutex_unblock(int32* mutex, uint32 flags);
 extern status_t		_kern_mutex_switch_lock(int32* fromMutex, uint32 fromFlags,
 						int32* toMutex, const char* name, uint32 toFlags,
 						bigtime_t timeout);
+extern status_t		_kern_mutex_requeue(int32* fromMutex, uint32 fromFlags,
+						int32* toMutex, uint32 toFlags);
 extern status_t		_kern_mutex_sem_acquire(int32* sem, const char* name,
 						uint32 flags, bigtime_t timeout);
 extern status_t		_kern_mutex_sem_release(int32* sem, uint32 flags);
@@ -146,6 +158,10 @@ extern thread_id	_kern_load_image(const char* const* flatArgs,
 						size_t flatArgsSize, int32 argCount, int32 envCount,
 						int32 priority, uint32 flags, port_id errorPort,
 						uint32 errorToken);
+extern thread_id	_kern_spawn_image(const char* const* flatArgs,
+						size_t flatArgsSize, int32 argCount, int32 envCount,
+						int32 priority, uint32 flags,
+						const struct spawn_args* spawnArgs);
 extern void __NO_RETURN _kern_exit_team(status_t returnValue);
 extern status_t		_kern_kill_team(team_id team);
 extern team_id		_kern_get_current_team();
@@ -213,6 +229,8 @@ extern bigtime_t	_kern_estimate_max_scheduling_latency(thread_id thread);
 
 extern status_t		_kern_set_scheduler_mode(int32 mode);
 extern int32		_kern_get_scheduler_mode(void);
+extern ssize_t		_kern_get_scheduler_core_stats(
+						struct scheduler_core_stats *stats, size_t size);
 extern status_t		_kern_get_loadavg(struct loadavg* info, size_t size);
 
 // user/group functions
@@ -338,6 +356,10 @@ extern ssize_t		_kern_write(int fd, off_t pos, const void *buffer,
 						size_t bufferSize);
 extern ssize_t		_kern_writev(int fd, off_t pos, const struct iovec *vecs,
 						size_t count);
+extern ssize_t		_kern_splice(int inFD, off_t *inOffset, int outFD,
+						off_t *outOffset, size_t length, uint32 flags);
+extern ssize_t		_kern_copy_file_range(int inFD, off_t *inOffset, int outFD,
+						off_t *outOffset, size_t length, uint32 flags);
 extern status_t		_kern_ioctl(int fd, uint32 cmd, void *data, size_t length);
 extern ssize_t		_kern_read_dir(int fd, struct dirent *buffer,
 						size_t bufferSize, uint32 maxCount);
@@ -493,6 +515,8 @@ extern status_t		_kern_writev_port_etc(port_id id, int32 msgCode,
 extern status_t		_kern_get_port_message_info_etc(port_id port,
 						port_message_info *info, size_t infoSize, uint32 flags,
 						bigtime_t timeout);
+extern status_t		_kern_get_port_stats(port_id port,
+						struct port_stats *stats, size_t statsSize);
 
 // debug support functions
 extern status_t		_kern_kernel_debugger(const char *message);
@@ -520,6 +544,10 @@ extern status_t		_kern_system_profiler_stop();
 extern status_t		_kern_system_profiler_recorded(
 						struct system_profiler_parameters* parameters);
 
+extern status_t		_kern_tracepoint_start(
+						struct tracepoint_parameters* parameters);
+extern status_t		_kern_tracepoint_stop(void);
+
 /* atomic_* ops (needed for CPUs that don't support them directly) */
 #ifdef ATOMIC_FUNCS_ARE_SYSCALLS
 extern void		_kern_atomic_set(int32 *value, int32 newValue);
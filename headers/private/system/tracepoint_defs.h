@@ -0,0 +1,115 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_TRACEPOINT_DEFS_H
+#define _SYSTEM_TRACEPOINT_DEFS_H
+
+
+#include <OS.h>
+
+
+struct tracepoint_parameters {
+	area_id		buffer_area;		// area the records will be written to
+	uint32		categories;			// B_TRACEPOINT_* categories to record
+	bigtime_t	sample_interval;	// for B_TRACEPOINT_SAMPLING
+};
+
+
+// categories
+enum {
+	B_TRACEPOINT_SCHEDULER		= 0x01,
+	B_TRACEPOINT_VM				= 0x02,
+	B_TRACEPOINT_VFS			= 0x04,
+	B_TRACEPOINT_BLOCK_CACHE	= 0x08,
+	B_TRACEPOINT_IO				= 0x10,
+	B_TRACEPOINT_NETWORK		= 0x20,
+	B_TRACEPOINT_SAMPLING		= 0x40,
+
+	B_TRACEPOINT_ALL			= 0x7f
+};
+
+
+// events and their arguments
+enum {
+	B_TRACEPOINT_THREAD_SWITCH = 1,		// previous thread, next thread
+	B_TRACEPOINT_THREAD_ENQUEUED,		// thread, priority
+
+	B_TRACEPOINT_PAGE_FAULT_BEGIN,		// address, write access
+	B_TRACEPOINT_PAGE_FAULT_END,		// address, error
+
+	B_TRACEPOINT_VFS_READ_BEGIN,		// FD, length
+	B_TRACEPOINT_VFS_READ_END,			// FD, bytes read or error
+	B_TRACEPOINT_VFS_WRITE_BEGIN,		// FD, length
+	B_TRACEPOINT_VFS_WRITE_END,			// FD, bytes written or error
+
+	B_TRACEPOINT_BLOCK_READ_BEGIN,		// FD of the device, block number
+	B_TRACEPOINT_BLOCK_READ_END,		// FD of the device, bytes read or error
+	B_TRACEPOINT_BLOCK_WRITE_BEGIN,		// FD of the device, block count
+	B_TRACEPOINT_BLOCK_WRITE_END,		// FD, bytes written or error
+
+	B_TRACEPOINT_IO_REQUEST_BEGIN,		// request, length
+	B_TRACEPOINT_IO_REQUEST_END,		// request, error
+
+	B_TRACEPOINT_NET_RECEIVE,			// interface index, size
+	B_TRACEPOINT_NET_SEND,				// interface index, size
+
+	B_TRACEPOINT_SAMPLE,				// program counter, in kernel
+
+	B_TRACEPOINT_EVENT_COUNT
+};
+
+
+typedef struct tracepoint_record {
+	bigtime_t	time;
+	int32		thread;
+	uint16		event;
+	uint16		cpu;
+	uint64		args[2];
+} tracepoint_record;
+
+
+#define B_TRACEPOINT_HEADER_SIZE	64
+
+
+/*!	The buffer area starts with this header. It is followed by one ring per
+	CPU, each made of a tracepoint_ring header and \c ring_capacity records.
+	The kernel fills in the header when recording starts.
+	Only the kernel writes to the rings; it overwrites the oldest records when
+	a ring is full. A reader copies the records between the last head it saw
+	and the current one, and then checks the head again: the records that may
+	have been overwritten in the meantime are lost.
+	The kernel only publishes the layout and the heads here; it never reads
+	them back, as the consumer can write to the buffer.
+*/
+typedef struct tracepoint_buffer_header {
+	uint32		cpu_count;
+	uint32		ring_capacity;		// records per ring, a power of two
+	uint32		ring_size;			// bytes per ring, including its header
+	uint32		categories;
+} tracepoint_buffer_header;
+
+typedef struct tracepoint_ring {
+	uint64		head;				// number of records written so far
+	uint8		_reserved[56];
+} tracepoint_ring;
+
+
+static inline tracepoint_ring*
+tracepoint_get_ring(tracepoint_buffer_header* header, uint32 cpu)
+{
+	return (tracepoint_ring*)((uint8*)header + B_TRACEPOINT_HEADER_SIZE
+		+ cpu * header->ring_size);
+}
+
+
+static inline tracepoint_record*
+tracepoint_get_record(tracepoint_buffer_header* header, tracepoint_ring* ring,
+	uint64 index)
+{
+	return (tracepoint_record*)(ring + 1)
+		+ (index & (header->ring_capacity - 1));
+}
+
+
+#endif	/* _SYSTEM_TRACEPOINT_DEFS_H */
@@ -8,6 +8,10 @@
 
 // flags passed to _kern_mutex_{un}block
 // (same uint32 also used for B_TIMEOUT, etc.)
+#define B_USER_MUTEX_PRIO_INHERIT	0x20000000
+	// The mutex value holds the ID of the owning thread instead of the flags
+	// below, and the owner inherits the priority of the threads waiting for
+	// it.
 #define B_USER_MUTEX_SHARED			0x40000000
 	// Mutex is in shared memory.
 #define B_USER_MUTEX_UNBLOCK_ALL	0x80000000
@@ -20,5 +24,9 @@
 #define B_USER_MUTEX_WAITING	0x02
 #define B_USER_MUTEX_DISABLED	0x04
 
+// priority inheritance mutex value flags
+#define B_USER_MUTEX_PI_WAITING	0x80000000
+	// Threads are waiting in the kernel, unlocking must be done there.
+
 
 #endif	/* _SYSTEM_USER_MUTEX_DEFS_H */
@@ -19,6 +19,13 @@ struct user_thread {
 	int32			defer_signals;		// counter; 0 == signals allowed
 	sigset_t		pending_signals;	// signals that are pending, when
 										// signals are deferred
+
+	// snapshot of the thread's CPU time clock, updated by the kernel whenever
+	// the thread is scheduled
+	int32			cpu_time_version;	// odd while being updated
+	bigtime_t		cpu_time;			// CPU time when last scheduled
+	bigtime_t		cpu_time_since;		// system time when last scheduled,
+										// 0 if the snapshot is not valid
 };
 
 
@@ -0,0 +1,28 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_VM_COMPRESSED_SWAP_H
+#define _SYSTEM_VM_COMPRESSED_SWAP_H
+
+#include <OS.h>
+
+
+#define COMPRESSED_SWAP_SYSCALLS	"vm compressed swap"
+#define GET_COMPRESSED_SWAP_INFO	0x01
+
+
+typedef struct compressed_swap_info {
+	uint64		pool_size;			/* memory set aside for the pool */
+	uint64		used_size;			/* memory of the pool in use */
+	uint64		stored_pages;		/* pages currently in the pool */
+	uint64		zero_pages;			/* stored pages that only contain zeros */
+	uint64		compressed_size;	/* compressed size of the stored pages */
+	uint64		stores;				/* pages written to the pool */
+	uint64		rejects;			/* pages that went to the swap files */
+	uint64		pool_reads;			/* pages read back from the pool */
+	uint64		file_reads;			/* pages read back from the swap files */
+} compressed_swap_info;
+
+
+#endif	/* _SYSTEM_VM_COMPRESSED_SWAP_H */
@@ -26,9 +26,13 @@
 #define B_KERNEL_AREA			(1 << 14)
 	// Usable from userland according to its protection flags, but the area
 	// itself is not deletable, resizable, etc from userland.
+#define B_LARGE_PAGES			(1 << 15)
+	// Hint to back a B_FULL_LOCK or B_CONTIGUOUS area with large pages,
+	// where the architecture supports them.
 
 #define B_USER_AREA_FLAGS		\
-	(B_USER_PROTECTION | B_OVERCOMMITTING_AREA | B_CLONEABLE_AREA)
+	(B_USER_PROTECTION | B_OVERCOMMITTING_AREA | B_CLONEABLE_AREA \
+	| B_LARGE_PAGES)
 #define B_KERNEL_AREA_FLAGS \
 	(B_KERNEL_PROTECTION | B_SHARED_AREA)
 
@@ -0,0 +1,27 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef _SYSTEM_VM_PAGE_MAGAZINES_H
+#define _SYSTEM_VM_PAGE_MAGAZINES_H
+
+#include <OS.h>
+
+
+#define VM_PAGE_MAGAZINE_SYSCALLS	"vm page magazines"
+#define GET_VM_PAGE_MAGAZINE_INFO	0x01
+
+
+typedef struct vm_page_magazine_info {
+	uint32		cpu_count;
+	uint32		magazine_size;		/* per CPU and page state */
+	uint64		free_pages;			/* free pages in all magazines */
+	uint64		clear_pages;		/* clear pages in all magazines */
+	uint64		hits;				/* allocations served by a magazine */
+	uint64		misses;				/* allocations needing a refill */
+	uint64		refills;			/* batches moved from the queues */
+	uint64		drains;				/* batches moved back to the queues */
+} vm_page_magazine_info;
+
+
+#endif	/* _SYSTEM_VM_PAGE_MAGAZINES_H */
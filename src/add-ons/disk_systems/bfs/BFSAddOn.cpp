@@ -284,6 +284,8 @@ BFSPartitionHandle::Repair(bool checkOnly)
 					printf(", names don't match");
 				if ((result.errors & BFS_INVALID_BPLUSTREE) != 0)
 					printf(", invalid b+tree");
+				if ((result.errors & BFS_INVALID_INLINE_DATA) != 0)
+					printf(", invalid inline data");
 				putchar('\n');
 			}
 
@@ -88,7 +88,7 @@ typedef struct {
 
 #include "dma_resources.h"
 #include "IORequest.h"
-#include "IOSchedulerSimple.h"
+#include "IOSchedulerMultiQueue.h"
 
 
 //#define TRACE_VIRTIO_BLOCK
@@ -481,8 +481,10 @@ virtio_block_set_capacity(virtio_block_driver_info* info)
 	if (status != B_OK)
 		panic("initializing DMAResource failed: %s", strerror(status));
 
-	info->io_scheduler = new(std::nothrow) IOSchedulerSimple(
-		info->dma_resource);
+	// We only use a single virtqueue, but the scheduler can still spare us
+	// the context switches while the device is idle.
+	info->io_scheduler = new(std::nothrow) IOSchedulerMultiQueue(
+		info->dma_resource, 1);
 	if (info->io_scheduler == NULL)
 		panic("allocating IOScheduler failed.");
 
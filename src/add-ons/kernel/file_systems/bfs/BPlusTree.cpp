@@ -658,6 +658,7 @@ BPlusTree::SetTo(Transaction& transaction, Inode* stream, int32 nodeSize)
 	// initializes in-memory B+Tree
 
 	fStream = stream;
+	fDirectoryCache.Invalidate();
 
 	CachedNode cached(this);
 	bplustree_header* header = cached.SetToWritableHeader(transaction);
@@ -708,6 +709,9 @@ BPlusTree::SetTo(Inode* stream)
 		RETURN_ERROR(fStatus = B_BAD_VALUE);
 
 	fStream = stream;
+#if !_BOOT_MODE
+	fDirectoryCache.Invalidate();
+#endif
 
 	// get on-disk B+Tree header
 
@@ -851,6 +855,8 @@ BPlusTree::Validate(bool repair, bool& _errorsFound)
 status_t
 BPlusTree::MakeEmpty()
 {
+	fDirectoryCache.Invalidate();
+
 	// Put all nodes into the free list in order
 	Transaction transaction(fStream->GetVolume(), fStream->BlockNumber());
 	fStream->WriteLockInTransaction(transaction);
@@ -972,6 +978,9 @@ BPlusTree::TransactionDone(bool success)
 		const bplustree_header* header = cached.SetToHeader();
 		if (header != NULL)
 			memcpy(&fHeader, header, sizeof(bplustree_header));
+
+		// the cache might contain changes that have just been reverted
+		fDirectoryCache.Invalidate();
 	}
 }
 
@@ -1692,6 +1701,18 @@ BPlusTree::_SplitNode(bplustree_node* node, off_t nodeOffset,
 status_t
 BPlusTree::Insert(Transaction& transaction, const uint8* key, uint16 keyLength,
 	off_t value)
+{
+	status_t status = _Insert(transaction, key, keyLength, value);
+	if (status == B_OK && _UsesDirectoryCache())
+		fDirectoryCache.Insert(key, keyLength, value);
+
+	return status;
+}
+
+
+status_t
+BPlusTree::_Insert(Transaction& transaction, const uint8* key,
+	uint16 keyLength, off_t value)
 {
 	if (keyLength < BPLUSTREE_MIN_KEY_LENGTH
 		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
@@ -2112,6 +2133,18 @@ BPlusTree::_RemoveKey(bplustree_node* node, uint16 index)
 status_t
 BPlusTree::Remove(Transaction& transaction, const uint8* key, uint16 keyLength,
 	off_t value)
+{
+	status_t status = _Remove(transaction, key, keyLength, value);
+	if (status == B_OK && _UsesDirectoryCache())
+		fDirectoryCache.Remove(key, keyLength);
+
+	return status;
+}
+
+
+status_t
+BPlusTree::_Remove(Transaction& transaction, const uint8* key,
+	uint16 keyLength, off_t value)
 {
 	if (keyLength < BPLUSTREE_MIN_KEY_LENGTH
 		|| keyLength > BPLUSTREE_MAX_KEY_LENGTH)
@@ -2262,6 +2295,8 @@ BPlusTree::Replace(Transaction& transaction, const uint8* key, uint16 keyLength,
 				if (writableNode != NULL) {
 					writableNode->Values()[keyIndex]
 						= HOST_ENDIAN_TO_BFS_INT64(value);
+					if (_UsesDirectoryCache())
+						fDirectoryCache.Insert(key, keyLength, value);
 				} else
 					status = B_IO_ERROR;
 			}
@@ -2302,6 +2337,12 @@ BPlusTree::Find(const uint8* key, uint16 keyLength, off_t* _value)
 
 #if !_BOOT_MODE
 	ASSERT_READ_LOCKED_INODE(fStream);
+
+	if (_UsesDirectoryCache()) {
+		status_t status = fDirectoryCache.Lookup(this, key, keyLength, _value);
+		if (status != B_NO_INIT)
+			return status;
+	}
 #endif
 
 	off_t nodeOffset = fHeader.RootNode();
@@ -11,6 +11,7 @@
 #include "Utility.h"
 
 #if !_BOOT_MODE
+#include "DirectoryCache.h"
 #include "Journal.h"
 class Inode;
 #else
@@ -315,6 +316,16 @@ private:
 								BPlusTree& operator=(const BPlusTree& other);
 									// no implementation
 
+#if !_BOOT_MODE
+			bool				_UsesDirectoryCache() const;
+			status_t			_Insert(Transaction& transaction,
+									const uint8* key, uint16 keyLength,
+									off_t value);
+			status_t			_Remove(Transaction& transaction,
+									const uint8* key, uint16 keyLength,
+									off_t value);
+#endif
+
 			int32				_CompareKeys(const void* key1, int keylength1,
 									const void* key2, int keylength2);
 			status_t			_FindKey(const bplustree_node* node,
@@ -367,6 +378,7 @@ private:
 private:
 			friend class TreeIterator;
 			friend class CachedNode;
+			friend class DirectoryCache;
 			friend struct TreeCheck;
 
 			Inode*				fStream;
@@ -379,6 +391,7 @@ private:
 #if !_BOOT_MODE
 			mutex				fIteratorLock;
 			SinglyLinkedList<TreeIterator> fIterators;
+			DirectoryCache		fDirectoryCache;
 #endif
 };
 
@@ -508,6 +521,16 @@ BPlusTree::Insert(Transaction& transaction, double key, off_t value)
 		return B_BAD_TYPE;
 	return Insert(transaction, (uint8*)&key, sizeof(key), value);
 }
+
+
+/*!	Only directories get a DirectoryCache; indices may contain duplicates,
+	and are not searched by name.
+*/
+inline bool
+BPlusTree::_UsesDirectoryCache() const
+{
+	return !fAllowDuplicates && fHeader.DataType() == BPLUSTREE_STRING_TYPE;
+}
 #endif // !_BOOT_MODE
 
 
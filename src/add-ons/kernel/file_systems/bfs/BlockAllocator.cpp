@@ -167,6 +167,74 @@ private:
 #endif
 
 
+/*!	Returns the index of the first bit at or after \a start in the given
+	bitmap that is set (if \a used is \c true) or cleared, or \a numBits if
+	there is none. The bitmap is scanned a 32-bit chunk at a time.
+*/
+static inline uint32
+next_bit(const uint32* bitmap, uint32 numBits, uint32 start, bool used)
+{
+	// Ignore all bits below the start bit in its chunk
+	uint32 ignore = (1UL << (start % 32)) - 1;
+
+	for (uint32 offset = ROUNDDOWN(start, 32); offset < numBits;
+			offset += 32) {
+		uint32 chunk = BFS_ENDIAN_TO_HOST_INT32(bitmap[offset >> 5]);
+		if (!used)
+			chunk = ~chunk;
+		chunk &= ~ignore;
+		ignore = 0;
+
+		if (chunk == 0)
+			continue;
+
+		uint32 result = offset + ffs(chunk) - 1;
+		return result < numBits ? result : numBits;
+	}
+
+	return numBits;
+}
+
+
+/*!	Returns the index of the last set bit below \a end in the given bitmap,
+	or -1 if there is none.
+*/
+static inline int32
+previous_used_bit(const uint32* bitmap, uint32 end)
+{
+	if (end == 0)
+		return -1;
+
+	// Ignore all bits from the end bit on in its chunk
+	uint32 last = end - 1;
+	uint32 mask = UINT32_MAX >> (31 - last % 32);
+
+	for (int32 offset = ROUNDDOWN(last, 32); offset >= 0; offset -= 32) {
+		uint32 chunk = BFS_ENDIAN_TO_HOST_INT32(bitmap[offset >> 5]) & mask;
+		mask = UINT32_MAX;
+
+		if (chunk != 0)
+			return offset + 31 - __builtin_clz(chunk);
+	}
+
+	return -1;
+}
+
+
+/*!	Returns the mask of \a numBits bits starting at bit \a start of a
+	chunk, limited to the end of the chunk.
+*/
+static inline uint32
+chunk_mask(uint32 start, uint32 numBits)
+{
+	start %= 32;
+	if (numBits >= 32 - start)
+		return UINT32_MAX << start;
+
+	return ((1UL << numBits) - 1) << start;
+}
+
+
 class AllocationBlock : public CachedBlock {
 public:
 	AllocationBlock(Volume* volume);
@@ -175,6 +243,8 @@ public:
 	inline void Free(uint16 start, uint16 numBlocks);
 	inline bool IsUsed(uint16 block);
 	inline uint32 NextFree(uint16 startBlock);
+	inline uint32 NextUsed(uint16 startBlock);
+	inline int32 PreviousUsed(uint32 endBlock);
 
 	status_t SetTo(AllocationGroup& group, uint16 block);
 	status_t SetToWritable(Transaction& transaction, AllocationGroup& group,
@@ -192,9 +262,21 @@ private:
 };
 
 
+/*!	Besides the allocation hints, every group remembers up to
+	kMaxFreeExtents of its largest free extents, so that allocations rarely
+	need to look at the block bitmap itself to find a place. The extents are
+	always maximal ranges of free blocks; the extents that didn't fit are
+	only known to be no longer than fUntrackedLength.
+	The extents are collected when the bitmap is scanned at mount time, kept
+	up to date on every allocation and free, and rebuilt lazily if they ever
+	become invalid.
+	All of this, as well as the part of the block bitmap that belongs to the
+	group, is protected by the group's lock.
+*/
 class AllocationGroup {
 public:
 	AllocationGroup();
+	~AllocationGroup();
 
 	void AddFreeRange(int32 start, int32 blocks);
 	bool IsFull() const { return fFreeBits == 0; }
@@ -202,10 +284,30 @@ public:
 	status_t Allocate(Transaction& transaction, uint16 start, int32 length);
 	status_t Free(Transaction& transaction, uint16 start, int32 length);
 
+	status_t FindFreeRange(Volume* volume, int32 start, int32 maximum,
+		int32& _start, int32& _length);
+	status_t Rescan(Volume* volume);
+
 	uint32 NumBits() const { return fNumBits; }
 	uint32 NumBitmapBlocks() const { return fNumBitmapBlocks; }
 	int32 Start() const { return fStart; }
 
+private:
+	struct FreeExtent {
+		int32	start;
+		int32	length;
+	};
+
+	static const int32 kMaxFreeExtents = 16;
+
+	void _ResetFreeRanges();
+	void _AddFreeExtent(int32 start, int32 length);
+	void _RemoveFreeRange(int32 start, int32 length);
+	status_t _FindFreeExtent(Volume* volume, int32 start, int32 end,
+		int32& _start, int32& _end);
+	status_t _ScanFreeRanges(Volume* volume, int32 start, int32 maximum,
+		bool rebuild, int32& _start, int32& _length);
+
 private:
 	friend class BlockAllocator;
 
@@ -215,9 +317,10 @@ private:
 	int32	fFirstFree;
 	int32	fFreeBits;
 
-	int32	fLargestStart;
-	int32	fLargestLength;
-	bool	fLargestValid;
+	FreeExtent fExtents[kMaxFreeExtents];
+	int32	fExtentCount;
+	int32	fUntrackedLength;
+	bool	fExtentsValid;
 };
 
 
@@ -274,24 +377,21 @@ AllocationBlock::IsUsed(uint16 block)
 uint32
 AllocationBlock::NextFree(uint16 startBlock)
 {
-	// Set all bits below the start block in the current chunk, to ignore them.
-	uint32 ignoreNext = (1UL << (startBlock % 32)) - 1;
+	return next_bit((uint32*)fBlock, fNumBits, startBlock, false);
+}
 
-	for (uint32 offset = ROUNDDOWN(startBlock, 32);
-			offset < fNumBits; offset += 32) {
-		uint32 chunk = Chunk(offset >> 5);
-		chunk |= ignoreNext;
-		ignoreNext = 0;
 
-		if (chunk == UINT32_MAX)
-			continue;
-		uint32 result = offset + ffs(~chunk) - 1;
-		if (result >= fNumBits)
-			break;
-		return result;
-	}
+uint32
+AllocationBlock::NextUsed(uint16 startBlock)
+{
+	return next_bit((uint32*)fBlock, fNumBits, startBlock, true);
+}
+
 
-	return fNumBits;
+int32
+AllocationBlock::PreviousUsed(uint32 endBlock)
+{
+	return previous_used_bit((uint32*)fBlock, endBlock);
 }
 
 
@@ -310,9 +410,8 @@ AllocationBlock::Allocate(uint16 start, uint16 numBlocks)
 	int32 block = start >> 5;
 
 	while (numBlocks > 0) {
-		uint32 mask = 0;
-		for (int32 i = start % 32; i < 32 && numBlocks; i++, numBlocks--)
-			mask |= 1UL << i;
+		uint32 mask = chunk_mask(start, numBlocks);
+		numBlocks -= __builtin_popcount(mask);
 
 		T(BlockChange("b-alloc", block, Chunk(block),
 			Block(block) | HOST_ENDIAN_TO_BFS_INT32(mask)));
@@ -346,9 +445,8 @@ AllocationBlock::Free(uint16 start, uint16 numBlocks)
 	int32 block = start >> 5;
 
 	while (numBlocks > 0) {
-		uint32 mask = 0;
-		for (int32 i = start % 32; i < 32 && numBlocks; i++, numBlocks--)
-			mask |= 1UL << (i % 32);
+		uint32 mask = chunk_mask(start, numBlocks);
+		numBlocks -= __builtin_popcount(mask);
 
 		T(BlockChange("b-free", block, Chunk(block),
 			Block(block) & HOST_ENDIAN_TO_BFS_INT32(~mask)));
@@ -370,7 +468,14 @@ AllocationGroup::AllocationGroup()
 	:
 	fFirstFree(-1),
 	fFreeBits(0),
-	fLargestValid(false)
+	fExtentCount(0),
+	fUntrackedLength(0),
+	fExtentsValid(false)
+{
+}
+
+
+AllocationGroup::~AllocationGroup()
 {
 }
 
@@ -384,11 +489,7 @@ AllocationGroup::AddFreeRange(int32 start, int32 blocks)
 	if (fFirstFree == -1)
 		fFirstFree = start;
 
-	if (!fLargestValid || fLargestLength < blocks) {
-		fLargestStart = start;
-		fLargestLength = blocks;
-		fLargestValid = true;
-	}
+	_AddFreeExtent(start, blocks);
 
 	fFreeBits += blocks;
 }
@@ -396,9 +497,9 @@ AllocationGroup::AddFreeRange(int32 start, int32 blocks)
 
 /*!	Allocates the specified run in the allocation group.
 	Doesn't check if the run is valid or already allocated partially, nor
-	does it maintain the free ranges hints or the volume's used blocks count.
+	does it maintain the volume's used blocks count.
 	It only does the low-level work of allocating some bits in the block bitmap.
-	Assumes that the block bitmap lock is hold.
+	Assumes that the group's lock is held.
 */
 status_t
 AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
@@ -412,26 +513,8 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 		fFirstFree = start + length;
 	fFreeBits -= length;
 
-	if (fLargestValid) {
-		bool cut = false;
-		if (fLargestStart == start) {
-			// cut from start
-			fLargestStart += length;
-			fLargestLength -= length;
-			cut = true;
-		} else if (start > fLargestStart
-			&& start < fLargestStart + fLargestLength) {
-			// cut from end
-			fLargestLength = start - fLargestStart;
-			cut = true;
-		}
-		if (cut && (fLargestLength < fLargestStart
-				|| fLargestLength
-						< (int32)fNumBits - (fLargestStart + fLargestLength))) {
-			// might not be the largest block anymore
-			fLargestValid = false;
-		}
-	}
+	if (fExtentsValid)
+		_RemoveFreeRange(start, length);
 
 	Volume* volume = transaction.GetVolume();
 
@@ -444,7 +527,7 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 
 	while (length > 0) {
 		if (cached.SetToWritable(transaction, *this, block) < B_OK) {
-			fLargestValid = false;
+			fExtentsValid = false;
 			RETURN_ERROR(B_IO_ERROR);
 		}
 
@@ -465,9 +548,9 @@ AllocationGroup::Allocate(Transaction& transaction, uint16 start, int32 length)
 
 /*!	Frees the specified run in the allocation group.
 	Doesn't check if the run is valid or was not completely allocated, nor
-	does it maintain the free ranges hints or the volume's used blocks count.
+	does it maintain the volume's used blocks count.
 	It only does the low-level work of freeing some bits in the block bitmap.
-	Assumes that the block bitmap lock is hold.
+	Assumes that the group's lock is held.
 */
 status_t
 AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
@@ -480,21 +563,9 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 		fFirstFree = start;
 	fFreeBits += length;
 
-	// The range to be freed cannot be part of the valid largest range
-	ASSERT(!fLargestValid || start + length <= fLargestStart
-		|| start > fLargestStart);
-
-	if (fLargestValid
-		&& (start + length == fLargestStart
-			|| fLargestStart + fLargestLength == start
-			|| (start < fLargestStart && fLargestStart > fLargestLength)
-			|| (start > fLargestStart
-				&& (int32)fNumBits - (fLargestStart + fLargestLength)
-						> fLargestLength))) {
-		fLargestValid = false;
-	}
-
 	Volume* volume = transaction.GetVolume();
+	int32 freeStart = start;
+	int32 freeEnd = start + length;
 
 	// calculate block in the block bitmap and position within
 	uint32 bitsPerBlock = volume->BlockSize() << 3;
@@ -504,8 +575,10 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 	AllocationBlock cached(volume);
 
 	while (length > 0) {
-		if (cached.SetToWritable(transaction, *this, block) < B_OK)
+		if (cached.SetToWritable(transaction, *this, block) < B_OK) {
+			fExtentsValid = false;
 			RETURN_ERROR(B_IO_ERROR);
+		}
 
 		T(Block("free-1", block, cached.Block(), volume->BlockSize()));
 		uint16 freeLength = length;
@@ -519,6 +592,271 @@ AllocationGroup::Free(Transaction& transaction, uint16 start, int32 length)
 		T(Block("free-2", block, cached.Block(), volume->BlockSize()));
 		block++;
 	}
+	cached.Unset();
+
+	if (fExtentsValid) {
+		// The freed range may have joined free extents on either side
+		if (_FindFreeExtent(volume, freeStart, freeEnd, freeStart, freeEnd)
+				== B_OK) {
+			_RemoveFreeRange(freeStart, freeEnd - freeStart);
+			_AddFreeExtent(freeStart, freeEnd - freeStart);
+		} else
+			fExtentsValid = false;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Looks for a free range at or after \a start. Returns the first range
+	that has at least \a maximum blocks, or the largest range if there is
+	none; \a _length is 0 if there are no free blocks after \a start.
+	The bitmap is only scanned if the free extents of the group aren't known
+	well enough to answer this.
+	Assumes that the group's lock is held.
+*/
+status_t
+AllocationGroup::FindFreeRange(Volume* volume, int32 start, int32 maximum,
+	int32& _start, int32& _length)
+{
+	if (!fExtentsValid) {
+		status_t status = Rescan(volume);
+		if (status != B_OK)
+			return status;
+	}
+
+	int32 fitStart = -1;
+	int32 fitLength = 0;
+	int32 bestStart = -1;
+	int32 bestLength = 0;
+
+	for (int32 i = 0; i < fExtentCount; i++) {
+		const FreeExtent& extent = fExtents[i];
+		int32 extentStart = max_c(extent.start, start);
+		int32 length = extent.start + extent.length - extentStart;
+		if (length <= 0)
+			continue;
+
+		if (length >= maximum) {
+			// prefer the range closest to the start
+			if (fitStart < 0 || extentStart < fitStart) {
+				fitStart = extentStart;
+				fitLength = length;
+			}
+		} else if (length > bestLength) {
+			bestStart = extentStart;
+			bestLength = length;
+		}
+	}
+
+	if (fitStart >= 0) {
+		_start = fitStart;
+		_length = fitLength;
+		return B_OK;
+	}
+	if (bestLength >= fUntrackedLength) {
+		_start = bestStart;
+		_length = bestLength;
+		return B_OK;
+	}
+
+	// One of the extents we don't know might be larger
+	return _ScanFreeRanges(volume, start, maximum, start == 0, _start,
+		_length);
+}
+
+
+/*!	Rebuilds all information about the free space in this group from its
+	block bitmap.
+	Assumes that the group's lock is held.
+*/
+status_t
+AllocationGroup::Rescan(Volume* volume)
+{
+	int32 start;
+	int32 length;
+	return _ScanFreeRanges(volume, 0, INT32_MAX, true, start, length);
+}
+
+
+void
+AllocationGroup::_ResetFreeRanges()
+{
+	fFirstFree = -1;
+	fFreeBits = 0;
+	fExtentCount = 0;
+	fUntrackedLength = 0;
+	fExtentsValid = false;
+}
+
+
+/*!	Remembers the given free extent, if it is among the largest ones of
+	the group.
+*/
+void
+AllocationGroup::_AddFreeExtent(int32 start, int32 length)
+{
+	if (fExtentCount < kMaxFreeExtents) {
+		fExtents[fExtentCount].start = start;
+		fExtents[fExtentCount].length = length;
+		fExtentCount++;
+		return;
+	}
+
+	int32 smallest = 0;
+	for (int32 i = 1; i < fExtentCount; i++) {
+		if (fExtents[i].length < fExtents[smallest].length)
+			smallest = i;
+	}
+
+	if (fExtents[smallest].length < length) {
+		fUntrackedLength = max_c(fUntrackedLength, fExtents[smallest].length);
+		fExtents[smallest].start = start;
+		fExtents[smallest].length = length;
+	} else
+		fUntrackedLength = max_c(fUntrackedLength, length);
+}
+
+
+/*!	Removes the given range from the free extents; what remains of the
+	extents it overlapped is kept.
+*/
+void
+AllocationGroup::_RemoveFreeRange(int32 start, int32 length)
+{
+	int32 end = start + length;
+
+	for (int32 i = fExtentCount; i-- > 0;) {
+		FreeExtent extent = fExtents[i];
+		int32 extentEnd = extent.start + extent.length;
+		if (extentEnd <= start || extent.start >= end)
+			continue;
+
+		fExtents[i] = fExtents[--fExtentCount];
+
+		if (extent.start < start)
+			_AddFreeExtent(extent.start, start - extent.start);
+		if (extentEnd > end)
+			_AddFreeExtent(end, extentEnd - end);
+	}
+}
+
+
+/*!	Extends the free range from \a start to \a end in both directions to
+	the maximal free extent that contains it.
+*/
+status_t
+AllocationGroup::_FindFreeExtent(Volume* volume, int32 start, int32 end,
+	int32& _start, int32& _end)
+{
+	uint32 bitsPerBlock = volume->BlockSize() << 3;
+	AllocationBlock cached(volume);
+
+	while (start > 0) {
+		uint32 block = (start - 1) / bitsPerBlock;
+		if (cached.SetTo(*this, block) != B_OK)
+			RETURN_ERROR(B_IO_ERROR);
+
+		int32 used = cached.PreviousUsed(start - block * bitsPerBlock);
+		if (used >= 0) {
+			start = block * bitsPerBlock + used + 1;
+			break;
+		}
+		start = block * bitsPerBlock;
+	}
+
+	while (end < (int32)fNumBits) {
+		uint32 block = end / bitsPerBlock;
+		if (cached.SetTo(*this, block) != B_OK)
+			RETURN_ERROR(B_IO_ERROR);
+
+		uint32 used = cached.NextUsed(end - block * bitsPerBlock);
+		end = block * bitsPerBlock + used;
+		if (used < cached.NumBlockBits())
+			break;
+	}
+
+	_start = start;
+	_end = min_c(end, (int32)fNumBits);
+	return B_OK;
+}
+
+
+/*!	Scans the block bitmap of the group for free ranges from \a start on,
+	and returns the first one that has at least \a maximum blocks, or else
+	the largest one.
+	If \a rebuild is \c true, the whole group is scanned, and all the
+	information about its free space is collected anew.
+*/
+status_t
+AllocationGroup::_ScanFreeRanges(Volume* volume, int32 start, int32 maximum,
+	bool rebuild, int32& _start, int32& _length)
+{
+	ASSERT(!rebuild || start == 0);
+
+	if (rebuild)
+		_ResetFreeRanges();
+
+	uint32 bitsPerBlock = volume->BlockSize() << 3;
+	AllocationBlock cached(volume);
+
+	int32 bestStart = -1;
+	int32 bestLength = 0;
+	int32 rangeStart = -1;
+	uint32 block = start / bitsPerBlock;
+	uint32 bit = start % bitsPerBlock;
+
+	for (; block < fNumBitmapBlocks; block++, bit = 0) {
+		if (cached.SetTo(*this, block) < B_OK)
+			RETURN_ERROR(B_IO_ERROR);
+
+		int32 offset = block * bitsPerBlock;
+
+		while (bit < cached.NumBlockBits()) {
+			if (rangeStart < 0) {
+				bit = cached.NextFree(bit);
+				if (bit >= cached.NumBlockBits())
+					break;
+				rangeStart = offset + bit;
+			}
+
+			bit = cached.NextUsed(bit);
+			if (bit >= cached.NumBlockBits()) {
+				// the range continues in the next block
+				break;
+			}
+
+			int32 length = offset + bit - rangeStart;
+			if (rebuild)
+				AddFreeRange(rangeStart, length);
+			if (length > bestLength && bestLength < maximum) {
+				bestStart = rangeStart;
+				bestLength = length;
+				if (bestLength >= maximum && !rebuild)
+					break;
+			}
+			rangeStart = -1;
+		}
+
+		if (bestLength >= maximum && !rebuild)
+			break;
+	}
+
+	if (rangeStart >= 0 && (rebuild || bestLength < maximum)) {
+		int32 length = fNumBits - rangeStart;
+		if (rebuild)
+			AddFreeRange(rangeStart, length);
+		if (length > bestLength && bestLength < maximum) {
+			bestStart = rangeStart;
+			bestLength = length;
+		}
+	}
+
+	if (rebuild)
+		fExtentsValid = true;
+
+	_start = bestStart;
+	_length = bestLength;
 	return B_OK;
 }
 
@@ -610,9 +948,9 @@ BlockAllocator::InitializeAndClearBitmap(Transaction& transaction)
 			fGroups[i].fNumBitmapBlocks = fBlocksPerGroup;
 		}
 		fGroups[i].fStart = offset;
-		fGroups[i].fFirstFree = fGroups[i].fLargestStart = 0;
-		fGroups[i].fFreeBits = fGroups[i].fLargestLength = fGroups[i].fNumBits;
-		fGroups[i].fLargestValid = true;
+		fGroups[i]._ResetFreeRanges();
+		fGroups[i].AddFreeRange(0, fGroups[i].fNumBits);
+		fGroups[i].fExtentsValid = true;
 
 		offset += fBlocksPerGroup;
 	}
@@ -675,26 +1013,15 @@ BlockAllocator::_Initialize(BlockAllocator* allocator)
 		groups[i].fStart = offset;
 
 		// finds all free ranges in this allocation group
-		int32 start = -1, range = 0;
-		int32 numBits = groups[i].fNumBits, bit = 0;
-		int32 count = (numBits + 31) / 32;
-
-		for (int32 k = 0; k < count; k++) {
-			for (int32 j = 0; j < 32 && bit < numBits; j++, bit++) {
-				if (buffer[k] & (1UL << j)) {
-					// block is in use
-					if (range > 0) {
-						groups[i].AddFreeRange(start, range);
-						range = 0;
-					}
-				} else if (range++ == 0) {
-					// block is free, start new free range
-					start = bit;
-				}
-			}
+		uint32 numBits = groups[i].fNumBits;
+		uint32 bit = next_bit(buffer, numBits, 0, false);
+
+		while (bit < numBits) {
+			uint32 end = next_bit(buffer, numBits, bit, true);
+			groups[i].AddFreeRange(bit, end - bit);
+			bit = next_bit(buffer, numBits, end, false);
 		}
-		if (range)
-			groups[i].AddFreeRange(start, range);
+		groups[i].fExtentsValid = true;
 
 		freeBlocks += groups[i].fFreeBits;
 
@@ -763,14 +1090,12 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		", maximum = %" B_PRIu16 ", minimum = %" B_PRIu16 "\n",
 		groupIndex, start, maximum, minimum));
 
-	AllocationBlock cached(fVolume);
 	RecursiveLocker lock(fLock);
 
-	uint32 bitsPerFullBlock = fVolume->BlockSize() << 3;
-
 	// Find the block_run that can fulfill the request best
+	int32 originalGroup = groupIndex % fNumGroups;
+	uint16 originalStart = start;
 	int32 bestGroup = -1;
-	int32 bestStart = -1;
 	int32 bestLength = -1;
 
 	for (int32 i = 0; i < fNumGroups + 1; i++, groupIndex++, start = 0) {
@@ -782,134 +1107,44 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		if (start >= group.NumBits() || group.IsFull())
 			continue;
 
-		// The wanted maximum is smaller than the largest free block in the
-		// group or already smaller than the minimum
-
 		if (start < group.fFirstFree)
 			start = group.fFirstFree;
 
-		if (group.fLargestValid) {
-			if (group.fLargestLength < bestLength)
-				continue;
-
-			if (group.fLargestStart >= start) {
-				if (group.fLargestLength >= bestLength) {
-					bestGroup = groupIndex;
-					bestStart = group.fLargestStart;
-					bestLength = group.fLargestLength;
-
-					if (bestLength >= maximum)
-						break;
-				}
-
-				// We know everything about this group we have to, let's skip
-				// to the next
-				continue;
-			}
+		int32 rangeStart;
+		int32 rangeLength;
+		if (group.FindFreeRange(fVolume, start, maximum, rangeStart,
+				rangeLength) != B_OK) {
+			RETURN_ERROR(B_IO_ERROR);
 		}
 
-		// There may be more than one block per allocation group - and
-		// we iterate through it to find a place for the allocation.
-		// (one allocation can't exceed one allocation group)
-
-		uint32 block = start / (fVolume->BlockSize() << 3);
-		int32 currentStart = 0, currentLength = 0;
-		int32 groupLargestStart = -1;
-		int32 groupLargestLength = -1;
-		int32 currentBit = start;
-		bool canFindGroupLargest = start == 0;
-
-		for (; block < group.NumBitmapBlocks(); block++) {
-			if (cached.SetTo(group, block) < B_OK)
-				RETURN_ERROR(B_ERROR);
-
-			T(Block("alloc-in", group.Start() + block, cached.Block(),
-				fVolume->BlockSize(), groupIndex, currentStart));
-
-			// find a block large enough to hold the allocation
-			for (uint32 bit = start % bitsPerFullBlock;
-					bit < cached.NumBlockBits(); bit++) {
-				if (!cached.IsUsed(bit)) {
-					if (currentLength == 0) {
-						// start new range
-						currentStart = currentBit;
-					}
-
-					// have we found a range large enough to hold numBlocks?
-					if (++currentLength >= maximum) {
-						bestGroup = groupIndex;
-						bestStart = currentStart;
-						bestLength = currentLength;
-						break;
-					}
-				} else {
-					if (currentLength) {
-						// end of a range
-						if (currentLength > bestLength) {
-							bestGroup = groupIndex;
-							bestStart = currentStart;
-							bestLength = currentLength;
-						}
-						if (currentLength > groupLargestLength) {
-							groupLargestStart = currentStart;
-							groupLargestLength = currentLength;
-						}
-						currentLength = 0;
-					}
-					if (((int32)group.NumBits() - currentBit)
-							<= groupLargestLength) {
-						// We can't find a bigger block in this group anymore,
-						// let's skip the rest.
-						block = group.NumBitmapBlocks();
-						break;
-					}
-
-					// Advance the current bit to one before the next free (or last) bit,
-					// so that the next loop iteration will check the next free bit.
-					const uint32 nextFreeOffset = cached.NextFree(bit) - bit;
-					bit += nextFreeOffset - 1;
-					currentBit += nextFreeOffset - 1;
-				}
-				currentBit++;
-			}
-
-			T(Block("alloc-out", block, cached.Block(),
-				fVolume->BlockSize(), groupIndex, currentStart));
-
-			if (bestLength >= maximum) {
-				canFindGroupLargest = false;
-				break;
-			}
-
-			// start from the beginning of the next block
-			start = 0;
+		if (rangeLength >= maximum) {
+			// There is no better range than this one
+			return _AllocateRange(transaction, groupIndex, rangeStart, maximum,
+				run);
 		}
 
-		if (currentBit == (int32)group.NumBits()) {
-			if (currentLength > bestLength) {
-				bestGroup = groupIndex;
-				bestStart = currentStart;
-				bestLength = currentLength;
-			}
-			if (canFindGroupLargest && currentLength > groupLargestLength) {
-				groupLargestStart = currentStart;
-				groupLargestLength = currentLength;
-			}
+		if (rangeLength > bestLength) {
+			bestGroup = groupIndex;
+			bestLength = rangeLength;
 		}
+	}
 
-		if (canFindGroupLargest && !group.fLargestValid
-			&& groupLargestLength >= 0) {
-			group.fLargestStart = groupLargestStart;
-			group.fLargestLength = groupLargestLength;
-			group.fLargestValid = true;
-		}
+	if (bestLength < minimum)
+		return B_DEVICE_FULL;
 
-		if (bestLength >= maximum)
-			break;
+	// Only the length of the best range has been remembered, so we have to
+	// look for it again; the original group has only been searched from
+	// the original start on
+	AllocationGroup& group = fGroups[bestGroup];
+	start = bestGroup == originalGroup ? originalStart : 0;
+	if (start < group.fFirstFree)
+		start = group.fFirstFree;
+
+	int32 bestStart;
+	if (group.FindFreeRange(fVolume, start, maximum, bestStart, bestLength)
+			!= B_OK) {
+		RETURN_ERROR(B_IO_ERROR);
 	}
-
-	// If we found a suitable range, mark the blocks as in use, and
-	// write the updated block bitmap back to disk
 	if (bestLength < minimum)
 		return B_DEVICE_FULL;
 
@@ -920,30 +1155,7 @@ BlockAllocator::AllocateBlocks(Transaction& transaction, int32 groupIndex,
 		bestLength = round_down(bestLength, minimum);
 	}
 
-	if (fGroups[bestGroup].Allocate(transaction, bestStart, bestLength) != B_OK)
-		RETURN_ERROR(B_IO_ERROR);
-
-	CHECK_ALLOCATION_GROUP(bestGroup);
-
-	run.allocation_group = HOST_ENDIAN_TO_BFS_INT32(bestGroup);
-	run.start = HOST_ENDIAN_TO_BFS_INT16(bestStart);
-	run.length = HOST_ENDIAN_TO_BFS_INT16(bestLength);
-
-	fVolume->SuperBlock().used_blocks
-		= HOST_ENDIAN_TO_BFS_INT64(fVolume->UsedBlocks() + bestLength);
-		// We are not writing back the disk's superblock - it's
-		// either done by the journaling code, or when the disk
-		// is unmounted.
-		// If the value is not correct at mount time, it will be
-		// fixed anyway.
-
-	// We need to flush any remaining blocks in the new allocation to make sure
-	// they won't interfere with the file cache.
-	block_cache_discard(fVolume->BlockCache(), fVolume->ToBlock(run),
-		run.Length());
-
-	T(Allocate(run));
-	return B_OK;
+	return _AllocateRange(transaction, bestGroup, bestStart, bestLength, run);
 }
 
 
@@ -1061,6 +1273,7 @@ BlockAllocator::Free(Transaction& transaction, block_run run)
 		DEBUGGER(("tried to free reserved block"));
 		return B_BAD_VALUE;
 	}
+
 #ifdef DEBUG
 	if (CheckBlockRun(run) != B_OK)
 		return B_BAD_DATA;
@@ -1080,12 +1293,72 @@ BlockAllocator::Free(Transaction& transaction, block_run run)
 	}
 #endif
 
-	fVolume->SuperBlock().used_blocks =
-		HOST_ENDIAN_TO_BFS_INT64(fVolume->UsedBlocks() - run.Length());
+	_AddUsedBlocks(-(int32)run.Length());
+	return B_OK;
+}
+
+
+/*!	Rebuilds what the allocator knows about the free space of all groups
+	from the block bitmap, after it has been changed behind its back.
+*/
+status_t
+BlockAllocator::Rescan()
+{
+	RecursiveLocker lock(fLock);
+
+	for (int32 i = 0; i < fNumGroups; i++) {
+		status_t status = fGroups[i].Rescan(fVolume);
+		if (status != B_OK)
+			return status;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Marks the given range in the block bitmap as used, and puts it into
+	\a run. You must hold fLock.
+*/
+status_t
+BlockAllocator::_AllocateRange(Transaction& transaction, int32 groupIndex,
+	int32 start, int32 length, block_run& run)
+{
+	ASSERT_LOCKED_RECURSIVE(&fLock);
+
+	if (fGroups[groupIndex].Allocate(transaction, start, length) != B_OK)
+		RETURN_ERROR(B_IO_ERROR);
+
+	CHECK_ALLOCATION_GROUP(groupIndex);
+
+	run.allocation_group = HOST_ENDIAN_TO_BFS_INT32(groupIndex);
+	run.start = HOST_ENDIAN_TO_BFS_INT16(start);
+	run.length = HOST_ENDIAN_TO_BFS_INT16(length);
+
+	_AddUsedBlocks(length);
+
+	// We need to flush any remaining blocks in the new allocation to make sure
+	// they won't interfere with the file cache.
+	block_cache_discard(fVolume->BlockCache(), fVolume->ToBlock(run),
+		run.Length());
+
+	T(Allocate(run));
 	return B_OK;
 }
 
 
+void
+BlockAllocator::_AddUsedBlocks(int32 blocks)
+{
+	fVolume->SuperBlock().used_blocks
+		= HOST_ENDIAN_TO_BFS_INT64(fVolume->UsedBlocks() + blocks);
+		// We are not writing back the disk's superblock - it's
+		// either done by the journaling code, or when the disk
+		// is unmounted.
+		// If the value is not correct at mount time, it will be
+		// fixed anyway.
+}
+
+
 #ifdef DEBUG_FRAGMENTER
 void
 BlockAllocator::Fragment()
@@ -1099,6 +1372,7 @@ BlockAllocator::Fragment()
 
 	for (int32 i = 0; i < fNumGroups; i++) {
 		AllocationGroup& group = fGroups[i];
+		group.fExtentsValid = false;
 
 		for (uint32 block = 0; block < group.NumBlocks(); block++) {
 			Transaction transaction(fVolume, 0);
@@ -1122,57 +1396,58 @@ void
 BlockAllocator::_CheckGroup(int32 groupIndex) const
 {
 	AllocationBlock cached(fVolume);
-	ASSERT_LOCKED_RECURSIVE(&fLock);
-
 	AllocationGroup& group = fGroups[groupIndex];
+	ASSERT_LOCKED_RECURSIVE(&fLock);
 
-	int32 currentStart = 0, currentLength = 0;
+	uint32 bitsPerBlock = fVolume->BlockSize() << 3;
+	int32 numBits = group.NumBits();
+	int32 currentStart = -1;
 	int32 firstFree = -1;
-	int32 largestStart = -1;
-	int32 largestLength = 0;
-	int32 currentBit = 0;
-
-	for (uint32 block = 0; block < group.NumBlocks(); block++) {
-		if (cached.SetTo(group, block) < B_OK) {
-			panic("setting group block %d failed\n", (int)block);
-			return;
+	int32 trackedExtents = 0;
+
+	// the extra iteration ends the last range
+	for (int32 bit = 0; bit <= numBits; bit++) {
+		bool isFree = false;
+		if (bit < numBits) {
+			if (bit % bitsPerBlock == 0
+				&& cached.SetTo(group, bit / bitsPerBlock) < B_OK) {
+				panic("setting group block %d failed\n",
+					(int)(bit / bitsPerBlock));
+				return;
+			}
+			isFree = !cached.IsUsed(bit % bitsPerBlock);
 		}
 
-		for (uint32 bit = 0; bit < cached.NumBlockBits(); bit++) {
-			if (!cached.IsUsed(bit)) {
-				if (firstFree < 0) {
-					firstFree = currentBit;
-					if (!group.fLargestValid) {
-						if (firstFree >= 0 && firstFree < group.fFirstFree) {
-							// mostly harmless but noteworthy
-							dprintf("group %d first free too late: should be "
-								"%d, is %d\n", (int)groupIndex, (int)firstFree,
-								(int)group.fFirstFree);
-						}
-						return;
-					}
-				}
-
-				if (currentLength == 0) {
-					// start new range
-					currentStart = currentBit;
-				}
-				currentLength++;
-			} else if (currentLength) {
-				// end of a range
-				if (currentLength > largestLength) {
-					largestStart = currentStart;
-					largestLength = currentLength;
-				}
-				currentLength = 0;
+		if (isFree) {
+			if (firstFree < 0)
+				firstFree = bit;
+			if (currentStart < 0) {
+				// start new range
+				currentStart = bit;
 			}
-			currentBit++;
+			continue;
 		}
-	}
+		if (currentStart < 0)
+			continue;
 
-	if (currentLength > largestLength) {
-		largestStart = currentStart;
-		largestLength = currentLength;
+		// end of a range, check if the group knows it correctly
+		int32 length = bit - currentStart;
+		bool tracked = false;
+		for (int32 i = 0; i < group.fExtentCount; i++) {
+			if (group.fExtents[i].start == currentStart
+				&& group.fExtents[i].length == length) {
+				tracked = true;
+				break;
+			}
+		}
+		if (tracked)
+			trackedExtents++;
+		else if (group.fExtentsValid && length > group.fUntrackedLength) {
+			panic("bfs %p: group %d free range %d.%d is not tracked, but "
+				"longer than %d.\n", fVolume, (int)groupIndex,
+				(int)currentStart, (int)length, (int)group.fUntrackedLength);
+		}
+		currentStart = -1;
 	}
 
 	if (firstFree >= 0 && firstFree < group.fFirstFree) {
@@ -1180,12 +1455,10 @@ BlockAllocator::_CheckGroup(int32 groupIndex) const
 		dprintf("group %d first free too late: should be %d, is %d\n",
 			(int)groupIndex, (int)firstFree, (int)group.fFirstFree);
 	}
-	if (group.fLargestValid
-		&& (largestStart != group.fLargestStart
-			|| largestLength != group.fLargestLength)) {
-		panic("bfs %p: group %d largest differs: %d.%d, checked %d.%d.\n",
-			fVolume, (int)groupIndex, (int)group.fLargestStart,
-			(int)group.fLargestLength, (int)largestStart, (int)largestLength);
+	if (group.fExtentsValid && trackedExtents != group.fExtentCount) {
+		panic("bfs %p: group %d tracks %d free extents that don't exist.\n",
+			fVolume, (int)groupIndex,
+			(int)(group.fExtentCount - trackedExtents));
 	}
 }
 #endif	// DEBUG_ALLOCATION_GROUPS
@@ -1431,10 +1704,15 @@ BlockAllocator::Dump(int32 index)
 		kprintf("      num blocks:     %" B_PRIu32 "\n", group.NumBitmapBlocks());
 		kprintf("      start:          %" B_PRId32 "\n", group.Start());
 		kprintf("      first free:     %" B_PRId32 "\n", group.fFirstFree);
-		kprintf("      largest start:  %" B_PRId32 "%s\n", group.fLargestStart,
-			group.fLargestValid ? "" : "  (invalid)");
-		kprintf("      largest length: %" B_PRId32 "\n", group.fLargestLength);
 		kprintf("      free bits:      %" B_PRId32 "\n", group.fFreeBits);
+		kprintf("      free extents:   %" B_PRId32 "%s\n", group.fExtentCount,
+			group.fExtentsValid ? "" : "  (invalid)");
+		for (int32 j = 0; j < group.fExtentCount; j++) {
+			kprintf("        %" B_PRId32 ".%" B_PRId32 "\n",
+				group.fExtents[j].start, group.fExtents[j].length);
+		}
+		kprintf("      others up to:   %" B_PRId32 "\n",
+			group.fUntrackedLength);
 	}
 }
 
@@ -39,6 +39,8 @@ public:
 								uint16 minimum = 1);
 			status_t		Free(Transaction& transaction, block_run run);
 
+			status_t		Rescan();
+
 			status_t		AllocateBlocks(Transaction& transaction,
 								int32 group, uint16 start, uint16 numBlocks,
 								uint16 minimum, block_run& run);
@@ -68,6 +70,11 @@ private:
 #ifdef DEBUG_ALLOCATION_GROUPS
 			void			_CheckGroup(int32 group) const;
 #endif
+			status_t		_AllocateRange(Transaction& transaction,
+								int32 group, int32 start, int32 length,
+								block_run& run);
+			void			_AddUsedBlocks(int32 blocks);
+
 			bool			_AddTrim(fs_trim_data& trimData, uint32 maxRanges,
 								uint64 offset, uint64 size);
 			status_t		_TrimNext(fs_trim_data& trimData, uint32 maxRanges,
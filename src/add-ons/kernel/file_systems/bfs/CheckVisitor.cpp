@@ -92,7 +92,6 @@ CheckVisitor::WriteBackCheckBitmap()
 	size_t size = _BitmapSize();
 	off_t usedBlocks = 0LL;
 
-	// TODO: update the allocation groups used blocks info
 	for (uint32 i = size >> 2; i-- > 0;) {
 		uint32 compare = 1;
 		// Count the number of bits set
@@ -153,6 +152,11 @@ CheckVisitor::WriteBackCheckBitmap()
 			}
 			transaction.Done();
 		}
+
+		// let the allocator know about the changes
+		status_t status = GetVolume()->Allocator().Rescan();
+		if (status != B_OK)
+			return status;
 	}
 
 	return B_OK;
@@ -479,6 +483,13 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 		return B_OK;
 	}
 
+	if (inode->IsInline() && !_IsInlineDataValid(inode)) {
+		FATAL(("inode at %" B_PRIdOFF " has invalid inline data!\n",
+			inode->BlockNumber()));
+		Control().errors |= BFS_INVALID_INLINE_DATA;
+			// any data stream it might have is still checked below
+	}
+
 	data_stream* data = &inode->Node().data;
 
 	// check the direct range
@@ -602,6 +613,36 @@ CheckVisitor::_CheckInodeBlocks(Inode* inode, const char* name)
 }
 
 
+/*!	Checks that a file with inline data has no data stream, and that the
+	data in its small_data section matches its size.
+*/
+bool
+CheckVisitor::_IsInlineDataValid(Inode* inode)
+{
+	if (!GetVolume()->HasInlineData() || !inode->IsFile())
+		return false;
+
+	const data_stream& data = inode->Node().data;
+	if (!data.direct[0].IsZero() || data.MaxDirectRange() != 0
+		|| !data.indirect.IsZero() || !data.double_indirect.IsZero())
+		return false;
+
+	NodeGetter node(GetVolume());
+	if (node.SetTo(inode) != B_OK)
+		return false;
+
+	RecursiveLocker locker(inode->SmallDataLock());
+
+	const char inlineTag[2] = {INLINE_DATA_NAME, 0};
+	small_data* item = inode->FindSmallData(node.Node(), inlineTag);
+	if (item == NULL)
+		return inode->Size() == 0;
+
+	return item->Type() == INLINE_DATA_TYPE
+		&& item->DataSize() == inode->Size();
+}
+
+
 status_t
 CheckVisitor::_CheckAllocated(block_run run, const char* type)
 {
@@ -56,6 +56,7 @@ private:
 			void				_SetCheckBitmapAt(off_t block);
 			status_t			_CheckInodeBlocks(Inode* inode,
 									const char* name);
+			bool				_IsInlineDataValid(Inode* inode);
 			status_t			_CheckAllocated(block_run run,
 									const char* type);
 
@@ -0,0 +1,550 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * This file may be used under the terms of the MIT License.
+ */
+
+
+//! In-memory hash index of the entries of large directories
+
+
+#include "DirectoryCache.h"
+
+#ifndef FS_SHELL
+#	include <low_resource_manager.h>
+#endif
+
+#include "BPlusTree.h"
+#include "Debug.h"
+#include "Inode.h"
+
+
+/*!	Looking up a name in a B+tree needs to visit a node on every level of the
+	tree, and to compare the name against the keys of each node. For
+	directories with hundreds of thousands of entries, this becomes the
+	dominating cost of open() and stat().
+
+	Once a large directory has seen enough lookups, a DirectoryCache maps
+	all of its names to their inode IDs in a hash table. The cache is always
+	complete, so a miss is authoritative, too; BPlusTree keeps it in sync on
+	every change of the tree, and drops it when a transaction that changed
+	the tree fails.
+	The memory used by all caches is limited, and they are freed in least
+	recently used order when the system runs low on memory.
+
+	Lookups only need the read lock of a cache, so that they can run in
+	parallel; changing or building it needs the write lock. Since the low
+	memory handler cannot wait for that lock, everyone also registers in
+	fUsers while working with the table, and the handler only frees caches
+	nobody is using. It holds sLock while doing so, which anyone who finds
+	the cache being freed waits for.
+*/
+
+
+// Minimum number of tree nodes a directory needs to be worth caching
+static const int32 kMinTreeNodes = 32;
+// Number of lookups in a directory before its cache is built
+static const int32 kBuildThreshold = 64;
+// Maximum memory used by all caches together
+static const size_t kMaxMemory = 64 * 1024 * 1024;
+static const uint32 kInitialTableSize = 256;
+// Added to fUsers while the low memory handler frees a cache
+static const int32 kEvicting = -0x40000000;
+
+
+struct DirectoryCache::Entry {
+	Entry*	next;
+	off_t	id;
+	uint32	hash;
+	uint16	length;
+	uint8	name[0];
+};
+
+
+struct DirectoryCache::UsageLocking {
+	inline bool Lock(DirectoryCache* cache)
+	{
+		while (atomic_add(&cache->fUsers, 1) < 0) {
+			atomic_add(&cache->fUsers, -1);
+
+			// the low memory handler is freeing the cache right now
+			MutexLocker locker(sLock);
+		}
+		return true;
+	}
+
+	inline void Unlock(DirectoryCache* cache)
+	{
+		atomic_add(&cache->fUsers, -1);
+	}
+};
+
+
+mutex DirectoryCache::sLock = MUTEX_INITIALIZER("bfs directory caches");
+DoublyLinkedList<DirectoryCache> DirectoryCache::sCaches;
+size_t DirectoryCache::sMemory = 0;
+int32 DirectoryCache::sHandlerRound = 0;
+
+
+static inline uint32
+hash_name(const uint8* name, uint16 length)
+{
+	uint32 hash = 0;
+	for (uint16 i = 0; i < length; i++)
+		hash = (hash << 5) - hash + name[i];
+
+	return hash;
+}
+
+
+//	#pragma mark -
+
+
+DirectoryCache::DirectoryCache()
+	:
+	fUsers(0),
+	fTable(NULL),
+	fTableSize(0),
+	fCount(0),
+	fMemory(0),
+	fLookups(0),
+	fLastUsed(0),
+	fHandlerRound(0)
+{
+	rw_lock_init(&fLock, "bfs directory cache");
+}
+
+
+DirectoryCache::~DirectoryCache()
+{
+	Invalidate();
+	rw_lock_destroy(&fLock);
+}
+
+
+/*!	Looks up the name in the cache, and builds the cache if the directory is
+	large and has been looked up often enough.
+	Returns B_OK and the ID of the entry if the name could be found, or
+	B_ENTRY_NOT_FOUND if the directory doesn't contain it. If there is no
+	cache, B_NO_INIT is returned, and the tree needs to be searched instead.
+	You need to have the inode read or write locked.
+*/
+status_t
+DirectoryCache::Lookup(BPlusTree* tree, const uint8* name, uint16 length,
+	off_t* _id)
+{
+	ReadLocker locker(fLock);
+	UsageLocker usage(this);
+
+	if (fTable != NULL)
+		return _Lookup(name, length, _id);
+
+	if (atomic_add(&fLookups, 1) + 1 < kBuildThreshold)
+		return B_NO_INIT;
+
+	// Building the cache needs the write lock; the tree cannot change in
+	// the meantime, as the caller keeps the inode locked
+	usage.Unlock();
+	locker.Unlock();
+
+	WriteLocker writeLocker(fLock);
+	usage.Lock();
+
+	if (fTable == NULL) {
+		atomic_set(&fLookups, 0);
+		if (tree->Stream()->Size() < kMinTreeNodes * (off_t)tree->NodeSize()
+			|| _Build(tree) != B_OK)
+			return B_NO_INIT;
+	}
+
+	return _Lookup(name, length, _id);
+}
+
+
+/*!	Adds the entry to the cache, if there is one. If that fails, the whole
+	cache is dropped, since it would no longer be complete.
+	You need to have the inode write locked.
+*/
+void
+DirectoryCache::Insert(const uint8* name, uint16 length, off_t id)
+{
+	WriteLocker locker(fLock);
+	UsageLocker usage(this);
+
+	if (fTable != NULL && !_Add(name, length, id))
+		_Free();
+}
+
+
+/*!	Removes the entry from the cache, if there is one.
+	You need to have the inode write locked.
+*/
+void
+DirectoryCache::Remove(const uint8* name, uint16 length)
+{
+	WriteLocker locker(fLock);
+	UsageLocker usage(this);
+
+	if (fTable == NULL)
+		return;
+
+	uint32 hash = hash_name(name, length);
+	Entry** link = &fTable[hash & (fTableSize - 1)];
+	while (Entry* entry = *link) {
+		if (entry->hash == hash && entry->length == length
+			&& memcmp(entry->name, name, length) == 0) {
+			*link = entry->next;
+			fCount--;
+
+			free(entry);
+			_Unaccount(sizeof(Entry) + length);
+			return;
+		}
+		link = &entry->next;
+	}
+}
+
+
+/*!	Drops the cache; it will be built again once the directory is used
+	heavily enough.
+*/
+void
+DirectoryCache::Invalidate()
+{
+	WriteLocker locker(fLock);
+	UsageLocker usage(this);
+
+	_Free();
+	atomic_set(&fLookups, 0);
+}
+
+
+/*static*/ status_t
+DirectoryCache::Init()
+{
+#ifndef FS_SHELL
+	return register_low_resource_handler(&_LowMemoryHandler, NULL,
+		B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY
+			| B_KERNEL_RESOURCE_ADDRESS_SPACE, 0);
+#else
+	return B_OK;
+#endif
+}
+
+
+/*static*/ void
+DirectoryCache::Uninit()
+{
+#ifndef FS_SHELL
+	unregister_low_resource_handler(&_LowMemoryHandler, NULL);
+#endif
+}
+
+
+/*!	You must hold fLock, and be registered in fUsers. */
+status_t
+DirectoryCache::_Lookup(const uint8* name, uint16 length, off_t* _id)
+{
+	fLastUsed = system_time();
+		// only a hint for the low memory handler, a lost update is harmless
+
+	Entry* entry = _Find(name, length, hash_name(name, length));
+	if (entry == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	if (_id != NULL)
+		*_id = entry->id;
+	return B_OK;
+}
+
+
+/*!	Reads all entries from the leaf nodes of the tree into the cache.
+	The tree cannot change while we're reading it, since the caller has the
+	inode locked.
+	You must hold fLock in write mode.
+*/
+status_t
+DirectoryCache::_Build(BPlusTree* tree)
+{
+#ifndef FS_SHELL
+	if (low_resource_state(B_KERNEL_RESOURCE_PAGES | B_KERNEL_RESOURCE_MEMORY
+			| B_KERNEL_RESOURCE_ADDRESS_SPACE) != B_NO_LOW_RESOURCE)
+		return B_NO_MEMORY;
+#endif
+
+	if (!_Account(kInitialTableSize * sizeof(Entry*)))
+		return B_NO_MEMORY;
+
+	fTable = (Entry**)calloc(kInitialTableSize, sizeof(Entry*));
+	if (fTable == NULL) {
+		_Free();
+		return B_NO_MEMORY;
+	}
+	fTableSize = kInitialTableSize;
+
+	off_t nodeOffset = tree->fHeader.RootNode();
+	CachedNode cached(tree);
+	const bplustree_node* node;
+
+	// find the leftmost leaf node
+	while ((node = cached.SetTo(nodeOffset)) != NULL
+		&& node->OverflowLink() != BPLUSTREE_NULL) {
+		off_t nextOffset = node->NumKeys() == 0 ? node->OverflowLink()
+			: BFS_ENDIAN_TO_HOST_INT64(node->Values()[0]);
+		if (nextOffset == nodeOffset) {
+			_Free();
+			RETURN_ERROR(B_BAD_DATA);
+		}
+
+		nodeOffset = nextOffset;
+	}
+
+	// and add the keys of all leaf nodes from there on; the node count
+	// guards us against loops in the right links
+	off_t maxNodes = tree->Stream()->Size() / tree->NodeSize();
+	status_t status = B_OK;
+
+	while (node != NULL && maxNodes-- > 0) {
+		for (int32 i = 0; i < node->NumKeys(); i++) {
+			off_t id = BFS_ENDIAN_TO_HOST_INT64(node->Values()[i]);
+			uint16 length;
+			uint8* name = node->KeyAt(i, &length);
+			if (name == NULL || length > BPLUSTREE_MAX_KEY_LENGTH
+				|| bplustree_node::IsDuplicate(id)) {
+				status = B_BAD_DATA;
+				break;
+			}
+			if (!_Add(name, length, id)) {
+				status = B_NO_MEMORY;
+				break;
+			}
+		}
+		if (status != B_OK)
+			break;
+
+		if (node->RightLink() == BPLUSTREE_NULL) {
+			fLastUsed = system_time();
+			return B_OK;
+		}
+
+		node = cached.SetTo(node->RightLink());
+	}
+
+	_Free();
+	if (status == B_OK)
+		status = B_BAD_DATA;
+	RETURN_ERROR(status);
+}
+
+
+DirectoryCache::Entry*
+DirectoryCache::_Find(const uint8* name, uint16 length, uint32 hash) const
+{
+	Entry* entry = fTable[hash & (fTableSize - 1)];
+	while (entry != NULL) {
+		if (entry->hash == hash && entry->length == length
+			&& memcmp(entry->name, name, length) == 0)
+			return entry;
+
+		entry = entry->next;
+	}
+
+	return NULL;
+}
+
+
+bool
+DirectoryCache::_Add(const uint8* name, uint16 length, off_t id)
+{
+	uint32 hash = hash_name(name, length);
+
+	Entry* entry = _Find(name, length, hash);
+	if (entry != NULL) {
+		entry->id = id;
+		return true;
+	}
+
+	if (!_Account(sizeof(Entry) + length))
+		return false;
+
+	entry = (Entry*)malloc(sizeof(Entry) + length);
+	if (entry == NULL) {
+		_Unaccount(sizeof(Entry) + length);
+		return false;
+	}
+
+	entry->id = id;
+	entry->hash = hash;
+	entry->length = length;
+	memcpy(entry->name, name, length);
+
+	Entry*& head = fTable[hash & (fTableSize - 1)];
+	entry->next = head;
+	head = entry;
+
+	if (++fCount > fTableSize)
+		_Resize(fTableSize * 2);
+
+	return true;
+}
+
+
+/*!	Grows the hash table. If there is not enough memory for that, the old
+	table just remains in use.
+*/
+void
+DirectoryCache::_Resize(uint32 tableSize)
+{
+	if (!_Account((tableSize - fTableSize) * sizeof(Entry*)))
+		return;
+
+	Entry** table = (Entry**)calloc(tableSize, sizeof(Entry*));
+	if (table == NULL) {
+		_Unaccount((tableSize - fTableSize) * sizeof(Entry*));
+		return;
+	}
+
+	for (uint32 i = 0; i < fTableSize; i++) {
+		Entry* entry = fTable[i];
+		while (entry != NULL) {
+			Entry* next = entry->next;
+			Entry*& head = table[entry->hash & (tableSize - 1)];
+			entry->next = head;
+			head = entry;
+			entry = next;
+		}
+	}
+
+	free(fTable);
+	fTable = table;
+	fTableSize = tableSize;
+}
+
+
+/*!	Frees the cache, and gives back its memory.
+	You must hold fLock in write mode.
+*/
+void
+DirectoryCache::_Free()
+{
+	if (fMemory == 0)
+		return;
+
+	MutexLocker locker(sLock);
+	sCaches.Remove(this);
+	sMemory -= fMemory;
+	locker.Unlock();
+
+	_FreeTable();
+}
+
+
+/*!	Frees all entries and the table; the caller is responsible for the
+	global accounting.
+*/
+void
+DirectoryCache::_FreeTable()
+{
+	for (uint32 i = 0; i < fTableSize; i++) {
+		Entry* entry = fTable[i];
+		while (entry != NULL) {
+			Entry* next = entry->next;
+			free(entry);
+			entry = next;
+		}
+	}
+
+	free(fTable);
+	fTable = NULL;
+	fTableSize = 0;
+	fCount = 0;
+	fMemory = 0;
+}
+
+
+/*!	Reserves the given amount of memory for this cache, and makes it known to
+	the low memory handler. Returns false if the caches have already used up
+	their share of memory.
+	You must hold fLock in write mode.
+*/
+bool
+DirectoryCache::_Account(size_t size)
+{
+	MutexLocker locker(sLock);
+
+	if (sMemory + size > kMaxMemory)
+		return false;
+
+	if (fMemory == 0)
+		sCaches.Add(this);
+
+	fMemory += size;
+	sMemory += size;
+	return true;
+}
+
+
+/*!	You must hold fLock in write mode. */
+void
+DirectoryCache::_Unaccount(size_t size)
+{
+	MutexLocker locker(sLock);
+
+	fMemory -= size;
+	sMemory -= size;
+}
+
+
+#ifndef FS_SHELL
+/*!	Frees caches, least recently used first, until the memory used by them
+	is down to what is acceptable for the current state.
+	Caches that are in use right now are left alone.
+*/
+/*static*/ void
+DirectoryCache::_LowMemoryHandler(void* /*data*/, uint32 /*resources*/,
+	int32 level)
+{
+	MutexLocker locker(sLock);
+
+	size_t target;
+	switch (level) {
+		case B_NO_LOW_RESOURCE:
+			return;
+		case B_LOW_RESOURCE_NOTE:
+			target = sMemory / 2;
+			break;
+		case B_LOW_RESOURCE_WARNING:
+			target = sMemory / 4;
+			break;
+		case B_LOW_RESOURCE_CRITICAL:
+		default:
+			target = 0;
+			break;
+	}
+
+	int32 round = ++sHandlerRound;
+
+	while (sMemory > target) {
+		DirectoryCache* oldest = NULL;
+
+		DoublyLinkedList<DirectoryCache>::Iterator iterator
+			= sCaches.GetIterator();
+		while (DirectoryCache* cache = iterator.Next()) {
+			if (cache->fHandlerRound != round
+				&& (oldest == NULL || cache->fLastUsed < oldest->fLastUsed))
+				oldest = cache;
+		}
+		if (oldest == NULL)
+			break;
+
+		oldest->fHandlerRound = round;
+		if (atomic_test_and_set(&oldest->fUsers, kEvicting, 0) != 0)
+			continue;
+
+		sCaches.Remove(oldest);
+		sMemory -= oldest->fMemory;
+		oldest->_FreeTable();
+
+		atomic_add(&oldest->fUsers, -kEvicting);
+	}
+}
+#endif	// !FS_SHELL
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * This file may be used under the terms of the MIT License.
+ */
+#ifndef DIRECTORY_CACHE_H
+#define DIRECTORY_CACHE_H
+
+
+#include "system_dependencies.h"
+
+
+class BPlusTree;
+
+
+class DirectoryCache : public DoublyLinkedListLinkImpl<DirectoryCache> {
+public:
+								DirectoryCache();
+								~DirectoryCache();
+
+			status_t			Lookup(BPlusTree* tree, const uint8* name,
+									uint16 length, off_t* _id);
+			void				Insert(const uint8* name, uint16 length,
+									off_t id);
+			void				Remove(const uint8* name, uint16 length);
+			void				Invalidate();
+
+	static	status_t			Init();
+	static	void				Uninit();
+
+private:
+			struct Entry;
+			struct UsageLocking;
+			typedef AutoLocker<DirectoryCache, UsageLocking> UsageLocker;
+
+			status_t			_Lookup(const uint8* name, uint16 length,
+									off_t* _id);
+			status_t			_Build(BPlusTree* tree);
+			Entry*				_Find(const uint8* name, uint16 length,
+									uint32 hash) const;
+			bool				_Add(const uint8* name, uint16 length,
+									off_t id);
+			void				_Resize(uint32 tableSize);
+			void				_Free();
+			void				_FreeTable();
+
+			bool				_Account(size_t size);
+			void				_Unaccount(size_t size);
+
+#ifndef FS_SHELL
+	static	void				_LowMemoryHandler(void* data,
+									uint32 resources, int32 level);
+#endif
+
+private:
+			rw_lock				fLock;
+			int32				fUsers;
+			Entry**				fTable;
+			uint32				fTableSize;
+			uint32				fCount;
+			size_t				fMemory;
+			int32				fLookups;
+			bigtime_t			fLastUsed;
+			int32				fHandlerRound;
+
+	static	mutex				sLock;
+	static	DoublyLinkedList<DirectoryCache> sCaches;
+	static	size_t				sMemory;
+	static	int32				sHandlerRound;
+};
+
+
+#endif	// DIRECTORY_CACHE_H
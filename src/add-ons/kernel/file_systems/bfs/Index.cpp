@@ -270,6 +270,8 @@ Index::Update(Transaction& transaction, const char* name, int32 type,
 			INFORM(("Could not find value in index \"%s\"!\n", name));
 		} else if (status != B_OK)
 			return status;
+		else
+			Node()->UpdateIndexStatistics(oldKey, oldLength, NULL, 0);
 	}
 
 	// add the new key to the tree
@@ -277,6 +279,8 @@ Index::Update(Transaction& transaction, const char* name, int32 type,
 	if (newKey != NULL) {
 		status = tree->Insert(transaction, (const uint8*)newKey, newLength,
 			inode->ID());
+		if (status == B_OK)
+			Node()->UpdateIndexStatistics(NULL, 0, newKey, newLength);
 	}
 
 	RETURN_ERROR(status);
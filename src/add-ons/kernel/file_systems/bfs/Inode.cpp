@@ -12,6 +12,8 @@
 #include "BPlusTree.h"
 #include "Index.h"
 
+#include <file_systems/QueryStatistics.h>
+
 
 #if BFS_TRACING && !defined(FS_SHELL) && !defined(_BOOT_MODE)
 namespace BFSInodeTracing {
@@ -134,6 +136,9 @@ private:
 #endif
 
 
+static const char kInlineDataTag[2] = {INLINE_DATA_NAME, 0};
+
+
 /*!	A helper class used by Inode::Create() to keep track of the belongings
 	of an inode creation in progress.
 	This class will make sure everything is cleaned up properly.
@@ -344,7 +349,8 @@ Inode::Inode(Volume* volume, ino_t id)
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fIndexStatistics(NULL)
 {
 	PRINT(("Inode::Inode(volume = %p, id = %" B_PRIdINO ") @ %p\n",
 		volume, id, this));
@@ -378,7 +384,8 @@ Inode::Inode(Volume* volume, Transaction& transaction, ino_t id, mode_t mode,
 	fTree(NULL),
 	fAttributes(NULL),
 	fCache(NULL),
-	fMap(NULL)
+	fMap(NULL),
+	fIndexStatistics(NULL)
 {
 	PRINT(("Inode::Inode(volume = %p, transaction = %p, id = %" B_PRIdINO
 		") @ %p\n", volume, &transaction, id, this));
@@ -423,6 +430,7 @@ Inode::~Inode()
 	file_cache_delete(FileCache());
 	file_map_delete(Map());
 	delete fTree;
+	delete fIndexStatistics;
 
 	rw_lock_destroy(&fLock);
 	recursive_lock_destroy(&fSmallDataLock);
@@ -568,7 +576,9 @@ Inode::_MakeSpaceForSmallData(Transaction& transaction, bfs_inode* node,
 		int32 index = 0, maxIndex = 0;
 		for (; !item->IsLast(node); item = item->Next(), index++) {
 			// should not remove those
-			if (*item->Name() == FILE_NAME_NAME || !strcmp(name, item->Name()))
+			if (*item->Name() == FILE_NAME_NAME
+				|| *item->Name() == INLINE_DATA_NAME
+				|| !strcmp(name, item->Name()))
 				continue;
 
 			if (max == NULL || max->Size() < item->Size()) {
@@ -1415,6 +1425,59 @@ Inode::ContainerContentsChanged(Transaction& transaction)
 }
 
 
+/*!	Copies the statistics the query planner gathered for this index, if
+	there are any.
+	They are only kept in memory, as long as the index inode is.
+*/
+status_t
+Inode::GetIndexStatistics(QueryParser::IndexStatistics& statistics)
+{
+	ReadLocker locker(fLock);
+
+	if (fIndexStatistics == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	statistics = *fIndexStatistics;
+	return B_OK;
+}
+
+
+status_t
+Inode::SetIndexStatistics(const QueryParser::IndexStatistics& statistics)
+{
+	WriteLocker locker(fLock);
+
+	if (fIndexStatistics == NULL) {
+		fIndexStatistics = new(std::nothrow) QueryParser::IndexStatistics;
+		if (fIndexStatistics == NULL)
+			return B_NO_MEMORY;
+	}
+
+	*fIndexStatistics = statistics;
+	return B_OK;
+}
+
+
+/*!	Keeps the statistics of this index up to date when a key is removed
+	from it, added to it, or both.
+	You need to hold the inode's write lock when calling this method.
+*/
+void
+Inode::UpdateIndexStatistics(const uint8* oldKey, uint16 oldLength,
+	const uint8* newKey, uint16 newLength)
+{
+	ASSERT_WRITE_LOCKED_INODE(this);
+
+	if (fIndexStatistics == NULL)
+		return;
+
+	if (oldKey != NULL)
+		fIndexStatistics->KeyRemoved(oldKey, oldLength);
+	if (newKey != NULL)
+		fIndexStatistics->KeyAdded(newKey, newLength);
+}
+
+
 //	#pragma mark - data stream
 
 
@@ -1574,6 +1637,15 @@ Inode::FindBlockRun(off_t pos, block_run& run, off_t& offset)
 status_t
 Inode::ReadAt(off_t pos, uint8* buffer, size_t* _length)
 {
+	if (IsInline()) {
+		InodeReadLocker locker(this);
+
+		// The file can only have been converted to a regular data stream
+		// since we looked
+		if (IsInline())
+			return _ReadInlineData(pos, buffer, _length);
+	}
+
 	return file_cache_read(FileCache(), NULL, pos, buffer, _length);
 }
 
@@ -1601,6 +1673,17 @@ Inode::WriteAt(Transaction& transaction, off_t pos, const uint8* buffer,
 
 	locker.Unlock();
 
+	if (IsInline()) {
+		bool converted;
+		status_t status = _WriteInlineData(transaction, pos, buffer, _length,
+			converted);
+		if (!converted)
+			return status;
+
+		// the data no longer fits into the inode, and the file now has a
+		// regular data stream
+	}
+
 	// the transaction doesn't have to be started already
 	if (changeSize && !transaction.IsStarted())
 		transaction.Start(fVolume, BlockNumber());
@@ -1668,6 +1751,11 @@ Inode::WriteAt(Transaction& transaction, off_t pos, const uint8* buffer,
 status_t
 Inode::FillGapWithZeros(off_t pos, off_t newSize)
 {
+	if (IsInline()) {
+		// the inline data is always padded with zeros already
+		return B_OK;
+	}
+
 	while (pos < newSize) {
 		size_t size;
 		if (newSize > pos + 1024 * 1024 * 1024)
@@ -2277,6 +2365,20 @@ Inode::SetFileSize(Transaction& transaction, off_t size)
 	if (size == oldSize)
 		return B_OK;
 
+	if (IsInline()) {
+		status_t status = B_DEVICE_FULL;
+		if ((uint64)size <= _MaxInlineDataSize())
+			status = _SetInlineData(transaction, 0, NULL, 0, size);
+		if (status == B_OK)
+			_DiscardInlinePages(size);
+		if (status != B_DEVICE_FULL)
+			return status;
+
+		status = _ConvertInlineData(transaction);
+		if (status != B_OK)
+			return status;
+	}
+
 	T(Resize(this, oldSize, size, false));
 
 	// should the data stream grow or shrink?
@@ -2308,6 +2410,22 @@ Inode::Append(Transaction& transaction, off_t bytes)
 }
 
 
+/*!	Moves the data of an inline file into a regular data stream. Its pages
+	can only be written back from there, so this has to be done before the
+	file is mapped shared and writable.
+*/
+status_t
+Inode::ConvertInlineData(Transaction& transaction)
+{
+	WriteLocker locker(fLock);
+
+	if (!IsInline())
+		return B_OK;
+
+	return _ConvertInlineData(transaction);
+}
+
+
 /*!	Checks whether or not this inode's data stream needs to be trimmed
 	because of an earlier preallocation.
 	Returns true if there are any blocks to be trimmed.
@@ -2386,6 +2504,11 @@ Inode::Free(Transaction& transaction)
 status_t
 Inode::Sync()
 {
+	if (IsInline()) {
+		// the data is part of the inode, and thus only written via the log
+		return fVolume->GetJournal(BlockNumber())->FlushLogAndBlocks();
+	}
+
 	if (FileCache())
 		return file_cache_sync(FileCache());
 
@@ -2484,6 +2607,246 @@ Inode::Sync()
 }
 
 
+//	#pragma mark - inline data
+
+
+/*!	Returns the maximum size of the data of a file that may be kept in the
+	small_data section of its inode. There is always enough room left for a
+	name of maximum length.
+*/
+size_t
+Inode::_MaxInlineDataSize() const
+{
+	const size_t itemOverhead = sizeof(small_data) + 1 + 3 + 1;
+		// one character name, padding, and the terminating null byte
+
+	return fVolume->InodeSize() - sizeof(bfs_inode) - 2 * itemOverhead
+		- (B_FILE_NAME_LENGTH - 1);
+}
+
+
+/*!	Reads from the data of a file that is stored in its inode.
+	You need to hold the inode's read lock when calling this method.
+*/
+status_t
+Inode::_ReadInlineData(off_t pos, uint8* buffer, size_t* _length)
+{
+	if (pos < 0)
+		return B_BAD_VALUE;
+
+	off_t size = Size();
+	if (pos >= size || *_length == 0) {
+		*_length = 0;
+		return B_OK;
+	}
+
+	size_t length = *_length;
+	if (pos + (off_t)length > size)
+		length = size - pos;
+
+	NodeGetter node(fVolume);
+	status_t status = node.SetTo(this);
+	if (status != B_OK)
+		return status;
+
+	RecursiveLocker locker(fSmallDataLock);
+
+	small_data* item = FindSmallData(node.Node(), kInlineDataTag);
+	if (item == NULL || item->DataSize() != size) {
+		FATAL(("inline data of inode %" B_PRIdINO " is corrupt!\n", ID()));
+		RETURN_ERROR(B_BAD_DATA);
+	}
+
+	if (user_memcpy(buffer, item->Data() + pos, length) != B_OK)
+		return B_BAD_ADDRESS;
+
+	*_length = length;
+	return B_OK;
+}
+
+
+/*!	Writes to a file that keeps its data in its inode. Unlike regular file
+	data, the data is written as part of the transaction.
+	If the new contents don't fit into the inode, the file is converted to
+	a regular data stream, and \a _converted is set to \c true; the caller
+	is then expected to write the data the usual way.
+*/
+status_t
+Inode::_WriteInlineData(Transaction& transaction, off_t pos,
+	const uint8* buffer, size_t* _length, bool& _converted)
+{
+	_converted = false;
+
+	if (!transaction.IsStarted())
+		transaction.Start(fVolume, BlockNumber());
+
+	WriteLocker writeLocker(fLock);
+
+	if (!IsInline()) {
+		// Someone else converted the file while we had no lock
+		_converted = true;
+		return B_OK;
+	}
+
+	size_t length = *_length;
+	status_t status = B_DEVICE_FULL;
+
+	if ((uint64)pos + (uint64)length <= _MaxInlineDataSize()) {
+		status = _SetInlineData(transaction, pos, buffer, length,
+			max_c(Size(), pos + (off_t)length));
+	}
+	if (status == B_DEVICE_FULL) {
+		// The data is either too large, or the attributes in the small_data
+		// section leave no room for it
+		status = _ConvertInlineData(transaction);
+		if (status == B_OK) {
+			_converted = true;
+			return B_OK;
+		}
+	}
+
+	if (status != B_OK)
+		*_length = 0;
+
+	// Like file_cache_write(), this must not be done with the inode locked,
+	// as reading in the pages needs its lock
+	off_t size = Size();
+	writeLocker.Unlock();
+
+	if (status == B_OK)
+		_DiscardInlinePages(size);
+
+	WriteLockInTransaction(transaction);
+	return status;
+}
+
+
+/*!	Sets the inline data of the file to \a size bytes. Its previous contents
+	are kept, or padded with zeros, and \a length bytes of \a buffer are
+	copied to \a pos on top. \a buffer may be a userland address.
+	Returns \c B_DEVICE_FULL if the data does not fit into the inode.
+	You need to hold the inode's write lock when calling this method.
+*/
+status_t
+Inode::_SetInlineData(Transaction& transaction, off_t pos,
+	const uint8* buffer, size_t length, off_t size)
+{
+	NodeGetter node(fVolume);
+	status_t status = node.SetToWritable(transaction, this);
+	if (status != B_OK)
+		return status;
+
+	if (size == 0) {
+		status = _RemoveSmallData(transaction, node, kInlineDataTag);
+		if (status != B_OK && status != B_ENTRY_NOT_FOUND)
+			return status;
+	} else {
+		uint8* data = (uint8*)malloc(size);
+		if (data == NULL)
+			return B_NO_MEMORY;
+
+		MemoryDeleter dataDeleter(data);
+
+		{
+			RecursiveLocker locker(fSmallDataLock);
+
+			small_data* item = FindSmallData(node.Node(), kInlineDataTag);
+			off_t oldSize = item != NULL ? item->DataSize() : 0;
+			if (oldSize > size)
+				oldSize = size;
+
+			if (oldSize > 0)
+				memcpy(data, item->Data(), oldSize);
+			memset(data + oldSize, 0, size - oldSize);
+		}
+
+		if (length > 0 && user_memcpy(data + pos, buffer, length) != B_OK)
+			return B_BAD_ADDRESS;
+
+		status = _AddSmallData(transaction, node, kInlineDataTag,
+			INLINE_DATA_TYPE, 0, data, size);
+		if (status != B_OK)
+			return status;
+	}
+
+	Node().data.size = HOST_ENDIAN_TO_BFS_INT64(size);
+	return WriteBack(transaction);
+}
+
+
+/*!	Moves the inline data of the file into a regular data stream; the file
+	will never be converted back.
+	The data is written to its new block directly, as the file cache does
+	not contain it.
+	You need to hold the inode's write lock when calling this method.
+*/
+status_t
+Inode::_ConvertInlineData(Transaction& transaction)
+{
+	off_t size = Size();
+	uint32 blockSize = fVolume->BlockSize();
+
+	uint8* block = (uint8*)malloc(blockSize);
+	if (block == NULL)
+		return B_NO_MEMORY;
+
+	MemoryDeleter blockDeleter(block);
+	memset(block, 0, blockSize);
+
+	if (size > 0) {
+		size_t length = size;
+		status_t status = _ReadInlineData(0, block, &length);
+		if (status != B_OK)
+			return status;
+
+		NodeGetter node(fVolume);
+		status = node.SetToWritable(transaction, this);
+		if (status == B_OK)
+			status = _RemoveSmallData(transaction, node, kInlineDataTag);
+		if (status != B_OK)
+			return status;
+	}
+
+	// Mappings of the file have to get their pages from the data stream
+	// from now on
+	file_cache_set_size(FileCache(), 0);
+
+	Node().flags &= ~HOST_ENDIAN_TO_BFS_INT32(INODE_INLINE_DATA);
+	Node().data.size = 0;
+
+	status_t status = SetFileSize(transaction, size);
+	if (status != B_OK)
+		return status;
+
+	if (size > 0) {
+		block_run run;
+		off_t offset;
+		status = FindBlockRun(0, run, offset);
+		if (status != B_OK)
+			return status;
+
+		if (write_pos(fVolume->Device(), fVolume->ToOffset(run), block,
+				blockSize) != (ssize_t)blockSize)
+			RETURN_ERROR(B_IO_ERROR);
+	}
+
+	return WriteBack(transaction);
+}
+
+
+/*!	The data of an inline file is not read through its file cache, but
+	mapping the file fills it with pages, too. Whenever the data changes,
+	these pages are removed, so that the mappings read it again on the next
+	access.
+*/
+void
+Inode::_DiscardInlinePages(off_t size)
+{
+	file_cache_set_size(FileCache(), 0);
+	file_cache_set_size(FileCache(), size);
+}
+
+
 //	#pragma mark - TransactionListener implementation
 
 
@@ -2741,6 +3104,11 @@ Inode::Create(Transaction& transaction, Inode* parent, const char* name,
 
 	node->type = HOST_ENDIAN_TO_BFS_INT32(type);
 
+	if (volume->HasInlineData() && inode->IsFile()) {
+		// the data of new files is kept in the inode until it gets too large
+		node->flags |= HOST_ENDIAN_TO_BFS_INT32(INODE_INLINE_DATA);
+	}
+
 	inode->WriteBack(transaction);
 		// make sure the initialized node is available to others
 
@@ -2894,8 +3262,10 @@ AttributeIterator::GetNext(char* name, size_t* _length, uint32* _type,
 
 		int32 index = 0;
 		for (; !item->IsLast(node); item = item->Next(), index++) {
-			if (item->NameSize() == FILE_NAME_NAME_LENGTH
-				&& *item->Name() == FILE_NAME_NAME)
+			if ((item->NameSize() == FILE_NAME_NAME_LENGTH
+					&& *item->Name() == FILE_NAME_NAME)
+				|| (item->NameSize() == INLINE_DATA_NAME_LENGTH
+					&& *item->Name() == INLINE_DATA_NAME))
 				continue;
 
 			if (index >= fCurrentSmallData)
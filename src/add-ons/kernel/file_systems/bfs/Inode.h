@@ -14,6 +14,10 @@
 #include "Volume.h"
 
 
+namespace QueryParser {
+	class IndexStatistics;
+};
+
 class BPlusTree;
 class TreeIterator;
 class AttributeIterator;
@@ -75,6 +79,11 @@ public:
 			bool				IsLongSymLink() const
 									{ return (Flags() & INODE_LONG_SYMLINK)
 										!= 0; }
+			bool				IsInline() const
+									{ return (Flags() & INODE_INLINE_DATA)
+										!= 0; }
+									// the file data is in the small_data
+									// section instead of the data stream
 
 			bool				HasUserAccessableStream() const
 									{ return IsFile(); }
@@ -141,6 +150,15 @@ public:
 			status_t			ContainerContentsChanged(
 									Transaction& transaction);
 
+			// for indices only:
+			status_t			GetIndexStatistics(
+									QueryParser::IndexStatistics& statistics);
+			status_t			SetIndexStatistics(const
+									QueryParser::IndexStatistics& statistics);
+			void				UpdateIndexStatistics(const uint8* oldKey,
+									uint16 oldLength, const uint8* newKey,
+									uint16 newLength);
+
 			// manipulating the data stream
 			status_t			FindBlockRun(off_t pos, block_run& run,
 									off_t& offset);
@@ -153,6 +171,7 @@ public:
 			status_t			SetFileSize(Transaction& transaction,
 									off_t size);
 			status_t			Append(Transaction& transaction, off_t bytes);
+			status_t			ConvertInlineData(Transaction& transaction);
 			status_t			TrimPreallocation(Transaction& transaction);
 			bool				NeedsTrimming() const;
 
@@ -254,6 +273,19 @@ private:
 			status_t			_ShrinkStream(Transaction& transaction,
 									off_t size);
 
+			// inline data
+			size_t				_MaxInlineDataSize() const;
+			status_t			_ReadInlineData(off_t pos, uint8* buffer,
+									size_t* _length);
+			status_t			_WriteInlineData(Transaction& transaction,
+									off_t pos, const uint8* buffer,
+									size_t* _length, bool& _converted);
+			status_t			_SetInlineData(Transaction& transaction,
+									off_t pos, const uint8* buffer,
+									size_t length, off_t size);
+			status_t			_ConvertInlineData(Transaction& transaction);
+			void				_DiscardInlinePages(off_t size);
+
 private:
 			rw_lock				fLock;
 			Volume*				fVolume;
@@ -262,6 +294,7 @@ private:
 			Inode*				fAttributes;
 			void*				fCache;
 			void*				fMap;
+			QueryParser::IndexStatistics* fIndexStatistics;
 			bfs_inode			fNode;
 
 			off_t				fOldSize;
@@ -407,7 +407,10 @@ Journal::Journal(Volume* volume)
 	fUsed(0),
 	fUnwrittenTransactions(0),
 	fHasSubtransaction(false),
-	fSeparateSubTransactions(false)
+	fSeparateSubTransactions(false),
+	fSyncCount(0),
+	fSyncStatus(B_OK),
+	fCheckpointID(-1)
 {
 	recursive_lock_init(&fLock, "bfs journal");
 	mutex_init(&fEntriesLock, "bfs journal entries");
@@ -417,6 +420,15 @@ Journal::Journal(Volume* volume)
 		B_NORMAL_PRIORITY, this);
 	if (fLogFlusher > 0)
 		resume_thread(fLogFlusher);
+
+	fCheckpointerSem = create_sem(0, "bfs checkpointer");
+	if (fCheckpointerSem >= 0) {
+		fCheckpointer = spawn_kernel_thread(&Journal::_Checkpointer,
+			"bfs checkpointer", B_NORMAL_PRIORITY, this);
+		if (fCheckpointer > 0)
+			resume_thread(fCheckpointer);
+	} else
+		fCheckpointer = fCheckpointerSem;
 }
 
 
@@ -424,19 +436,32 @@ Journal::~Journal()
 {
 	FlushLogAndBlocks();
 
-	recursive_lock_destroy(&fLock);
-	mutex_destroy(&fEntriesLock);
+	// Both threads use the locks, and the checkpointer may still be writing
+	// back blocks, so they have to be gone before the locks are destroyed
+
+	sem_id checkpointer = fCheckpointerSem;
+	fCheckpointerSem = -1;
+	delete_sem(checkpointer);
+	wait_for_thread(fCheckpointer, NULL);
 
 	sem_id logFlusher = fLogFlusherSem;
 	fLogFlusherSem = -1;
 	delete_sem(logFlusher);
 	wait_for_thread(fLogFlusher, NULL);
+
+	recursive_lock_destroy(&fLock);
+	mutex_destroy(&fEntriesLock);
 }
 
 
 status_t
 Journal::InitCheck()
 {
+	if (fLogFlusherSem < 0)
+		return fLogFlusherSem;
+	if (fCheckpointer < 0)
+		return fCheckpointer;
+
 	return B_OK;
 }
 
@@ -719,6 +744,26 @@ Journal::_LogFlusher(void* _journal)
 }
 
 
+/*!	Writes the blocks of the transactions that are already in the log back to
+	their home location, which frees their log space again.
+	This is started early, when the log becomes half full, so that committing
+	a transaction usually doesn't have to wait for that.
+*/
+/*static*/ status_t
+Journal::_Checkpointer(void* _journal)
+{
+	Journal* journal = (Journal*)_journal;
+	while (journal->fCheckpointerSem >= 0) {
+		if (acquire_sem(journal->fCheckpointerSem) != B_OK)
+			continue;
+
+		cache_sync_transaction(journal->fVolume->BlockCache(),
+			atomic_get(&journal->fCheckpointID));
+	}
+	return B_OK;
+}
+
+
 /*!	Writes the blocks that are part of current transaction into the log,
 	and ends the current transaction.
 	If the current transaction is too large to fit into the log, it will
@@ -901,6 +946,8 @@ Journal::_WriteTransactionToLog()
 	fUsed += logEntry->Length();
 	mutex_unlock(&fEntriesLock);
 
+	int32 loggedID = fTransactionID;
+
 	if (detached) {
 		fTransactionID = cache_detach_sub_transaction(fVolume->BlockCache(),
 			fTransactionID, _TransactionWritten, logEntry);
@@ -919,16 +966,27 @@ Journal::_WriteTransactionToLog()
 		fUnwrittenTransactions = 0;
 	}
 
+	if (FreeLogBlocks() < fLogSize / 2) {
+		// let the checkpointer make room for the next transactions
+		atomic_set(&fCheckpointID, loggedID);
+		release_sem_etc(fCheckpointerSem, 1, B_DO_NOT_RESCHEDULE);
+	}
+
 	return status;
 }
 
 
 /*!	Flushes the current log entry to disk. If \a flushBlocks is \c true it will
 	also write back all dirty blocks for this volume.
+	Concurrent callers that want the blocks flushed are served together: if
+	such a flush has been started by another thread after we were called, it
+	covered everything we need to write, too.
 */
 status_t
 Journal::_FlushLog(bool canWait, bool flushBlocks)
 {
+	int32 syncCount = atomic_get(&fSyncCount);
+
 	status_t status = canWait ? recursive_lock_lock(&fLock)
 		: recursive_lock_trylock(&fLock);
 	if (status != B_OK)
@@ -940,6 +998,15 @@ Journal::_FlushLog(bool canWait, bool flushBlocks)
 		return B_OK;
 	}
 
+	if (flushBlocks) {
+		if (atomic_get(&fSyncCount) != syncCount) {
+			status = fSyncStatus;
+			recursive_lock_unlock(&fLock);
+			return status;
+		}
+		atomic_add(&fSyncCount, 1);
+	}
+
 	// write the current log entry to disk
 
 	if (fUnwrittenTransactions != 0) {
@@ -949,7 +1016,7 @@ Journal::_FlushLog(bool canWait, bool flushBlocks)
 	}
 
 	if (flushBlocks)
-		status = fVolume->FlushDevice();
+		fSyncStatus = status = fVolume->FlushDevice();
 
 	recursive_lock_unlock(&fLock);
 	return status;
@@ -1118,6 +1185,8 @@ Journal::Dump()
 	kprintf("  transaction ID:       %" B_PRId32 "\n", fTransactionID);
 	kprintf("  has subtransaction:   %d\n", fHasSubtransaction);
 	kprintf("  separate sub-trans.:  %d\n", fSeparateSubTransactions);
+	kprintf("  syncs:                %" B_PRId32 "\n", fSyncCount);
+	kprintf("  checkpoint ID:        %" B_PRId32 "\n", fCheckpointID);
 	kprintf("entries:\n");
 	kprintf("  address        id  start length\n");
 
@@ -61,6 +61,7 @@ private:
 	static	void			_TransactionIdle(int32 transactionID, int32 event,
 								void* _journal);
 	static	status_t		_LogFlusher(void* _journal);
+	static	status_t		_Checkpointer(void* _journal);
 
 private:
 			Volume*			fVolume;
@@ -79,6 +80,13 @@ private:
 
 			thread_id		fLogFlusher;
 			sem_id			fLogFlusherSem;
+
+			int32			fSyncCount;
+			status_t		fSyncStatus;
+
+			thread_id		fCheckpointer;
+			sem_id			fCheckpointerSem;
+			int32			fCheckpointID;
 };
 
 
@@ -57,6 +57,7 @@ struct Query::QueryPolicy {
 	};
 
 	static const int32 kMaxFileNameLength = INODE_FILE_NAME_LENGTH;
+	static const size_t kMaxIndexKeyLength = MAX_INDEX_KEY_LENGTH;
 
 	// Entry interface
 
@@ -150,6 +151,18 @@ struct Query::QueryPolicy {
 		return iterator;
 	}
 
+	static status_t IndexGetStatistics(Index& index,
+		QueryParser::IndexStatistics& statistics)
+	{
+		return index.Node()->GetIndexStatistics(statistics);
+	}
+
+	static void IndexSetStatistics(Index& index,
+		const QueryParser::IndexStatistics& statistics)
+	{
+		index.Node()->SetIndexStatistics(statistics);
+	}
+
 	// IndexIterator interface
 
 	static void IndexIteratorDelete(IndexIterator* iterator)
@@ -206,6 +219,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* iterator)
+	{
+		return iterator->offset;
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* iterator)
 	{
 		iterator->SkipDuplicates();
@@ -347,6 +365,13 @@ Query::GetNextEntry(struct dirent* entry, size_t size)
 }
 
 
+status_t
+Query::Explain(char* buffer, size_t size)
+{
+	return fImpl->Explain(buffer, size);
+}
+
+
 void
 Query::LiveUpdate(Inode* inode, const char* attribute, int32 type,
 	const void* oldKey, size_t oldLength, const void* newKey, size_t newLength)
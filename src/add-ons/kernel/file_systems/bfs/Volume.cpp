@@ -53,7 +53,8 @@ disk_super_block::IsValid() const
 		|| BlocksPerAllocationGroup() < 1
 		|| NumBlocks() < 10
 		|| AllocationGroups() != divide_roundup(NumBlocks(),
-			1L << AllocationGroupShift()))
+			1L << AllocationGroupShift())
+		|| (Features() & ~SUPER_BLOCK_FEATURE_INLINE_DATA) != 0)
 		return false;
 
 	return true;
@@ -579,6 +580,10 @@ Volume::Initialize(int fd, const char* name, uint32 blockSize,
 	// create valid superblock
 
 	fSuperBlock.Initialize(name, numBlocks, blockSize);
+	if ((flags & VOLUME_INLINE_DATA) != 0) {
+		fSuperBlock.features
+			= HOST_ENDIAN_TO_BFS_INT32(SUPER_BLOCK_FEATURE_INLINE_DATA);
+	}
 
 	// initialize short hands to the superblock (to save byte swapping)
 	fBlockSize = fSuperBlock.BlockSize();
@@ -24,6 +24,7 @@ enum volume_flags {
 
 enum volume_initialize_flags {
 	VOLUME_NO_INDICES	= 0x0001,
+	VOLUME_INLINE_DATA	= 0x0002,
 };
 
 typedef DoublyLinkedList<Inode> InodeList;
@@ -80,6 +81,9 @@ public:
 			uint32			AllocationGroupShift() const
 								{ return fAllocationGroupShift; }
 			disk_super_block& SuperBlock() { return fSuperBlock; }
+			bool			HasInlineData() const
+								{ return (fSuperBlock.Features()
+									& SUPER_BLOCK_FEATURE_INLINE_DATA) != 0; }
 
 			off_t			ToOffset(block_run run) const
 								{ return ToBlock(run) << BlockShift(); }
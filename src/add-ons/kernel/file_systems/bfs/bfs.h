@@ -76,7 +76,8 @@ struct disk_super_block {
 	int32		magic3;
 	inode_addr	root_dir;
 	inode_addr	indices;
-	int32		_reserved[8];
+	int32		features;
+	int32		_reserved[7];
 	int32		pad_to_block[87];
 		// this also contains parts of the boot block
 
@@ -95,6 +96,7 @@ struct disk_super_block {
 	int32 AllocationGroupShift() const
 		{ return BFS_ENDIAN_TO_HOST_INT32(ag_shift); }
 	int32 Flags() const { return BFS_ENDIAN_TO_HOST_INT32(flags); }
+	int32 Features() const { return BFS_ENDIAN_TO_HOST_INT32(features); }
 	off_t LogStart() const { return BFS_ENDIAN_TO_HOST_INT64(log_start); }
 	off_t LogEnd() const { return BFS_ENDIAN_TO_HOST_INT64(log_end); }
 
@@ -113,6 +115,11 @@ struct disk_super_block {
 #define SUPER_BLOCK_DISK_CLEAN		'CLEN'		/* CLEN */
 #define SUPER_BLOCK_DISK_DIRTY		'DIRT'		/* DIRT */
 
+// Features that older implementations do not know about; the field has been
+// zero on all volumes created before it existed.
+#define SUPER_BLOCK_FEATURE_INLINE_DATA	0x00000001
+	// the data of small files may be stored in the inode
+
 //**************************************
 
 #define NUM_DIRECT_BLOCKS			12
@@ -172,6 +179,11 @@ struct small_data {
 #define FILE_NAME_NAME			0x13
 #define FILE_NAME_NAME_LENGTH	1
 
+// The contents of files with INODE_INLINE_DATA set are a small_data item, too
+#define INLINE_DATA_TYPE		'RAWT'
+#define INLINE_DATA_NAME		0x14
+#define INLINE_DATA_NAME_LENGTH	1
+
 // The maximum key length of attribute data that is put  in the index.
 // This excludes a terminating null byte.
 // This must be smaller than or equal as BPLUSTREE_MAX_KEY_LENGTH.
@@ -259,6 +271,7 @@ enum inode_flags {
 	INODE_DELETED			= 0x00000010,
 	INODE_NOT_READY			= 0x00000020,	// used during Inode construction
 	INODE_LONG_SYMLINK		= 0x00000040,	// symlink in data stream
+	INODE_INLINE_DATA		= 0x00000080,	// file data in the small data area
 
 	INODE_PERMANENT_FLAGS	= 0x0000ffff,
 
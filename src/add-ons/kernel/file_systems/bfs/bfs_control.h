@@ -93,6 +93,7 @@ struct check_control {
 #define BFS_WRONG_TYPE			16
 #define BFS_NAMES_DONT_MATCH	32
 #define BFS_INVALID_BPLUSTREE	64
+#define BFS_INVALID_INLINE_DATA	128
 
 /* check control magic value */
 #define BFS_IOCTL_CHECK_MAGIC	'BChk'
@@ -103,5 +104,10 @@ struct check_control {
  */
 #define BFS_IOCTL_RESIZE		14205
 
+/* Describes how a query would be evaluated. The buffer contains the query
+ * string on input, and the query plan as text on output.
+ */
+#define BFS_IOCTL_EXPLAIN_QUERY	14206
+
 
 #endif	/* BFS_CONTROL_H */
@@ -10,6 +10,7 @@
 #include "Attribute.h"
 #include "CheckVisitor.h"
 #include "Debug.h"
+#include "DirectoryCache.h"
 #include "Volume.h"
 #include "Inode.h"
 #include "Index.h"
@@ -23,6 +24,7 @@
 #ifndef FS_SHELL
 #	include <io_requests.h>
 #	include <util/fs_trim_support.h>
+#	include <vfs.h>
 #endif
 
 
@@ -408,6 +410,57 @@ bfs_can_page(fs_volume* _volume, fs_vnode* _v, void* _cookie)
 }
 
 
+/*!	Reads pages of a file that keeps its data in its inode, as happens when
+	it is mapped into memory. Anything beyond the end of the file is cleared.
+*/
+static status_t
+read_inline_pages(Inode* inode, off_t pos, const iovec* vecs, size_t count,
+	size_t* _numBytes)
+{
+	size_t bytesLeft = *_numBytes;
+
+	for (size_t i = 0; i < count && bytesLeft > 0; i++) {
+		size_t length = min_c(vecs[i].iov_len, bytesLeft);
+		size_t bytesRead = length;
+
+		status_t status = inode->ReadAt(pos, (uint8*)vecs[i].iov_base,
+			&bytesRead);
+		if (status != B_OK)
+			return status;
+
+		memset((uint8*)vecs[i].iov_base + bytesRead, 0, length - bytesRead);
+		pos += length;
+		bytesLeft -= length;
+	}
+
+	*_numBytes -= bytesLeft;
+	return B_OK;
+}
+
+
+#ifndef FS_SHELL
+static status_t
+read_inline_io(Inode* inode, io_request* request)
+{
+	size_t length = io_request_length(request);
+	uint8* buffer = (uint8*)malloc(length);
+	if (buffer == NULL)
+		return B_NO_MEMORY;
+
+	MemoryDeleter deleter(buffer);
+
+	size_t bytesRead = length;
+	status_t status = inode->ReadAt(io_request_offset(request), buffer,
+		&bytesRead);
+	if (status != B_OK)
+		return status;
+
+	memset(buffer + bytesRead, 0, length - bytesRead);
+	return write_to_io_request(request, buffer, length);
+}
+#endif
+
+
 static status_t
 bfs_read_pages(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 	off_t pos, const iovec* vecs, size_t count, size_t* _numBytes)
@@ -415,6 +468,9 @@ bfs_read_pages(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 	Volume* volume = (Volume*)_volume->private_volume;
 	Inode* inode = (Inode*)_node->private_node;
 
+	if (inode->IsInline())
+		return read_inline_pages(inode, pos, vecs, count, _numBytes);
+
 	if (inode->FileCache() == NULL)
 		RETURN_ERROR(B_BAD_VALUE);
 
@@ -460,6 +516,11 @@ bfs_write_pages(fs_volume* _volume, fs_vnode* _node, void* _cookie,
 	if (volume->IsReadOnly())
 		return B_READ_ONLY_DEVICE;
 
+	// Pages of inline files can only be written through bfs_write(); files
+	// are converted before they can be mapped shared and writable
+	if (inode->IsInline())
+		RETURN_ERROR(B_NOT_SUPPORTED);
+
 	if (inode->FileCache() == NULL)
 		RETURN_ERROR(B_BAD_VALUE);
 
@@ -513,6 +574,18 @@ bfs_io(fs_volume* _volume, fs_vnode* _node, void* _cookie, io_request* request)
 	}
 #endif
 
+#ifndef FS_SHELL
+	if (inode->IsInline()) {
+		// Pages of inline files can only be written through bfs_write()
+		status_t status = B_NOT_SUPPORTED;
+		if (!io_request_is_write(request))
+			status = read_inline_io(inode, request);
+
+		notify_io_request(request, status);
+		return status;
+	}
+#endif
+
 	if (inode->FileCache() == NULL) {
 #ifndef FS_SHELL
 		notify_io_request(request, B_BAD_VALUE);
@@ -548,6 +621,10 @@ bfs_get_file_map(fs_volume* _volume, fs_vnode* _node, off_t offset, size_t size,
 
 	//FUNCTION_START(("offset = %lld, size = %lu\n", offset, size));
 
+	// inline data has no location on disk of its own
+	if (inode->IsInline())
+		return B_NOT_SUPPORTED;
+
 	while (true) {
 		status_t status = inode->FindBlockRun(offset, run, fileOffset);
 		if (status != B_OK)
@@ -678,6 +755,22 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 
 			return copy_trim_data_to_user(buffer, trimData);
 		}
+
+		case B_PREPARE_WRITABLE_MAPPING:
+		{
+			// The pages of an inline file cannot be written back, so it
+			// has to be converted first
+			Inode* inode = (Inode*)_node->private_node;
+			status_t status = B_OK;
+			if (inode->IsInline()) {
+				Transaction transaction(volume, inode->BlockNumber());
+				status = inode->ConvertInlineData(transaction);
+				if (status == B_OK)
+					status = transaction.Done();
+			}
+
+			return user_memcpy(buffer, &status, sizeof(status_t));
+		}
 #endif
 
 		case BFS_IOCTL_VERSION:
@@ -793,6 +886,33 @@ bfs_ioctl(fs_volume* _volume, fs_vnode* _node, void* _cookie, uint32 cmd,
 			ResizeVisitor resizer(volume);
 			return resizer.Resize(size, -1);
 		}
+		case BFS_IOCTL_EXPLAIN_QUERY:
+		{
+			if (buffer == NULL || bufferLength == 0
+				|| bufferLength > 65536) {
+				return B_BAD_VALUE;
+			}
+
+			char* plan = (char*)malloc(bufferLength);
+			if (plan == NULL)
+				return B_NO_MEMORY;
+			MemoryDeleter planDeleter(plan);
+
+			if (user_strlcpy(plan, (const char*)buffer, bufferLength) < B_OK)
+				return B_BAD_ADDRESS;
+
+			Query* query;
+			status_t status = Query::Create(volume, plan, 0, -1, 0, query);
+			if (status != B_OK)
+				return status;
+
+			status = query->Explain(plan, bufferLength);
+			delete query;
+			if (status != B_OK)
+				return status;
+
+			return user_memcpy(buffer, plan, strlen(plan) + 1);
+		}
 
 #ifdef DEBUG_FRAGMENTER
 		case 56741:
@@ -1999,6 +2119,10 @@ bfs_remove_attr(fs_volume* _volume, fs_vnode* _node, const char* name)
 	Volume* volume = (Volume*)_volume->private_volume;
 	Inode* inode = (Inode*)_node->private_node;
 
+	// the inline data of a file is not an attribute
+	if (name[0] == INLINE_DATA_NAME && name[1] == '\0')
+		RETURN_ERROR(B_NOT_ALLOWED);
+
 	status_t status = inode->CheckPermissions(W_OK);
 	if (status != B_OK)
 		return status;
@@ -2410,11 +2534,17 @@ bfs_std_ops(int32 op, ...)
 {
 	switch (op) {
 		case B_MODULE_INIT:
+		{
+			status_t status = DirectoryCache::Init();
+			if (status != B_OK)
+				return status;
 #ifdef BFS_DEBUGGER_COMMANDS
 			add_debugger_commands();
 #endif
 			return B_OK;
+		}
 		case B_MODULE_UNINIT:
+			DirectoryCache::Uninit();
 #ifdef BFS_DEBUGGER_COMMANDS
 			remove_debugger_commands();
 #endif
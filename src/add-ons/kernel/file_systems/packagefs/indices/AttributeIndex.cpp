@@ -311,7 +311,8 @@ AttributeIndex::NodeAdded(Node* node)
 	TreeValue* treeValue = fIndexer->Cookie();
 	treeValue->node = node;
 
-	fNodes->Insert(treeValue);
+	if (fNodes->Insert(treeValue) == B_OK)
+		_KeyAdded(treeValue->data, treeValue->length);
 }
 
 
@@ -323,7 +324,8 @@ AttributeIndex::NodeRemoved(Node* node)
 		return;
 
 	treeValue->owner->UnsetIndexCookie(treeValue->attributeCookie);
-	fNodes->Remove(treeValue);
+	if (fNodes->Remove(treeValue))
+		_KeyRemoved(treeValue->data, treeValue->length);
 }
 
 
@@ -348,12 +350,13 @@ AttributeIndex::NodeChanged(Node* node, uint32 statFields,
 		}
 
 		// remove the node
-		fNodes->Remove(oldTreeValue);
+		if (fNodes->Remove(oldTreeValue))
+			_KeyRemoved(oldTreeValue->data, oldTreeValue->length);
 	}
 
 	// re-insert the node
-	if (treeValue != NULL)
-		fNodes->Insert(treeValue);
+	if (treeValue != NULL && fNodes->Insert(treeValue) == B_OK)
+		_KeyAdded(treeValue->data, treeValue->length);
 
 	// Move the iterators to the next node again. If the node hasn't changed
 	// its place, they will point to it again, otherwise to the node originally
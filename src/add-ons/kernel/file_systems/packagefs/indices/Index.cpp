@@ -6,6 +6,10 @@
 
 #include "Index.h"
 
+#include <new>
+
+#include <file_systems/QueryStatistics.h>
+
 #include "DebugSupport.h"
 #include "Directory.h"
 #include "Node.h"
@@ -21,13 +25,15 @@ Index::Index()
 	fName(),
 	fType(0),
 	fKeyLength(0),
-	fFixedKeyLength(true)
+	fFixedKeyLength(true),
+	fStatistics(NULL)
 {
 }
 
 
 Index::~Index()
 {
+	delete fStatistics;
 }
 
 
@@ -68,6 +74,49 @@ Index::Find(const void* key, size_t length, IndexIterator& iterator)
 }
 
 
+/*!	Returns the statistics the query planner gathered for this index, if
+	any. The caller needs to hold the volume lock.
+*/
+status_t
+Index::GetStatistics(QueryParser::IndexStatistics& statistics) const
+{
+	if (fStatistics == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	statistics = *fStatistics;
+	return B_OK;
+}
+
+
+void
+Index::SetStatistics(const QueryParser::IndexStatistics& statistics)
+{
+	if (fStatistics == NULL)
+		fStatistics = new(std::nothrow) QueryParser::IndexStatistics;
+	if (fStatistics != NULL)
+		*fStatistics = statistics;
+}
+
+
+/*!	Keeps the statistics of the index up to date. Must be called by the
+	subclasses whenever they add a key to, or remove one from the index.
+*/
+void
+Index::_KeyAdded(const void* key, size_t length)
+{
+	if (fStatistics != NULL)
+		fStatistics->KeyAdded(key, length);
+}
+
+
+void
+Index::_KeyRemoved(const void* key, size_t length)
+{
+	if (fStatistics != NULL)
+		fStatistics->KeyRemoved(key, length);
+}
+
+
 void
 Index::Dump()
 {
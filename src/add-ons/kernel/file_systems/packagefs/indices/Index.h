@@ -21,6 +21,10 @@ class IndexIterator;
 class Node;
 class Volume;
 
+namespace QueryParser {
+	class IndexStatistics;
+}
+
 
 static const size_t kMaxIndexKeyLength = 256;
 
@@ -50,6 +54,12 @@ public:
 									// sets the iterator to the first value
 									// >= key
 
+			status_t			GetStatistics(
+									QueryParser::IndexStatistics& statistics)
+									const;
+			void				SetStatistics(const QueryParser::IndexStatistics&
+									statistics);
+
 			Index*&				IndexHashLink()
 									{ return fHashLink; }
 
@@ -63,6 +73,9 @@ protected:
 									// returns an iterator pointing to the first
 									// value >= key
 
+			void				_KeyAdded(const void* key, size_t length);
+			void				_KeyRemoved(const void* key, size_t length);
+
 protected:
 			Index*				fHashLink;
 			Volume*				fVolume;
@@ -70,6 +83,7 @@ protected:
 			uint32				fType;
 			size_t				fKeyLength;
 			bool				fFixedKeyLength;
+			QueryParser::IndexStatistics* fStatistics;
 };
 
 
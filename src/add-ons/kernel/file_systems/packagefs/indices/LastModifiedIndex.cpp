@@ -184,14 +184,20 @@ LastModifiedIndex::CountEntries() const
 void
 LastModifiedIndex::NodeAdded(Node* node)
 {
-	fNodes->Insert(node);
+	if (fNodes->Insert(node) == B_OK) {
+		time_t lastModified = node->ModifiedTime().tv_sec;
+		_KeyAdded(&lastModified, sizeof(lastModified));
+	}
 }
 
 
 void
 LastModifiedIndex::NodeRemoved(Node* node)
 {
-	fNodes->Remove(node, node);
+	if (fNodes->Remove(node, node) == B_OK) {
+		time_t lastModified = node->ModifiedTime().tv_sec;
+		_KeyRemoved(&lastModified, sizeof(lastModified));
+	}
 }
 
 
@@ -223,10 +229,12 @@ LastModifiedIndex::NodeChanged(Node* node, uint32 statFields,
 
 	// remove and re-insert the node
 	nodeIterator.Remove();
+	_KeyRemoved(&oldLastModified, sizeof(oldLastModified));
 	if (fNodes->Insert(node) != B_OK) {
 		fIteratorsToUpdate->MakeEmpty();
 		return;
 	}
+	_KeyAdded(&newLastModified, sizeof(newLastModified));
 
 	// Move the iterators to the next node again. If the node hasn't changed
 	// its place, they will point to it again, otherwise to the node originally
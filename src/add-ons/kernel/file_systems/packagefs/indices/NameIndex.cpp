@@ -158,7 +158,8 @@ NameIndex::CountEntries() const
 void
 NameIndex::NodeAdded(Node* node)
 {
-	fEntries->Insert(node);
+	if (fEntries->Insert(node) == B_OK)
+		_KeyAdded(node->Name(), strlen(node->Name()));
 
 	// update live queries
 	_UpdateLiveQueries(node, NULL, node->Name());
@@ -168,7 +169,8 @@ NameIndex::NodeAdded(Node* node)
 void
 NameIndex::NodeRemoved(Node* node)
 {
-	fEntries->Remove(node, node);
+	if (fEntries->Remove(node, node) == B_OK)
+		_KeyRemoved(node->Name(), strlen(node->Name()));
 
 	// update live queries
 	_UpdateLiveQueries(node, node->Name(), NULL);
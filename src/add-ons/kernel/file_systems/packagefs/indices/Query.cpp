@@ -47,6 +47,7 @@ struct Query::QueryPolicy {
 	};
 
 	static const int32 kMaxFileNameLength = B_FILE_NAME_LENGTH;
+	static const size_t kMaxIndexKeyLength = ::kMaxIndexKeyLength;
 
 	// Entry interface
 
@@ -123,6 +124,18 @@ struct Query::QueryPolicy {
 		return iterator;
 	}
 
+	static status_t IndexGetStatistics(Index& index,
+		QueryParser::IndexStatistics& statistics)
+	{
+		return index.index->GetStatistics(statistics);
+	}
+
+	static void IndexSetStatistics(Index& index,
+		const QueryParser::IndexStatistics& statistics)
+	{
+		index.index->SetStatistics(statistics);
+	}
+
 	// IndexIterator interface
 
 	static void IndexIteratorDelete(IndexIterator* indexIterator)
@@ -157,6 +170,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return indexIterator->entry->ID();
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
 	{
 		// Nothing to do.
@@ -183,14 +183,20 @@ SizeIndex::CountEntries() const
 void
 SizeIndex::NodeAdded(Node* node)
 {
-	fNodes->Insert(node);
+	if (fNodes->Insert(node) == B_OK) {
+		off_t size = node->FileSize();
+		_KeyAdded(&size, sizeof(size));
+	}
 }
 
 
 void
 SizeIndex::NodeRemoved(Node* node)
 {
-	fNodes->Remove(node, node);
+	if (fNodes->Remove(node, node) == B_OK) {
+		off_t size = node->FileSize();
+		_KeyRemoved(&size, sizeof(size));
+	}
 }
 
 
@@ -221,10 +227,12 @@ SizeIndex::NodeChanged(Node* node, uint32 statFields,
 
 	// remove and re-insert the node
 	nodeIterator.Remove();
+	_KeyRemoved(&oldSize, sizeof(oldSize));
 	if (fNodes->Insert(node) != B_OK) {
 		fIteratorsToUpdate->MakeEmpty();
 		return;
 	}
+	_KeyAdded(&newSize, sizeof(newSize));
 
 	// Move the iterators to the next node again. If the node hasn't changed
 	// its place, they will point to it again, otherwise to the node originally
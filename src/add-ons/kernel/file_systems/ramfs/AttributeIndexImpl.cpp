@@ -261,6 +261,7 @@ AttributeIndexImpl::Changed(Attribute *attribute, const uint8 *oldKey,
 				}
 				// remove and re-insert the attribute
 				it.Remove();
+				_KeyRemoved(oldKey, oldLength);
 			}
 		}
 		// re-insert the attribute
@@ -268,9 +269,10 @@ AttributeIndexImpl::Changed(Attribute *attribute, const uint8 *oldKey,
 			attribute->SetIndex(this, false);
 		} else {
 			error = fAttributes->Insert(attribute);
-			if (error == B_OK)
+			if (error == B_OK) {
 				attribute->SetIndex(this, true);
-			else
+				_AttributeKeyAdded(attribute);
+			} else
 				attribute->SetIndex(NULL, false);
 		}
 	}
@@ -289,8 +291,10 @@ PRINT("AttributeIndex::Add(%p)\n", attribute);
 			attribute->SetIndex(this, false);
 		} else {
 			error = fAttributes->Insert(attribute);
-			if (error == B_OK)
+			if (error == B_OK) {
 				attribute->SetIndex(this, true);
+				_AttributeKeyAdded(attribute);
+			}
 		}
 	}
 	return error;
@@ -303,8 +307,10 @@ AttributeIndexImpl::Removed(Attribute *attribute)
 PRINT("AttributeIndex::Removed(%p)\n", attribute);
 	bool result = (attribute && attribute->GetIndex() == this);
 	if (result) {
-		if (attribute->IsInIndex())
-			fAttributes->Remove(attribute, attribute);
+		if (attribute->IsInIndex()
+			&& fAttributes->Remove(attribute, attribute) == B_OK) {
+			_AttributeKeyRemoved(attribute);
+		}
 		attribute->SetIndex(NULL, false);
 	}
 	return result;
@@ -356,6 +362,26 @@ AttributeIndexImpl::_RemoveIterator(Iterator *iterator)
 	fIterators->Remove(iterator);
 }
 
+// _AttributeKeyAdded
+void
+AttributeIndexImpl::_AttributeKeyAdded(Attribute *attribute)
+{
+	uint8 key[kMaxIndexKeyLength];
+	size_t length = kMaxIndexKeyLength;
+	attribute->GetKey(key, &length);
+	_KeyAdded(key, length);
+}
+
+// _AttributeKeyRemoved
+void
+AttributeIndexImpl::_AttributeKeyRemoved(Attribute *attribute)
+{
+	uint8 key[kMaxIndexKeyLength];
+	size_t length = kMaxIndexKeyLength;
+	attribute->GetKey(key, &length);
+	_KeyRemoved(key, length);
+}
+
 
 // Iterator
 
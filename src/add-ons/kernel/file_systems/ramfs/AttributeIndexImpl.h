@@ -42,6 +42,8 @@ private:
 private:
 	void _AddIterator(Iterator *iterator);
 	void _RemoveIterator(Iterator *iterator);
+	void _AttributeKeyAdded(Attribute *attribute);
+	void _AttributeKeyRemoved(Attribute *attribute);
 
 private:
 	AttributeTree	*fAttributes;
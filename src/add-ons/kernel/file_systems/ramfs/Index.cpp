@@ -9,6 +9,8 @@
 #include "Index.h"
 #include "IndexImpl.h"
 
+#include <file_systems/QueryStatistics.h>
+
 // Index
 
 // constructor
@@ -19,7 +21,8 @@ Index::Index(Volume *volume, const char *name, uint32 type,
 	  fName(name),
 	  fType(type),
 	  fKeyLength(keyLength),
-	  fFixedKeyLength(fixedKeyLength)
+	  fFixedKeyLength(fixedKeyLength),
+	  fStatistics(NULL)
 {
 	if (!fVolume)
 		fInitStatus = B_BAD_VALUE;
@@ -30,6 +33,7 @@ Index::Index(Volume *volume, const char *name, uint32 type,
 // destructor
 Index::~Index()
 {
+	delete fStatistics;
 }
 
 // InitCheck
@@ -70,6 +74,43 @@ Index::Find(const uint8 *key, size_t length, IndexEntryIterator *iterator)
 	return result;
 }
 
+// GetStatistics
+status_t
+Index::GetStatistics(QueryParser::IndexStatistics &statistics) const
+{
+	if (fStatistics == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	statistics = *fStatistics;
+	return B_OK;
+}
+
+// SetStatistics
+void
+Index::SetStatistics(const QueryParser::IndexStatistics &statistics)
+{
+	if (fStatistics == NULL)
+		fStatistics = new(std::nothrow) QueryParser::IndexStatistics;
+	if (fStatistics != NULL)
+		*fStatistics = statistics;
+}
+
+// _KeyAdded
+void
+Index::_KeyAdded(const void *key, size_t length)
+{
+	if (fStatistics != NULL)
+		fStatistics->KeyAdded(key, length);
+}
+
+// _KeyRemoved
+void
+Index::_KeyRemoved(const void *key, size_t length)
+{
+	if (fStatistics != NULL)
+		fStatistics->KeyRemoved(key, length);
+}
+
 // Dump
 void
 Index::Dump()
@@ -15,6 +15,10 @@ class IndexEntryIterator;
 class Node;
 class Volume;
 
+namespace QueryParser {
+	class IndexStatistics;
+}
+
 // Index
 class Index {
 public:
@@ -38,10 +42,17 @@ public:
 	bool Find(const uint8 *key, size_t length,
 			  IndexEntryIterator *iterator);
 
+	// query planning
+	status_t GetStatistics(QueryParser::IndexStatistics &statistics) const;
+	void SetStatistics(const QueryParser::IndexStatistics &statistics);
+
 	// debugging
 	void Dump();
 
 protected:
+	void _KeyAdded(const void *key, size_t length);
+	void _KeyRemoved(const void *key, size_t length);
+
 	virtual AbstractIndexEntryIterator *InternalGetIterator() = 0;
 	virtual AbstractIndexEntryIterator *InternalFind(const uint8 *key,
 													 size_t length) = 0;
@@ -53,6 +64,7 @@ protected:
 	uint32		fType;
 	size_t		fKeyLength;
 	bool		fFixedKeyLength;
+	QueryParser::IndexStatistics *fStatistics;
 };
 
 // IndexEntryIterator
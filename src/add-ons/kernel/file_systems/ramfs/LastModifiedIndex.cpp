@@ -167,10 +167,14 @@ LastModifiedIndex::Changed(Node *node, time_t oldModified)
 			}
 			// remove and re-insert the node
 			it.Remove();
+			_KeyRemoved(&oldModified, sizeof(oldModified));
 			error = fNodes->Insert(node);
 
-			// udpate live queries
 			time_t newModified = node->GetMTime();
+			if (error == B_OK)
+				_KeyAdded(&newModified, sizeof(newModified));
+
+			// udpate live queries
 			fVolume->UpdateLiveQueries(NULL, node, GetName(), GetType(),
 				(const uint8*)&oldModified, sizeof(oldModified),
 				(const uint8*)&newModified, sizeof(newModified));
@@ -183,16 +187,20 @@ LastModifiedIndex::Changed(Node *node, time_t oldModified)
 void
 LastModifiedIndex::NodeAdded(Node *node)
 {
-	if (node)
-		fNodes->Insert(node);
+	if (node && fNodes->Insert(node) == B_OK) {
+		time_t modified = node->GetMTime();
+		_KeyAdded(&modified, sizeof(modified));
+	}
 }
 
 // NodeRemoved
 void
 LastModifiedIndex::NodeRemoved(Node *node)
 {
-	if (node)
-		fNodes->Remove(node, node);
+	if (node && fNodes->Remove(node, node) == B_OK) {
+		time_t modified = node->GetMTime();
+		_KeyRemoved(&modified, sizeof(modified));
+	}
 }
 
 // InternalGetIterator
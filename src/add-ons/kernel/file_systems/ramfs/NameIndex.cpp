@@ -141,7 +141,10 @@ NameIndex::Changed(Entry *entry, const char *oldName)
 			= fEntries->Find(NameIndexPrimaryKey(entry, oldName), entry, &it);
 		if (foundEntry && *foundEntry == entry) {
 			it.Remove();
+			_KeyRemoved(oldName, strlen(oldName));
 			error = fEntries->Insert(entry);
+			if (error == B_OK)
+				_KeyAdded(entry->GetName(), strlen(entry->GetName()));
 
 			// udpate live queries
 			_UpdateLiveQueries(entry, oldName, entry->GetName());
@@ -155,7 +158,8 @@ void
 NameIndex::EntryAdded(Entry *entry)
 {
 	if (entry) {
-		fEntries->Insert(entry);
+		if (fEntries->Insert(entry) == B_OK)
+			_KeyAdded(entry->GetName(), strlen(entry->GetName()));
 
 		// udpate live queries
 		_UpdateLiveQueries(entry, NULL, entry->GetName());
@@ -167,7 +171,8 @@ void
 NameIndex::EntryRemoved(Entry *entry)
 {
 	if (entry) {
-		fEntries->Remove(entry, entry);
+		if (fEntries->Remove(entry, entry) == B_OK)
+			_KeyRemoved(entry->GetName(), strlen(entry->GetName()));
 
 		// udpate live queries
 		_UpdateLiveQueries(entry, entry->GetName(), NULL);
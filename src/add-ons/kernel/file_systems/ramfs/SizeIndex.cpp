@@ -166,10 +166,14 @@ SizeIndex::Changed(Node *node, off_t oldSize)
 
 			// remove and re-insert the node
 			it.Remove();
+			_KeyRemoved(&oldSize, sizeof(oldSize));
 			error = fNodes->Insert(node);
 
-			// udpate live queries
 			off_t newSize = node->GetSize();
+			if (error == B_OK)
+				_KeyAdded(&newSize, sizeof(newSize));
+
+			// udpate live queries
 			fVolume->UpdateLiveQueries(NULL, node, GetName(), GetType(),
 				(const uint8*)&oldSize, sizeof(oldSize), (const uint8*)&newSize,
 				sizeof(newSize));
@@ -182,16 +186,20 @@ SizeIndex::Changed(Node *node, off_t oldSize)
 void
 SizeIndex::NodeAdded(Node *node)
 {
-	if (node)
-		fNodes->Insert(node);
+	if (node && fNodes->Insert(node) == B_OK) {
+		off_t size = node->GetSize();
+		_KeyAdded(&size, sizeof(size));
+	}
 }
 
 // NodeRemoved
 void
 SizeIndex::NodeRemoved(Node *node)
 {
-	if (node)
-		fNodes->Remove(node, node);
+	if (node && fNodes->Remove(node, node) == B_OK) {
+		off_t size = node->GetSize();
+		_KeyRemoved(&size, sizeof(size));
+	}
 }
 
 // InternalGetIterator
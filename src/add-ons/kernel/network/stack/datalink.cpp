@@ -23,6 +23,7 @@
 #include <net_datalink.h>
 #include <net_device.h>
 #include <NetUtilities.h>
+#include <tracepoint.h>
 
 #include "device_interfaces.h"
 #include "domains.h"
@@ -707,6 +708,8 @@ interface_protocol_send_data(net_datalink_protocol* _protocol,
 		device_interface_monitor_receive(interface->DeviceInterface(), buffer);
 
 	const size_t packetSize = buffer->size;
+	TRACEPOINT(B_TRACEPOINT_NETWORK, B_TRACEPOINT_NET_SEND,
+		protocol->device->index, packetSize);
 	status_t status = protocol->device_module->send_data(protocol->device, buffer);
 	update_device_send_stats(protocol->device, status, packetSize);
 	return status;
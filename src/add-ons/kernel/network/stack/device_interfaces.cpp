@@ -16,6 +16,7 @@
 #include <net_device.h>
 
 #include <lock.h>
+#include <tracepoint.h>
 #include <util/AutoLock.h>
 
 #include <KernelExport.h>
@@ -69,6 +70,8 @@ device_reader_thread(void* _interface)
 			}
 
 			const size_t packetSize = buffer->size;
+			TRACEPOINT(B_TRACEPOINT_NETWORK, B_TRACEPOINT_NET_RECEIVE,
+				device->index, packetSize);
 			status = fifo_enqueue_buffer(&interface->receive_queue, buffer);
 			if (status == B_OK) {
 				atomic_add((int32*)&device->stats.receive.packets, 1);
@@ -465,13 +465,10 @@ ProcessController::MessageReceived(BMessage *message)
 
 		case 'Schd':
 		{
-			BMenuItem* source;
-			if (message->FindPointer("source", (void**)&source) != B_OK)
+			int32 mode;
+			if (message->FindInt32("mode", &mode) != B_OK)
 				break;
-			if (!source->IsMarked())
-				set_scheduler_mode(SCHEDULER_MODE_POWER_SAVING);
-			else
-				set_scheduler_mode(SCHEDULER_MODE_LOW_LATENCY);
+			set_scheduler_mode(mode);
 			Preferences preferences(kPreferencesFileName);
 			preferences.SaveInt32(get_scheduler_mode(), "scheduler_mode");
 			break;
@@ -849,12 +846,28 @@ thread_popup(void *arg)
 		set_scheduler_mode(savedMode);
 		currentMode = get_scheduler_mode();
 	}
-	BMessage* msg = new BMessage('Schd');
-	item = new BMenuItem(B_TRANSLATE("Power saving"), msg);
-	if ((uint32)currentMode == SCHEDULER_MODE_POWER_SAVING)
-		item->SetMarked(true);
-	item->SetTarget(gPCView);
-	addtopbottom(item);
+	static const struct {
+		const char*	label;
+		int32		mode;
+	} kSchedulerModes[] = {
+		{ B_TRANSLATE_MARK("Low latency"), SCHEDULER_MODE_LOW_LATENCY },
+		{ B_TRANSLATE_MARK("Power saving"), SCHEDULER_MODE_POWER_SAVING },
+		{ B_TRANSLATE_MARK("Throughput"), SCHEDULER_MODE_THROUGHPUT },
+	};
+	BMenu* schedulerMenu = new BMenu(B_TRANSLATE("Scheduler mode"));
+	schedulerMenu->SetRadioMode(true);
+	for (size_t i = 0; i < B_COUNT_OF(kSchedulerModes); i++) {
+		BMessage* msg = new BMessage('Schd');
+		msg->AddInt32("mode", kSchedulerModes[i].mode);
+		item = new BMenuItem(B_TRANSLATE_NOCOLLECT(kSchedulerModes[i].label),
+			msg);
+		if (currentMode == kSchedulerModes[i].mode)
+			item->SetMarked(true);
+		item->SetTarget(gPCView);
+		schedulerMenu->AddItem(item);
+	}
+	schedulerMenu->SetFont(be_plain_font);
+	addtopbottom(schedulerMenu);
 	addtopbottom(new BSeparatorItem());
 
 	if (!be_roster->IsRunning(kTrackerSig)) {
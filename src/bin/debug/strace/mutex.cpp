@@ -30,6 +30,7 @@ static const FlagsTypeHandler::FlagInfo kMutexOptionFlagsInfo[] = {
 	FLAG_INFO_ENTRY(B_ABSOLUTE_TIMEOUT),
 	FLAG_INFO_ENTRY(B_TIMEOUT_REAL_TIME_BASE),
 
+	FLAG_INFO_ENTRY(B_USER_MUTEX_PRIO_INHERIT),
 	FLAG_INFO_ENTRY(B_USER_MUTEX_SHARED),
 	FLAG_INFO_ENTRY(B_USER_MUTEX_UNBLOCK_ALL),
 
@@ -100,6 +101,14 @@ patch_mutex()
 	mutex_switch_lock->GetParameter("toFlags")->SetHandler(
 		new FlagsTypeHandler(kMutexOptionFlags));
 
+	Syscall *mutex_requeue = get_syscall("_kern_mutex_requeue");
+	mutex_requeue->GetParameter("fromMutex")->SetHandler(new MutexTypeHandler());
+	mutex_requeue->GetParameter("fromFlags")->SetHandler(
+		new FlagsTypeHandler(kMutexOptionFlags));
+	mutex_requeue->GetParameter("toMutex")->SetHandler(new MutexTypeHandler());
+	mutex_requeue->GetParameter("toFlags")->SetHandler(
+		new FlagsTypeHandler(kMutexOptionFlags));
+
 	Syscall *mutex_sem_acquire = get_syscall("_kern_mutex_sem_acquire");
 	mutex_sem_acquire->GetParameter("flags")->SetHandler(new FlagsTypeHandler(kMutexOptionFlags));
 
@@ -0,0 +1,667 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <OS.h>
+
+#include <syscalls.h>
+#include <tracepoint_defs.h>
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+
+#define KTRACE_MAGIC	'KTrc'
+#define KTRACE_VERSION	1
+
+static const bigtime_t kPollInterval = 10000;
+static const uint32 kDefaultRingCapacity = 8192;
+
+extern const char* __progname;
+
+static volatile bool sQuit = false;
+
+
+/*!	A trace file starts with this header, followed by \c thread_count
+	ktrace_thread entries, followed by \c record_count records.
+*/
+struct ktrace_file_header {
+	uint32		magic;
+	uint32		version;
+	uint32		cpu_count;
+	uint32		categories;
+	uint64		record_count;
+	uint64		lost_count;
+	uint32		thread_count;
+	uint32		_reserved;
+};
+
+struct ktrace_thread {
+	thread_id	thread;
+	team_id		team;
+	char		name[B_OS_NAME_LENGTH];
+};
+
+struct category_name {
+	const char*	name;
+	uint32		category;
+};
+
+static const category_name kCategories[] = {
+	{ "sched",	B_TRACEPOINT_SCHEDULER },
+	{ "vm",		B_TRACEPOINT_VM },
+	{ "vfs",	B_TRACEPOINT_VFS },
+	{ "block",	B_TRACEPOINT_BLOCK_CACHE },
+	{ "io",		B_TRACEPOINT_IO },
+	{ "net",	B_TRACEPOINT_NETWORK },
+	{ "sample",	B_TRACEPOINT_SAMPLING },
+	{ "all",	B_TRACEPOINT_ALL },
+	{ NULL,		0 }
+};
+
+static const char* kUsage =
+	"Usage: %s record [ <options> ] [ <seconds> ]\n"
+	"       %s report [ <trace file> ]\n"
+	"\n"
+	"\"record\" records the kernel tracepoints of the given categories until\n"
+	"the given number of seconds has passed, or until interrupted.\n"
+	"\"report\" prints a recorded trace in the JSON format understood by the\n"
+	"Chrome trace viewer (chrome://tracing).\n"
+	"\n"
+	"Options:\n"
+	"  -c <categories>  - Comma separated list of the categories to record:\n"
+	"                     sched, vm, vfs, block, io, net, sample, or all.\n"
+	"                     Defaults to all categories but sample.\n"
+	"  -h, --help       - Print this usage info.\n"
+	"  -i <interval>    - Use a sample interval of <interval> microseconds.\n"
+	"                     Defaults to 1000.\n"
+	"  -o <file>        - Write the trace to <file>. Defaults to\n"
+	"                     \"ktrace.out\".\n"
+	"  -r <records>     - Make room for <records> records per CPU. Defaults\n"
+	"                     to 8192; rounded up to a power of two.\n";
+
+
+static void
+print_usage_and_exit(bool error)
+{
+	fprintf(error ? stderr : stdout, kUsage, __progname, __progname);
+	exit(error ? 1 : 0);
+}
+
+
+static uint32
+parse_categories(const char* string)
+{
+	uint32 categories = 0;
+
+	while (*string != '\0') {
+		size_t length = strcspn(string, ",");
+
+		int32 i = 0;
+		for (; kCategories[i].name != NULL; i++) {
+			if (strlen(kCategories[i].name) == length
+				&& strncmp(kCategories[i].name, string, length) == 0) {
+				break;
+			}
+		}
+
+		if (kCategories[i].name == NULL) {
+			fprintf(stderr, "%s: Unknown category: \"%.*s\"\n", __progname,
+				(int)length, string);
+			exit(1);
+		}
+
+		categories |= kCategories[i].category;
+		string += length;
+		if (*string == ',')
+			string++;
+	}
+
+	return categories;
+}
+
+
+static void
+signal_handler(int signal, void* data)
+{
+	sQuit = true;
+}
+
+
+// #pragma mark - record
+
+
+/*!	Copies the records written to the given ring since \a _lastHead into
+	\a buffer, and updates \a _lastHead. Records that the kernel overwrote
+	before they could be copied are added to \a _lost.
+	Returns the number of records copied.
+*/
+static uint32
+copy_ring_records(tracepoint_buffer_header* header, uint32 cpu,
+	tracepoint_record* buffer, uint64& _lastHead, uint64& _lost)
+{
+	tracepoint_ring* ring = tracepoint_get_ring(header, cpu);
+	uint32 capacity = header->ring_capacity;
+
+	uint64 head = atomic_get64((int64*)&ring->head);
+	uint64 first = _lastHead;
+	if (head - first > capacity) {
+		_lost += head - first - capacity;
+		first = head - capacity;
+	}
+
+	for (uint64 i = first; i < head; i++)
+		buffer[i - first] = *tracepoint_get_record(header, ring, i);
+
+	// The kernel may have overwritten the oldest records while we were
+	// copying them. It publishes a new head only after writing the record,
+	// so the one after the last published record may be half written, too.
+	uint64 newHead = atomic_get64((int64*)&ring->head);
+	uint64 valid = first;
+	if (newHead - first >= capacity)
+		valid = newHead - capacity + 1;
+	if (valid > head)
+		valid = head;
+
+	_lost += valid - first;
+	_lastHead = head;
+
+	uint32 count = head - valid;
+	if (valid != first)
+		memmove(buffer, buffer + (valid - first), count * sizeof(*buffer));
+
+	return count;
+}
+
+
+static status_t
+write_thread_names(FILE* file, uint32& _count)
+{
+	_count = 0;
+
+	int32 teamCookie = 0;
+	team_info teamInfo;
+	while (get_next_team_info(&teamCookie, &teamInfo) == B_OK) {
+		int32 threadCookie = 0;
+		thread_info threadInfo;
+		while (get_next_thread_info(teamInfo.team, &threadCookie, &threadInfo)
+				== B_OK) {
+			ktrace_thread thread;
+			memset(&thread, 0, sizeof(thread));
+			thread.thread = threadInfo.thread;
+			thread.team = threadInfo.team;
+			strlcpy(thread.name, threadInfo.name, sizeof(thread.name));
+
+			if (fwrite(&thread, sizeof(thread), 1, file) != 1)
+				return errno;
+			_count++;
+		}
+	}
+
+	return B_OK;
+}
+
+
+static int
+record(int argc, char** argv)
+{
+	uint32 categories = B_TRACEPOINT_ALL & ~(uint32)B_TRACEPOINT_SAMPLING;
+	bigtime_t interval = 1000;
+	uint32 capacity = kDefaultRingCapacity;
+	const char* outputFile = "ktrace.out";
+
+	int c;
+	while ((c = getopt(argc, argv, "c:hi:o:r:")) != -1) {
+		switch (c) {
+			case 'c':
+				categories = parse_categories(optarg);
+				break;
+			case 'h':
+				print_usage_and_exit(false);
+				break;
+			case 'i':
+				interval = atol(optarg);
+				break;
+			case 'o':
+				outputFile = optarg;
+				break;
+			case 'r':
+				capacity = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				print_usage_and_exit(true);
+				break;
+		}
+	}
+
+	bigtime_t duration = -1;
+	if (optind < argc)
+		duration = (bigtime_t)(strtod(argv[optind++], NULL) * 1000000);
+	if (optind != argc || categories == 0 || capacity == 0)
+		print_usage_and_exit(true);
+
+	uint32 ringCapacity = 1;
+	while (ringCapacity < capacity)
+		ringCapacity *= 2;
+
+	system_info info;
+	get_system_info(&info);
+	uint32 cpuCount = info.cpu_count;
+
+	size_t ringSize = sizeof(tracepoint_ring)
+		+ ringCapacity * sizeof(tracepoint_record);
+	size_t areaSize = (B_TRACEPOINT_HEADER_SIZE + cpuCount * ringSize
+		+ B_PAGE_SIZE - 1) / B_PAGE_SIZE * B_PAGE_SIZE;
+
+	tracepoint_buffer_header* header;
+	area_id area = create_area("tracepoint buffer", (void**)&header,
+		B_ANY_ADDRESS, areaSize, B_NO_LOCK, B_READ_AREA | B_WRITE_AREA);
+	if (area < 0) {
+		fprintf(stderr, "%s: Failed to create buffer area: %s\n", __progname,
+			strerror(area));
+		return 1;
+	}
+
+	FILE* file = fopen(outputFile, "wb");
+	if (file == NULL) {
+		fprintf(stderr, "%s: Failed to open \"%s\": %s\n", __progname,
+			outputFile, strerror(errno));
+		return 1;
+	}
+
+	// the header is written again with the final counts at the end
+	ktrace_file_header fileHeader;
+	memset(&fileHeader, 0, sizeof(fileHeader));
+	fileHeader.magic = KTRACE_MAGIC;
+	fileHeader.version = KTRACE_VERSION;
+	fileHeader.cpu_count = cpuCount;
+	fileHeader.categories = categories;
+
+	if (fwrite(&fileHeader, sizeof(fileHeader), 1, file) != 1
+		|| write_thread_names(file, fileHeader.thread_count) != B_OK) {
+		fprintf(stderr, "%s: Failed to write \"%s\": %s\n", __progname,
+			outputFile, strerror(errno));
+		return 1;
+	}
+
+	struct sigaction action;
+	action.sa_handler = (__sighandler_t)signal_handler;
+	sigemptyset(&action.sa_mask);
+	action.sa_userdata = NULL;
+	action.sa_flags = 0;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGHUP, &action, NULL);
+	sigaction(SIGQUIT, &action, NULL);
+
+	tracepoint_parameters parameters;
+	parameters.buffer_area = area;
+	parameters.categories = categories;
+	parameters.sample_interval = interval;
+
+	status_t error = _kern_tracepoint_start(&parameters);
+	if (error != B_OK) {
+		fprintf(stderr, "%s: Failed to start recording: %s\n", __progname,
+			strerror(error));
+		fclose(file);
+		unlink(outputFile);
+		return 1;
+	}
+
+	// the kernel may have made the rings a bit larger than requested
+	tracepoint_record* buffer = (tracepoint_record*)malloc(
+		header->ring_capacity * sizeof(tracepoint_record));
+	uint64* lastHeads = (uint64*)calloc(cpuCount, sizeof(uint64));
+	if (buffer == NULL || lastHeads == NULL) {
+		_kern_tracepoint_stop();
+		fprintf(stderr, "%s: Out of memory\n", __progname);
+		return 1;
+	}
+
+	if (duration >= 0)
+		printf("Recording for %g seconds...\n", duration / 1000000.0);
+	else
+		printf("Recording, press Ctrl-C to stop...\n");
+
+	bigtime_t endTime = system_time() + duration;
+	bool stopped = false;
+	while (true) {
+		if (!stopped
+			&& (sQuit || (duration >= 0 && system_time() >= endTime))) {
+			// collect what's left after the kernel stopped writing
+			_kern_tracepoint_stop();
+			stopped = true;
+		}
+
+		for (uint32 cpu = 0; cpu < cpuCount; cpu++) {
+			uint32 count = copy_ring_records(header, cpu, buffer,
+				lastHeads[cpu], fileHeader.lost_count);
+			if (count > 0 && fwrite(buffer, sizeof(tracepoint_record), count,
+					file) != count) {
+				fprintf(stderr, "%s: Failed to write \"%s\": %s\n",
+					__progname, outputFile, strerror(errno));
+				if (!stopped)
+					_kern_tracepoint_stop();
+				return 1;
+			}
+			fileHeader.record_count += count;
+		}
+
+		if (stopped)
+			break;
+
+		snooze(kPollInterval);
+	}
+
+	if (fseek(file, 0, SEEK_SET) != 0
+		|| fwrite(&fileHeader, sizeof(fileHeader), 1, file) != 1) {
+		fprintf(stderr, "%s: Failed to write \"%s\": %s\n", __progname,
+			outputFile, strerror(errno));
+		return 1;
+	}
+	fclose(file);
+
+	printf("%" B_PRIu64 " records written to \"%s\"", fileHeader.record_count,
+		outputFile);
+	if (fileHeader.lost_count > 0)
+		printf(", %" B_PRIu64 " lost", fileHeader.lost_count);
+	printf(".\n");
+
+	delete_area(area);
+	return 0;
+}
+
+
+// #pragma mark - report
+
+
+struct cpu_state {
+	bigtime_t	switch_time;
+	thread_id	thread;
+};
+
+
+static const ktrace_thread*
+find_thread(const ktrace_thread* threads, uint32 count, thread_id id)
+{
+	for (uint32 i = 0; i < count; i++) {
+		if (threads[i].thread == id)
+			return &threads[i];
+	}
+	return NULL;
+}
+
+
+static team_id
+thread_team(const ktrace_thread* threads, uint32 count, thread_id id)
+{
+	const ktrace_thread* thread = find_thread(threads, count, id);
+	return thread != NULL ? thread->team : B_SYSTEM_TEAM;
+}
+
+
+static const char*
+thread_name(const ktrace_thread* threads, uint32 count, thread_id id)
+{
+	const ktrace_thread* thread = find_thread(threads, count, id);
+	return thread != NULL ? thread->name : "?";
+}
+
+
+static const char*
+event_name(uint16 event)
+{
+	switch (event) {
+		case B_TRACEPOINT_PAGE_FAULT_BEGIN:
+		case B_TRACEPOINT_PAGE_FAULT_END:
+			return "page fault";
+		case B_TRACEPOINT_VFS_READ_BEGIN:
+		case B_TRACEPOINT_VFS_READ_END:
+			return "read";
+		case B_TRACEPOINT_VFS_WRITE_BEGIN:
+		case B_TRACEPOINT_VFS_WRITE_END:
+			return "write";
+		case B_TRACEPOINT_BLOCK_READ_BEGIN:
+		case B_TRACEPOINT_BLOCK_READ_END:
+			return "block read";
+		case B_TRACEPOINT_BLOCK_WRITE_BEGIN:
+		case B_TRACEPOINT_BLOCK_WRITE_END:
+			return "block write";
+		case B_TRACEPOINT_NET_RECEIVE:
+			return "net receive";
+		case B_TRACEPOINT_NET_SEND:
+			return "net send";
+		default:
+			return "?";
+	}
+}
+
+
+/*!	Prints a string as a JSON string literal.
+*/
+static void
+print_string(const char* string)
+{
+	putchar('"');
+	for (; *string != '\0'; string++) {
+		if (*string == '"' || *string == '\\')
+			printf("\\%c", *string);
+		else if ((uint8)*string < 0x20)
+			printf("\\u%04x", *string);
+		else
+			putchar(*string);
+	}
+	putchar('"');
+}
+
+
+static void
+print_event_prefix(bool& first, const char* phase, const char* name,
+	team_id team, thread_id thread, bigtime_t time)
+{
+	printf("%s\n{\"ph\":\"%s\",\"name\":", first ? "" : ",", phase);
+	print_string(name);
+	printf(",\"pid\":%" B_PRId32 ",\"tid\":%" B_PRId32 ",\"ts\":%" B_PRId64,
+		team, thread, time);
+	first = false;
+}
+
+
+static int
+report(int argc, char** argv)
+{
+	if (argc > 2)
+		print_usage_and_exit(true);
+
+	const char* inputFile = argc == 2 ? argv[1] : "ktrace.out";
+	FILE* file = fopen(inputFile, "rb");
+	if (file == NULL) {
+		fprintf(stderr, "%s: Failed to open \"%s\": %s\n", __progname,
+			inputFile, strerror(errno));
+		return 1;
+	}
+
+	ktrace_file_header header;
+	if (fread(&header, sizeof(header), 1, file) != 1
+		|| header.magic != KTRACE_MAGIC || header.version != KTRACE_VERSION) {
+		fprintf(stderr, "%s: \"%s\" is not a trace file\n", __progname,
+			inputFile);
+		return 1;
+	}
+
+	ktrace_thread* threads = (ktrace_thread*)malloc(
+		header.thread_count * sizeof(ktrace_thread));
+	cpu_state* cpus = (cpu_state*)calloc(header.cpu_count, sizeof(cpu_state));
+	if ((threads == NULL && header.thread_count > 0) || cpus == NULL) {
+		fprintf(stderr, "%s: Out of memory\n", __progname);
+		return 1;
+	}
+
+	if (fread(threads, sizeof(ktrace_thread), header.thread_count, file)
+			!= header.thread_count) {
+		fprintf(stderr, "%s: \"%s\" is truncated\n", __progname, inputFile);
+		return 1;
+	}
+
+	// The CPU timelines are shown as the threads of a pseudo team that
+	// doesn't exist in the system.
+	const team_id cpuTeam = 0;
+	bool first = true;
+
+	printf("{\"traceEvents\":[");
+
+	for (uint32 i = 0; i < header.thread_count; i++) {
+		print_event_prefix(first, "M", "thread_name", threads[i].team,
+			threads[i].thread, 0);
+		printf(",\"args\":{\"name\":");
+		print_string(threads[i].name);
+		printf("}}");
+	}
+	print_event_prefix(first, "M", "process_name", cpuTeam, 0, 0);
+	printf(",\"args\":{\"name\":\"CPUs\"}}");
+	for (uint32 i = 0; i < header.cpu_count; i++) {
+		print_event_prefix(first, "M", "thread_name", cpuTeam, i, 0);
+		printf(",\"args\":{\"name\":\"CPU %" B_PRIu32 "\"}}", i);
+	}
+
+	tracepoint_record record;
+	while (fread(&record, sizeof(record), 1, file) == 1) {
+		team_id team = thread_team(threads, header.thread_count,
+			record.thread);
+		const char* phase;
+
+		switch (record.event) {
+			case B_TRACEPOINT_THREAD_SWITCH:
+			{
+				if (record.cpu >= header.cpu_count)
+					break;
+
+				// the records of a CPU are in chronological order
+				cpu_state& cpu = cpus[record.cpu];
+				if (cpu.switch_time != 0) {
+					print_event_prefix(first, "X",
+						thread_name(threads, header.thread_count, cpu.thread),
+						cpuTeam, record.cpu, cpu.switch_time);
+					printf(",\"dur\":%" B_PRId64 ",\"args\":{\"thread\":%"
+						B_PRId32 "}}", record.time - cpu.switch_time,
+						cpu.thread);
+				}
+				cpu.switch_time = record.time;
+				cpu.thread = (thread_id)record.args[1];
+				break;
+			}
+
+			case B_TRACEPOINT_THREAD_ENQUEUED:
+				print_event_prefix(first, "i", "enqueue", team, record.thread,
+					record.time);
+				printf(",\"s\":\"t\",\"args\":{\"thread\":%" B_PRId32
+					",\"priority\":%" B_PRId32 "}}", (thread_id)record.args[0],
+					(int32)record.args[1]);
+				break;
+
+			case B_TRACEPOINT_PAGE_FAULT_BEGIN:
+				print_event_prefix(first, "B", event_name(record.event), team,
+					record.thread, record.time);
+				printf(",\"args\":{\"address\":\"%#" B_PRIx64
+					"\",\"write\":%s}}", record.args[0],
+					record.args[1] != 0 ? "true" : "false");
+				break;
+
+			case B_TRACEPOINT_VFS_READ_BEGIN:
+			case B_TRACEPOINT_VFS_WRITE_BEGIN:
+				print_event_prefix(first, "B", event_name(record.event), team,
+					record.thread, record.time);
+				printf(",\"args\":{\"fd\":%" B_PRId32 ",\"length\":%" B_PRIu64
+					"}}", (int32)record.args[0], record.args[1]);
+				break;
+
+			case B_TRACEPOINT_BLOCK_READ_BEGIN:
+			case B_TRACEPOINT_BLOCK_WRITE_BEGIN:
+				print_event_prefix(first, "B", event_name(record.event), team,
+					record.thread, record.time);
+				printf(",\"args\":{\"device fd\":%" B_PRId32 ",\"%s\":%"
+					B_PRIu64 "}}", (int32)record.args[0],
+					record.event == B_TRACEPOINT_BLOCK_READ_BEGIN
+						? "block" : "count", record.args[1]);
+				break;
+
+			case B_TRACEPOINT_PAGE_FAULT_END:
+			case B_TRACEPOINT_VFS_READ_END:
+			case B_TRACEPOINT_VFS_WRITE_END:
+			case B_TRACEPOINT_BLOCK_READ_END:
+			case B_TRACEPOINT_BLOCK_WRITE_END:
+				print_event_prefix(first, "E", event_name(record.event), team,
+					record.thread, record.time);
+				printf(",\"args\":{\"result\":%" B_PRId64 "}}",
+					(int64)record.args[1]);
+				break;
+
+			case B_TRACEPOINT_IO_REQUEST_BEGIN:
+			case B_TRACEPOINT_IO_REQUEST_END:
+				// IO requests usually complete in another thread, so they
+				// are async events identified by the request
+				phase = record.event == B_TRACEPOINT_IO_REQUEST_BEGIN
+					? "b" : "e";
+				print_event_prefix(first, phase, "io request", team,
+					record.thread, record.time);
+				printf(",\"cat\":\"io\",\"id\":\"%#" B_PRIx64
+					"\",\"args\":{\"%s\":%" B_PRId64 "}}", record.args[0],
+					record.event == B_TRACEPOINT_IO_REQUEST_BEGIN
+						? "length" : "status", (int64)record.args[1]);
+				break;
+
+			case B_TRACEPOINT_NET_RECEIVE:
+			case B_TRACEPOINT_NET_SEND:
+				print_event_prefix(first, "i", event_name(record.event), team,
+					record.thread, record.time);
+				printf(",\"s\":\"t\",\"args\":{\"interface\":%" B_PRIu64
+					",\"size\":%" B_PRIu64 "}}", record.args[0],
+					record.args[1]);
+				break;
+
+			case B_TRACEPOINT_SAMPLE:
+				print_event_prefix(first, "i", "sample", team, record.thread,
+					record.time);
+				printf(",\"s\":\"t\",\"args\":{\"pc\":\"%#" B_PRIx64
+					"\",\"kernel\":%s}}", record.args[0],
+					record.args[1] != 0 ? "true" : "false");
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	printf("\n],\"otherData\":{\"lost records\":\"%" B_PRIu64 "\"}}\n",
+		header.lost_count);
+
+	fclose(file);
+	return 0;
+}
+
+
+// #pragma mark -
+
+
+int
+main(int argc, char** argv)
+{
+	if (argc < 2)
+		print_usage_and_exit(true);
+
+	if (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0)
+		print_usage_and_exit(false);
+
+	if (strcmp(argv[1], "record") == 0)
+		return record(argc - 1, argv + 1);
+	if (strcmp(argv[1], "report") == 0)
+		return report(argc - 1, argv + 1);
+
+	print_usage_and_exit(true);
+	return 1;
+}
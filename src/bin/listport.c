@@ -14,8 +14,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <OS.h>
 
+#include <port_defs.h>
+#include <syscalls.h>
+
 
 void list_team_ports  (team_id id);
 void show_port_totals (void); 
@@ -79,15 +83,29 @@ list_team_ports(team_id id)
 	}
 
 	printf("\nTEAM %4" B_PRId32 " (%s):\n", id, this_team.args);
-	printf("   ID                         name  capacity  queued\n");
-	printf("----------------------------------------------------\n");
+	printf("   ID                         name  capacity  queued"
+		"     written        read  shared   waits  contended\n");
+	printf("----------------------------------------------------"
+		"-----------------------------------------------------\n");
 	
 	while (get_next_port_info(id, &cookie, &this_port) == B_OK) {
-		printf("%5" B_PRId32 " %28s  %8" B_PRId32 "  %6" B_PRId32 "\n",
+		port_stats stats;
+		if (_kern_get_port_stats(this_port.port, &stats, sizeof(stats))
+				!= B_OK)
+			memset(&stats, 0, sizeof(stats));
+
+		printf("%5" B_PRId32 " %28s  %8" B_PRId32 "  %6" B_PRId32
+			"  %10" B_PRIu64 "  %10" B_PRIu64 "  %6" B_PRIu32 "  %6" B_PRIu32
+			"  %9" B_PRIu32 "\n",
 		        this_port.port,
 		        this_port.name,
 		        this_port.capacity,
-		        this_port.queue_count);
+		        this_port.queue_count,
+		        stats.bytes_written,
+		        stats.bytes_read,
+		        stats.shared_messages,
+		        stats.read_waits + stats.write_waits,
+		        stats.lock_contention);
 	}
 }
 
@@ -20,6 +20,9 @@
 
 #include <list>
 
+#include <scheduler_defs.h>
+#include <syscalls.h>
+
 #include "termcap.h"
 
 static const char IDLE_NAME[] = "idle thread ";
@@ -110,6 +113,34 @@ cpu_perc(bigtime_t spent, bigtime_t interval)
 }
 
 
+/*
+ * Print the number of threads waiting in the run queue of each core, and how
+ * many threads the core has taken over from busier cores so far.
+ * Returns the number of lines printed.
+ */
+static int
+print_core_stats()
+{
+	scheduler_core_stats stats[64];
+	ssize_t count = _kern_get_scheduler_core_stats(stats, sizeof(stats));
+	if (count < 2)
+		return 0;
+
+	int length = printf("CORE QUEUE/STEALS:");
+	for (ssize_t i = 0; i < count; i++) {
+		char buffer[64];
+		int entryLength = snprintf(buffer, sizeof(buffer),
+			" %" B_PRId32 ":%" B_PRId32 "/%" B_PRId64, stats[i].core,
+			stats[i].queue_depth, stats[i].steals);
+		if (length + entryLength >= columns && columns > 0)
+			break;
+		length += printf("%s", buffer);
+	}
+	printf("\n");
+	return 1;
+}
+
+
 /*
  * Compare an old snapshot with the new one
  */
@@ -187,9 +218,10 @@ compare(
 	 */
 	times.sort();
 
+	linecount = print_core_stats();
 	printf("%6s %7s %7s %7s %4s %16s %-16s \n", "THID", "TOTAL", "USER",
 		"KERNEL", "%CPU", "TEAM NAME", "THREAD NAME");
-	linecount = 1;
+	linecount++;
 	idletime = 0;
 	gtotal = 0;
 	ktotal = 0;
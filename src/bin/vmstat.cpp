@@ -9,12 +9,18 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <generic_syscall_defs.h>
+#include <object_cache_stats.h>
+#include <syscalls.h>
 #include <system_info.h>
+#include <vm_compressed_swap.h>
+#include <vm_page_magazines.h>
 
 
 static struct option const kLongOptions[] = {
 	{"periodic", no_argument, 0, 'p'},
 	{"rate", required_argument, 0, 'r'},
+	{"slabs", no_argument, 0, 's'},
 	{"help", no_argument, 0, 'h'},
 	{NULL}
 };
@@ -26,15 +32,64 @@ static const char *kProgramName = __progname;
 void
 usage(int status)
 {
-	fprintf(stderr, "usage: %s [-p] [-r <time>]\n"
+	fprintf(stderr, "usage: %s [-p] [-r <time>] [-s]\n"
 		" -p,--periodic\tDumps changes periodically every second.\n"
-		" -r,--rate\tDumps changes periodically every <time> milli seconds.\n",
+		" -r,--rate\tDumps changes periodically every <time> milli seconds.\n"
+		" -s,--slabs\tDumps the statistics of the kernel object caches.\n",
 		kProgramName);
 
 	exit(status);
 }
 
 
+static int
+dump_object_caches()
+{
+	object_cache_stats_request request = {};
+	uint32 capacity = 0;
+	while (true) {
+		status_t status = _kern_generic_syscall(OBJECT_CACHE_SYSCALLS,
+			GET_OBJECT_CACHE_STATS, &request, sizeof(request));
+		if (status != B_OK) {
+			fprintf(stderr, "%s: cannot get object cache statistics: %s\n",
+				kProgramName, strerror(status));
+			free(request.stats);
+			return 1;
+		}
+		if (request.count <= capacity)
+			break;
+
+		// leave some room for caches created in the meantime
+		capacity = request.count + 16;
+		free(request.stats);
+		request.stats = (object_cache_stats*)malloc(
+			capacity * sizeof(object_cache_stats));
+		if (request.stats == NULL) {
+			fprintf(stderr, "%s: out of memory\n", kProgramName);
+			return 1;
+		}
+		request.count = capacity;
+	}
+
+	printf("%-24s %10s %10s %10s %8s %5s %10s %8s %10s\n", "cache",
+		"depot hits", "misses", "slab alloc", "frees", "mag", "exchanges",
+		"contend", "wait (us)");
+
+	for (uint32 i = 0; i < request.count; i++) {
+		const object_cache_stats& stats = request.stats[i];
+		printf("%-24s %10" B_PRIu64 " %10" B_PRIu64 " %10" B_PRIu64 " %8"
+			B_PRIu64 " %5" B_PRIu32 " %10" B_PRIu64 " %8" B_PRIu64 " %10"
+			B_PRId64 "\n", stats.name, stats.depot_hits, stats.depot_misses,
+			stats.slab_allocations, stats.slab_frees, stats.magazine_capacity,
+			stats.magazine_exchanges, stats.contended_locks,
+			stats.lock_wait_time);
+	}
+
+	free(request.stats);
+	return 0;
+}
+
+
 int
 main(int argc, char** argv)
 {
@@ -42,7 +97,7 @@ main(int argc, char** argv)
 	bigtime_t rate = 1000000LL;
 
 	int c;
-	while ((c = getopt_long(argc, argv, "pr:h", kLongOptions, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "pr:sh", kLongOptions, NULL)) != -1) {
 		switch (c) {
 			case 0:
 				break;
@@ -58,6 +113,8 @@ main(int argc, char** argv)
 				}
 				periodically = true;
 				break;
+			case 's':
+				return dump_object_caches();
 			case 'h':
 				usage(0);
 				break;
@@ -85,6 +142,39 @@ main(int argc, char** argv)
 		info.free_swap_pages * B_PAGE_SIZE);
 	printf("page faults:\t\t%" B_PRIu32 "\n", info.page_faults);
 
+	vm_page_magazine_info magazineInfo;
+	if (_kern_generic_syscall(VM_PAGE_MAGAZINE_SYSCALLS,
+			GET_VM_PAGE_MAGAZINE_INFO, &magazineInfo,
+			sizeof(magazineInfo)) == B_OK) {
+		printf("page magazines:\t\t%" B_PRIu64 " free, %" B_PRIu64 " clear "
+			"(%" B_PRIu32 " CPUs, %" B_PRIu32 " pages each)\n",
+			magazineInfo.free_pages, magazineInfo.clear_pages,
+			magazineInfo.cpu_count, magazineInfo.magazine_size);
+		printf("magazine hits:\t\t%" B_PRIu64 " (%" B_PRIu64 " misses, %"
+			B_PRIu64 " refills, %" B_PRIu64 " drains)\n", magazineInfo.hits,
+			magazineInfo.misses, magazineInfo.refills, magazineInfo.drains);
+	}
+
+	compressed_swap_info swapInfo;
+	if (_kern_generic_syscall(COMPRESSED_SWAP_SYSCALLS,
+			GET_COMPRESSED_SWAP_INFO, &swapInfo, sizeof(swapInfo)) == B_OK
+		&& swapInfo.pool_size > 0) {
+		uint64 compressedPages = swapInfo.stored_pages - swapInfo.zero_pages;
+		double ratio = swapInfo.compressed_size > 0
+			? (double)compressedPages * B_PAGE_SIZE / swapInfo.compressed_size
+			: 0;
+
+		printf("compressed swap:	%" B_PRIu64 " of %" B_PRIu64 " used\n",
+			swapInfo.used_size, swapInfo.pool_size);
+		printf("compressed pages:	%" B_PRIu64 " (%" B_PRIu64 " zero pages, "
+			"ratio %.2f)\n", swapInfo.stored_pages, swapInfo.zero_pages,
+			ratio);
+		printf("compressed stores:	%" B_PRIu64 " (%" B_PRIu64 " rejected)\n",
+			swapInfo.stores, swapInfo.rejects);
+		printf("swap reads:		%" B_PRIu64 " from pool, %" B_PRIu64
+			" from swap files\n", swapInfo.pool_reads, swapInfo.file_reads);
+	}
+
 	if (periodically) {
 		puts("\npage faults  used memory    used swap  block cache");
 		system_info lastInfo = info;
@@ -72,6 +72,7 @@ respective holders. All rights reserved.
 #include <fs_info.h>
 #include <sys/utsname.h>
 
+#include <AutoDeleter.h>
 #include <AutoLocker.h>
 #include <libroot/libroot_private.h>
 #include <system/syscalls.h>
@@ -267,6 +268,13 @@ CopyLoopControl::SkipEntry(const BEntry*, bool)
 }
 
 
+bool
+CopyLoopControl::NeedsChecksums()
+{
+	return false;
+}
+
+
 void
 CopyLoopControl::ChecksumChunk(const char*, size_t)
 {
@@ -1458,6 +1466,14 @@ LowLevelCopy(BEntry* srcEntry, StatStruct* srcStat, BDirectory* destDir,
 	SetupPoseLocation(ref.directory, destNodeRef.node, &srcFile,
 		&destFile, loc);
 
+	// let the kernel move the file data directly from one file cache to
+	// the other, unless the loop control needs to see it
+	bool checksum = loopControl->NeedsChecksums();
+	FileDescriptorCloser srcFD(srcFile.Dup());
+	FileDescriptorCloser destFD(destFile.Dup());
+	off_t srcOffset = 0;
+	off_t destOffset = 0;
+
 	char* buffer = new char[bufsize];
 	try {
 		// copy data portion of file
@@ -1474,34 +1490,32 @@ LowLevelCopy(BEntry* srcEntry, StatStruct* srcStat, BDirectory* destDir,
 			}
 
 			ASSERT(buffer);
-			ssize_t bytes = srcFile.Read(buffer, bufsize);
-
-			if (bytes > 0) {
-				ssize_t updateBytes = 0;
-				if (bytes > 32* 1024) {
-					// when copying large chunks, update after read and after
-					// write to get better update granularity
-					updateBytes = bytes / 2;
-					loopControl->UpdateStatus(NULL, ref, updateBytes, true);
-				}
-
-				loopControl->ChecksumChunk(buffer, (size_t)bytes);
-
-				ssize_t result = destFile.Write(buffer, (size_t)bytes);
-				if (result != bytes) {
-					if (result < 0)
-						throw (status_t)result;
-					throw (status_t)B_ERROR;
+			ssize_t bytes;
+			if (checksum) {
+				bytes = srcFile.Read(buffer, bufsize);
+				if (bytes > 0) {
+					loopControl->ChecksumChunk(buffer, (size_t)bytes);
+
+					ssize_t result = destFile.Write(buffer, (size_t)bytes);
+					if (result != bytes) {
+						if (result < 0)
+							throw (status_t)result;
+						throw (status_t)B_ERROR;
+					}
 				}
+			} else {
+				bytes = _kern_copy_file_range(srcFD.Get(), &srcOffset,
+					destFD.Get(), &destOffset, bufsize, 0);
+			}
 
-				result = destFile.Sync();
+			if (bytes > 0) {
+				ssize_t result = destFile.Sync();
 				if (result != B_OK)
 					throw (status_t)result;
 
-				loopControl->UpdateStatus(NULL, ref, bytes - updateBytes,
-					true);
+				loopControl->UpdateStatus(NULL, ref, bytes, true);
 			} else if (bytes < 0) {
-				// read error
+				// read or write error
 				throw (status_t)bytes;
 			} else {
 				// we are done
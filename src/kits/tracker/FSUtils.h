@@ -100,6 +100,11 @@ public:
 	//! Override to prevent copying of a given file or directory
 	virtual	bool				SkipEntry(const BEntry*, bool file);
 
+	//! Override to return true when overriding ChecksumChunk(). Only
+	// then the file data is passed through userland, otherwise the
+	// kernel copies it directly.
+	virtual	bool				NeedsChecksums();
+
 	//! During a file copy, this is called every time a chunk of data
 	// is copied.  Users may override to keep a running checksum.
 	virtual	void				ChecksumChunk(const char* block, size_t size);
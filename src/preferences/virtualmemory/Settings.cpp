@@ -34,6 +34,8 @@ static const off_t kGigaByte = kMegaByte * 1024;
 
 
 Settings::Settings()
+	:
+	fCompressedSwapSize(0)
 {
 	fDefaultSettings.enabled = true;
 	fDefaultSettings.automatic = true;
@@ -157,6 +159,12 @@ Settings::ReadSwapSettings()
 	const char* capacity = get_driver_parameter(settings.Get(),
 		"swap_volume_capacity", NULL, NULL);
 
+	// not configurable here, but must survive rewriting the settings
+	const char* compressedSize = get_driver_parameter(settings.Get(),
+		"swap_compressed_size", NULL, NULL);
+	if (compressedSize != NULL)
+		fCompressedSwapSize = atoll(compressedSize);
+
 	if (enabled == NULL	|| automatic == NULL || size == NULL || device == NULL
 		|| volume == NULL || capacity == NULL || filesystem == NULL)
 		return kErrorSettingsInvalid;
@@ -233,6 +241,12 @@ Settings::WriteSwapSettings()
 		SwapSize(), info.volume_name, info.device_name, info.fsh_name,
 		info.total_blocks * info.block_size);
 
+	if (fCompressedSwapSize > 0) {
+		size_t length = strlen(buffer);
+		snprintf(buffer + length, sizeof(buffer) - length,
+			"swap_compressed_size %" B_PRIdOFF "\n", fCompressedSwapSize);
+	}
+
 	file.Write(buffer, strlen(buffer));
 	return B_OK;
 }
@@ -65,6 +65,7 @@ private:
 			};
 
 			BPoint			fWindowPosition;
+			off_t			fCompressedSwapSize;
 
 			SwapSettings	fCurrentSettings;
 			SwapSettings	fInitialSettings;
@@ -194,6 +194,43 @@ Stream::ReadLink(char* buffer, size_t bufferSize)
 }
 
 
+/*!	Reads the data of a small file from the small_data section of its inode,
+	which the constructor doesn't load.
+*/
+status_t
+Stream::ReadInlineData(off_t pos, uint8* buffer, size_t length)
+{
+	uint32 inodeSize = fVolume.BlockSize();
+	bfs_inode* node = (bfs_inode*)malloc(inodeSize);
+	if (node == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = B_BAD_DATA;
+	if (read_pos(fVolume.Device(), fVolume.ToOffset(inode_num), node,
+			inodeSize) != (ssize_t)inodeSize) {
+		status = B_IO_ERROR;
+	} else if (node->InodeSize() == (int32)inodeSize) {
+		const small_data* item = node->SmallDataStart();
+		for (; !item->IsLast(node); item = item->Next()) {
+			if (*item->Name() != INLINE_DATA_NAME
+				|| item->NameSize() != INLINE_DATA_NAME_LENGTH)
+				continue;
+
+			if (item->DataSize() == data.Size()
+				&& item->Data() + item->DataSize()
+					<= (uint8*)node + inodeSize) {
+				memcpy(buffer, item->Data() + pos, length);
+				status = B_OK;
+			}
+			break;
+		}
+	}
+
+	free(node);
+	return status;
+}
+
+
 status_t
 Stream::FindBlockRun(off_t pos, block_run& run, off_t& offset)
 {
@@ -309,6 +346,12 @@ Stream::ReadAt(off_t pos, uint8* buffer, size_t* _length)
 	if (pos + (off_t)length > data.Size())
 		length = data.Size() - pos;
 
+	if ((Flags() & INODE_INLINE_DATA) != 0) {
+		status_t status = ReadInlineData(pos, buffer, length);
+		*_length = status == B_OK ? length : 0;
+		return status;
+	}
+
 	block_run run;
 	off_t offset;
 	if (FindBlockRun(pos, run, offset) < B_OK) {
@@ -1663,6 +1663,7 @@ _user_set_clock(clockid_t clockID, bigtime_t time)
 			thread->cpu_clock_offset += diff;
 
 			thread_clock_changed(thread, diff);
+			thread_publish_cpu_time(thread);
 			return B_OK;
 		}
 
@@ -1695,6 +1696,11 @@ _user_set_clock(clockid_t clockID, bigtime_t time)
 				thread->cpu_clock_offset += diff;
 
 				thread_clock_changed(thread, diff);
+
+				// We can only reach the user_thread of threads in our own
+				// team, others will see the change once they are rescheduled.
+				if (thread->team == thread_get_current_thread()->team)
+					thread_publish_cpu_time(thread);
 				return B_OK;
 			} else {
 				teamID = clockID & CPUCLOCK_ID_MASK;
@@ -0,0 +1,223 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Retrieves the NUMA topology from the ACPI System Resource Affinity Table
+	(SRAT) and System Locality Information Table (SLIT).
+*/
+
+
+#include <arch/x86/acpi_numa.h>
+
+#include <ACPI.h>
+#include <AutoDeleter.h>
+#include <numa.h>
+#include <safemode.h>
+#include <smp.h>
+
+#include <arch/x86/arch_smp.h>
+
+#include "acpi.h"
+
+
+//#define TRACE_ACPI_NUMA
+#ifdef TRACE_ACPI_NUMA
+#	define TRACE(x...) dprintf("acpi_numa: " x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+#define MAX_MEMORY_RANGES	32
+
+
+struct numa_info {
+	uint32				domains[NUMA_MAX_NODES];
+	int32				node_count;
+	numa_memory_range	ranges[MAX_MEMORY_RANGES];
+	int32				range_count;
+	int32				cpu_nodes[SMP_MAX_CPUS];
+};
+
+
+/*!	Returns the node index for the given proximity domain, adding a new node
+	if the domain hasn't been seen yet. Returns -1 if there are too many.
+*/
+static int32
+node_for_domain(numa_info& info, uint32 domain, bool add)
+{
+	for (int32 i = 0; i < info.node_count; i++) {
+		if (info.domains[i] == domain)
+			return i;
+	}
+
+	if (!add || info.node_count == NUMA_MAX_NODES)
+		return -1;
+
+	info.domains[info.node_count] = domain;
+	return info.node_count++;
+}
+
+
+static void
+set_cpu_node(numa_info& info, uint32 apicID, int32 node)
+{
+	for (int32 cpu = 0; cpu < smp_get_num_cpus(); cpu++) {
+		if (x86_get_cpu_apic_id(cpu) == apicID) {
+			info.cpu_nodes[cpu] = node;
+			return;
+		}
+	}
+}
+
+
+static status_t
+parse_srat(acpi_table_srat* srat, numa_info& info)
+{
+	acpi_subtable_header* entry
+		= (acpi_subtable_header*)((uint8*)srat + sizeof(acpi_table_srat));
+	void* end = (uint8*)srat + srat->Header.Length;
+
+	while (entry < end && entry->Length > 0) {
+		switch (entry->Type) {
+			case ACPI_SRAT_TYPE_CPU_AFFINITY:
+			{
+				acpi_srat_cpu_affinity* cpu = (acpi_srat_cpu_affinity*)entry;
+				if ((cpu->Flags & ACPI_SRAT_CPU_USE_AFFINITY) == 0)
+					break;
+
+				uint32 domain = cpu->ProximityDomainLo
+					| (uint32)cpu->ProximityDomainHi[0] << 8
+					| (uint32)cpu->ProximityDomainHi[1] << 16
+					| (uint32)cpu->ProximityDomainHi[2] << 24;
+				int32 node = node_for_domain(info, domain, true);
+				if (node < 0)
+					return B_BAD_DATA;
+
+				TRACE("apic %u: domain %" B_PRIu32 "\n", cpu->ApicId, domain);
+				set_cpu_node(info, cpu->ApicId, node);
+				break;
+			}
+
+			case ACPI_SRAT_TYPE_X2APIC_CPU_AFFINITY:
+			{
+				acpi_srat_x2apic_cpu_affinity* cpu
+					= (acpi_srat_x2apic_cpu_affinity*)entry;
+				if ((cpu->Flags & ACPI_SRAT_CPU_ENABLED) == 0)
+					break;
+
+				int32 node = node_for_domain(info, cpu->ProximityDomain, true);
+				if (node < 0)
+					return B_BAD_DATA;
+
+				TRACE("x2apic %" B_PRIu32 ": domain %" B_PRIu32 "\n",
+					(uint32)cpu->ApicId, (uint32)cpu->ProximityDomain);
+				set_cpu_node(info, cpu->ApicId, node);
+				break;
+			}
+
+			case ACPI_SRAT_TYPE_MEMORY_AFFINITY:
+			{
+				acpi_srat_mem_affinity* memory
+					= (acpi_srat_mem_affinity*)entry;
+				if ((memory->Flags & ACPI_SRAT_MEM_ENABLED) == 0
+					|| memory->Length == 0) {
+					break;
+				}
+
+				int32 node = node_for_domain(info, memory->ProximityDomain,
+					true);
+				if (node < 0)
+					return B_BAD_DATA;
+
+				if (info.range_count == MAX_MEMORY_RANGES) {
+					// the memory is simply considered to belong to node 0
+					dprintf("acpi_numa: too many memory ranges, ignoring %#"
+						B_PRIx64 " - %#" B_PRIx64 "\n",
+						(uint64)memory->BaseAddress,
+						(uint64)(memory->BaseAddress + memory->Length));
+					break;
+				}
+
+				TRACE("memory %#" B_PRIx64 " - %#" B_PRIx64 ": domain %"
+					B_PRIu32 "\n", (uint64)memory->BaseAddress,
+					(uint64)(memory->BaseAddress + memory->Length),
+					(uint32)memory->ProximityDomain);
+
+				numa_memory_range& range = info.ranges[info.range_count++];
+				range.start = memory->BaseAddress;
+				range.end = memory->BaseAddress + memory->Length;
+				range.node = node;
+				break;
+			}
+		}
+
+		entry = (acpi_subtable_header*)((uint8*)entry + entry->Length);
+	}
+
+	return B_OK;
+}
+
+
+/*!	Fills in \a distances from the SLIT, which is indexed by proximity
+	domain. Returns \c false if the table doesn't cover all nodes.
+*/
+static bool
+parse_slit(acpi_table_slit* slit, const numa_info& info, uint8* distances)
+{
+	for (int32 from = 0; from < info.node_count; from++) {
+		for (int32 to = 0; to < info.node_count; to++) {
+			if (info.domains[from] >= slit->LocalityCount
+				|| info.domains[to] >= slit->LocalityCount) {
+				return false;
+			}
+
+			distances[from * info.node_count + to] = slit->Entry[
+				info.domains[from] * slit->LocalityCount + info.domains[to]];
+		}
+	}
+
+	return true;
+}
+
+
+//	#pragma mark -
+
+
+void
+acpi_numa_init()
+{
+	if (smp_get_num_cpus() == 1
+		|| get_safemode_boolean(B_SAFEMODE_DISABLE_ACPI, false)) {
+		return;
+	}
+
+	acpi_module_info* acpiModule;
+	if (get_module(B_ACPI_MODULE_NAME, (module_info**)&acpiModule) != B_OK)
+		return;
+	BPrivate::CObjectDeleter<const char, status_t, put_module>
+		acpiModulePutter(B_ACPI_MODULE_NAME);
+
+	acpi_table_srat* srat = NULL;
+	if (acpiModule->get_table(ACPI_SIG_SRAT, 0, (void**)&srat) != B_OK)
+		return;
+
+	numa_info info = {};
+	if (parse_srat(srat, info) != B_OK) {
+		dprintf("acpi_numa: unsupported SRAT, ignoring NUMA topology\n");
+		return;
+	}
+	if (info.node_count < 2)
+		return;
+
+	uint8 distances[NUMA_MAX_NODES * NUMA_MAX_NODES];
+	bool haveDistances = false;
+	acpi_table_slit* slit = NULL;
+	if (acpiModule->get_table(ACPI_SIG_SLIT, 0, (void**)&slit) == B_OK)
+		haveDistances = parse_slit(slit, info, distances);
+
+	numa_set_topology(info.node_count, info.ranges, info.range_count,
+		info.cpu_nodes, haveDistances ? distances : NULL);
+}
@@ -12,6 +12,8 @@
 
 #include <real_time_clock.h>
 #include <real_time_data.h>
+#include <smp.h>
+#include <util/AutoLock.h>
 
 
 #define CMOS_ADDR_PORT 0x70
@@ -28,6 +30,9 @@ typedef struct	{
 } cmos_time;
 
 
+static spinlock sSystemTimeOffsetLock = B_SPINLOCK_INITIALIZER;
+
+
 static uint32
 bcd_to_int(uint8 bcd)
 {
@@ -218,10 +223,21 @@ arch_rtc_set_hw_time(uint32 seconds)
 }
 
 
+/*!	Updates the offset userland adds to system_time() to get the real time.
+	The commpage is read-only for userland, so it cannot use atomic_get64()
+	on it; instead the update is bracketed by incrementing the version, which
+	is odd while the offset is being changed.
+*/
 void
 arch_rtc_set_system_time_offset(struct real_time_data *data, bigtime_t offset)
 {
+	InterruptsSpinLocker locker(sSystemTimeOffsetLock);
+
+	atomic_add(&data->arch_data.version, 1);
+	memory_write_barrier();
 	atomic_set64(&data->arch_data.system_time_offset, offset);
+	memory_write_barrier();
+	atomic_add(&data->arch_data.version, 1);
 }
 
 
@@ -30,6 +30,7 @@
 #include <arch/int.h>
 #include <arch/cpu.h>
 
+#include <arch/x86/acpi_numa.h>
 #include <arch/x86/bios.h>
 
 
@@ -761,6 +762,10 @@ arch_vm_init_end(kernel_args *args)
 status_t
 arch_vm_init_post_modules(kernel_args *args)
 {
+	// the ACPI module is now accessible, so we can find out about the memory
+	// nodes of the machine
+	acpi_numa_init();
+
 	// the x86 CPU modules are now accessible
 
 	sMemoryTypeRegisterCount = x86_count_mtrrs();
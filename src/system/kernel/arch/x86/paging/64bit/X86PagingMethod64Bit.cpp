@@ -381,9 +381,8 @@ X86PagingMethod64Bit::PageTableForAddress(uint64* virtualPMLTop,
 		mapCount++;
 	}
 
-	// No proper large page support at the moment, but they are used for the
-	// physical map area. Ensure that nothing tries to treat that as normal
-	// address space.
+	// Large pages have to be split by the translation map before the range
+	// they cover can be treated as normal address space.
 	ASSERT(!(*pde & X86_64_PDE_LARGE_PAGE));
 
 	return (uint64*)pageMapper->GetPageTableAt(*pde & X86_64_PDE_ADDRESS_MASK);
@@ -433,6 +432,28 @@ X86PagingMethod64Bit::PutPageTableEntryInTable(uint64* entry,
 }
 
 
+/*static*/ void
+X86PagingMethod64Bit::PutLargePageEntryInDirectory(uint64* entry,
+	phys_addr_t physicalAddress, uint32 attributes, uint32 memoryType,
+	bool globalPage)
+{
+	ASSERT(physicalAddress % k64BitPageTableRange == 0);
+
+	// compute the protection bits like for a normal page
+	uint64 page;
+	PutPageTableEntryInTable(&page, 0, attributes, B_WRITE_BACK_MEMORY,
+		globalPage);
+
+	page = (page & ~X86_64_PTE_ADDRESS_MASK)
+		| (physicalAddress & X86_64_PDE_LARGE_ADDRESS_MASK)
+		| X86_64_PDE_LARGE_PAGE
+		| MemoryTypeToLargePageEntryFlags(memoryType);
+
+	// put it in the page directory
+	SetTableEntry(entry, page);
+}
+
+
 /*static*/ void
 X86PagingMethod64Bit::_EnableExecutionDisable(void* dummy, int cpu)
 {
@@ -86,6 +86,12 @@ public:
 									uint64* entry, phys_addr_t physicalAddress,
 									uint32 attributes, uint32 memoryType,
 									bool globalPage);
+	static	void				PutLargePageEntryInDirectory(
+									uint64* entry, phys_addr_t physicalAddress,
+									uint32 attributes, uint32 memoryType,
+									bool globalPage);
+	static	uint64				PageTableEntryFromLargePageEntry(
+									uint64 largeEntry, uint32 index);
 	static	void				SetTableEntry(uint64_t* entry,
 									uint64_t newEntry);
 	static	uint64_t			SetTableEntryFlags(uint64_t* entryPointer,
@@ -98,6 +104,8 @@ public:
 
 	static	uint64				MemoryTypeToPageTableEntryFlags(
 									uint32 memoryType);
+	static	uint64				MemoryTypeToLargePageEntryFlags(
+									uint32 memoryType);
 
 private:
 	static	void				_EnableExecutionDisable(void* dummy, int cpu);
@@ -184,4 +192,33 @@ X86PagingMethod64Bit::MemoryTypeToPageTableEntryFlags(uint32 memoryType)
 }
 
 
+/*static*/ inline uint64
+X86PagingMethod64Bit::MemoryTypeToLargePageEntryFlags(uint32 memoryType)
+{
+	// the PAT bit lives at a different position in large page entries
+	uint64 flags = MemoryTypeToPageTableEntryFlags(memoryType);
+	if ((flags & X86_64_PTE_PAT) != 0)
+		flags = (flags & ~X86_64_PTE_PAT) | X86_64_PDE_PAT;
+	return flags;
+}
+
+
+/*!	Returns the page table entry mapping the \a index th 4 KB page of the
+	large page described by \a largeEntry, with the same attributes.
+*/
+/*static*/ inline uint64
+X86PagingMethod64Bit::PageTableEntryFromLargePageEntry(uint64 largeEntry,
+	uint32 index)
+{
+	uint64 entry = largeEntry
+		& ~(X86_64_PDE_LARGE_ADDRESS_MASK | X86_64_PDE_LARGE_PAGE
+			| X86_64_PDE_PAT);
+	if ((largeEntry & X86_64_PDE_PAT) != 0)
+		entry |= X86_64_PTE_PAT;
+
+	return entry | ((largeEntry & X86_64_PDE_LARGE_ADDRESS_MASK)
+		+ (uint64)index * B_PAGE_SIZE);
+}
+
+
 #endif	// KERNEL_ARCH_X86_PAGING_64BIT_X86_PAGING_METHOD_64BIT_H
@@ -91,8 +91,10 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 				uint64* virtualPageDir = (uint64*)fPageMapper->GetPageTableAt(
 					virtualPDPT[j] & X86_64_PDPTE_ADDRESS_MASK);
 				for (uint32 k = 0; k < 512; k++) {
-					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0)
+					if ((virtualPageDir[k] & X86_64_PDE_PRESENT) == 0
+						|| (virtualPageDir[k] & X86_64_PDE_LARGE_PAGE) != 0) {
 						continue;
+					}
 
 					address = virtualPageDir[k] & X86_64_PDE_ADDRESS_MASK;
 					page = vm_lookup_page(address / B_PAGE_SIZE);
@@ -142,6 +144,11 @@ X86VMTranslationMap64Bit::~X86VMTranslationMap64Bit()
 		}
 	}
 
+	while (vm_page* page = fSpareTables.RemoveHead()) {
+		DEBUG_PAGE_ACCESS_START(page);
+		vm_page_free_etc(NULL, page, &reservation);
+	}
+
 	vm_page_unreserve_pages(&reservation);
 
 	fPageMapper->Delete();
@@ -267,6 +274,73 @@ X86VMTranslationMap64Bit::Map(addr_t virtualAddress, phys_addr_t physicalAddress
 }
 
 
+size_t
+X86VMTranslationMap64Bit::LargePageSize() const
+{
+	return k64BitPageTableRange;
+}
+
+
+status_t
+X86VMTranslationMap64Bit::MapLargePage(addr_t virtualAddress,
+	phys_addr_t physicalAddress, uint32 attributes, uint32 memoryType,
+	vm_page_reservation* reservation)
+{
+	TRACE("X86VMTranslationMap64Bit::MapLargePage(%#" B_PRIxADDR ", %#"
+		B_PRIxPHYSADDR ")\n", virtualAddress, physicalAddress);
+
+	ASSERT(virtualAddress % k64BitPageTableRange == 0);
+	ASSERT(physicalAddress % k64BitPageTableRange == 0);
+
+	ThreadCPUPinner pinner(thread_get_current_thread());
+
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), virtualAddress, fIsKernelMap,
+		true, reservation, fPageMapper, fMapCount);
+	ASSERT(pde != NULL);
+
+	vm_page* spareTable;
+	if ((*pde & X86_64_PDE_PRESENT) != 0) {
+		if ((*pde & X86_64_PDE_LARGE_PAGE) != 0)
+			return B_BUSY;
+
+		// Page tables are not freed when their last page is unmapped. If this
+		// one is empty, we can just take it over as our spare table.
+		uint64* pageTable = (uint64*)fPageMapper->GetPageTableAt(
+			*pde & X86_64_PDE_ADDRESS_MASK);
+		for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+			if (pageTable[i] != 0)
+				return B_BUSY;
+		}
+
+		spareTable = vm_lookup_page(
+			(*pde & X86_64_PDE_ADDRESS_MASK) / B_PAGE_SIZE);
+		fMapCount--;
+
+		// the paging structure caches might still know the page table
+		InvalidatePage(virtualAddress);
+	} else {
+		// Put aside a page table now, so that splitting the large page later
+		// on doesn't need to allocate memory.
+		spareTable = vm_page_allocate_page(reservation,
+			PAGE_STATE_WIRED | VM_PAGE_ALLOC_CLEAR);
+		DEBUG_PAGE_ACCESS_END(spareTable);
+	}
+
+	fSpareTables.Add(spareTable);
+
+	uint64 entry;
+	X86PagingMethod64Bit::PutLargePageEntryInDirectory(&entry, physicalAddress,
+		attributes, memoryType, fIsKernelMap);
+	X86PagingMethod64Bit::SetTableEntry(pde, entry | X86_64_PDE_SPARE_TABLE);
+
+	fMapCount += k64BitTableEntryCount;
+	atomic_add(&gMappedLargePagesCount, 1);
+
+	return B_OK;
+}
+
+
 status_t
 X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 {
@@ -277,9 +351,27 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 	TRACE("X86VMTranslationMap64Bit::Unmap(%#" B_PRIxADDR ", %#" B_PRIxADDR
 		")\n", start, end);
 
+	PageList freeTables;
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		if (uint64* pde = _LargePageEntryForAddress(start)) {
+			if (start % k64BitPageTableRange == 0
+				&& start + (k64BitPageTableRange - B_PAGE_SIZE) < end) {
+				// the range covers the whole large page
+				uint64 oldEntry = X86PagingMethod64Bit::ClearTableEntry(pde);
+				_LargePageUnmapped(oldEntry, freeTables);
+
+				if ((oldEntry & X86_64_PDE_ACCESSED) != 0)
+					InvalidatePage(start);
+
+				start += k64BitPageTableRange;
+				continue;
+			}
+
+			_SplitLargePage(pde, start);
+		}
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -312,6 +404,9 @@ X86VMTranslationMap64Bit::Unmap(addr_t start, addr_t end)
 		}
 	} while (start != 0 && start < end);
 
+	pinner.Unlock();
+	_FreePageTables(freeTables);
+
 	return B_OK;
 }
 
@@ -330,6 +425,9 @@ X86VMTranslationMap64Bit::DebugMarkRangePresent(addr_t start, addr_t end,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		if (uint64* pde = _LargePageEntryForAddress(start))
+			_SplitLargePage(pde, start);
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -380,6 +478,9 @@ X86VMTranslationMap64Bit::UnmapPage(VMArea* area, addr_t address,
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	if (uint64* pde = _LargePageEntryForAddress(address))
+		_SplitLargePage(pde, address);
+
 	// Look up the page table for the virtual address.
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
@@ -456,11 +557,43 @@ X86VMTranslationMap64Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 		B_PRIxADDR ")\n", area, start, end);
 
 	VMAreaMappings queue;
+	PageList freeTables;
 
 	RecursiveLocker locker(fLock);
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		if (uint64* pde = _LargePageEntryForAddress(start)) {
+			if (start % k64BitPageTableRange == 0
+				&& start + (k64BitPageTableRange - B_PAGE_SIZE) < end) {
+				// the range covers the whole large page
+				uint64 oldEntry = X86PagingMethod64Bit::ClearTableEntry(pde);
+				_LargePageUnmapped(oldEntry, freeTables);
+
+				if ((oldEntry & X86_64_PDE_ACCESSED) != 0
+					&& !deletingAddressSpace) {
+					InvalidatePage(start);
+				}
+
+				if (area->cache_type != CACHE_TYPE_DEVICE) {
+					page_num_t page = (oldEntry & X86_64_PDE_LARGE_ADDRESS_MASK)
+						/ B_PAGE_SIZE;
+					for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+						PageUnmapped(area, page + i,
+							(oldEntry & X86_64_PDE_ACCESSED) != 0,
+							(oldEntry & X86_64_PDE_DIRTY) != 0,
+							updatePageQueue, &queue);
+					}
+				}
+
+				Flush();
+				start += k64BitPageTableRange;
+				continue;
+			}
+
+			_SplitLargePage(pde, start);
+		}
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -506,8 +639,11 @@ X86VMTranslationMap64Bit::UnmapPages(VMArea* area, addr_t base, size_t size,
 	// area range is unmapped for good (resized/cut) and the pages will likely
 	// be freed.
 
+	pinner.Unlock();
 	locker.Unlock();
 
+	_FreePageTables(freeTables);
+
 	// free removed mappings
 	bool isKernelSpace = area->address_space == VMAddressSpace::Kernel();
 	uint32 freeFlags = CACHE_DONT_WAIT_FOR_MEMORY
@@ -538,8 +674,8 @@ X86VMTranslationMap64Bit::Query(addr_t virtualAddress,
 	uint64 entry;
 	if ((*pde & X86_64_PDE_LARGE_PAGE) != 0) {
 		entry = *pde;
-		*_physicalAddress = (entry & X86_64_PDE_ADDRESS_MASK)
-			+ (virtualAddress % 0x200000);
+		*_physicalAddress = (entry & X86_64_PDE_LARGE_ADDRESS_MASK)
+			+ (virtualAddress % k64BitPageTableRange);
 	} else {
 		uint64* virtualPageTable = (uint64*)fPageMapper->GetPageTableAt(
 			*pde & X86_64_PDE_ADDRESS_MASK);
@@ -606,6 +742,37 @@ X86VMTranslationMap64Bit::Protect(addr_t start, addr_t end, uint32 attributes,
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
 	do {
+		if (uint64* pde = _LargePageEntryForAddress(start)) {
+			if (start % k64BitPageTableRange == 0
+				&& start + (k64BitPageTableRange - B_PAGE_SIZE) < end) {
+				// the range covers the whole large page
+				uint64 entry = *pde;
+				uint64 oldEntry;
+				while (true) {
+					oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+						(entry & ~(X86_64_PTE_PROTECTION_MASK
+								| X86_64_PDE_WRITE_THROUGH
+								| X86_64_PDE_CACHING_DISABLED
+								| X86_64_PDE_PAT))
+							| newProtectionFlags
+							| X86PagingMethod64Bit
+								::MemoryTypeToLargePageEntryFlags(memoryType),
+						entry);
+					if (oldEntry == entry)
+						break;
+					entry = oldEntry;
+				}
+
+				if ((oldEntry & X86_64_PDE_ACCESSED) != 0)
+					InvalidatePage(start);
+
+				start += k64BitPageTableRange;
+				continue;
+			}
+
+			_SplitLargePage(pde, start);
+		}
+
 		uint64* pageTable = X86PagingMethod64Bit::PageTableForAddress(
 			fPagingStructures->VirtualPMLTop(), start, fIsKernelMap, false,
 			NULL, fPageMapper, fMapCount);
@@ -663,6 +830,9 @@ X86VMTranslationMap64Bit::ClearFlags(addr_t address, uint32 flags)
 
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	if (uint64* pde = _LargePageEntryForAddress(address))
+		_SplitLargePage(pde, address);
+
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
 		false, NULL, fPageMapper, fMapCount);
@@ -694,6 +864,9 @@ X86VMTranslationMap64Bit::ClearAccessedAndModified(VMArea* area, addr_t address,
 	RecursiveLocker locker(fLock);
 	ThreadCPUPinner pinner(thread_get_current_thread());
 
+	if (uint64* pde = _LargePageEntryForAddress(address))
+		_SplitLargePage(pde, address);
+
 	uint64* entry = X86PagingMethod64Bit::PageTableEntryForAddress(
 		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap,
 		false, NULL, fPageMapper, fMapCount);
@@ -807,7 +980,8 @@ X86VMTranslationMap64Bit::DebugGetReverseMappingInfo(phys_addr_t physicalAddress
 						continue;
 
 					if ((virtualPageDir[k] & X86_64_PDE_LARGE_PAGE) != 0) {
-						phys_addr_t largeAddress = virtualPageDir[k] & X86_64_PDE_ADDRESS_MASK;
+						phys_addr_t largeAddress
+							= virtualPageDir[k] & X86_64_PDE_LARGE_ADDRESS_MASK;
 						if (physicalAddress >= largeAddress
 								&& physicalAddress < (largeAddress + k64BitPageTableRange)) {
 							off_t offset = physicalAddress - largeAddress;
@@ -857,3 +1031,126 @@ X86VMTranslationMap64Bit::PagingStructures() const
 {
 	return fPagingStructures;
 }
+
+
+/*!	Returns the page directory entry for \a address, if it maps a large page,
+	\c NULL otherwise. The thread must be pinned.
+*/
+uint64*
+X86VMTranslationMap64Bit::_LargePageEntryForAddress(addr_t address)
+{
+	uint64* pde = X86PagingMethod64Bit::PageDirectoryEntryForAddress(
+		fPagingStructures->VirtualPMLTop(), address, fIsKernelMap, false,
+		NULL, fPageMapper, fMapCount);
+	if (pde == NULL
+		|| (*pde & (X86_64_PDE_PRESENT | X86_64_PDE_LARGE_PAGE))
+			!= (X86_64_PDE_PRESENT | X86_64_PDE_LARGE_PAGE)) {
+		return NULL;
+	}
+
+	return pde;
+}
+
+
+/*!	Replaces the large page mapped by \a pde with a page table that maps the
+	same physical range with the same attributes, so that the pages can be
+	unmapped or protected individually. The thread must be pinned.
+	Every large page mapped by MapLargePage() is marked with
+	\c X86_64_PDE_SPARE_TABLE and owns one of the spare page tables, so
+	splitting it cannot fail. Only the large pages of the boot-time physical
+	map come without one; the VM never unmaps or protects parts of those.
+*/
+void
+X86VMTranslationMap64Bit::_SplitLargePage(uint64* pde, addr_t address)
+{
+	RecursiveLocker locker(fLock);
+
+	TRACE("X86VMTranslationMap64Bit::_SplitLargePage(%#" B_PRIxADDR ")\n",
+		address);
+
+	vm_page* page;
+	if ((*pde & X86_64_PDE_SPARE_TABLE) != 0) {
+		page = fSpareTables.RemoveHead();
+		ASSERT(page != NULL);
+	} else {
+		vm_page_reservation reservation;
+		if (!vm_page_try_reserve_pages(&reservation, 1, VM_PRIORITY_VIP)) {
+			panic("X86VMTranslationMap64Bit: no memory to split large page at "
+				"%#" B_PRIxADDR, address);
+		}
+
+		page = vm_page_allocate_page(&reservation,
+			PAGE_STATE_WIRED | VM_PAGE_ALLOC_CLEAR);
+		vm_page_unreserve_pages(&reservation);
+		DEBUG_PAGE_ACCESS_END(page);
+	}
+
+	phys_addr_t physicalPageTable
+		= (phys_addr_t)page->physical_page_number * B_PAGE_SIZE;
+	uint64* pageTable = (uint64*)fPageMapper->GetPageTableAt(
+		physicalPageTable);
+
+	uint64 entry = *pde;
+	while (true) {
+		for (uint32 i = 0; i < k64BitTableEntryCount; i++) {
+			pageTable[i] = X86PagingMethod64Bit
+				::PageTableEntryFromLargePageEntry(
+					entry & ~X86_64_PDE_SPARE_TABLE, i);
+		}
+
+		uint64 oldEntry = X86PagingMethod64Bit::TestAndSetTableEntry(pde,
+			(physicalPageTable & X86_64_PDE_ADDRESS_MASK)
+				| X86_64_PDE_PRESENT
+				| X86_64_PDE_WRITABLE
+				| X86_64_PDE_USER,
+			entry);
+		if (oldEntry == entry)
+			break;
+
+		// the accessed or dirty flag was set in the meantime
+		entry = oldEntry;
+	}
+
+	fMapCount++;
+	atomic_add(&gMappedLargePagesCount, -1);
+	atomic_add(&gSplitLargePagesCount, 1);
+
+	// invalidating any address of the range drops the large TLB entry
+	if ((entry & X86_64_PDE_ACCESSED) != 0)
+		InvalidatePage(ROUNDDOWN(address, k64BitPageTableRange));
+}
+
+
+/*!	Does the bookkeeping after the large page \a oldEntry has been unmapped
+	completely. The spare page table set aside for it, if any, is moved to
+	\a freeTables, which the caller has to pass to _FreePageTables() once the
+	thread is no longer pinned.
+*/
+void
+X86VMTranslationMap64Bit::_LargePageUnmapped(uint64 oldEntry,
+	PageList& freeTables)
+{
+	fMapCount -= k64BitTableEntryCount;
+	atomic_add(&gMappedLargePagesCount, -1);
+
+	if ((oldEntry & X86_64_PDE_SPARE_TABLE) != 0) {
+		vm_page* page = fSpareTables.RemoveHead();
+		ASSERT(page != NULL);
+		freeTables.Add(page);
+	}
+}
+
+
+void
+X86VMTranslationMap64Bit::_FreePageTables(PageList& tables)
+{
+	if (tables.IsEmpty())
+		return;
+
+	vm_page_reservation reservation = {};
+	while (vm_page* page = tables.RemoveHead()) {
+		DEBUG_PAGE_ACCESS_START(page);
+		vm_page_free_etc(NULL, page, &reservation);
+	}
+	vm_page_unreserve_pages(&reservation);
+}
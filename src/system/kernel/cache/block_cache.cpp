@@ -27,7 +27,11 @@
 #include <vm/vm_page.h>
 
 #ifndef BUILDING_USERLAND_FS_SERVER
+#include <tracepoint.h>
+
 #include "IORequest.h"
+#else
+#define TRACEPOINT(category, event, arg0, arg1)	do { } while (false)
 #endif // !BUILDING_USERLAND_FS_SERVER
 #include "kernel_debug_config.h"
 
@@ -312,12 +316,35 @@ private:
 			void				_BlockDone(cached_block* block,
 									cache_transaction* transaction);
 			void				_UnmarkWriting(cached_block* block);
+			void				_WriteFailed(uint32 first, uint32 count,
+									status_t status);
 
 	static	int					_CompareBlocks(const void* _blockA,
 									const void* _blockB);
 
+#ifndef BUILDING_USERLAND_FS_SERVER
+			struct WriteRequest {
+				BlockWriter*	writer;
+				uint32			first;
+				uint32			count;
+				status_t		status;
+				bool			pending;
+			};
+
+			status_t			_WriteBlocksAsync(uint32 first, uint32 count);
+			WriteRequest*		_NextWriteRequest();
+			void				_WaitForWrites();
+	static	void				_WriteFinishedCallback(void* cookie,
+									io_request* request, status_t status,
+									bool partialTransfer,
+									generic_size_t bytesTransferred);
+#endif
+
 private:
 	static	const size_t		kBufferSize = 64;
+#ifndef BUILDING_USERLAND_FS_SERVER
+	static	const size_t		kMaxWritesInFlight = 8;
+#endif
 
 			block_cache*		fCache;
 			cached_block*		fBuffer[kBufferSize];
@@ -328,6 +355,12 @@ private:
 			size_t				fMax;
 			status_t			fStatus;
 			bool				fDeletedTransaction;
+#ifndef BUILDING_USERLAND_FS_SERVER
+			WriteRequest		fWriteRequests[kMaxWritesInFlight];
+			spinlock			fWriteLock;
+			ConditionVariable	fWriteCondition;
+			int32				fPendingWrites;
+#endif
 };
 
 
@@ -1144,6 +1177,17 @@ BlockWriter::BlockWriter(block_cache* cache, size_t max)
 	fStatus(B_OK),
 	fDeletedTransaction(false)
 {
+#ifndef BUILDING_USERLAND_FS_SERVER
+	for (size_t i = 0; i < kMaxWritesInFlight; i++) {
+		fWriteRequests[i].writer = this;
+		fWriteRequests[i].count = 0;
+		fWriteRequests[i].pending = false;
+	}
+
+	B_INITIALIZE_SPINLOCK(&fWriteLock);
+	fWriteCondition.Init(this, "block writer");
+	fPendingWrites = 0;
+#endif
 }
 
 
@@ -1260,22 +1304,25 @@ BlockWriter::Write(cache_transaction* transaction, bool canUnlock)
 				break;
 		}
 
+#ifndef BUILDING_USERLAND_FS_SERVER
+		// Keep several runs in flight at once; if we cannot issue the run
+		// asynchronously, fall back to writing it synchronously.
+		status_t status = _WriteBlocksAsync(i, blocks);
+		if (status == B_NO_MEMORY)
+			status = _WriteBlocks(fBlocks + i, blocks);
+#else
 		status_t status = _WriteBlocks(fBlocks + i, blocks);
-		if (status != B_OK) {
-			// propagate to global error handling
-			if (fStatus == B_OK)
-				fStatus = status;
-
-			for (uint32 j = i; j < (i + blocks); j++) {
-				_UnmarkWriting(fBlocks[j]);
-				fBlocks[j] = NULL;
-					// This block will not be marked clean
-			}
-		}
+#endif
+		if (status != B_OK)
+			_WriteFailed(i, blocks, status);
 
 		i += (blocks - 1);
 	}
 
+#ifndef BUILDING_USERLAND_FS_SERVER
+	_WaitForWrites();
+#endif
+
 	bigtime_t finish = system_time();
 
 	if (canUnlock)
@@ -1340,8 +1387,12 @@ BlockWriter::_WriteBlocks(cached_block** blocks, uint32 count)
 		vecs[i].iov_len = blockSize;
 	}
 
+	TRACEPOINT(B_TRACEPOINT_BLOCK_CACHE, B_TRACEPOINT_BLOCK_WRITE_BEGIN,
+		fCache->fd, count);
 	ssize_t written = writev_pos(fCache->fd,
 		blocks[0]->block_number * blockSize, vecs, count);
+	TRACEPOINT(B_TRACEPOINT_BLOCK_CACHE, B_TRACEPOINT_BLOCK_WRITE_END,
+		fCache->fd, written);
 
 	if (written != (ssize_t)(blockSize * count)) {
 		TB(Error(fCache, block->block_number, "write failed", written));
@@ -1357,6 +1408,169 @@ BlockWriter::_WriteBlocks(cached_block** blocks, uint32 count)
 }
 
 
+/*!	Marks the blocks of a failed write as not being written anymore. They
+	will not be marked clean, and the error is propagated to the caller of
+	Write().
+*/
+void
+BlockWriter::_WriteFailed(uint32 first, uint32 count, status_t status)
+{
+	if (fStatus == B_OK)
+		fStatus = status;
+
+	for (uint32 i = first; i < first + count; i++) {
+		_UnmarkWriting(fBlocks[i]);
+		fBlocks[i] = NULL;
+	}
+}
+
+
+#ifndef BUILDING_USERLAND_FS_SERVER
+/*!	Issues an asynchronous write of the \a count consecutive blocks starting
+	at index \a first. Returns \c B_NO_MEMORY if the request could not be
+	created; any I/O error is reported through _WaitForWrites().
+*/
+status_t
+BlockWriter::_WriteBlocksAsync(uint32 first, uint32 count)
+{
+	const size_t blockSize = fCache->block_size;
+	cached_block** blocks = fBlocks + first;
+
+	BStackOrHeapArray<generic_io_vec, 8> vecs(count);
+	if (!vecs.IsValid())
+		return B_NO_MEMORY;
+
+	for (uint32 i = 0; i < count; i++) {
+		cached_block* block = blocks[i];
+		ASSERT(block->busy_writing);
+
+		TB(Write(fCache, block));
+		TB2(BlockData(fCache, block, "before write"));
+
+		vecs[i].base = (generic_addr_t)_Data(block);
+		vecs[i].length = blockSize;
+	}
+
+	IORequest* request = IORequest::Create(false);
+	if (request == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = request->Init(blocks[0]->block_number * blockSize, vecs,
+		count, count * blockSize, true, B_DELETE_IO_REQUEST);
+	if (status != B_OK) {
+		delete request;
+		return B_NO_MEMORY;
+	}
+
+	WriteRequest* writeRequest = _NextWriteRequest();
+	writeRequest->first = first;
+	writeRequest->count = count;
+	writeRequest->status = B_OK;
+
+	TRACEPOINT(B_TRACEPOINT_BLOCK_CACHE, B_TRACEPOINT_BLOCK_WRITE_BEGIN,
+		fCache->fd, count);
+
+	request->SetFinishedCallback(&_WriteFinishedCallback, writeRequest);
+
+	// the callback will be called in any case
+	do_fd_io(fCache->fd, request);
+	return B_OK;
+}
+
+
+/*!	Returns an unused write request, and waits for one to finish if
+	necessary. The failure of a previous request is propagated first.
+*/
+BlockWriter::WriteRequest*
+BlockWriter::_NextWriteRequest()
+{
+	InterruptsSpinLocker locker(fWriteLock);
+
+	while (true) {
+		for (size_t i = 0; i < kMaxWritesInFlight; i++) {
+			WriteRequest* writeRequest = &fWriteRequests[i];
+			if (writeRequest->pending)
+				continue;
+
+			writeRequest->pending = true;
+			fPendingWrites++;
+			locker.Unlock();
+
+			if (writeRequest->count != 0 && writeRequest->status != B_OK) {
+				_WriteFailed(writeRequest->first, writeRequest->count,
+					writeRequest->status);
+			}
+			writeRequest->count = 0;
+			return writeRequest;
+		}
+
+		ConditionVariableEntry entry;
+		fWriteCondition.Add(&entry);
+		locker.Unlock();
+
+		entry.Wait();
+		locker.Lock();
+	}
+}
+
+
+/*!	Waits until all asynchronous writes have finished, and propagates their
+	failures.
+*/
+void
+BlockWriter::_WaitForWrites()
+{
+	InterruptsSpinLocker locker(fWriteLock);
+
+	while (fPendingWrites > 0) {
+		ConditionVariableEntry entry;
+		fWriteCondition.Add(&entry);
+		locker.Unlock();
+
+		entry.Wait();
+		locker.Lock();
+	}
+
+	locker.Unlock();
+
+	for (size_t i = 0; i < kMaxWritesInFlight; i++) {
+		WriteRequest& writeRequest = fWriteRequests[i];
+		if (writeRequest.count != 0 && writeRequest.status != B_OK)
+			_WriteFailed(writeRequest.first, writeRequest.count,
+				writeRequest.status);
+		writeRequest.count = 0;
+	}
+}
+
+
+/*static*/ void
+BlockWriter::_WriteFinishedCallback(void* cookie, io_request* request,
+	status_t status, bool partialTransfer, generic_size_t bytesTransferred)
+{
+	WriteRequest* writeRequest = (WriteRequest*)cookie;
+	BlockWriter* writer = writeRequest->writer;
+
+	if (status == B_OK && partialTransfer)
+		status = B_IO_ERROR;
+	TRACEPOINT(B_TRACEPOINT_BLOCK_CACHE, B_TRACEPOINT_BLOCK_WRITE_END,
+		writer->fCache->fd, status);
+	if (status != B_OK) {
+		TRACE_ALWAYS("could not write back %" B_PRIu32 " blocks (start block %"
+			B_PRIdOFF "): %s\n", writeRequest->count,
+			writer->fBlocks[writeRequest->first]->block_number,
+			strerror(status));
+	}
+
+	// The writer might be gone as soon as we release the lock.
+	InterruptsSpinLocker locker(writer->fWriteLock);
+	writeRequest->status = status;
+	writeRequest->pending = false;
+	writer->fPendingWrites--;
+	writer->fWriteCondition.NotifyAll();
+}
+#endif // !BUILDING_USERLAND_FS_SERVER
+
+
 void
 BlockWriter::_BlockDone(cached_block* block,
 	cache_transaction* transaction)
@@ -2183,8 +2397,12 @@ retry:
 		mark_block_busy_reading(cache, block);
 		mutex_unlock(&cache->lock);
 
+		TRACEPOINT(B_TRACEPOINT_BLOCK_CACHE, B_TRACEPOINT_BLOCK_READ_BEGIN,
+			cache->fd, blockNumber);
 		ssize_t bytesRead = read_pos(cache->fd, blockNumber * blockSize,
 			block->current_data, blockSize);
+		TRACEPOINT(B_TRACEPOINT_BLOCK_CACHE, B_TRACEPOINT_BLOCK_READ_END,
+			cache->fd, bytesRead);
 
 		mutex_lock(&cache->lock);
 		if (bytesRead < blockSize) {
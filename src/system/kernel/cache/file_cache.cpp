@@ -42,6 +42,11 @@
 #define BYPASS_IO_SIZE		65536
 #define LAST_ACCESSES		3
 
+// read-ahead window limits
+#define MIN_READ_AHEAD		(128 * 1024)
+#define MAX_READ_AHEAD		(4 * 1024 * 1024)
+#define MAX_STRIDED_READ_AHEAD	8	// accesses
+
 struct file_cache_ref {
 	VMCache			*cache;
 	struct vnode	*vnode;
@@ -52,6 +57,13 @@ struct file_cache_ref {
 	int32			last_access_index;
 	uint16			disabled_count;
 
+	// read-ahead state; only a hint, therefore not locked
+	off_t			last_read;
+	off_t			next_read;
+	off_t			read_stride;
+	off_t			read_ahead_end;
+	size_t			read_ahead_size;
+
 	inline void SetLastAccess(int32 index, off_t access, bool isWrite)
 	{
 		// we remember writes as negative offsets
@@ -113,6 +125,8 @@ static const size_t kZeroVecSize = kZeroVecCount * B_PAGE_SIZE;
 static phys_addr_t sZeroPage;
 static generic_io_vec sZeroVecs[kZeroVecCount];
 
+static size_t sMaxReadAhead = MAX_READ_AHEAD;
+
 
 //	#pragma mark -
 
@@ -1002,48 +1016,33 @@ file_cache_control(const char* subsystem, uint32 function, void* buffer,
 }
 
 
-//	#pragma mark - private kernel API
-
-
-extern "C" void
-cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
+/*!	Starts asynchronous reads for all pages in the given range that are not
+	in the cache yet. If \a mayWait is \c false, it will not wait for pages
+	to become available, but just give up.
+*/
+static void
+prefetch_range(file_cache_ref* ref, off_t offset, size_t size, bool mayWait)
 {
-	if (size == 0)
-		return;
-
-	VMCache* cache;
-	if (vfs_get_vnode_cache(vnode, &cache, false) != B_OK)
-		return;
-	if (cache->type != CACHE_TYPE_VNODE) {
-		cache->ReleaseRef();
-		return;
-	}
-
-	file_cache_ref* ref = ((VMVnodeCache*)cache)->FileCacheRef();
-	off_t fileSize = cache->virtual_end;
-
-	if ((off_t)(offset + size) > fileSize)
-		size = fileSize - offset;
+	VMCache* cache = ref->cache;
 
 	// "offset" and "size" are always aligned to B_PAGE_SIZE,
 	offset = ROUNDDOWN(offset, B_PAGE_SIZE);
 	size = ROUNDUP(size, B_PAGE_SIZE);
 
 	const size_t pagesCount = size / B_PAGE_SIZE;
-
-	// Don't do anything if we don't have the resources left, or the cache
-	// already contains more than 2/3 of its pages
-	if (offset >= fileSize || vm_page_num_unused_pages() < 2 * pagesCount
-		|| (3 * cache->page_count) > (2 * fileSize / B_PAGE_SIZE)) {
-		cache->ReleaseRef();
+	if (pagesCount == 0)
 		return;
-	}
 
 	size_t bytesToRead = 0;
 	off_t lastOffset = offset;
 
 	vm_page_reservation reservation;
-	vm_page_reserve_pages(&reservation, pagesCount, VM_PRIORITY_USER);
+	if (mayWait)
+		vm_page_reserve_pages(&reservation, pagesCount, VM_PRIORITY_USER);
+	else if (!vm_page_try_reserve_pages(&reservation, pagesCount,
+			VM_PRIORITY_USER)) {
+		return;
+	}
 
 	cache->Lock();
 
@@ -1087,11 +1086,144 @@ cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
 		lastOffset = offset;
 	}
 
-	cache->ReleaseRefAndUnlock();
+	cache->Unlock();
 	vm_page_unreserve_pages(&reservation);
 }
 
 
+/*!	Tracks the read accesses to the file, and if they are sequential or
+	strided, asynchronously reads ahead of them. The read-ahead window of
+	sequential readers grows with every read, up to sMaxReadAhead, which
+	shrinks under memory pressure (see read_ahead_low_resource_handler()).
+*/
+static void
+read_ahead(file_cache_ref* ref, off_t offset, size_t size)
+{
+	const off_t end = offset + size;
+	const off_t stride = offset - ref->last_read;
+
+	bool sequential = offset == ref->next_read;
+	bool strided = !sequential && stride > (off_t)size
+		&& stride == ref->read_stride;
+
+	ref->last_read = offset;
+	ref->next_read = end;
+	ref->read_stride = stride;
+
+	size_t maxReadAhead = sMaxReadAhead;
+	if (maxReadAhead < MAX_READ_AHEAD
+		&& low_resource_state(B_KERNEL_RESOURCE_PAGES) == B_NO_LOW_RESOURCE) {
+		// the pressure is gone, let the window grow back
+		maxReadAhead = min_c(MAX_READ_AHEAD,
+			max_c(2 * maxReadAhead, MIN_READ_AHEAD));
+		sMaxReadAhead = maxReadAhead;
+	}
+
+	if ((!sequential && !strided) || maxReadAhead == 0) {
+		ref->read_ahead_size = 0;
+		ref->read_ahead_end = 0;
+		return;
+	}
+
+	const off_t fileSize = ref->cache->virtual_end;
+
+	if (strided) {
+		// read the next few accesses in advance
+		ref->read_ahead_size = 0;
+
+		uint32 count = min_c(MAX_STRIDED_READ_AHEAD, maxReadAhead / size);
+		for (uint32 i = 1; i <= count; i++) {
+			off_t next = offset + i * stride;
+			if (next >= fileSize)
+				break;
+			if (next < ref->read_ahead_end)
+				continue;
+
+			prefetch_range(ref, next, min_c((off_t)size, fileSize - next),
+				false);
+			ref->read_ahead_end = next + size;
+		}
+		return;
+	}
+
+	size_t window = ref->read_ahead_size == 0
+		? MIN_READ_AHEAD : 2 * ref->read_ahead_size;
+	window = min_c(window, maxReadAhead);
+	ref->read_ahead_size = window;
+
+	// Only issue new reads when less than half of the window is left, so
+	// that we read in large chunks, but never run dry.
+	off_t start = max_c(end, ref->read_ahead_end);
+	if (start - end > (off_t)window / 2)
+		return;
+
+	off_t aheadEnd = min_c(end + (off_t)window, fileSize);
+	if (aheadEnd <= start)
+		return;
+
+	ref->read_ahead_end = aheadEnd;
+	prefetch_range(ref, start, aheadEnd - start, false);
+}
+
+
+static void
+read_ahead_low_resource_handler(void* /*data*/, uint32 resources, int32 level)
+{
+	switch (level) {
+		case B_NO_LOW_RESOURCE:
+			sMaxReadAhead = MAX_READ_AHEAD;
+			break;
+		case B_LOW_RESOURCE_NOTE:
+			sMaxReadAhead = MAX_READ_AHEAD / 4;
+			break;
+		case B_LOW_RESOURCE_WARNING:
+			sMaxReadAhead = MIN_READ_AHEAD;
+			break;
+		case B_LOW_RESOURCE_CRITICAL:
+			sMaxReadAhead = 0;
+			break;
+	}
+}
+
+
+//	#pragma mark - private kernel API
+
+
+extern "C" void
+cache_prefetch_vnode(struct vnode* vnode, off_t offset, size_t size)
+{
+	if (size == 0)
+		return;
+
+	VMCache* cache;
+	if (vfs_get_vnode_cache(vnode, &cache, false) != B_OK)
+		return;
+	if (cache->type != CACHE_TYPE_VNODE) {
+		cache->ReleaseRef();
+		return;
+	}
+
+	file_cache_ref* ref = ((VMVnodeCache*)cache)->FileCacheRef();
+	off_t fileSize = cache->virtual_end;
+
+	if ((off_t)(offset + size) > fileSize)
+		size = fileSize - offset;
+
+	const size_t pagesCount = ROUNDUP(size, B_PAGE_SIZE) / B_PAGE_SIZE;
+
+	// Don't do anything if we don't have the resources left, or the cache
+	// already contains more than 2/3 of its pages
+	if (offset >= fileSize || vm_page_num_unused_pages() < 2 * pagesCount
+		|| (3 * cache->page_count) > (2 * fileSize / B_PAGE_SIZE)) {
+		cache->ReleaseRef();
+		return;
+	}
+
+	prefetch_range(ref, offset, size, true);
+	cache->ReleaseRef();
+}
+
+
 extern "C" void
 cache_prefetch(dev_t mountID, ino_t vnodeID, off_t offset, size_t size)
 {
@@ -1185,6 +1317,8 @@ file_cache_init(void)
 	}
 
 	register_generic_syscall(CACHE_SYSCALLS, file_cache_control, 1, 0);
+	register_low_resource_handler(&read_ahead_low_resource_handler, NULL,
+		B_KERNEL_RESOURCE_PAGES, 0);
 	return B_OK;
 }
 
@@ -1205,6 +1339,11 @@ file_cache_create(dev_t mountID, ino_t vnodeID, off_t size)
 	memset(ref->last_access, 0, sizeof(ref->last_access));
 	ref->last_access_index = 0;
 	ref->disabled_count = 0;
+	ref->last_read = 0;
+	ref->next_read = 0;
+	ref->read_stride = 0;
+	ref->read_ahead_end = 0;
+	ref->read_ahead_size = 0;
 
 	// TODO: delay VMCache creation until data is
 	//	requested/written for the first time? Listing lots of
@@ -1368,7 +1507,12 @@ file_cache_read(void* _cacheRef, void* cookie, off_t offset, void* buffer,
 		return error;
 	}
 
-	return cache_io(ref, cookie, offset, (addr_t)buffer, _size, false);
+	status_t status = cache_io(ref, cookie, offset, (addr_t)buffer, _size,
+		false);
+	if (status == B_OK && *_size > 0)
+		read_ahead(ref, offset, *_size);
+
+	return status;
 }
 
 
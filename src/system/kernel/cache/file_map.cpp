@@ -32,6 +32,8 @@ using namespace FSShell;
 #	include "kernel_debug_config.h"
 #endif
 
+#include <util/AVLTree.h>
+
 
 //#define TRACE_FILE_MAP
 #ifdef TRACE_FILE_MAP
@@ -40,26 +42,61 @@ using namespace FSShell;
 #	define TRACE(x...) ;
 #endif
 
-// TODO: use a sparse array - eventually, the unused BlockMap would be something
-//	to reuse for this. We could also have an upperbound of memory consumption
-//	for the whole map.
 // TODO: it would be nice if we could free a file map in low memory situations.
+//	We could also have an upperbound of memory consumption for the whole map.
 
 
-#define CACHED_FILE_EXTENTS	2
-	// must be smaller than MAX_FILE_IO_VECS
-	// TODO: find out how much of these are typically used
+#define MAX_FILE_MAP_VECS	8
+	// number of extents retrieved from the file system at once
+#define MAX_FILE_OFFSET		((off_t)(~(uint64)0 >> 1))
 
-struct file_extent {
+struct file_extent : AVLTreeNode {
 	off_t			offset;
 	file_io_vec		disk;
+
+	off_t End() const
+	{
+		return offset + disk.length;
+	}
 };
 
-struct file_extent_array {
-	file_extent*	array;
-	size_t			max_count;
+struct FileExtentTreeDefinition {
+	typedef off_t					Key;
+	typedef file_extent				Value;
+
+	AVLTreeNode* GetAVLTreeNode(Value* value) const
+	{
+		return value;
+	}
+
+	Value* GetValue(AVLTreeNode* node) const
+	{
+		return static_cast<Value*>(node);
+	}
+
+	int Compare(off_t a, const Value* _b) const
+	{
+		off_t b = _b->offset;
+		if (a == b)
+			return 0;
+		return a < b ? -1 : 1;
+	}
+
+	int Compare(const Value* a, const Value* b) const
+	{
+		return Compare(a->offset, b);
+	}
 };
 
+typedef AVLTree<FileExtentTreeDefinition> FileExtentTree;
+
+/*!	The file map caches the extents of a file in a tree that is indexed by
+	their file offset. It does not need to be complete: only the parts of the
+	file that are actually accessed are retrieved from the file system, so
+	that the costs of a lookup only grow logarithmically with the number of
+	extents, and do not depend on how much of a fragmented file has been
+	mapped before.
+*/
 class FileMap
 #if DEBUG_FILE_MAP
 	: public DoublyLinkedListLinkImpl<FileMap>
@@ -76,32 +113,36 @@ public:
 								file_io_vec* vecs, size_t* _count,
 								size_t align);
 
-			file_extent*	ExtentAt(uint32 index);
+			file_extent*	FirstExtent() const
+								{ return fExtents.LeftMost(); }
+			file_extent*	NextExtent(file_extent* extent) const
+								{ return fExtents.Next(extent); }
 
-			size_t			Count() const { return fCount; }
+			size_t			Count() const { return fExtents.Count(); }
 			struct vnode*	Vnode() const { return fVnode; }
 			off_t			Size() const { return fSize; }
 
 			status_t		SetMode(uint32 mode);
 
 private:
-			file_extent*	_FindExtent(off_t offset, uint32* _index);
-			status_t		_MakeSpace(size_t count);
-			status_t		_Add(file_io_vec* vecs, size_t vecCount,
-								off_t& lastOffset);
+			file_extent*	_FindExtent(off_t offset) const;
+			status_t		_Add(off_t offset, const file_io_vec& vec);
+			status_t		_Retrieve(off_t& offset, off_t limit);
 			status_t		_Cache(off_t offset, off_t size);
-			void			_InvalidateAfter(off_t offset);
+			status_t		_Translate(off_t offset, size_t size,
+								size_t padLastVec, file_io_vec* vecs,
+								size_t* _count) const;
+			void			_InvalidateRange(off_t start, off_t end);
 			void			_Free();
 
-	union {
-		file_extent	fDirect[CACHED_FILE_EXTENTS];
-		file_extent_array fIndirect;
-	};
-	mutex			fLock;
-	size_t			fCount;
-	struct vnode*	fVnode;
-	off_t			fSize;
-	bool			fCacheAll;
+	static	bool			_IsContiguous(const file_extent* extent,
+								const file_io_vec& vec);
+
+			FileExtentTree	fExtents;
+			mutex			fLock;
+			struct vnode*	fVnode;
+			off_t			fSize;
+			bool			fCacheAll;
 };
 
 #if DEBUG_FILE_MAP
@@ -114,7 +155,6 @@ static mutex sLock;
 
 FileMap::FileMap(struct vnode* vnode, off_t size)
 	:
-	fCount(0),
 	fVnode(vnode),
 	fSize(size),
 	fCacheAll(false)
@@ -140,169 +180,180 @@ FileMap::~FileMap()
 }
 
 
+/*!	Returns the cached extent that contains \a offset, or \c NULL if that part
+	of the file has not been mapped yet.
+*/
 file_extent*
-FileMap::ExtentAt(uint32 index)
+FileMap::_FindExtent(off_t offset) const
 {
-	if (index >= fCount)
+	file_extent* extent = fExtents.FindClosest(offset, true);
+	if (extent == NULL || extent->End() <= offset)
 		return NULL;
 
-	if (fCount > CACHED_FILE_EXTENTS)
-		return &fIndirect.array[index];
-
-	return &fDirect[index];
+	return extent;
 }
 
 
-file_extent*
-FileMap::_FindExtent(off_t offset, uint32 *_index)
+/*static*/ bool
+FileMap::_IsContiguous(const file_extent* extent, const file_io_vec& vec)
 {
-	int32 left = 0;
-	int32 right = fCount - 1;
-
-	while (left <= right) {
-		int32 index = (left + right) / 2;
-		file_extent* extent = ExtentAt(index);
-
-		if (extent->offset > offset) {
-			// search in left part
-			right = index - 1;
-		} else if (extent->offset + extent->disk.length <= offset) {
-			// search in right part
-			left = index + 1;
-		} else {
-			// found extent
-			if (_index)
-				*_index = index;
+	if (extent->disk.offset == -1 || vec.offset == -1)
+		return extent->disk.offset == vec.offset;
 
-			return extent;
-		}
-	}
-
-	return NULL;
+	return extent->disk.offset + extent->disk.length == vec.offset;
 }
 
 
+/*!	Adds the extent \a vec that starts at file \a offset to the map. The range
+	must not be mapped yet. If possible, the extent is merged with its
+	neighbours.
+*/
 status_t
-FileMap::_MakeSpace(size_t count)
+FileMap::_Add(off_t offset, const file_io_vec& vec)
 {
-	if (count <= CACHED_FILE_EXTENTS) {
-		// just use the reserved area in the file_cache_ref structure
-		if (fCount > CACHED_FILE_EXTENTS) {
-			// the new size is smaller than the minimal array size
-			file_extent *array = fIndirect.array;
-			memcpy(fDirect, array, sizeof(file_extent) * count);
-			free(array);
-		}
-	} else {
-		// resize array if needed
-		file_extent* oldArray = NULL;
-		size_t maxCount = CACHED_FILE_EXTENTS;
-		if (fCount > CACHED_FILE_EXTENTS) {
-			oldArray = fIndirect.array;
-			maxCount = fIndirect.max_count;
-		}
+	TRACE("FileMap@%p::_Add(offset %lld, disk offset %lld, length %lld)\n",
+		this, offset, vec.offset, vec.length);
 
-		if (count > maxCount) {
-			// allocate new array
-			while (maxCount < count) {
-				if (maxCount < 32768)
-					maxCount <<= 1;
-				else
-					maxCount += 32768;
-			}
-
-			file_extent* newArray = (file_extent *)realloc(oldArray,
-				maxCount * sizeof(file_extent));
-			if (newArray == NULL)
-				return B_NO_MEMORY;
+	file_extent* extent = fExtents.FindClosest(offset, true);
+	if (extent != NULL && extent->End() == offset
+		&& _IsContiguous(extent, vec)) {
+		extent->disk.length += vec.length;
+	} else {
+		extent = new(std::nothrow) file_extent;
+		if (extent == NULL)
+			return B_NO_MEMORY;
 
-			if (fCount > 0 && fCount <= CACHED_FILE_EXTENTS)
-				memcpy(newArray, fDirect, sizeof(file_extent) * fCount);
+		extent->offset = offset;
+		extent->disk = vec;
 
-			fIndirect.array = newArray;
-			fIndirect.max_count = maxCount;
+		status_t status = fExtents.Insert(extent);
+		if (status != B_OK) {
+			delete extent;
+			return status;
 		}
 	}
 
-	fCount = count;
+	file_extent* next = fExtents.Next(extent);
+	if (next != NULL && extent->End() == next->offset
+		&& _IsContiguous(extent, next->disk)) {
+		extent->disk.length += next->disk.length;
+		fExtents.Remove(next);
+		delete next;
+	}
+
 	return B_OK;
 }
 
 
+/*!	Retrieves the extents starting at \a offset from the file system, and adds
+	them to the map. Extents are clipped at \a limit, which is the start of
+	the next extent that is already mapped, or -1 if there is none.
+	On success, \a offset is set to the end of the mapped range.
+*/
 status_t
-FileMap::_Add(file_io_vec* vecs, size_t vecCount, off_t& lastOffset)
+FileMap::_Retrieve(off_t& offset, off_t limit)
 {
-	TRACE("FileMap@%p::Add(vecCount = %ld)\n", this, vecCount);
+	file_io_vec vecs[MAX_FILE_MAP_VECS];
+	size_t vecCount = MAX_FILE_MAP_VECS;
 
-	uint32 start = fCount;
-	off_t offset = 0;
-
-	status_t status = _MakeSpace(fCount + vecCount);
-	if (status != B_OK)
+	status_t status = vfs_get_file_map(Vnode(), offset, ~0UL, vecs,
+		&vecCount);
+	if (status != B_OK && status != B_BUFFER_OVERFLOW)
 		return status;
 
-	file_extent* lastExtent = NULL;
-	if (start != 0) {
-		lastExtent = ExtentAt(start - 1);
-		offset = lastExtent->offset + lastExtent->disk.length;
+	off_t start = offset;
+
+	for (size_t i = 0; i < vecCount; i++) {
+		file_io_vec vec = vecs[i];
+		if (limit >= 0 && offset + vec.length > limit)
+			vec.length = limit - offset;
+		if (vec.length <= 0)
+			break;
+
+		status = _Add(offset, vec);
+		if (status != B_OK)
+			return status;
+
+		offset += vec.length;
 	}
 
-	for (uint32 i = 0; i < vecCount; i++) {
-		if (lastExtent != NULL) {
-			if (lastExtent->disk.offset + lastExtent->disk.length
-					== vecs[i].offset
-				|| (lastExtent->disk.offset == -1 && vecs[i].offset == -1)) {
+	// the file system must at least map the requested offset
+	return offset > start ? B_OK : B_ERROR;
+}
 
-				lastExtent->disk.length += vecs[i].length;
-				offset += vecs[i].length;
 
-				_MakeSpace(fCount - 1);
-				if (fCount == CACHED_FILE_EXTENTS) {
-					// We moved the indirect array into the direct one, making
-					// lastExtent a stale pointer, re-get it.
-					lastExtent = ExtentAt(start - 1);
-				}
+/*!	Makes sure that the extents of the given range of the file are in the map.
+	Only the missing parts are retrieved from the file system.
+*/
+status_t
+FileMap::_Cache(off_t offset, off_t size)
+{
+	off_t end = offset + size;
 
-				continue;
-			}
+	file_extent* extent = fExtents.FindClosest(offset, true);
+	if (extent == NULL)
+		extent = fExtents.LeftMost();
+	else if (extent->End() <= offset)
+		extent = fExtents.Next(extent);
+
+	while (offset < end) {
+		if (extent != NULL && extent->offset <= offset) {
+			// this part is mapped already
+			offset = extent->End();
+			extent = fExtents.Next(extent);
+			continue;
 		}
 
-		file_extent* extent = ExtentAt(start++);
-		extent->offset = offset;
-		extent->disk = vecs[i];
+		if (fCacheAll)
+			return B_ERROR;
 
-		offset += extent->disk.length;
-		lastExtent = extent;
-	}
+		// We don't have the requested extents yet, retrieve them
+		status_t status = _Retrieve(offset,
+			extent != NULL ? extent->offset : -1);
+		if (status != B_OK)
+			return status;
 
-#ifdef TRACE_FILE_MAP
-	for (uint32 i = 0; i < fCount; i++) {
-		file_extent* extent = ExtentAt(i);
-		TRACE("[%ld] extent offset %lld, disk offset %lld, length %lld\n",
-			i, extent->offset, extent->disk.offset, extent->disk.length);
+		// merging may have removed the next extent
+		extent = fExtents.FindClosest(offset, true);
+		if (extent != NULL && extent->End() <= offset)
+			extent = fExtents.Next(extent);
 	}
-#endif
 
-	lastOffset = offset;
 	return B_OK;
 }
 
 
+/*!	Removes the range from \a start to \a end from the map. Extents that
+	start before the range are shortened instead; anything they mapped behind
+	the range is retrieved again on demand.
+*/
 void
-FileMap::_InvalidateAfter(off_t offset)
+FileMap::_InvalidateRange(off_t start, off_t end)
 {
-	uint32 index;
-	file_extent* extent = _FindExtent(offset, &index);
-	if (extent != NULL) {
-		uint32 resizeTo = index + 1;
-
-		if (extent->offset + extent->disk.length > offset) {
-			extent->disk.length = offset - extent->offset;
-			if (extent->disk.length == 0)
-				resizeTo = index;
+	file_extent* extent = fExtents.FindClosest(start, true);
+	if (extent == NULL)
+		extent = fExtents.LeftMost();
+
+	while (extent != NULL && extent->offset < end) {
+		file_extent* next = fExtents.Next(extent);
+
+		if (extent->offset < start) {
+			if (extent->End() > start)
+				extent->disk.length = start - extent->offset;
+		} else if (extent->End() > end) {
+			// Cut off the front; this does not change the extent's position
+			// in the tree, as it cannot overlap with its successor.
+			off_t length = end - extent->offset;
+			extent->offset = end;
+			if (extent->disk.offset != -1)
+				extent->disk.offset += length;
+			extent->disk.length -= length;
+		} else {
+			fExtents.Remove(extent);
+			delete extent;
 		}
 
-		_MakeSpace(resizeTo);
+		extent = next;
 	}
 }
 
@@ -314,13 +365,16 @@ FileMap::Invalidate(off_t offset, off_t size)
 {
 	MutexLocker _(fLock);
 
-	// TODO: honour size, we currently always remove everything after "offset"
-	if (offset == 0) {
+	if (offset <= 0 && size >= fSize) {
 		_Free();
 		return;
 	}
 
-	_InvalidateAfter(offset);
+	off_t end = offset + size;
+	if (size < 0 || end < offset)
+		end = MAX_FILE_OFFSET;
+
+	_InvalidateRange(offset, end);
 }
 
 
@@ -330,7 +384,7 @@ FileMap::SetSize(off_t size)
 	MutexLocker _(fLock);
 
 	if (size < fSize)
-		_InvalidateAfter(size);
+		_InvalidateRange(size, MAX_FILE_OFFSET);
 
 	fSize = size;
 }
@@ -339,42 +393,10 @@ FileMap::SetSize(off_t size)
 void
 FileMap::_Free()
 {
-	if (fCount > CACHED_FILE_EXTENTS)
-		free(fIndirect.array);
-
-	fCount = 0;
-}
-
-
-status_t
-FileMap::_Cache(off_t offset, off_t size)
-{
-	file_extent* lastExtent = NULL;
-	if (fCount > 0)
-		lastExtent = ExtentAt(fCount - 1);
-
-	off_t mapEnd = 0;
-	if (lastExtent != NULL)
-		mapEnd = lastExtent->offset + lastExtent->disk.length;
-
-	off_t end = offset + size;
-
-	if (fCacheAll && mapEnd < end)
-		return B_ERROR;
-
-	status_t status = B_OK;
-	file_io_vec vecs[8];
-	const size_t kMaxVecs = 8;
-
-	while (status == B_OK && mapEnd < end) {
-		// We don't have the requested extents yet, retrieve them
-		size_t vecCount = kMaxVecs;
-		status = vfs_get_file_map(Vnode(), mapEnd, ~0UL, vecs, &vecCount);
-		if (status == B_OK || status == B_BUFFER_OVERFLOW)
-			status = _Add(vecs, vecCount, mapEnd);
+	while (file_extent* extent = fExtents.LeftMost()) {
+		fExtents.Remove(extent);
+		delete extent;
 	}
-
-	return status;
 }
 
 
@@ -412,7 +434,6 @@ FileMap::Translate(off_t offset, size_t size, file_io_vec* vecs, size_t* _count,
 
 	MutexLocker _(fLock);
 
-	size_t maxVecs = *_count;
 	size_t padLastVec = 0;
 
 	if (offset >= Size()) {
@@ -428,18 +449,35 @@ FileMap::Translate(off_t offset, size_t size, file_io_vec* vecs, size_t* _count,
 		size = fSize - offset;
 	}
 
-	// First, we need to make sure that we have already cached all file
-	// extents needed for this request.
+	// Most requests can be served from the extents we already have; only if
+	// we run into a part of the file that is not mapped yet, we need to
+	// retrieve the missing extents and try again.
 
-	status_t status = _Cache(offset, size);
+	status_t status = _Translate(offset, size, padLastVec, vecs, _count);
+	if (status != B_ENTRY_NOT_FOUND)
+		return status;
+
+	status = _Cache(offset, size);
 	if (status != B_OK)
 		return status;
 
-	// We now have cached the map of this file as far as we need it, now
-	// we need to translate it for the requested access.
+	return _Translate(offset, size, padLastVec, vecs, _count);
+}
+
+
+/*!	Translates the file range to disk vecs using the cached extents only.
+	Returns \c B_ENTRY_NOT_FOUND if part of the range has not been mapped yet,
+	in which case  _count is left untouched.
+*/
+status_t
+FileMap::_Translate(off_t offset, size_t size, size_t padLastVec,
+	file_io_vec* vecs, size_t* _count) const
+{
+	size_t maxVecs = *_count;
 
-	uint32 index;
-	file_extent* fileExtent = _FindExtent(offset, &index);
+	file_extent* fileExtent = _FindExtent(offset);
+	if (fileExtent == NULL)
+		return B_ENTRY_NOT_FOUND;
 
 	offset -= fileExtent->offset;
 	if (fileExtent->disk.offset != -1)
@@ -460,8 +498,11 @@ FileMap::Translate(off_t offset, size_t size, file_io_vec* vecs, size_t* _count,
 	uint32 vecIndex = 1;
 
 	while (true) {
-		fileExtent++;
+		file_extent* next = fExtents.Next(fileExtent);
+		if (next == NULL || next->offset != fileExtent->End())
+			return B_ENTRY_NOT_FOUND;
 
+		fileExtent = next;
 		vecs[vecIndex++] = fileExtent->disk;
 
 		if ((off_t)size <= fileExtent->disk.length) {
@@ -512,9 +553,9 @@ dump_file_map(int argc, char** argv)
 	if (!printExtents)
 		return 0;
 
-	for (uint32 i = 0; i < map->Count(); i++) {
-		file_extent* extent = map->ExtentAt(i);
-
+	uint32 i = 0;
+	for (file_extent* extent = map->FirstExtent(); extent != NULL;
+			extent = map->NextExtent(extent), i++) {
 		kprintf("  [%" B_PRIu32 "] offset %" B_PRIdOFF ", disk offset %"
 			B_PRIdOFF ", length %" B_PRIdOFF "\n", i, extent->offset,
 			extent->disk.offset, extent->disk.length);
@@ -551,9 +592,10 @@ dump_file_map_stats(int argc, char** argv)
 			continue;
 
 		if (map->Count() != 0) {
-			file_extent* extent = map->ExtentAt(map->Count() - 1);
-			if (extent != NULL)
-				mapSize += extent->offset + extent->disk.length;
+			for (file_extent* extent = map->FirstExtent(); extent != NULL;
+					extent = map->NextExtent(extent)) {
+				mapSize += extent->disk.length;
+			}
 
 			extents += map->Count();
 		} else
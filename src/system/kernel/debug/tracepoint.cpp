@@ -0,0 +1,284 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <tracepoint.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+#include <arch/debug.h>
+#include <kernel.h>
+#include <lock.h>
+#include <Notifications.h>
+#include <smp.h>
+#include <team.h>
+#include <thread.h>
+#include <timer.h>
+#include <user_debugger.h>
+#include <util/atomic.h>
+#include <util/AutoLock.h>
+
+
+class TeamListener : public NotificationListener {
+public:
+	virtual	void				EventOccurred(NotificationService& service,
+									const KMessage* event);
+};
+
+
+uint32 gTracepointCategories = 0;
+
+static mutex sTracepointLock = MUTEX_INITIALIZER("tracepoints");
+static tracepoint_buffer_header* sHeader;
+static area_id sKernelArea = -1;
+static size_t sAreaSize;
+static team_id sTeam = -1;
+static bigtime_t sSampleInterval;
+static timer sSampleTimers[SMP_MAX_CPUS];
+
+// The layout of the rings, and their heads. Userland can write to the
+// buffer, so the kernel must never read them back from there.
+static uint32 sRingSize;
+static uint32 sRingMask;
+static uint64 sRingHeads[SMP_MAX_CPUS];
+
+static TeamListener sTeamListener;
+static int32 sTeamListenerAdded;
+
+
+static int32
+sample_event(timer* /* timer */)
+{
+	bool isSyscall;
+	void* pc = arch_debug_get_interrupt_pc(&isSyscall);
+	TRACEPOINT(B_TRACEPOINT_SAMPLING, B_TRACEPOINT_SAMPLE, pc,
+		IS_KERNEL_ADDRESS(pc));
+
+	return B_HANDLED_INTERRUPT;
+}
+
+
+static void
+start_sample_timer(void* /* cookie */, int cpu)
+{
+	add_timer(&sSampleTimers[cpu], &sample_event, sSampleInterval,
+		B_PERIODIC_TIMER);
+}
+
+
+static void
+stop_sample_timer(void* /* cookie */, int cpu)
+{
+	cancel_timer(&sSampleTimers[cpu]);
+}
+
+
+static void
+wait_for_writers(void* /* cookie */, int /* cpu */)
+{
+	// Nothing to do: once every CPU has run this, none of them can still be
+	// writing to the buffer.
+}
+
+
+static tracepoint_ring*
+get_ring(tracepoint_buffer_header* header, int32 cpu)
+{
+	return (tracepoint_ring*)((uint8*)header + B_TRACEPOINT_HEADER_SIZE
+		+ cpu * sRingSize);
+}
+
+
+/*!	Stops recording and releases the buffer.
+	The caller must hold \c sTracepointLock, and recording must be active.
+*/
+static void
+stop_tracing()
+{
+	uint32 categories = atomic_get_and_set((int32*)&gTracepointCategories, 0);
+	if ((categories & B_TRACEPOINT_SAMPLING) != 0)
+		call_all_cpus_sync(&stop_sample_timer, NULL);
+
+	tracepoint_buffer_header* header = sHeader;
+	atomic_pointer_set(&sHeader, (tracepoint_buffer_header*)NULL);
+	call_all_cpus_sync(&wait_for_writers, NULL);
+
+	unlock_memory(header, sAreaSize, B_READ_DEVICE);
+	delete_area(sKernelArea);
+	sKernelArea = -1;
+	sTeam = -1;
+}
+
+
+/*!	Stops recording when the team that consumes the records goes away, as
+	nobody would stop it otherwise.
+*/
+void
+TeamListener::EventOccurred(NotificationService& service,
+	const KMessage* event)
+{
+	int32 eventCode;
+	int32 team;
+	if (event->FindInt32("event", &eventCode) != B_OK
+		|| eventCode != TEAM_REMOVED
+		|| event->FindInt32("team", &team) != B_OK) {
+		return;
+	}
+
+	MutexLocker locker(sTracepointLock);
+	if (sHeader != NULL && team == sTeam)
+		stop_tracing();
+}
+
+
+// #pragma mark - kernel API
+
+
+/*!	Writes an event into the ring of the current CPU. Only the current CPU
+	writes to its ring, and it does so with interrupts disabled, so that no
+	lock is needed.
+*/
+void
+tracepoint_record_event(uint16 event, uint64 arg0, uint64 arg1)
+{
+	cpu_status state = disable_interrupts();
+
+	tracepoint_buffer_header* header = atomic_pointer_get(&sHeader);
+	if (header != NULL) {
+		int32 cpu = smp_get_current_cpu();
+		tracepoint_ring* ring = get_ring(header, cpu);
+		uint64 head = sRingHeads[cpu]++;
+
+		tracepoint_record* record = (tracepoint_record*)(ring + 1)
+			+ (head & sRingMask);
+		record->time = system_time();
+		record->thread = thread_get_current_thread_id();
+		record->event = event;
+		record->cpu = cpu;
+		record->args[0] = arg0;
+		record->args[1] = arg1;
+
+		// publish the record
+		atomic_set64((int64*)&ring->head, head + 1);
+	}
+
+	restore_interrupts(state);
+}
+
+
+// #pragma mark - syscalls
+
+
+status_t
+_user_tracepoint_start(struct tracepoint_parameters* userParameters)
+{
+	if (geteuid() != 0)
+		return B_PERMISSION_DENIED;
+
+	tracepoint_parameters parameters;
+	if (userParameters == NULL || !IS_USER_ADDRESS(userParameters)
+		|| user_memcpy(&parameters, userParameters, sizeof(parameters))
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	if (parameters.categories == 0
+		|| (parameters.categories & ~(uint32)B_TRACEPOINT_ALL) != 0) {
+		return B_BAD_VALUE;
+	}
+
+	area_info areaInfo;
+	status_t error = get_area_info(parameters.buffer_area, &areaInfo);
+	if (error != B_OK)
+		return error;
+	if (areaInfo.team != team_get_current_team_id())
+		return B_BAD_VALUE;
+
+	// every CPU gets a ring of the same power of two number of records
+	int32 cpuCount = smp_get_num_cpus();
+	size_t ringSize = (areaInfo.size - B_TRACEPOINT_HEADER_SIZE) / cpuCount;
+	if (areaInfo.size < B_TRACEPOINT_HEADER_SIZE
+		|| ringSize < sizeof(tracepoint_ring) + sizeof(tracepoint_record)) {
+		return B_BAD_VALUE;
+	}
+
+	uint32 capacity = 1;
+	while (sizeof(tracepoint_ring) + capacity * 2 * sizeof(tracepoint_record)
+			<= ringSize) {
+		capacity *= 2;
+	}
+
+	// The listener is never removed again: it is called with the
+	// notification service locked, and takes sTracepointLock itself.
+	if (atomic_test_and_set(&sTeamListenerAdded, 1, 0) == 0) {
+		error = NotificationManager::Manager().AddListener("teams",
+			TEAM_REMOVED, sTeamListener);
+		if (error != B_OK) {
+			atomic_set(&sTeamListenerAdded, 0);
+			return error;
+		}
+	}
+
+	MutexLocker locker(sTracepointLock);
+	if (sHeader != NULL)
+		return B_BUSY;
+
+	void* address;
+	area_id kernelArea = clone_area("tracepoint rings", &address,
+		B_ANY_KERNEL_ADDRESS, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA,
+		parameters.buffer_area);
+	if (kernelArea < 0)
+		return kernelArea;
+
+	error = lock_memory(address, areaInfo.size, B_READ_DEVICE);
+	if (error != B_OK) {
+		delete_area(kernelArea);
+		return error;
+	}
+
+	sRingSize = sizeof(tracepoint_ring) + capacity * sizeof(tracepoint_record);
+	sRingMask = capacity - 1;
+
+	tracepoint_buffer_header* header = (tracepoint_buffer_header*)address;
+	header->cpu_count = cpuCount;
+	header->ring_capacity = capacity;
+	header->ring_size = sRingSize;
+	header->categories = parameters.categories;
+	for (int32 i = 0; i < cpuCount; i++) {
+		memset(get_ring(header, i), 0, sizeof(tracepoint_ring));
+		sRingHeads[i] = 0;
+	}
+
+	sKernelArea = kernelArea;
+	sAreaSize = areaInfo.size;
+	sTeam = team_get_current_team_id();
+	atomic_pointer_set(&sHeader, header);
+
+	if ((parameters.categories & B_TRACEPOINT_SAMPLING) != 0) {
+		sSampleInterval = std::max(parameters.sample_interval,
+			(bigtime_t)B_DEBUG_MIN_PROFILE_INTERVAL);
+		call_all_cpus(&start_sample_timer, NULL);
+	}
+
+	atomic_set((int32*)&gTracepointCategories, parameters.categories);
+	return B_OK;
+}
+
+
+status_t
+_user_tracepoint_stop()
+{
+	if (geteuid() != 0)
+		return B_PERMISSION_DENIED;
+
+	MutexLocker locker(sTracepointLock);
+	if (sHeader == NULL)
+		return B_BAD_VALUE;
+
+	stop_tracing();
+	return B_OK;
+}
@@ -15,6 +15,7 @@
 #include <kernel.h>
 #include <team.h>
 #include <thread.h>
+#include <tracepoint.h>
 #include <util/AutoLock.h>
 #include <vm/vm.h>
 #include <vm/VMAddressSpace.h>
@@ -788,6 +789,7 @@ IORequest::Init(off_t offset, generic_size_t firstVecOffset,
 	fBuffer->SetVecs(firstVecOffset, lastVecSize, vecs, count, length, flags);
 
 	fOwner = NULL;
+	fDeadline = 0;
 	fOffset = offset;
 	fLength = length;
 	fRelativeParentOffset = 0;
@@ -809,6 +811,8 @@ IORequest::Init(off_t offset, generic_size_t firstVecOffset,
 
 	fStatus = 1;
 
+	TRACEPOINT(B_TRACEPOINT_IO, B_TRACEPOINT_IO_REQUEST_BEGIN, (addr_t)this,
+		length);
 	return B_OK;
 }
 
@@ -968,6 +972,9 @@ IORequest::NotifyFinished()
 		|| dynamic_cast<IOOperation*>(fChildren.Head()) == NULL);
 	ASSERT(fTransferSize <= fLength);
 
+	TRACEPOINT(B_TRACEPOINT_IO, B_TRACEPOINT_IO_REQUEST_END, (addr_t)this,
+		fStatus);
+
 	// unlock the memory
 	if (fBuffer->IsMemoryLocked())
 		fBuffer->UnlockMemory(fTeam, fIsWrite);
@@ -1447,6 +1454,7 @@ IORequest::Dump() const
 	kprintf("io_request at %p\n", this);
 
 	kprintf("  owner:             %p\n", fOwner);
+	kprintf("  deadline:          %" B_PRIdBIGTIME "\n", fDeadline);
 	kprintf("  parent:            %p\n", fParent);
 	kprintf("  status:            %s\n", strerror(fStatus));
 	kprintf("  mutex:             %p\n", &fLock);
@@ -0,0 +1,698 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include "IOSchedulerMultiQueue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <lock.h>
+#include <smp.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+
+#include "IOSchedulerRoster.h"
+
+
+//#define TRACE_IO_SCHEDULER
+#ifdef TRACE_IO_SCHEDULER
+#	define TRACE(x...) dprintf(x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+// Deadlines relative to the time a request has been scheduled. Reads are
+// usually synchronous, so they get the shorter one. A request that has
+// passed its deadline is served before any other.
+static const bigtime_t kReadDeadline = 500000;
+static const bigtime_t kWriteDeadline = 5000000;
+
+// Number of times reads may be preferred over pending writes, before a write
+// is dispatched even if its deadline has not expired yet.
+static const int32 kMaxWritesStarved = 4;
+
+// How long a queue waits before it retries, if the DMA resource ran out of
+// buffers while none of its own operations were in flight, or if the driver
+// could not accept an operation.
+static const bigtime_t kResourceRetryDelay = 1000;
+
+
+struct IOSchedulerMultiQueue::AbortedRequest
+	: DoublyLinkedListLinkImpl<AbortedRequest> {
+	IORequest*			request;
+	status_t			status;
+};
+
+
+struct IOSchedulerMultiQueue::HardwareQueue {
+	IOSchedulerMultiQueue*	scheduler;
+	int32				index;
+	mutex				lock;
+	spinlock			completionLock;
+	thread_id			thread;
+	ConditionVariable	condition;
+
+	IORequestOwner		reads;
+	IORequestOwner		writes;
+	IOOperationList		unusedOperations;
+	IOOperationList		unfinishedOperations;
+	IOOperationList		completedOperations;
+		// protected by completionLock
+	DoublyLinkedList<AbortedRequest> abortedRequests;
+	DoublyLinkedList<AbortedRequest> unusedAbortedRequests;
+
+	int32				inFlight;
+	int32				writesStarved;
+	bool				dispatching;
+	bool				resourcesExhausted;
+	bool				deviceBusy;
+
+	// statistics
+	int64				requestsScheduled;
+	int64				expiredDeadlines;
+};
+
+
+IOSchedulerMultiQueue::IOSchedulerMultiQueue(DMAResource* resource,
+	int32 hardwareQueueCount)
+	:
+	IOScheduler(resource),
+	fQueues(NULL),
+	fQueueCount(std::max(hardwareQueueCount, (int32)1)),
+	fCPUQueues(NULL),
+	fOperations(NULL),
+	fAbortedRequests(NULL),
+	fOperationsPerQueue(0),
+	fTerminating(false)
+{
+}
+
+
+IOSchedulerMultiQueue::~IOSchedulerMultiQueue()
+{
+	if (fQueues != NULL) {
+		// shutdown threads
+		for (int32 i = 0; i < fQueueCount; i++) {
+			HardwareQueue& queue = fQueues[i];
+			MutexLocker locker(queue.lock);
+			fTerminating = true;
+			queue.condition.NotifyAll();
+		}
+
+		for (int32 i = 0; i < fQueueCount; i++) {
+			HardwareQueue& queue = fQueues[i];
+			if (queue.thread >= 0)
+				wait_for_thread(queue.thread, NULL);
+
+			mutex_lock(&queue.lock);
+			mutex_destroy(&queue.lock);
+		}
+	}
+
+	delete[] fQueues;
+	delete[] fOperations;
+	delete[] fAbortedRequests;
+	delete[] fCPUQueues;
+}
+
+
+status_t
+IOSchedulerMultiQueue::Init(const char* name)
+{
+	status_t error = IOScheduler::Init(name);
+	if (error != B_OK)
+		return error;
+
+	int32 cpuCount = smp_get_num_cpus();
+	fQueueCount = std::min(fQueueCount, cpuCount);
+
+	fCPUQueues = new(std::nothrow) int32[cpuCount];
+	if (fCPUQueues == NULL)
+		return B_NO_MEMORY;
+
+	for (int32 i = 0; i < cpuCount; i++)
+		fCPUQueues[i] = i % fQueueCount;
+
+	// Split the DMA buffers among the queues, so that a busy queue cannot
+	// starve the others of operations.
+	size_t operationCount = fDMAResource != NULL
+		? fDMAResource->BufferCount() : 16;
+	fOperationsPerQueue = std::max((int32)(operationCount / fQueueCount),
+		(int32)2);
+
+	fOperations = new(std::nothrow) IOOperation[
+		fOperationsPerQueue * fQueueCount];
+	fAbortedRequests = new(std::nothrow) AbortedRequest[
+		fOperationsPerQueue * fQueueCount];
+	fQueues = new(std::nothrow) HardwareQueue[fQueueCount];
+	if (fOperations == NULL || fAbortedRequests == NULL || fQueues == NULL)
+		return B_NO_MEMORY;
+
+	for (int32 i = 0; i < fQueueCount; i++) {
+		HardwareQueue& queue = fQueues[i];
+		queue.scheduler = this;
+		queue.index = i;
+		mutex_init(&queue.lock, "I/O scheduler queue");
+		B_INITIALIZE_SPINLOCK(&queue.completionLock);
+		queue.thread = -1;
+		queue.condition.Init(&queue, "I/O queue");
+
+		queue.reads.team = queue.writes.team = -1;
+		queue.reads.thread = queue.writes.thread = -1;
+		queue.reads.priority = queue.writes.priority = B_NORMAL_PRIORITY;
+
+		queue.inFlight = 0;
+		queue.writesStarved = 0;
+		queue.dispatching = false;
+		queue.resourcesExhausted = false;
+		queue.deviceBusy = false;
+		queue.requestsScheduled = 0;
+		queue.expiredDeadlines = 0;
+
+		// An aborted request is only remembered while at least one of its
+		// operations is in flight, so we need at most one entry per operation.
+		IOOperation* operations = fOperations + i * fOperationsPerQueue;
+		AbortedRequest* aborted = fAbortedRequests + i * fOperationsPerQueue;
+		for (int32 k = 0; k < fOperationsPerQueue; k++) {
+			queue.unusedOperations.Add(&operations[k]);
+			queue.unusedAbortedRequests.Add(&aborted[k]);
+		}
+	}
+
+	// start threads
+	for (int32 i = 0; i < fQueueCount; i++) {
+		HardwareQueue& queue = fQueues[i];
+
+		char buffer[B_OS_NAME_LENGTH];
+		snprintf(buffer, sizeof(buffer), "%s queue %" B_PRId32 " %" B_PRId32,
+			name, i, fID);
+		queue.thread = spawn_kernel_thread(&_DispatcherThread, buffer,
+			B_NORMAL_PRIORITY + 2, (void*)&queue);
+		if (queue.thread < B_OK)
+			return queue.thread;
+
+		resume_thread(queue.thread);
+	}
+
+	return B_OK;
+}
+
+
+status_t
+IOSchedulerMultiQueue::ScheduleRequest(IORequest* request)
+{
+	TRACE("%p->IOSchedulerMultiQueue::ScheduleRequest(%p)\n", this, request);
+
+	IOBuffer* buffer = request->Buffer();
+
+	if (buffer->IsVirtual()) {
+		status_t status = buffer->LockMemory(request->TeamID(),
+			request->IsWrite());
+		if (status != B_OK) {
+			request->SetStatusAndNotify(status);
+			return status;
+		}
+	}
+
+	HardwareQueue* queue = &fQueues[fCPUQueues[smp_get_current_cpu()]];
+
+	MutexLocker locker(queue->lock);
+
+	IORequestOwner* owner;
+	if (request->IsWrite()) {
+		owner = &queue->writes;
+		request->SetDeadline(system_time() + kWriteDeadline);
+	} else {
+		owner = &queue->reads;
+		request->SetDeadline(system_time() + kReadDeadline);
+	}
+
+	request->SetOwner(owner);
+	owner->requests.Add(request);
+	queue->requestsScheduled++;
+
+	IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_SCHEDULED, this,
+		request);
+
+	queue->condition.NotifyAll();
+	return B_OK;
+}
+
+
+void
+IOSchedulerMultiQueue::AbortRequest(IORequest* request, status_t status)
+{
+	for (int32 i = 0; i < fQueueCount; i++) {
+		HardwareQueue& queue = fQueues[i];
+		MutexLocker locker(queue.lock);
+
+		IORequestOwner* owner = request->Owner();
+		if (owner == &queue.reads || owner == &queue.writes) {
+			owner->requests.Remove(request);
+			request->SetOwner(NULL);
+		}
+
+		// Operations that are already in flight will finish the request.
+		if (_DeferAbort(&queue, request, status))
+			return;
+	}
+
+	request->SetStatusAndNotify(status);
+}
+
+
+void
+IOSchedulerMultiQueue::OperationCompleted(IOOperation* operation,
+	status_t status, generic_size_t transferredBytes)
+{
+	HardwareQueue* queue = _QueueFor(operation);
+
+	InterruptsSpinLocker _(queue->completionLock);
+
+	// finish operation only once
+	if (operation->Status() <= 0)
+		return;
+
+	operation->SetStatus(status, transferredBytes);
+
+	queue->completedOperations.Add(operation);
+	queue->resourcesExhausted = false;
+	queue->condition.NotifyAll();
+}
+
+
+void
+IOSchedulerMultiQueue::Dump() const
+{
+	kprintf("IOSchedulerMultiQueue at %p\n", this);
+	kprintf("  DMA resource:   %p\n", fDMAResource);
+	kprintf("  queues:         %" B_PRId32 "\n", fQueueCount);
+
+	for (int32 i = 0; i < fQueueCount; i++) {
+		const HardwareQueue& queue = fQueues[i];
+		kprintf("  queue %" B_PRId32 ": thread %" B_PRId32 ", in flight %"
+			B_PRId32 ", %s%s\n", i, queue.thread, queue.inFlight,
+			queue.dispatching ? "dispatching" : "idle",
+			queue.deviceBusy ? ", device busy" : "");
+		kprintf("    scheduled: %" B_PRId64 ", expired deadlines: %" B_PRId64
+			"\n", queue.requestsScheduled, queue.expiredDeadlines);
+
+		kprintf("    reads:");
+		for (IORequestList::ConstIterator it
+					= queue.reads.requests.GetIterator();
+				IORequest* request = it.Next();) {
+			kprintf(" %p", request);
+		}
+		kprintf("\n    writes:");
+		for (IORequestList::ConstIterator it
+					= queue.writes.requests.GetIterator();
+				IORequest* request = it.Next();) {
+			kprintf(" %p", request);
+		}
+		kprintf("\n");
+	}
+}
+
+
+IOSchedulerMultiQueue::HardwareQueue*
+IOSchedulerMultiQueue::_QueueFor(IOOperation* operation) const
+{
+	return &fQueues[(operation - fOperations) / fOperationsPerQueue];
+}
+
+
+/*!	Must be called with the queue's lock held. */
+IOSchedulerMultiQueue::AbortedRequest*
+IOSchedulerMultiQueue::_FindAbortedRequest(HardwareQueue* queue,
+	IORequest* request) const
+{
+	for (DoublyLinkedList<AbortedRequest>::Iterator it
+				= queue->abortedRequests.GetIterator();
+			AbortedRequest* aborted = it.Next();) {
+		if (aborted->request == request)
+			return aborted;
+	}
+
+	return NULL;
+}
+
+
+/*!	Fails \a request with \a status once its operations in this queue have
+	finished. Returns \c false, if none of them is in flight anymore; the
+	caller has to notify the request itself then.
+	Must be called with the queue's lock held.
+*/
+bool
+IOSchedulerMultiQueue::_DeferAbort(HardwareQueue* queue, IORequest* request,
+	status_t status)
+{
+	if (_FindAbortedRequest(queue, request) != NULL)
+		return true;
+
+	IOOperation* operations = fOperations + queue->index * fOperationsPerQueue;
+	int32 i = 0;
+	for (; i < fOperationsPerQueue; i++) {
+		if (operations[i].Parent() == request)
+			break;
+	}
+	if (i == fOperationsPerQueue)
+		return false;
+
+	AbortedRequest* aborted = queue->unusedAbortedRequests.RemoveHead();
+	ASSERT(aborted != NULL);
+
+	aborted->request = request;
+	aborted->status = status;
+	queue->abortedRequests.Add(aborted);
+	return true;
+}
+
+
+/*!	Must be called with the queue's lock and completion lock held. */
+bool
+IOSchedulerMultiQueue::_WorkPending(HardwareQueue* queue) const
+{
+	if (!queue->completedOperations.IsEmpty())
+		return true;
+	if (queue->deviceBusy)
+		return false;
+	if (!queue->unfinishedOperations.IsEmpty())
+		return true;
+
+	return !queue->resourcesExhausted && !queue->unusedOperations.IsEmpty()
+		&& (!queue->reads.requests.IsEmpty()
+			|| !queue->writes.requests.IsEmpty());
+}
+
+
+/*!	Picks the request to translate next. The request whose deadline has
+	expired first is always served first. Otherwise, reads are preferred,
+	unless the oldest write has been passed over too often.
+	Must be called with the queue's lock held.
+*/
+IORequest*
+IOSchedulerMultiQueue::_NextRequest(HardwareQueue* queue)
+{
+	IORequest* read = queue->reads.requests.Head();
+	IORequest* write = queue->writes.requests.Head();
+	bigtime_t now = system_time();
+
+	if (write == NULL) {
+		if (read != NULL && read->Deadline() <= now)
+			queue->expiredDeadlines++;
+		return read;
+	}
+	if (read == NULL) {
+		if (write->Deadline() <= now)
+			queue->expiredDeadlines++;
+		queue->writesStarved = 0;
+		return write;
+	}
+
+	if (read->Deadline() <= now || write->Deadline() <= now) {
+		queue->expiredDeadlines++;
+		if (read->Deadline() <= write->Deadline())
+			return read;
+
+		queue->writesStarved = 0;
+		return write;
+	}
+
+	if (++queue->writesStarved > kMaxWritesStarved) {
+		queue->writesStarved = 0;
+		return write;
+	}
+
+	return read;
+}
+
+
+/*!	Must be called with the queue's lock held. */
+status_t
+IOSchedulerMultiQueue::_TranslateRequest(HardwareQueue* queue,
+	IORequest* request, IOOperationList& operations)
+{
+	if (fDMAResource == NULL) {
+		IOOperation* operation = queue->unusedOperations.RemoveHead();
+		if (operation == NULL)
+			return B_BUSY;
+
+		status_t status = operation->Prepare(request);
+		if (status != B_OK) {
+			operation->SetParent(NULL);
+			queue->unusedOperations.Add(operation);
+			return status;
+		}
+
+		operation->SetOriginalRange(request->Offset(), request->Length());
+		request->Advance(request->Length());
+
+		operations.Add(operation);
+		queue->inFlight++;
+		return B_OK;
+	}
+
+	while (request->RemainingBytes() > 0) {
+		IOOperation* operation = queue->unusedOperations.RemoveHead();
+		if (operation == NULL)
+			return B_BUSY;
+
+		status_t status = fDMAResource->TranslateNext(request, operation, 0);
+		if (status != B_OK) {
+			operation->SetParent(NULL);
+			queue->unusedOperations.Add(operation);
+			return status;
+		}
+
+		operations.Add(operation);
+		queue->inFlight++;
+	}
+
+	return B_OK;
+}
+
+
+/*!	Must be called with the queue's lock held. */
+void
+IOSchedulerMultiQueue::_PrepareOperations(HardwareQueue* queue,
+	IOOperationList& operations)
+{
+	// Operations that need another phase go first; they already hold their
+	// resources.
+	operations.TakeFrom(&queue->unfinishedOperations);
+
+	while (!queue->unusedOperations.IsEmpty()) {
+		IORequest* request = _NextRequest(queue);
+		if (request == NULL)
+			break;
+
+		status_t status = _TranslateRequest(queue, request, operations);
+		if (status == B_BUSY) {
+			// Some resource is temporarily unavailable. If none of our
+			// operations is in flight, no completion will wake us up again.
+			if (queue->inFlight == 0)
+				queue->resourcesExhausted = true;
+			break;
+		}
+
+		if (status != B_OK) {
+			request->Owner()->requests.Remove(request);
+			request->SetOwner(NULL);
+
+			// Operations of the request that are still in flight will finish
+			// it.
+			if (_DeferAbort(queue, request, status))
+				continue;
+
+			// the notification might schedule new requests
+			mutex_unlock(&queue->lock);
+			request->SetStatusAndNotify(status);
+			mutex_lock(&queue->lock);
+			continue;
+		}
+
+		if (request->RemainingBytes() == 0) {
+			request->Owner()->requests.Remove(request);
+			request->SetOwner(NULL);
+		}
+	}
+}
+
+
+/*!	Issues operations and processes their completion. The caller must have
+	set the queue's \c dispatching flag; it is cleared when this method
+	returns.
+	If the driver cannot accept an operation right now, it and the rest of
+	its batch are put back, and issued again after a short delay, or once
+	another operation has completed.
+*/
+void
+IOSchedulerMultiQueue::_Dispatch(HardwareQueue* queue)
+{
+	while (true) {
+		_Finisher(queue);
+
+		MutexLocker locker(queue->lock);
+
+		IOOperationList operations;
+		if (!fTerminating && !queue->deviceBusy)
+			_PrepareOperations(queue, operations);
+
+		if (operations.IsEmpty())
+			break;
+
+		locker.Unlock();
+
+		while (IOOperation* operation = operations.RemoveHead()) {
+			TRACE("IOSchedulerMultiQueue::_Dispatch(): queue %" B_PRId32
+				", operation %p\n", queue->index, operation);
+
+			IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_OPERATION_STARTED,
+				this, operation->Parent(), operation);
+
+			if (fIOCallback(fIOCallbackData, operation) == B_BUSY) {
+				// The driver didn't take the operation; it is still ours.
+				locker.Lock();
+				operations.Add(operation, false);
+				queue->unfinishedOperations.TakeFrom(&operations);
+				queue->deviceBusy = true;
+				break;
+			}
+		}
+	}
+
+	MutexLocker locker(queue->lock);
+	queue->dispatching = false;
+}
+
+
+/*!	Must only be called by the thread that set the queue's \c dispatching
+	flag.
+*/
+void
+IOSchedulerMultiQueue::_Finisher(HardwareQueue* queue)
+{
+	while (true) {
+		InterruptsSpinLocker locker(queue->completionLock);
+		IOOperation* operation = queue->completedOperations.RemoveHead();
+		if (operation == NULL)
+			return;
+
+		locker.Unlock();
+
+		TRACE("IOSchedulerMultiQueue::_Finisher(): operation: %p\n",
+			operation);
+
+		bool operationFinished = operation->Finish();
+
+		IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_OPERATION_FINISHED,
+			this, operation->Parent(), operation);
+
+		if (!operationFinished) {
+			MutexLocker _(queue->lock);
+			queue->unfinishedOperations.Add(operation);
+			continue;
+		}
+
+		IORequest* request = operation->Parent();
+
+		// The operation must leave the request with the queue's lock held, so
+		// that _DeferAbort() sees a consistent picture.
+		MutexLocker queueLocker(queue->lock);
+		queue->deviceBusy = false;
+		AbortedRequest* aborted = _FindAbortedRequest(queue, request);
+		if (aborted != NULL && operation->Status() == B_OK)
+			operation->SetStatus(aborted->status, 0);
+
+		request->OperationFinished(operation);
+
+		// recycle the operation
+		if (fDMAResource != NULL)
+			fDMAResource->RecycleBuffer(operation->Buffer());
+
+		queue->inFlight--;
+		queue->unusedOperations.Add(operation);
+
+		if (!request->IsFinished())
+			continue;
+
+		if (aborted != NULL) {
+			queue->abortedRequests.Remove(aborted);
+			queue->unusedAbortedRequests.Add(aborted);
+		}
+
+		if (request->Status() == B_OK && request->RemainingBytes() > 0) {
+			// The request is still queued, it just couldn't be translated in
+			// one go.
+			request->SetUnfinished();
+			continue;
+		}
+
+		IORequestOwner* owner = request->Owner();
+		if (owner != NULL) {
+			owner->requests.Remove(request);
+			request->SetOwner(NULL);
+		}
+
+		queueLocker.Unlock();
+
+		IOSchedulerRoster::Default()->Notify(IO_SCHEDULER_REQUEST_FINISHED,
+			this, request);
+		request->NotifyFinished();
+	}
+}
+
+
+status_t
+IOSchedulerMultiQueue::_Dispatcher(HardwareQueue* queue)
+{
+	while (true) {
+		MutexLocker locker(queue->lock);
+		InterruptsSpinLocker completionLocker(queue->completionLock);
+
+		if (fTerminating && !queue->dispatching)
+			return B_OK;
+
+		if (!queue->dispatching && _WorkPending(queue)) {
+			queue->dispatching = true;
+			completionLocker.Unlock();
+			locker.Unlock();
+
+			_Dispatch(queue);
+			continue;
+		}
+
+		bool retry = (queue->resourcesExhausted || queue->deviceBusy)
+			&& !queue->dispatching;
+
+		ConditionVariableEntry entry;
+		queue->condition.Add(&entry);
+
+		completionLocker.Unlock();
+		locker.Unlock();
+
+		if (retry) {
+			entry.Wait(B_RELATIVE_TIMEOUT, kResourceRetryDelay);
+
+			locker.Lock();
+			queue->resourcesExhausted = false;
+			queue->deviceBusy = false;
+		} else
+			entry.Wait(B_CAN_INTERRUPT);
+	}
+}
+
+
+/*static*/ status_t
+IOSchedulerMultiQueue::_DispatcherThread(void* _queue)
+{
+	HardwareQueue* queue = (HardwareQueue*)_queue;
+	return queue->scheduler->_Dispatcher(queue);
+}
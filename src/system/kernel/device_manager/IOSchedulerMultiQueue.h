@@ -0,0 +1,82 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef IO_SCHEDULER_MULTI_QUEUE_H
+#define IO_SCHEDULER_MULTI_QUEUE_H
+
+
+#include <KernelExport.h>
+
+#include <condition_variable.h>
+#include <lock.h>
+
+#include "dma_resources.h"
+#include "IOScheduler.h"
+
+
+/*!	I/O scheduler for devices with one or more hardware submission queues.
+
+	Every CPU is mapped onto one of the device's hardware queues, and each
+	queue is scheduled independently with its own lock, operation pool and
+	dispatcher thread. Instead of elevator sorting, requests are served in
+	FIFO order per direction, with reads preferred over writes. A request
+	that has passed its deadline is served first, regardless of its
+	direction.
+
+	Operations are always issued by the dispatcher thread of their queue, as
+	drivers may block until an operation has completed.
+*/
+class IOSchedulerMultiQueue : public IOScheduler {
+public:
+								IOSchedulerMultiQueue(DMAResource* resource,
+									int32 hardwareQueueCount = 1);
+	virtual						~IOSchedulerMultiQueue();
+
+	virtual	status_t			Init(const char* name);
+
+	virtual	status_t			ScheduleRequest(IORequest* request);
+
+	virtual	void				AbortRequest(IORequest* request,
+									status_t status = B_CANCELED);
+	virtual	void				OperationCompleted(IOOperation* operation,
+									status_t status,
+									generic_size_t transferredBytes);
+
+	virtual	void				Dump() const;
+
+private:
+			struct AbortedRequest;
+			struct HardwareQueue;
+
+			HardwareQueue*		_QueueFor(IOOperation* operation) const;
+			AbortedRequest*		_FindAbortedRequest(HardwareQueue* queue,
+									IORequest* request) const;
+			bool				_DeferAbort(HardwareQueue* queue,
+									IORequest* request, status_t status);
+
+			bool				_WorkPending(HardwareQueue* queue) const;
+			IORequest*			_NextRequest(HardwareQueue* queue);
+			status_t			_TranslateRequest(HardwareQueue* queue,
+									IORequest* request,
+									IOOperationList& operations);
+			void				_PrepareOperations(HardwareQueue* queue,
+									IOOperationList& operations);
+			void				_Dispatch(HardwareQueue* queue);
+			void				_Finisher(HardwareQueue* queue);
+
+			status_t			_Dispatcher(HardwareQueue* queue);
+	static	status_t			_DispatcherThread(void* queue);
+
+private:
+			HardwareQueue*		fQueues;
+			int32				fQueueCount;
+			int32*				fCPUQueues;
+			IOOperation*		fOperations;
+			AbortedRequest*		fAbortedRequests;
+			int32				fOperationsPerQueue;
+	volatile bool				fTerminating;
+};
+
+
+#endif	// IO_SCHEDULER_MULTI_QUEUE_H
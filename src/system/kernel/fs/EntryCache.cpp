@@ -7,6 +7,10 @@
 #include "EntryCache.h"
 
 #include <new>
+#include <arch/atomic.h>
+#include <arch/cpu.h>
+#include <smp.h>
+#include <thread.h>
 #include <vm/vm.h>
 #include <slab/Slab.h>
 
@@ -14,6 +18,31 @@
 static const int32 kEntryNotInArray = -1;
 static const int32 kEntryRemoved = -2;
 
+// Number of sequence counters the hash buckets are striped over. Must be a
+// power of two, and not greater than the number of buckets.
+static const uint32 kSequenceCount = 256;
+
+// Number of retired entries after which we try to reclaim them.
+static const int32 kReclaimThreshold = 64;
+
+enum {
+	kLookupNotFound,
+	kLookupFound,
+	kLookupLocked
+};
+
+
+/*!	Announces that lockless lookups are running on this CPU, and the epoch
+	the first of them started in. Entries removed from the table are only
+	freed once no CPU is in an epoch that could still see them.
+	The lookups can be preempted by other lookups on the same CPU, so they
+	share the announcement, which is only withdrawn when the last one is done.
+*/
+struct EntryCacheCPU {
+	int64				epoch;
+	int32				readers;
+} CACHE_LINE_ALIGN;
+
 
 // #pragma mark - EntryCacheGeneration
 
@@ -50,25 +79,45 @@ EntryCacheGeneration::Init(int32 entriesSize)
 
 EntryCache::EntryCache()
 	:
+	fBuckets(NULL),
+	fBucketMask(0),
+	fSequences(NULL),
+	fCPUs(NULL),
+	fCPUCount(0),
+	fEpoch(1),
+	fRetired(NULL),
+	fRetiredTail(NULL),
+	fRetiredCount(0),
 	fGenerationCount(0),
 	fGenerations(NULL),
 	fCurrentGeneration(0)
 {
 	rw_lock_init(&fLock, "entry cache");
-
-	new(&fEntries) EntryTable;
 }
 
 
 EntryCache::~EntryCache()
 {
 	// delete entries
-	EntryCacheEntry* entry = fEntries.Clear(true);
-	while (entry != NULL) {
-		EntryCacheEntry* next = entry->hash_link;
+	if (fBuckets != NULL) {
+		for (uint32 i = 0; i <= fBucketMask; i++) {
+			EntryCacheEntry* entry = fBuckets[i];
+			while (entry != NULL) {
+				EntryCacheEntry* next = entry->hash_link;
+				free(entry);
+				entry = next;
+			}
+		}
+	}
+
+	while (EntryCacheEntry* entry = fRetired) {
+		fRetired = entry->retired_link;
 		free(entry);
-		entry = next;
 	}
+
+	delete[] fBuckets;
+	delete[] fSequences;
+	free(fCPUs);
 	delete[] fGenerations;
 
 	rw_lock_destroy(&fLock);
@@ -78,10 +127,6 @@ EntryCache::~EntryCache()
 status_t
 EntryCache::Init()
 {
-	status_t error = fEntries.Init();
-	if (error != B_OK)
-		return error;
-
 	int32 entriesSize = 1024;
 	fGenerationCount = 8;
 
@@ -92,9 +137,36 @@ EntryCache::Init()
 		fGenerationCount = 16;
 	}
 
+	// The table never grows, so that lockless readers never see it resized.
+	// It can hold at most all generations, so we size it accordingly, to
+	// keep the bucket chains short.
+	uint32 bucketCount = kSequenceCount;
+	while (bucketCount < (uint32)(entriesSize * fGenerationCount))
+		bucketCount *= 2;
+
+	fBuckets = new(std::nothrow) EntryCacheEntry*[bucketCount];
+	fSequences = new(std::nothrow) int32[kSequenceCount];
+	fCPUCount = smp_get_num_cpus();
+	fCPUs = (EntryCacheCPU*)memalign(CACHE_LINE_SIZE,
+		sizeof(EntryCacheCPU) * fCPUCount);
+	if (fBuckets == NULL || fSequences == NULL || fCPUs == NULL) {
+		fGenerationCount = 0;
+		return B_NO_MEMORY;
+	}
+
+	fBucketMask = bucketCount - 1;
+	memset(fBuckets, 0, sizeof(EntryCacheEntry*) * bucketCount);
+	memset(fSequences, 0, sizeof(int32) * kSequenceCount);
+	memset(fCPUs, 0, sizeof(EntryCacheCPU) * fCPUCount);
+
 	fGenerations = new(std::nothrow) EntryCacheGeneration[fGenerationCount];
+	if (fGenerations == NULL) {
+		fGenerationCount = 0;
+		return B_NO_MEMORY;
+	}
+
 	for (int32 i = 0; i < fGenerationCount; i++) {
-		error = fGenerations[i].Init(entriesSize);
+		status_t error = fGenerations[i].Init(entriesSize);
 		if (error != B_OK)
 			return error;
 	}
@@ -113,10 +185,13 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 	if (fGenerationCount == 0)
 		return B_NO_MEMORY;
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
+	EntryCacheEntry* entry = _Lookup(key);
 	if (entry != NULL) {
+		_BeginWrite(entry->hash);
 		entry->node_id = nodeID;
 		entry->missing = missing;
+		_EndWrite(entry->hash);
+
 		if (entry->generation != fCurrentGeneration) {
 			if (entry->index >= 0) {
 				fGenerations[entry->generation].entries[entry->index] = NULL;
@@ -134,18 +209,23 @@ EntryCache::Add(ino_t dirID, const char* name, ino_t nodeID, bool missing)
 	if (entry == NULL)
 		return B_NO_MEMORY;
 
+	entry->retired_link = NULL;
 	entry->node_id = nodeID;
 	entry->dir_id = dirID;
-	entry->hash = EntryCacheKey::Hash(dirID, name);
+	entry->retired_epoch = 0;
+	entry->hash = key.hash;
 	entry->missing = missing;
 	entry->generation = fCurrentGeneration;
 	entry->index = kEntryNotInArray;
 	memcpy(entry->name, name, nameLen + 1);
 
-	fEntries.Insert(entry);
+	_Insert(entry);
 
 	_AddEntryToCurrentGeneration(entry);
 
+	if (fRetiredCount >= kReclaimThreshold)
+		_ReclaimRetired();
+
 	return B_OK;
 }
 
@@ -157,16 +237,19 @@ EntryCache::Remove(ino_t dirID, const char* name)
 
 	WriteLocker writeLocker(fLock);
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
+	if (fGenerationCount == 0)
+		return B_ENTRY_NOT_FOUND;
+
+	EntryCacheEntry* entry = _Lookup(key);
 	if (entry == NULL)
 		return B_ENTRY_NOT_FOUND;
 
-	fEntries.Remove(entry);
+	_Remove(entry);
 
 	if (entry->index >= 0) {
 		// remove the entry from its generation and delete it
 		fGenerations[entry->generation].entries[entry->index] = NULL;
-		free(entry);
+		_Retire(entry);
 	} else {
 		// We can't free it, since another thread is about to try to move it
 		// to another generation. We mark it removed and the other thread will
@@ -174,6 +257,9 @@ EntryCache::Remove(ino_t dirID, const char* name)
 		entry->index = kEntryRemoved;
 	}
 
+	if (fRetiredCount >= kReclaimThreshold)
+		_ReclaimRetired();
+
 	return B_OK;
 }
 
@@ -184,9 +270,18 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 {
 	EntryCacheKey key(dirID, name);
 
+	if (fGenerationCount == 0)
+		return false;
+
+	// Most lookups find an entry of the current generation, or none at all;
+	// those don't need the lock and don't write to any shared memory.
+	int32 result = _LookupLockless(key, _nodeID, _missing);
+	if (result != kLookupLocked)
+		return result == kLookupFound;
+
 	ReadLocker readLocker(fLock);
 
-	EntryCacheEntry* entry = fEntries.Lookup(key);
+	EntryCacheEntry* entry = _Lookup(key);
 	if (entry == NULL)
 		return false;
 
@@ -221,7 +316,7 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 
 	if (entry->index == kEntryRemoved) {
 		// the entry has been removed in the meantime
-		free(entry);
+		_Retire(entry);
 		return false;
 	}
 
@@ -236,19 +331,234 @@ EntryCache::Lookup(ino_t dirID, const char* name, ino_t& _nodeID,
 const char*
 EntryCache::DebugReverseLookup(ino_t nodeID, ino_t& _dirID)
 {
-	for (EntryTable::Iterator it = fEntries.GetIterator();
-			EntryCacheEntry* entry = it.Next();) {
-		if (nodeID == entry->node_id && strcmp(entry->name, ".") != 0
-				&& strcmp(entry->name, "..") != 0) {
-			_dirID = entry->dir_id;
-			return entry->name;
+	if (fBuckets == NULL)
+		return NULL;
+
+	for (uint32 i = 0; i <= fBucketMask; i++) {
+		for (EntryCacheEntry* entry = fBuckets[i]; entry != NULL;
+				entry = entry->hash_link) {
+			if (nodeID == entry->node_id && strcmp(entry->name, ".") != 0
+					&& strcmp(entry->name, "..") != 0) {
+				_dirID = entry->dir_id;
+				return entry->name;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+
+/*!	Looks up the entry without holding the lock. The bucket is validated
+	through its sequence counter, and entries are kept alive by announcing the
+	current epoch for this CPU during the lookup.
+	Returns \c kLookupLocked if the lookup has to be done (again) with the lock
+	held, because either a writer interfered, or the entry needs to be moved
+	to the current generation.
+*/
+int32
+EntryCache::_LookupLockless(const EntryCacheKey& key, ino_t& _nodeID,
+	bool& _missing)
+{
+	int32 result = kLookupLocked;
+
+	// we must not change the CPU while our epoch is announced
+	Thread* thread = thread_get_current_thread();
+	thread_pin_to_current_cpu(thread);
+
+	EntryCacheCPU& cpu = fCPUs[smp_get_current_cpu()];
+	_EnterEpoch(cpu);
+
+	int32* sequence = &fSequences[key.hash & (kSequenceCount - 1)];
+
+	for (int32 attempt = 0; attempt < 2; attempt++) {
+		const int32 start = atomic_get(sequence);
+		if ((start & 1) != 0) {
+			// a writer is modifying the bucket right now
+			continue;
+		}
+
+		EntryCacheEntry* entry = fBuckets[key.hash & fBucketMask];
+		while (entry != NULL) {
+			if (entry->hash == key.hash && entry->dir_id == key.dir_id
+				&& strcmp(entry->name, key.name) == 0) {
+				break;
+			}
+			entry = entry->hash_link;
+		}
+
+		ino_t nodeID = 0;
+		bool missing = false;
+		bool current = false;
+		if (entry != NULL) {
+			nodeID = entry->node_id;
+			missing = entry->missing;
+			current = entry->generation == fCurrentGeneration;
+		}
+
+		memory_read_barrier();
+		if (atomic_get(sequence) != start)
+			continue;
+
+		if (entry == NULL)
+			result = kLookupNotFound;
+		else if (current) {
+			_nodeID = nodeID;
+			_missing = missing;
+			result = kLookupFound;
+		}
+		break;
+	}
+
+	_ExitEpoch(cpu);
+	thread_unpin_from_current_cpu(thread);
+
+	return result;
+}
+
+
+/*!	Announces the current epoch for \a cpu, unless another lookup on it
+	already did. Interrupts are only disabled while the announcement is
+	updated, not during the lookup itself.
+	The calling thread must be pinned to \a cpu.
+*/
+void
+EntryCache::_EnterEpoch(EntryCacheCPU& cpu)
+{
+	InterruptsLocker _;
+
+	if (cpu.readers++ == 0)
+		atomic_set64(&cpu.epoch, atomic_get64(&fEpoch));
+
+	memory_full_barrier();
+}
+
+
+/*!	The calling thread must be pinned to \a cpu. */
+void
+EntryCache::_ExitEpoch(EntryCacheCPU& cpu)
+{
+	memory_full_barrier();
+
+	InterruptsLocker _;
+
+	if (--cpu.readers == 0)
+		atomic_set64(&cpu.epoch, 0);
+}
+
+
+/*!	Must be called with the lock held. */
+EntryCacheEntry*
+EntryCache::_Lookup(const EntryCacheKey& key) const
+{
+	EntryCacheEntry* entry = fBuckets[key.hash & fBucketMask];
+	while (entry != NULL) {
+		if (entry->hash == key.hash && entry->dir_id == key.dir_id
+			&& strcmp(entry->name, key.name) == 0) {
+			return entry;
 		}
+		entry = entry->hash_link;
 	}
 
 	return NULL;
 }
 
 
+/*!	Must be called with the write lock held. */
+void
+EntryCache::_Insert(EntryCacheEntry* entry)
+{
+	EntryCacheEntry** bucket = &fBuckets[entry->hash & fBucketMask];
+
+	_BeginWrite(entry->hash);
+	entry->hash_link = *bucket;
+	memory_write_barrier();
+	*bucket = entry;
+	_EndWrite(entry->hash);
+}
+
+
+/*!	Must be called with the write lock held. The entry's \c hash_link is left
+	intact, so that lockless readers currently looking at the entry can
+	continue their way through the bucket.
+*/
+void
+EntryCache::_Remove(EntryCacheEntry* entry)
+{
+	EntryCacheEntry** link = &fBuckets[entry->hash & fBucketMask];
+	while (*link != NULL && *link != entry)
+		link = &(*link)->hash_link;
+
+	if (*link == NULL)
+		return;
+
+	_BeginWrite(entry->hash);
+	*link = entry->hash_link;
+	_EndWrite(entry->hash);
+}
+
+
+/*!	Frees the entry as soon as no lockless reader can see it anymore.
+	Must be called with the write lock held, and after the entry has been
+	removed from the table.
+*/
+void
+EntryCache::_Retire(EntryCacheEntry* entry)
+{
+	entry->retired_link = NULL;
+	entry->retired_epoch = atomic_get64(&fEpoch);
+
+	if (fRetiredTail != NULL)
+		fRetiredTail->retired_link = entry;
+	else
+		fRetired = entry;
+	fRetiredTail = entry;
+	fRetiredCount++;
+
+	// any reader announcing the new epoch cannot find the entry anymore
+	atomic_add64(&fEpoch, 1);
+}
+
+
+/*!	Must be called with the write lock held. */
+void
+EntryCache::_ReclaimRetired()
+{
+	memory_full_barrier();
+
+	int64 oldestEpoch = INT64_MAX;
+	for (int32 i = 0; i < fCPUCount; i++) {
+		int64 epoch = atomic_get64(&fCPUs[i].epoch);
+		if (epoch != 0 && epoch < oldestEpoch)
+			oldestEpoch = epoch;
+	}
+
+	while (fRetired != NULL && fRetired->retired_epoch < oldestEpoch) {
+		EntryCacheEntry* entry = fRetired;
+		fRetired = entry->retired_link;
+		free(entry);
+		fRetiredCount--;
+	}
+
+	if (fRetired == NULL)
+		fRetiredTail = NULL;
+}
+
+
+void
+EntryCache::_BeginWrite(uint32 hash)
+{
+	atomic_add(&fSequences[hash & (kSequenceCount - 1)], 1);
+}
+
+
+void
+EntryCache::_EndWrite(uint32 hash)
+{
+	atomic_add(&fSequences[hash & (kSequenceCount - 1)], 1);
+}
+
+
 void
 EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 {
@@ -271,8 +581,8 @@ EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 			continue;
 
 		fGenerations[newGeneration].entries[i] = NULL;
-		fEntries.Remove(otherEntry);
-		free(otherEntry);
+		_Remove(otherEntry);
+		_Retire(otherEntry);
 	}
 
 	// set the new generation and add the entry
@@ -281,4 +591,6 @@ EntryCache::_AddEntryToCurrentGeneration(EntryCacheEntry* entry)
 	fGenerations[newGeneration].next_index = 1;
 	entry->generation = newGeneration;
 	entry->index = 0;
+
+	_ReclaimRetired();
 }
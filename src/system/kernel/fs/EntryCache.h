@@ -10,7 +10,6 @@
 
 #include <util/AutoLock.h>
 #include <util/DoublyLinkedList.h>
-#include <util/OpenHashTable.h>
 #include <util/StringHash.h>
 
 
@@ -38,8 +37,10 @@ struct EntryCacheKey {
 
 struct EntryCacheEntry {
 	EntryCacheEntry*	hash_link;
+	EntryCacheEntry*	retired_link;
 	ino_t				node_id;
 	ino_t				dir_id;
+	int64				retired_epoch;
 	uint32				hash;
 	int32				generation;
 	int32				index;
@@ -60,33 +61,7 @@ struct EntryCacheGeneration {
 };
 
 
-struct EntryCacheHashDefinition {
-	typedef EntryCacheKey	KeyType;
-	typedef EntryCacheEntry	ValueType;
-
-	uint32 HashKey(const EntryCacheKey& key) const
-	{
-		return key.hash;
-	}
-
-	uint32 Hash(const EntryCacheEntry* value) const
-	{
-		return value->hash;
-	}
-
-	bool Compare(const EntryCacheKey& key, const EntryCacheEntry* value) const
-	{
-		if (key.hash != value->hash)
-			return false;
-		return value->dir_id == key.dir_id
-			&& strcmp(value->name, key.name) == 0;
-	}
-
-	EntryCacheEntry*& GetLink(EntryCacheEntry* value) const
-	{
-		return value->hash_link;
-	}
-};
+struct EntryCacheCPU;
 
 
 class EntryCache {
@@ -107,16 +82,36 @@ public:
 			const char*			DebugReverseLookup(ino_t nodeID, ino_t& _dirID);
 
 private:
-			typedef BOpenHashTable<EntryCacheHashDefinition> EntryTable;
-			typedef DoublyLinkedList<EntryCacheEntry> EntryList;
+			int32				_LookupLockless(const EntryCacheKey& key,
+									ino_t& _nodeID, bool& _missing);
+			void				_EnterEpoch(EntryCacheCPU& cpu);
+			void				_ExitEpoch(EntryCacheCPU& cpu);
+			EntryCacheEntry*	_Lookup(const EntryCacheKey& key) const;
+			void				_Insert(EntryCacheEntry* entry);
+			void				_Remove(EntryCacheEntry* entry);
+			void				_Retire(EntryCacheEntry* entry);
+			void				_ReclaimRetired();
+
+			void				_BeginWrite(uint32 hash);
+			void				_EndWrite(uint32 hash);
 
-private:
 			void				_AddEntryToCurrentGeneration(
 									EntryCacheEntry* entry);
 
 private:
 			rw_lock				fLock;
-			EntryTable			fEntries;
+									// held by writers, and by readers that
+									// need to move an entry to the current
+									// generation
+			EntryCacheEntry**	fBuckets;
+			uint32				fBucketMask;
+			int32*				fSequences;
+			EntryCacheCPU*		fCPUs;
+			int32				fCPUCount;
+			int64				fEpoch;
+			EntryCacheEntry*	fRetired;
+			EntryCacheEntry*	fRetiredTail;
+			int32				fRetiredCount;
 			int32				fGenerationCount;
 			EntryCacheGeneration* fGenerations;
 			int32				fCurrentGeneration;
@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 
 #include <OS.h>
 
@@ -24,6 +25,7 @@
 #include <syscalls.h>
 #include <syscall_restart.h>
 #include <slab/Slab.h>
+#include <tracepoint.h>
 #include <util/AutoLock.h>
 #include <util/iovec_support.h>
 #include <vfs.h>
@@ -41,6 +43,7 @@
 
 
 static const size_t kMaxReadDirBufferSize = B_PAGE_SIZE * 2;
+static const size_t kSpliceBufferSize = 64 * 1024;
 
 extern object_cache* sFileDescriptorCache;
 
@@ -808,10 +811,17 @@ common_user_io(int fd, off_t pos, void* buffer, size_t length, bool write)
 
 	SyscallRestartWrapper<status_t> status;
 
-	if (write)
+	if (write) {
+		TRACEPOINT(B_TRACEPOINT_VFS, B_TRACEPOINT_VFS_WRITE_BEGIN, fd, length);
 		status = descriptor->ops->fd_write(descriptor.Get(), pos, buffer, &length);
-	else
+		TRACEPOINT(B_TRACEPOINT_VFS, B_TRACEPOINT_VFS_WRITE_END, fd,
+			status == B_OK ? (ssize_t)length : (ssize_t)status);
+	} else {
+		TRACEPOINT(B_TRACEPOINT_VFS, B_TRACEPOINT_VFS_READ_BEGIN, fd, length);
 		status = descriptor->ops->fd_read(descriptor.Get(), pos, buffer, &length);
+		TRACEPOINT(B_TRACEPOINT_VFS, B_TRACEPOINT_VFS_READ_END, fd,
+			status == B_OK ? (ssize_t)length : (ssize_t)status);
+	}
 
 	if (status != B_OK)
 		return status;
@@ -847,6 +857,178 @@ common_user_vector_io(int fd, off_t pos, const iovec* userVecs, size_t count,
 }
 
 
+/*!	Returns the position to use for \a descriptor in a splice operation, and
+	whether the descriptor's own position has to be updated afterwards.
+	\a userOffset is the optional offset passed by the caller.
+*/
+static status_t
+get_splice_position(file_descriptor* descriptor, off_t* userOffset,
+	off_t& pos, bool& movePosition)
+{
+	movePosition = false;
+
+	if (userOffset == NULL) {
+		pos = descriptor->pos;
+		movePosition = pos != -1;
+		return B_OK;
+	}
+
+	if (descriptor->pos == -1)
+		return ESPIPE;
+	if (!IS_USER_ADDRESS(userOffset)
+		|| user_memcpy(&pos, userOffset, sizeof(off_t)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+	if (pos < 0)
+		return B_BAD_VALUE;
+
+	return B_OK;
+}
+
+
+/*!	Moves up to \a length bytes from \a inFD to \a outFD without passing them
+	through userland. Any kind of descriptor that supports reading or writing
+	can be used on either side; \a filesOnly restricts both to regular files
+	(for copy_file_range()).
+	The data is staged in a kernel buffer: the read and write hooks of the
+	descriptors copy directly from and to the file cache, the FIFO ring
+	buffers, and the socket buffers.
+*/
+static ssize_t
+common_splice(int inFD, off_t* userInOffset, int outFD, off_t* userOutOffset,
+	size_t length, bool filesOnly)
+{
+	io_context* context = get_current_io_context(false);
+
+	FileDescriptorPutter in(get_fd(context, inFD));
+	FileDescriptorPutter out(get_fd(context, outFD));
+	if (!in.IsSet() || !out.IsSet())
+		return B_FILE_ERROR;
+
+	if ((in->open_mode & O_RWMASK) == O_WRONLY
+		|| (out->open_mode & O_RWMASK) == O_RDONLY) {
+		return B_FILE_ERROR;
+	}
+	if (in->ops->fd_read == NULL || out->ops->fd_write == NULL
+		|| in->ops->fd_read_stat == NULL || out->ops->fd_read_stat == NULL) {
+		return B_BAD_VALUE;
+	}
+
+	struct stat inStat;
+	struct stat outStat;
+	status_t status = in->ops->fd_read_stat(in.Get(), &inStat);
+	if (status == B_OK)
+		status = out->ops->fd_read_stat(out.Get(), &outStat);
+	if (status != B_OK)
+		return status;
+
+	if (S_ISDIR(inStat.st_mode) || S_ISDIR(outStat.st_mode))
+		return B_IS_A_DIRECTORY;
+
+	bool inIsFile = S_ISREG(inStat.st_mode);
+	bool outIsFile = S_ISREG(outStat.st_mode);
+	if (filesOnly) {
+		if (!inIsFile || !outIsFile)
+			return B_BAD_VALUE;
+		if ((out->open_mode & O_APPEND) != 0)
+			return B_FILE_ERROR;
+	}
+
+	off_t inPos;
+	off_t outPos;
+	bool moveInPosition;
+	bool moveOutPosition;
+	status = get_splice_position(in.Get(), userInOffset, inPos,
+		moveInPosition);
+	if (status == B_OK) {
+		status = get_splice_position(out.Get(), userOutOffset, outPos,
+			moveOutPosition);
+	}
+	if (status != B_OK)
+		return status;
+
+	if (inIsFile && inStat.st_dev == outStat.st_dev
+		&& inStat.st_ino == outStat.st_ino) {
+		// copying within a file only works for distinct ranges
+		if (inPos == -1 || outPos == -1
+			|| (inPos < outPos + (off_t)length
+				&& outPos < inPos + (off_t)length)) {
+			return B_BAD_VALUE;
+		}
+	}
+
+	if (length == 0)
+		return 0;
+	if (length > SSIZE_MAX)
+		length = SSIZE_MAX;
+
+	size_t bufferSize = min_c(length, kSpliceBufferSize);
+	MemoryDeleter buffer(malloc(bufferSize));
+	if (!buffer.IsSet())
+		return B_NO_MEMORY;
+
+	size_t transferred = 0;
+
+	{
+		// the descriptor hooks must accept our kernel buffer
+		SyscallFlagUnsetter _;
+
+		while (length > 0) {
+			size_t bytesRead = min_c(length, bufferSize);
+			status = in->ops->fd_read(in.Get(), inPos, buffer.Get(),
+				&bytesRead);
+			if (status != B_OK || bytesRead == 0)
+				break;
+
+			// Data that has been read from a pipe or a socket cannot be
+			// put back, so we try hard to write everything.
+			size_t bytesWritten = 0;
+			while (bytesWritten < bytesRead) {
+				size_t toWrite = bytesRead - bytesWritten;
+				status = out->ops->fd_write(out.Get(), outPos,
+					(uint8*)buffer.Get() + bytesWritten, &toWrite);
+				if (status != B_OK)
+					break;
+				if (toWrite == 0) {
+					status = B_IO_ERROR;
+					break;
+				}
+
+				bytesWritten += toWrite;
+				if (outPos != -1)
+					outPos += toWrite;
+			}
+
+			if (inPos != -1)
+				inPos += bytesWritten;
+			transferred += bytesWritten;
+			length -= bytesWritten;
+
+			// Anything but a file might block on the next read; return what
+			// we have, like read() would.
+			if (status != B_OK || !inIsFile)
+				break;
+		}
+	}
+
+	if (moveInPosition)
+		in->pos = inPos;
+	if (moveOutPosition) {
+		out->pos = (out->open_mode & O_APPEND) != 0
+			? out->ops->fd_seek(out.Get(), 0, SEEK_END) : outPos;
+	}
+	if (userInOffset != NULL)
+		user_memcpy(userInOffset, &inPos, sizeof(off_t));
+	if (userOutOffset != NULL)
+		user_memcpy(userOutOffset, &outPos, sizeof(off_t));
+
+	if (transferred == 0 && status != B_OK)
+		return status;
+
+	return transferred;
+}
+
+
 static status_t
 common_close(int fd, bool kernel)
 {
@@ -915,6 +1097,34 @@ _user_writev(int fd, off_t pos, const iovec* userVecs, size_t count)
 }
 
 
+ssize_t
+_user_splice(int inFD, off_t* inOffset, int outFD, off_t* outOffset,
+	size_t length, uint32 flags)
+{
+	if (flags != 0)
+		return B_BAD_VALUE;
+
+	SyscallRestartWrapper<ssize_t> result;
+	result = common_splice(inFD, inOffset, outFD, outOffset, length, false);
+
+	return result;
+}
+
+
+ssize_t
+_user_copy_file_range(int inFD, off_t* inOffset, int outFD, off_t* outOffset,
+	size_t length, uint32 flags)
+{
+	if (flags != 0)
+		return B_BAD_VALUE;
+
+	SyscallRestartWrapper<ssize_t> result;
+	result = common_splice(inFD, inOffset, outFD, outOffset, length, true);
+
+	return result;
+}
+
+
 off_t
 _user_seek(int fd, off_t pos, int seekType)
 {
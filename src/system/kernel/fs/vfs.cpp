@@ -4676,6 +4676,33 @@ vfs_can_page(struct vnode* vnode, void* cookie)
 }
 
 
+/*!	Called by the VM before the file \a fd is mapped shared, and the mapping
+	may be written to. The file system gets the chance to prepare a file
+	whose pages it could not write back as it is, or to refuse the mapping.
+	Since file systems fail unknown ioctls in all kinds of ways, the result
+	of the B_PREPARE_WRITABLE_MAPPING ioctl is passed back in its buffer.
+*/
+extern "C" status_t
+vfs_prepare_writable_mapping(int fd, bool kernel)
+{
+	struct vnode* vnode;
+	FileDescriptorPutter descriptor(get_fd_and_vnode(fd, &vnode, kernel));
+	if (!descriptor.IsSet())
+		return B_FILE_ERROR;
+
+	if (!S_ISREG(vnode->Type()) || !HAS_FS_CALL(vnode, ioctl))
+		return B_OK;
+
+	status_t result = B_OK;
+	if (FS_CALL(vnode, ioctl, descriptor->cookie, B_PREPARE_WRITABLE_MAPPING,
+			&result, sizeof(result)) != B_OK) {
+		return B_OK;
+	}
+
+	return result;
+}
+
+
 extern "C" status_t
 vfs_read_pages(struct vnode* vnode, void* cookie, off_t pos,
 	const generic_io_vec* vecs, size_t count, uint32 flags,
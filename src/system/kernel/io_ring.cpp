@@ -0,0 +1,802 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Submission/completion rings for batched asynchronous syscalls.
+
+	A ring is a memory area shared between the kernel and a team, holding a
+	queue of submitted operations and a queue of their results. A single
+	_user_io_ring_enter() call consumes any number of submissions. Operations
+	that usually don't block (I/O on regular files and block devices, open,
+	close, fsync) are executed right away in the calling thread; socket
+	operations are first tried without blocking. Everything that would block
+	is handed to a small pool of kernel threads that run in the team of the
+	ring, so that they can use its file descriptors and address space like
+	the submitting thread would. Timeouts are kernel timers, and don't
+	occupy a thread.
+	The operations themselves go through the regular syscall implementations,
+	i.e. the VFS, file cache and IORequest paths for files, and the
+	net_socket paths for sockets.
+*/
+
+
+#include <io_ring.h>
+
+#include <algorithm>
+#include <new>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <AutoDeleter.h>
+#include <AutoDeleterDrivers.h>
+#include <condition_variable.h>
+#include <DPC.h>
+#include <fs/fd.h>
+#include <kernel.h>
+#include <ksignal.h>
+#include <lock.h>
+#include <Referenceable.h>
+#include <syscall_restart.h>
+#include <team.h>
+#include <thread.h>
+#include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
+#include <vfs.h>
+#include <vm/vm.h>
+
+
+//#define TRACE_IO_RING
+#ifdef TRACE_IO_RING
+#	define TRACE(x...) dprintf("io_ring: " x)
+#else
+#	define TRACE(x...) ;
+#endif
+
+
+#define IO_RING_MAX_WORKERS		16
+
+
+class IORing : public BReferenceable {
+public:
+								IORing(team_id team);
+	virtual						~IORing();
+
+			status_t			Init(uint32 entries);
+			area_id				Area() const	{ return fArea; }
+
+			void				Close();
+
+			int32				Submit(uint32 count);
+			status_t			WaitForCompletions(uint32 count,
+									uint32 flags, bigtime_t timeout);
+
+private:
+			struct Request : DoublyLinkedListLinkImpl<Request> {
+				io_ring_sqe		entry;
+			};
+			typedef DoublyLinkedList<Request> RequestList;
+
+			struct Timeout : DPCCallback {
+				IORing*			ring;
+				timer			event;
+				uint64			user_data;
+				DoublyLinkedListLink<Timeout> link;
+
+				virtual	void	DoDPC(DPCQueue* queue);
+			};
+			typedef DoublyLinkedList<Timeout,
+				DoublyLinkedListMemberGetLink<Timeout, &Timeout::link> >
+					TimeoutList;
+
+			uint32				_CompletionSpace();
+			void				_Complete(uint64 userData, int64 result,
+									bool async);
+
+			int64				_Perform(const io_ring_sqe& entry);
+			bool				_TryInline(const io_ring_sqe& entry,
+									int64& result);
+			status_t			_Queue(const io_ring_sqe& entry);
+
+			status_t			_AddTimeout(const io_ring_sqe& entry);
+	static	int32				_TimeoutExpired(timer* event);
+			void				_TimeoutDone(Timeout* timeout,
+									status_t status);
+
+	static	status_t			_WorkerEntry(void* data);
+			void				_Worker();
+
+private:
+			mutex				fLock;
+				// protects the completion queue and the workers
+			mutex				fSubmitLock;
+			ConditionVariable	fCompletionCondition;
+			ConditionVariable	fWorkCondition;
+
+			team_id				fTeam;
+			area_id				fArea;
+			io_ring_header*		fHeader;
+			io_ring_sqe*		fSubmissions;
+			io_ring_cqe*		fCompletions;
+			uint32				fSubmissionEntries;
+			uint32				fSubmissionMask;
+			uint32				fCompletionEntries;
+			uint32				fCompletionMask;
+				// kept here, since userland can write to the header
+			uint32				fSubmissionHead;
+			uint32				fCompletionTail;
+
+			RequestList			fQueue;
+			TimeoutList			fTimeouts;
+			uint32				fInFlight;
+			int32				fWorkerCount;
+			int32				fIdleWorkers;
+			bool				fClosing;
+};
+
+
+static uint32
+round_up_to_power_of_two(uint32 value)
+{
+	uint32 result = 1;
+	while (result < value)
+		result <<= 1;
+	return result;
+}
+
+
+static bool
+kill_pending()
+{
+	return (thread_get_current_thread()->AllPendingSignals()
+		& KILL_SIGNALS) != 0;
+}
+
+
+/*!	Returns whether \a fd refers to a regular file or a block device, i.e.
+	whether reading or writing it only ever waits for the disk.
+*/
+static bool
+is_storage_fd(int fd)
+{
+	file_descriptor* descriptor = get_fd(get_current_io_context(false), fd);
+	if (descriptor == NULL)
+		return false;
+	FileDescriptorPutter descriptorPutter(descriptor);
+
+	struct stat stat;
+	if (!fd_is_file(descriptor) || descriptor->ops->fd_read_stat == NULL
+		|| descriptor->ops->fd_read_stat(descriptor, &stat) != B_OK) {
+		return false;
+	}
+
+	return S_ISREG(stat.st_mode) || S_ISBLK(stat.st_mode);
+}
+
+
+IORing::IORing(team_id team)
+	:
+	fTeam(team),
+	fArea(-1),
+	fHeader(NULL),
+	fSubmissions(NULL),
+	fCompletions(NULL),
+	fSubmissionEntries(0),
+	fSubmissionMask(0),
+	fCompletionEntries(0),
+	fCompletionMask(0),
+	fSubmissionHead(0),
+	fCompletionTail(0),
+	fInFlight(0),
+	fWorkerCount(0),
+	fIdleWorkers(0),
+	fClosing(false)
+{
+	mutex_init(&fLock, "io ring");
+	mutex_init(&fSubmitLock, "io ring submit");
+	fCompletionCondition.Init(this, "io ring completion");
+	fWorkCondition.Init(this, "io ring work");
+}
+
+
+IORing::~IORing()
+{
+	while (Request* request = fQueue.RemoveHead())
+		delete request;
+
+	if (fArea >= 0)
+		delete_area(fArea);
+
+	mutex_destroy(&fLock);
+	mutex_destroy(&fSubmitLock);
+}
+
+
+status_t
+IORing::Init(uint32 entries)
+{
+	if (entries == 0 || entries > IO_RING_MAX_ENTRIES)
+		return B_BAD_VALUE;
+
+	uint32 submissionEntries = round_up_to_power_of_two(entries);
+	uint32 completionEntries = submissionEntries * 2;
+
+	size_t submissionOffset = sizeof(io_ring_header);
+	size_t completionOffset = submissionOffset
+		+ submissionEntries * sizeof(io_ring_sqe);
+	size_t size = ROUNDUP(completionOffset
+		+ completionEntries * sizeof(io_ring_cqe), B_PAGE_SIZE);
+
+	void* address;
+	fArea = create_area("io ring", &address, B_ANY_KERNEL_ADDRESS, size,
+		B_FULL_LOCK, B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
+	if (fArea < 0)
+		return fArea;
+
+	memset(address, 0, size);
+
+	fSubmissionEntries = submissionEntries;
+	fSubmissionMask = submissionEntries - 1;
+	fCompletionEntries = completionEntries;
+	fCompletionMask = completionEntries - 1;
+
+	fHeader = (io_ring_header*)address;
+	fHeader->sq_entries = submissionEntries;
+	fHeader->cq_entries = completionEntries;
+	fHeader->sq_offset = submissionOffset;
+	fHeader->cq_offset = completionOffset;
+
+	fSubmissions = (io_ring_sqe*)((uint8*)address + submissionOffset);
+	fCompletions = (io_ring_cqe*)((uint8*)address + completionOffset);
+	return B_OK;
+}
+
+
+void
+IORing::Close()
+{
+	MutexLocker locker(fLock);
+	fClosing = true;
+	fWorkCondition.NotifyAll();
+	fCompletionCondition.NotifyAll(B_FILE_ERROR);
+
+	// Timers that already fired have queued their DPC, which will complete
+	// them; all others are canceled here.
+	TimeoutList canceled;
+	TimeoutList::Iterator iterator = fTimeouts.GetIterator();
+	while (Timeout* timeout = iterator.Next()) {
+		if (!cancel_timer(&timeout->event)) {
+			iterator.Remove();
+			canceled.Add(timeout);
+		}
+	}
+
+	locker.Unlock();
+
+	while (Timeout* timeout = canceled.RemoveHead())
+		_TimeoutDone(timeout, B_CANCELED);
+}
+
+
+/*!	Consumes up to \a count entries of the submission queue. Submission stops
+	early when the completion queue could otherwise overflow.
+	Returns the number of consumed entries.
+*/
+int32
+IORing::Submit(uint32 count)
+{
+	MutexLocker submitLocker(fSubmitLock);
+
+	uint32 tail = atomic_get((int32*)&fHeader->sq_tail);
+	uint32 available = tail - fSubmissionHead;
+	if (available > fSubmissionEntries)
+		return B_BAD_DATA;
+
+	count = std::min(count, available);
+
+	uint32 submitted = 0;
+	for (; submitted < count; submitted++) {
+		if (_CompletionSpace() == 0)
+			break;
+
+		// userland may still write to the entry, so work with a copy
+		io_ring_sqe entry = fSubmissions[fSubmissionHead & fSubmissionMask];
+		fSubmissionHead++;
+		atomic_set((int32*)&fHeader->sq_head, fSubmissionHead);
+
+		int64 result;
+		if (entry.op == IO_RING_OP_TIMEOUT) {
+			status_t status = _AddTimeout(entry);
+			if (status != B_OK)
+				_Complete(entry.user_data, status, false);
+		} else if (_TryInline(entry, result))
+			_Complete(entry.user_data, result, false);
+		else {
+			status_t status = _Queue(entry);
+			if (status != B_OK)
+				_Complete(entry.user_data, status, false);
+		}
+	}
+
+	return submitted;
+}
+
+
+status_t
+IORing::WaitForCompletions(uint32 count, uint32 flags, bigtime_t timeout)
+{
+	MutexLocker locker(fLock);
+
+	while (!fClosing) {
+		uint32 ready = fCompletionTail
+			- (uint32)atomic_get((int32*)&fHeader->cq_head);
+		if (ready >= count || ready + fInFlight < count) {
+			// either we're done, or we would wait forever
+			return B_OK;
+		}
+
+		ConditionVariableEntry entry;
+		fCompletionCondition.Add(&entry);
+		locker.Unlock();
+
+		status_t status = entry.Wait(flags | B_CAN_INTERRUPT, timeout);
+		if (status != B_OK)
+			return status;
+
+		locker.Lock();
+	}
+
+	return B_FILE_ERROR;
+}
+
+
+/*!	Returns how many more completions can be queued, taking into account
+	the ones still in flight. The ring lock must not be held.
+*/
+uint32
+IORing::_CompletionSpace()
+{
+	MutexLocker locker(fLock);
+
+	uint32 used = fCompletionTail
+		- (uint32)atomic_get((int32*)&fHeader->cq_head) + fInFlight;
+	if (used >= fCompletionEntries)
+		return 0;
+
+	return fCompletionEntries - used;
+}
+
+
+void
+IORing::_Complete(uint64 userData, int64 result, bool async)
+{
+	MutexLocker locker(fLock);
+
+	if (async)
+		fInFlight--;
+
+	uint32 head = atomic_get((int32*)&fHeader->cq_head);
+	if (fCompletionTail - head >= fCompletionEntries) {
+		// userland moved the head beyond what it has been given
+		atomic_add((int32*)&fHeader->dropped, 1);
+		return;
+	}
+
+	io_ring_cqe& completion
+		= fCompletions[fCompletionTail & fCompletionMask];
+	completion.user_data = userData;
+	completion.result = result;
+
+	fCompletionTail++;
+	atomic_set((int32*)&fHeader->cq_tail, fCompletionTail);
+
+	fCompletionCondition.NotifyAll();
+}
+
+
+int64
+IORing::_Perform(const io_ring_sqe& entry)
+{
+	void* address = (void*)(addr_t)entry.address;
+
+	switch (entry.op) {
+		case IO_RING_OP_NOP:
+			return B_OK;
+
+		case IO_RING_OP_READ:
+			return _user_read(entry.fd, entry.offset, address, entry.length);
+		case IO_RING_OP_WRITE:
+			return _user_write(entry.fd, entry.offset, address, entry.length);
+		case IO_RING_OP_READV:
+			return _user_readv(entry.fd, entry.offset, (const iovec*)address,
+				entry.length);
+		case IO_RING_OP_WRITEV:
+			return _user_writev(entry.fd, entry.offset, (const iovec*)address,
+				entry.length);
+
+		case IO_RING_OP_FSYNC:
+			return _user_fsync(entry.fd,
+				(entry.op_flags & IO_RING_FSYNC_DATASYNC) != 0);
+		case IO_RING_OP_OPENAT:
+			return _user_open(entry.fd, (const char*)address, entry.op_flags,
+				entry.length);
+		case IO_RING_OP_CLOSE:
+			return _user_close(entry.fd);
+
+		case IO_RING_OP_ACCEPT:
+			return _user_accept(entry.fd, (sockaddr*)address,
+				(socklen_t*)(addr_t)entry.address2, entry.op_flags);
+		case IO_RING_OP_CONNECT:
+			return _user_connect(entry.fd, (const sockaddr*)address,
+				entry.length);
+		case IO_RING_OP_SEND:
+			return _user_send(entry.fd, address, entry.length,
+				entry.op_flags);
+		case IO_RING_OP_RECV:
+			return _user_recv(entry.fd, address, entry.length,
+				entry.op_flags);
+	}
+
+	return B_BAD_VALUE;
+}
+
+
+/*!	Executes \a entry in the calling thread, if that is not likely to block
+	for long. Returns \c false if the entry has to be given to a worker.
+*/
+bool
+IORing::_TryInline(const io_ring_sqe& entry, int64& result)
+{
+	if ((entry.flags & IO_RING_SQE_ASYNC) != 0)
+		return false;
+
+	switch (entry.op) {
+		case IO_RING_OP_ACCEPT:
+		case IO_RING_OP_CONNECT:
+			return false;
+
+		case IO_RING_OP_READ:
+		case IO_RING_OP_WRITE:
+		case IO_RING_OP_READV:
+		case IO_RING_OP_WRITEV:
+			// pipes, sockets, and character devices may wait for a peer,
+			// and would hold up the submission queue meanwhile
+			if (!is_storage_fd(entry.fd))
+				return false;
+			break;
+
+		case IO_RING_OP_SEND:
+		case IO_RING_OP_RECV:
+		{
+			if ((entry.op_flags & MSG_DONTWAIT) != 0)
+				break;
+
+			io_ring_sqe nonBlocking = entry;
+			nonBlocking.op_flags |= MSG_DONTWAIT;
+			result = _Perform(nonBlocking);
+			return result != B_WOULD_BLOCK;
+		}
+	}
+
+	result = _Perform(entry);
+	return true;
+}
+
+
+status_t
+IORing::_Queue(const io_ring_sqe& entry)
+{
+	Request* request = new(std::nothrow) Request;
+	if (request == NULL)
+		return B_NO_MEMORY;
+	request->entry = entry;
+
+	MutexLocker locker(fLock);
+	if (fClosing) {
+		delete request;
+		return B_FILE_ERROR;
+	}
+
+	fQueue.Add(request);
+	fInFlight++;
+
+	if (fIdleWorkers > 0) {
+		fWorkCondition.NotifyOne();
+		return B_OK;
+	}
+
+	if (fWorkerCount < IO_RING_MAX_WORKERS) {
+		// all workers are busy, start another one
+		AcquireReference();
+		thread_id thread = spawn_kernel_thread_etc(&_WorkerEntry,
+			"io ring worker", B_NORMAL_PRIORITY, this, fTeam);
+		if (thread < 0) {
+			ReleaseReference();
+			if (fWorkerCount == 0) {
+				fQueue.Remove(request);
+				fInFlight--;
+				delete request;
+				return thread;
+			}
+		} else {
+			fWorkerCount++;
+			resume_thread(thread);
+		}
+	}
+
+	return B_OK;
+}
+
+
+/*!	Starts a timer that completes \a entry with \c B_TIMED_OUT once its
+	timeout has passed.
+*/
+status_t
+IORing::_AddTimeout(const io_ring_sqe& entry)
+{
+	Timeout* timeout = new(std::nothrow) Timeout;
+	if (timeout == NULL)
+		return B_NO_MEMORY;
+	timeout->ring = this;
+	timeout->user_data = entry.user_data;
+	timeout->event.user_data = timeout;
+
+	MutexLocker locker(fLock);
+	if (fClosing) {
+		delete timeout;
+		return B_FILE_ERROR;
+	}
+
+	AcquireReference();
+	fTimeouts.Add(timeout);
+	fInFlight++;
+
+	add_timer(&timeout->event, &_TimeoutExpired,
+		std::max((bigtime_t)entry.offset, (bigtime_t)0),
+		B_ONE_SHOT_RELATIVE_TIMER);
+	return B_OK;
+}
+
+
+/*static*/ int32
+IORing::_TimeoutExpired(timer* event)
+{
+	// we're in interrupt context, the ring has to be locked for completing
+	Timeout* timeout = (Timeout*)event->user_data;
+	DPCQueue::DefaultQueue(B_NORMAL_PRIORITY)->Add(timeout);
+	return B_HANDLED_INTERRUPT;
+}
+
+
+void
+IORing::Timeout::DoDPC(DPCQueue* queue)
+{
+	MutexLocker locker(ring->fLock);
+	ring->fTimeouts.Remove(this);
+	locker.Unlock();
+
+	ring->_TimeoutDone(this, B_TIMED_OUT);
+}
+
+
+/*!	Completes \a timeout, which must no longer be in the timeout list, and
+	deletes it.
+*/
+void
+IORing::_TimeoutDone(Timeout* timeout, status_t status)
+{
+	_Complete(timeout->user_data, status, true);
+	delete timeout;
+
+	ReleaseReference();
+}
+
+
+/*static*/ status_t
+IORing::_WorkerEntry(void* data)
+{
+	IORing* ring = (IORing*)data;
+	ring->_Worker();
+	ring->ReleaseReference();
+	return B_OK;
+}
+
+
+void
+IORing::_Worker()
+{
+	MutexLocker locker(fLock);
+
+	while (!fClosing) {
+		Request* request = fQueue.RemoveHead();
+		if (request == NULL) {
+			ConditionVariableEntry entry;
+			fWorkCondition.Add(&entry);
+			fIdleWorkers++;
+			locker.Unlock();
+
+			status_t status = entry.Wait(B_CAN_INTERRUPT);
+
+			locker.Lock();
+			fIdleWorkers--;
+
+			if (status == B_INTERRUPTED && kill_pending())
+				break;
+			continue;
+		}
+
+		locker.Unlock();
+
+		TRACE("worker %" B_PRId32 ": op %u on fd %" B_PRId32 "\n",
+			find_thread(NULL), request->entry.op, request->entry.fd);
+
+		int64 result = _Perform(request->entry);
+		_Complete(request->entry.user_data, result, true);
+		delete request;
+
+		locker.Lock();
+
+		// the team is going away
+		if (kill_pending())
+			break;
+	}
+
+	fWorkerCount--;
+
+	if (fWorkerCount == 0) {
+		// nobody is going to execute the remaining requests
+		while (Request* request = fQueue.RemoveHead()) {
+			locker.Unlock();
+			_Complete(request->entry.user_data, B_CANCELED, true);
+			delete request;
+			locker.Lock();
+		}
+	}
+}
+
+
+//	#pragma mark - file descriptor ops
+
+
+static status_t
+io_ring_close(file_descriptor* descriptor)
+{
+	IORing* ring = (IORing*)descriptor->cookie;
+	ring->Close();
+	return B_OK;
+}
+
+
+static void
+io_ring_free(file_descriptor* descriptor)
+{
+	IORing* ring = (IORing*)descriptor->cookie;
+	ring->ReleaseReference();
+}
+
+
+static struct fd_ops sIORingFDOps = {
+	&io_ring_close,
+	&io_ring_free
+};
+
+
+static status_t
+get_ring_descriptor(int fd, file_descriptor*& descriptor)
+{
+	if (fd < 0)
+		return B_FILE_ERROR;
+
+	descriptor = get_fd(get_current_io_context(false), fd);
+	if (descriptor == NULL)
+		return B_FILE_ERROR;
+
+	if (descriptor->ops != &sIORingFDOps) {
+		put_fd(descriptor);
+		return B_BAD_VALUE;
+	}
+
+	return B_OK;
+}
+
+
+//	#pragma mark - User syscalls
+
+
+int
+_user_io_ring_create(uint32 entries, uint32 flags, io_ring_params* userParams)
+{
+	if (flags != 0)
+		return B_BAD_VALUE;
+	if (userParams == NULL || !IS_USER_ADDRESS(userParams))
+		return B_BAD_ADDRESS;
+
+	team_id team = team_get_current_team_id();
+
+	IORing* ring = new(std::nothrow) IORing(team);
+	if (ring == NULL)
+		return B_NO_MEMORY;
+	BReference<IORing> ringReference(ring, true);
+
+	status_t status = ring->Init(entries);
+	if (status != B_OK)
+		return status;
+
+	io_ring_params params;
+	params.address = NULL;
+	params.area = vm_clone_area(team, "io ring", &params.address,
+		B_ANY_ADDRESS, B_READ_AREA | B_WRITE_AREA, REGION_NO_PRIVATE_MAP,
+		ring->Area(), true);
+	if (params.area < 0)
+		return params.area;
+
+	if (user_memcpy(userParams, &params, sizeof(params)) != B_OK) {
+		vm_delete_area(team, params.area, true);
+		return B_BAD_ADDRESS;
+	}
+
+	file_descriptor* descriptor = alloc_fd();
+	if (descriptor == NULL) {
+		vm_delete_area(team, params.area, true);
+		return B_NO_MEMORY;
+	}
+
+	descriptor->ops = &sIORingFDOps;
+	descriptor->cookie = ring;
+	descriptor->open_mode = O_RDWR;
+
+	io_context* context = get_current_io_context(false);
+	int fd = new_fd(context, descriptor);
+	if (fd < 0) {
+		free(descriptor);
+		vm_delete_area(team, params.area, true);
+		return fd;
+	}
+
+	// The workers belong to this team, so the ring must not be shared with
+	// other teams.
+	rw_lock_write_lock(&context->lock);
+	fd_set_close_on_exec(context, fd, true);
+	fd_set_close_on_fork(context, fd, true);
+	rw_lock_write_unlock(&context->lock);
+
+	ringReference.Detach();
+	return fd;
+}
+
+
+int32
+_user_io_ring_enter(int ringFD, uint32 submit, uint32 wait, uint32 flags,
+	bigtime_t timeout)
+{
+	syscall_restart_handle_timeout_pre(flags, timeout);
+
+	if ((flags & (B_RELATIVE_TIMEOUT | B_ABSOLUTE_TIMEOUT)) == 0)
+		timeout = B_INFINITE_TIMEOUT;
+
+	file_descriptor* descriptor;
+	status_t status = get_ring_descriptor(ringFD, descriptor);
+	if (status != B_OK)
+		return status;
+	FileDescriptorPutter _(descriptor);
+
+	IORing* ring = (IORing*)descriptor->cookie;
+
+	int32 submitted = 0;
+	if (submit > 0) {
+		submitted = ring->Submit(submit);
+		if (submitted < 0)
+			return submitted;
+	}
+
+	if ((flags & IO_RING_ENTER_WAIT) != 0 && wait > 0) {
+		status = ring->WaitForCompletions(wait,
+			flags & (B_RELATIVE_TIMEOUT | B_ABSOLUTE_TIMEOUT), timeout);
+		if (status != B_OK && submitted == 0)
+			return syscall_restart_handle_timeout_post(status, timeout);
+	}
+
+	return submitted;
+}
@@ -10,140 +10,366 @@
 #include <user_mutex.h>
 #include <user_mutex_defs.h>
 
-#include <condition_variable.h>
+#include <errno.h>
+
+#include <algorithm>
+
 #include <kernel.h>
+#include <kscheduler.h>
 #include <lock.h>
 #include <smp.h>
 #include <syscall_restart.h>
 #include <util/AutoLock.h>
+#include <util/DoublyLinkedList.h>
 #include <util/ThreadAutoLock.h>
-#include <util/OpenHashTable.h>
+#include <util/atomic.h>
 #include <vm/vm.h>
 #include <vm/VMArea.h>
 #include <arch/generic/user_memory.h>
 
 
-/*! One UserMutexEntry corresponds to one mutex address.
- *
- * The mutex's "waiting" state is controlled by the rw_lock: a waiter acquires
- * a "read" lock before initiating a wait, and an unblocker acquires a "write"
- * lock. That way, unblockers can be sure that no waiters will start waiting
- * during unblock, and they can thus safely (without races) unset WAITING.
- */
-struct UserMutexEntry {
-	generic_addr_t		address;
-	UserMutexEntry*		hash_next;
-	int32				ref_count;
-
-	rw_lock				lock;
-	ConditionVariable	condition;
+/*!	A user_mutex_context only serves to tell apart equal addresses in
+	different address spaces: waiters are keyed by context and address.
+	Mutexes in shared memory use a global context and their physical address.
+*/
+struct user_mutex_context {
+	team_id		team;
 };
 
-struct UserMutexHashDefinition {
-	typedef generic_addr_t	KeyType;
-	typedef UserMutexEntry	ValueType;
+struct UserMutexKey {
+	struct user_mutex_context*	context;
+	generic_addr_t				address;
 
-	size_t HashKey(generic_addr_t key) const
+	bool operator==(const UserMutexKey& other) const
 	{
-		return key >> 2;
+		return context == other.context && address == other.address;
 	}
+};
 
-	size_t Hash(const UserMutexEntry* value) const
-	{
-		return HashKey(value->address);
-	}
+struct UserMutexBucket;
 
-	bool Compare(generic_addr_t key, const UserMutexEntry* value) const
-	{
-		return value->address == key;
-	}
+/*!	A thread waiting on a user mutex or semaphore.
 
-	UserMutexEntry*& GetLink(UserMutexEntry* value) const
+	Waiters are queued in the bucket their key hashes to, and are only ever
+	modified with that bucket locked. An unblocker dequeues the waiter, sets
+	its status, and unblocks the thread, if it already called
+	thread_prepare_to_block(). A waiter that isn't blocked yet will find
+	itself dequeued once it locks its bucket again.
+*/
+struct UserMutexWaiter : DoublyLinkedListLinkImpl<UserMutexWaiter> {
+	UserMutexWaiter(const UserMutexKey& key)
+		:
+		thread(thread_get_current_thread()),
+		key(key),
+		bucket(NULL),
+		status(B_OK),
+		blocked(false),
+		requeued(false),
+		pi_owner(-1)
 	{
-		return value->hash_next;
 	}
+
+	Thread*				thread;
+	UserMutexKey		key;
+	UserMutexBucket*	bucket;
+		// the bucket the waiter is queued in, NULL once it has been dequeued
+	status_t			status;
+	bool				blocked;
+	bool				requeued;
+		// the waiter has been moved over from another mutex, and has to be
+		// woken without a hand-off
+	thread_id			pi_owner;
+		// the owner of the priority inheritance mutex, as known to the kernel
 };
 
-typedef BOpenHashTable<UserMutexHashDefinition> UserMutexTable;
+typedef DoublyLinkedList<UserMutexWaiter> UserMutexWaiterList;
 
+struct UserMutexBucket {
+	spinlock			lock;
+	UserMutexWaiterList	waiters;
+} CACHE_LINE_ALIGN;
 
-struct user_mutex_context {
-	UserMutexTable table;
-	rw_lock lock;
-};
+
+static const uint32 kUserMutexBucketCount = 1024;
+
+static UserMutexBucket sUserMutexBuckets[kUserMutexBucketCount];
 static user_mutex_context sSharedUserMutexContext;
-static const char* kUserMutexEntryType = "umtx entry";
+
+static mutex sUserMutexPILock
+	= MUTEX_INITIALIZER("user mutex priority inheritance");
+	// serializes all operations on priority inheritance mutexes, and
+	// protects Thread::user_mutex_pi
 
 
 // #pragma mark - user atomics
 
 
-static int32
-user_atomic_or(int32* value, int32 orValue, bool isWired)
+/*!	The user atomics return \c B_BAD_ADDRESS if \a value could not be
+	accessed, and otherwise store its previous value in \a _oldValue, if
+	given. Wired values never fault.
+*/
+static status_t
+user_atomic_or(int32* value, int32 orValue, bool isWired,
+	int32* _oldValue = NULL)
 {
-	int32 result;
+	int32 oldValue;
 	if (isWired) {
 		arch_cpu_enable_user_access();
-		result = atomic_or(value, orValue);
+		oldValue = atomic_or(value, orValue);
 		arch_cpu_disable_user_access();
-		return result;
+	} else if (!user_access([=, &oldValue] {
+			oldValue = atomic_or(value, orValue);
+		})) {
+		return B_BAD_ADDRESS;
 	}
 
-	return user_access([=, &result] {
-		result = atomic_or(value, orValue);
-	}) ? result : INT32_MIN;
+	if (_oldValue != NULL)
+		*_oldValue = oldValue;
+	return B_OK;
 }
 
 
-static int32
-user_atomic_and(int32* value, int32 andValue, bool isWired)
+static status_t
+user_atomic_and(int32* value, int32 andValue, bool isWired,
+	int32* _oldValue = NULL)
 {
-	int32 result;
+	int32 oldValue;
 	if (isWired) {
 		arch_cpu_enable_user_access();
-		result = atomic_and(value, andValue);
+		oldValue = atomic_and(value, andValue);
 		arch_cpu_disable_user_access();
-		return result;
+	} else if (!user_access([=, &oldValue] {
+			oldValue = atomic_and(value, andValue);
+		})) {
+		return B_BAD_ADDRESS;
 	}
 
-	return user_access([=, &result] {
-		result = atomic_and(value, andValue);
-	}) ? result : INT32_MIN;
+	if (_oldValue != NULL)
+		*_oldValue = oldValue;
+	return B_OK;
 }
 
 
-static int32
-user_atomic_get(int32* value, bool isWired)
+static status_t
+user_atomic_get(int32* value, bool isWired, int32* _value)
 {
-	int32 result;
 	if (isWired) {
 		arch_cpu_enable_user_access();
-		result = atomic_get(value);
+		*_value = atomic_get(value);
 		arch_cpu_disable_user_access();
-		return result;
+		return B_OK;
 	}
 
-	return user_access([=, &result] {
-		result = atomic_get(value);
-	}) ? result : INT32_MIN;
+	int32 result;
+	if (!user_access([=, &result] {
+			result = atomic_get(value);
+		})) {
+		return B_BAD_ADDRESS;
+	}
+
+	*_value = result;
+	return B_OK;
 }
 
 
-static int32
+static status_t
 user_atomic_test_and_set(int32* value, int32 newValue, int32 testAgainst,
-	bool isWired)
+	bool isWired, int32* _oldValue = NULL)
 {
-	int32 result;
+	int32 oldValue;
 	if (isWired) {
 		arch_cpu_enable_user_access();
-		result = atomic_test_and_set(value, newValue, testAgainst);
+		oldValue = atomic_test_and_set(value, newValue, testAgainst);
 		arch_cpu_disable_user_access();
-		return result;
+	} else if (!user_access([=, &oldValue] {
+			oldValue = atomic_test_and_set(value, newValue, testAgainst);
+		})) {
+		return B_BAD_ADDRESS;
 	}
 
+	if (_oldValue != NULL)
+		*_oldValue = oldValue;
+	return B_OK;
+}
+
+
+/*!	Makes sure the page \a value lives in is mapped writable.
+
+	The user atomics are called with a bucket spinlock held, so a page fault
+	cannot be resolved but lets them fail with \c B_BAD_ADDRESS instead. In that
+	case, the bucket is unlocked, the page is faulted in here, and the
+	operation is retried.
+*/
+static status_t
+user_mutex_fault_in(int32* value)
+{
+	int32 result;
 	return user_access([=, &result] {
-		result = atomic_test_and_set(value, newValue, testAgainst);
-	}) ? result : INT32_MIN;
+		result = atomic_or(value, 0);
+	}) ? B_OK : B_BAD_ADDRESS;
+}
+
+
+static status_t
+user_mutex_fault_in(int32* value, InterruptsSpinLocker& locker)
+{
+	locker.Unlock();
+	status_t status = user_mutex_fault_in(value);
+	locker.Lock();
+
+	return status;
+}
+
+
+// #pragma mark - wait queues
+
+
+static inline UserMutexBucket*
+user_mutex_bucket(const UserMutexKey& key)
+{
+	uint64 hash = ((uint64)key.address >> 2) ^ ((addr_t)key.context >> 4);
+	hash *= 0x9e3779b97f4a7c15ULL;
+	return &sUserMutexBuckets[(hash >> 32) % kUserMutexBucketCount];
+}
+
+
+static inline void
+user_mutex_lock_buckets(UserMutexBucket* first, UserMutexBucket* second)
+{
+	if (first > second)
+		std::swap(first, second);
+
+	acquire_spinlock(&first->lock);
+	if (second != first)
+		acquire_spinlock(&second->lock);
+}
+
+
+static inline void
+user_mutex_unlock_buckets(UserMutexBucket* first, UserMutexBucket* second)
+{
+	if (second != first)
+		release_spinlock(&second->lock);
+	release_spinlock(&first->lock);
+}
+
+
+static UserMutexWaiter*
+user_mutex_next_waiter(UserMutexBucket* bucket, const UserMutexKey& key,
+	UserMutexWaiter* waiter = NULL)
+{
+	waiter = waiter == NULL
+		? bucket->waiters.Head() : bucket->waiters.GetNext(waiter);
+	while (waiter != NULL && !(waiter->key == key))
+		waiter = bucket->waiters.GetNext(waiter);
+
+	return waiter;
+}
+
+
+static inline bool
+user_mutex_has_waiters(UserMutexBucket* bucket, const UserMutexKey& key)
+{
+	return user_mutex_next_waiter(bucket, key) != NULL;
+}
+
+
+static inline void
+user_mutex_enqueue(UserMutexBucket* bucket, UserMutexWaiter& waiter)
+{
+	bucket->waiters.Add(&waiter);
+	waiter.bucket = bucket;
+}
+
+
+/*!	Dequeues the waiter, and unblocks its thread with \a status.
+	The bucket must be locked. The waiter must not be touched afterwards, as
+	its thread might return from the wait and release it any time.
+*/
+static void
+user_mutex_wake(UserMutexBucket* bucket, UserMutexWaiter* waiter,
+	status_t status)
+{
+	bucket->waiters.Remove(waiter);
+	waiter->status = status;
+	if (waiter->blocked)
+		thread_unblock(waiter->thread, status);
+
+	atomic_pointer_set(&waiter->bucket, (UserMutexBucket*)NULL);
+}
+
+
+/*!	Locks the bucket the waiter is queued in. Returns \c false, if the waiter
+	has been dequeued already.
+*/
+static bool
+user_mutex_lock_waiter_bucket(UserMutexWaiter& waiter,
+	InterruptsSpinLocker& locker)
+{
+	while (true) {
+		UserMutexBucket* bucket = atomic_pointer_get(&waiter.bucket);
+		if (bucket == NULL)
+			return false;
+
+		locker.SetTo(bucket->lock, false);
+		if (waiter.bucket == bucket)
+			return true;
+
+		// the waiter has been requeued or dequeued in the meantime
+		locker.Unlock();
+	}
+}
+
+
+/*!	Removes the waiter from its bucket, if it is still queued. Returns
+	\c true in this case, with the bucket still locked by \a locker.
+	Returns \c false if an unblocker already dequeued the waiter; its status
+	is then the result of the wait.
+*/
+static bool
+user_mutex_dequeue(UserMutexWaiter& waiter, InterruptsSpinLocker& locker)
+{
+	if (!user_mutex_lock_waiter_bucket(waiter, locker))
+		return false;
+
+	waiter.bucket->waiters.Remove(&waiter);
+	waiter.bucket = NULL;
+	return true;
+}
+
+
+/*!	Blocks the current thread on the queued waiter, whose bucket must be
+	locked by \a locker. The bucket is unlocked when this function returns.
+*/
+static status_t
+user_mutex_block(UserMutexWaiter& waiter, uint32 flags, bigtime_t timeout,
+	InterruptsSpinLocker& locker)
+{
+	waiter.blocked = true;
+	thread_prepare_to_block(waiter.thread, flags,
+		THREAD_BLOCK_TYPE_OTHER_OBJECT, &waiter);
+	locker.Unlock();
+
+	if ((flags & (B_RELATIVE_TIMEOUT | B_ABSOLUTE_TIMEOUT)) != 0)
+		return thread_block_with_timeout(flags, timeout);
+	return thread_block();
+}
+
+
+/*!	Waits until the waiter is woken up, the timeout occurs, or the wait is
+	interrupted. The waiter must be queued, and its bucket locked by
+	\a locker. If the wait failed, the waiter is dequeued, and its bucket
+	remains locked; otherwise the bucket is unlocked.
+*/
+static status_t
+user_mutex_wait_locked(UserMutexWaiter& waiter, uint32 flags,
+	bigtime_t timeout, InterruptsSpinLocker& locker)
+{
+	status_t error = user_mutex_block(waiter, flags, timeout, locker);
+	if (!user_mutex_dequeue(waiter, locker))
+		return waiter.status;
+
+	return error;
 }
 
 
@@ -168,37 +394,55 @@ dump_user_mutex(int argc, char** argv)
 		return 0;
 	}
 
-	if (thread->wait.type != THREAD_BLOCK_TYPE_CONDITION_VARIABLE) {
-		kprintf("thread is not blocked on cvar (thus not user_mutex)\n");
+	if (thread->state != B_THREAD_WAITING
+		|| thread->wait.type != THREAD_BLOCK_TYPE_OTHER_OBJECT) {
+		kprintf("thread is not blocked on a user_mutex\n");
 		return 0;
 	}
 
-	ConditionVariable* variable = (ConditionVariable*)thread->wait.object;
-	if (variable->ObjectType() != kUserMutexEntryType) {
-		kprintf("thread is not blocked on user_mutex\n");
-		return 0;
+	UserMutexWaiter* waiter = NULL;
+	UserMutexBucket* bucket = NULL;
+	for (uint32 i = 0; i < kUserMutexBucketCount && waiter == NULL; i++) {
+		bucket = &sUserMutexBuckets[i];
+		for (UserMutexWaiterList::Iterator it = bucket->waiters.GetIterator();
+				UserMutexWaiter* candidate = it.Next();) {
+			if (candidate == thread->wait.object) {
+				waiter = candidate;
+				break;
+			}
+		}
 	}
 
-	UserMutexEntry* entry = (UserMutexEntry*)variable->Object();
+	if (waiter == NULL) {
+		kprintf("thread is not blocked on a user_mutex\n");
+		return 0;
+	}
 
-	const bool physical = (sSharedUserMutexContext.table.Lookup(entry->address) == entry);
-	kprintf("user mutex entry %p\n", entry);
-	kprintf("  address:  0x%" B_PRIxPHYSADDR " (%s)\n", entry->address,
+	const bool physical = waiter->key.context == &sSharedUserMutexContext;
+	kprintf("user mutex waiter %p\n", waiter);
+	kprintf("  address:  0x%" B_PRIxPHYSADDR " (%s)\n", waiter->key.address,
 		physical ? "physical" : "virtual");
-	kprintf("  refcount: %" B_PRId32 "\n", entry->ref_count);
-	kprintf("  lock:     %p\n", &entry->lock);
+	kprintf("  bucket:   %p (%" B_PRIuSIZE ")\n", bucket,
+		(size_t)(bucket - sUserMutexBuckets));
+	kprintf("  requeued: %s\n", waiter->requeued ? "yes" : "no");
 
 	int32 mutex = 0;
 	status_t status = B_ERROR;
 	if (!physical) {
-		status = debug_memcpy(thread->team->id, &mutex,
-			(void*)entry->address, sizeof(mutex));
+		status = debug_memcpy(waiter->key.context->team, &mutex,
+			(void*)waiter->key.address, sizeof(mutex));
 	}
 
 	if (status == B_OK)
 		kprintf("  mutex:    0x%" B_PRIx32 "\n", mutex);
 
-	entry->condition.Dump();
+	kprintf("  waiting threads:");
+	for (UserMutexWaiterList::Iterator it = bucket->waiters.GetIterator();
+			UserMutexWaiter* other = it.Next();) {
+		if (other->key == waiter->key)
+			kprintf(" %" B_PRId32, other->thread->id);
+	}
+	kprintf("\n");
 
 	return 0;
 }
@@ -207,9 +451,9 @@ dump_user_mutex(int argc, char** argv)
 void
 user_mutex_init()
 {
-	sSharedUserMutexContext.lock = RW_LOCK_INITIALIZER("shared user mutex table");
-	if (sSharedUserMutexContext.table.Init() != B_OK)
-		panic("user_mutex_init(): Failed to init table!");
+	for (uint32 i = 0; i < kUserMutexBucketCount; i++)
+		B_INITIALIZE_SPINLOCK(&sUserMutexBuckets[i].lock);
+	sSharedUserMutexContext.team = -1;
 
 	add_debugger_command_etc("user_mutex", &dump_user_mutex,
 		"Dump user-mutex info",
@@ -236,11 +480,7 @@ get_team_user_mutex_context()
 	if (context == NULL)
 		return NULL;
 
-	context->lock = RW_LOCK_INITIALIZER("user mutex table");
-	if (context->table.Init() != B_OK) {
-		delete context;
-		return NULL;
-	}
+	context->team = team->id;
 
 	team->user_mutex_context = context;
 	return context;
@@ -250,347 +490,727 @@ get_team_user_mutex_context()
 void
 delete_user_mutex_context(struct user_mutex_context* context)
 {
-	if (context == NULL)
-		return;
-
-	// This should be empty at this point in team destruction.
-	ASSERT(context->table.IsEmpty());
+	// All of the team's threads are gone at this point in team destruction,
+	// and with them any waiters keyed by this context.
 	delete context;
 }
 
 
-static UserMutexEntry*
-get_user_mutex_entry(struct user_mutex_context* context,
-	generic_addr_t address, bool noInsert = false, bool alreadyLocked = false)
-{
-	ReadLocker tableReadLocker;
-	if (!alreadyLocked)
-		tableReadLocker.SetTo(context->lock, false);
+// #pragma mark - user mutexes
 
-	UserMutexEntry* entry = context->table.Lookup(address);
-	if (entry != NULL) {
-		atomic_add(&entry->ref_count, 1);
-		return entry;
-	} else if (noInsert)
-		return entry;
 
-	tableReadLocker.Unlock();
-	WriteLocker tableWriteLocker(context->lock);
+struct UserMutexContextFetcher {
+	UserMutexContextFetcher(int32* mutex, uint32 flags)
+		:
+		fInitStatus(B_OK),
+		fShared((flags & B_USER_MUTEX_SHARED) != 0),
+		fAddress(0)
+	{
+		if (!fShared) {
+			fContext = get_team_user_mutex_context();
+			if (fContext == NULL) {
+				fInitStatus = B_NO_MEMORY;
+				return;
+			}
 
-	entry = context->table.Lookup(address);
-	if (entry != NULL) {
-		atomic_add(&entry->ref_count, 1);
-		return entry;
-	}
+			fAddress = (addr_t)mutex;
+		} else {
+			fContext = &sSharedUserMutexContext;
 
-	entry = new(std::nothrow) UserMutexEntry;
-	if (entry == NULL)
-		return entry;
+			// wire the page and get the physical address
+			fInitStatus = vm_wire_page(B_CURRENT_TEAM, (addr_t)mutex, true,
+				&fWiringInfo);
+			if (fInitStatus != B_OK)
+				return;
+			fAddress = fWiringInfo.physicalAddress;
+		}
+	}
 
-	entry->address = address;
-	entry->ref_count = 1;
-	rw_lock_init(&entry->lock, "UserMutexEntry lock");
-	entry->condition.Init(entry, kUserMutexEntryType);
+	~UserMutexContextFetcher()
+	{
+		if (fInitStatus != B_OK)
+			return;
 
-	context->table.Insert(entry);
-	return entry;
-}
+		if (fShared)
+			vm_unwire_page(&fWiringInfo);
+	}
 
+	status_t InitCheck() const
+		{ return fInitStatus; }
 
-static void
-put_user_mutex_entry(struct user_mutex_context* context, UserMutexEntry* entry)
-{
-	if (entry == NULL)
-		return;
+	UserMutexKey Key() const
+		{ return { fContext, fAddress }; }
 
-	const generic_addr_t address = entry->address;
-	if (atomic_add(&entry->ref_count, -1) != 1)
-		return;
+	bool IsWired() const
+		{ return fShared; }
 
-	WriteLocker tableWriteLocker(context->lock);
+private:
+	status_t fInitStatus;
+	bool fShared;
+	struct user_mutex_context* fContext;
+	VMPageWiringInfo fWiringInfo;
+	generic_addr_t fAddress;
+};
 
-	// Was it removed & deleted while we were waiting for the lock?
-	if (context->table.Lookup(address) != entry)
-		return;
 
-	// Or did someone else acquire a reference to it?
-	if (atomic_get(&entry->ref_count) > 0)
-		return;
+/*!	Tries to lock the mutex, and marks it as contended if that doesn't work.
+	Returns \c B_OK if the mutex could be locked, \c B_WOULD_BLOCK if the
+	caller needs to wait, or \c B_BAD_ADDRESS in case of a page fault.
+*/
+static status_t
+user_mutex_prepare_to_lock(UserMutexBucket* bucket, const UserMutexKey& key,
+	int32* mutex, bool isWired)
+{
+	int32 oldValue;
+	if (user_atomic_or(mutex, B_USER_MUTEX_LOCKED | B_USER_MUTEX_WAITING,
+			isWired, &oldValue) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
 
-	context->table.Remove(entry);
-	tableWriteLocker.Unlock();
+	if ((oldValue & B_USER_MUTEX_LOCKED) == 0
+			|| (oldValue & B_USER_MUTEX_DISABLED) != 0) {
+		// possibly unset waiting flag
+		if ((oldValue & B_USER_MUTEX_WAITING) == 0
+				&& !user_mutex_has_waiters(bucket, key)) {
+			user_atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING, isWired);
+		}
+		return B_OK;
+	}
 
-	rw_lock_destroy(&entry->lock);
-	delete entry;
+	return B_WOULD_BLOCK;
 }
 
 
+/*!	Hands the mutex off to the first waiter, or, with
+	\c B_USER_MUTEX_UNBLOCK_ALL, wakes up all of them. Requeued waiters are
+	woken without a hand-off, as they will lock the mutex themselves.
+	Returns \c B_BAD_ADDRESS in case of a page fault.
+*/
 static status_t
-user_mutex_wait_locked(UserMutexEntry* entry,
-	uint32 flags, bigtime_t timeout, ReadLocker& locker)
+user_mutex_unblock_locked(UserMutexBucket* bucket, const UserMutexKey& key,
+	int32* mutex, uint32 flags, bool isWired)
 {
-	ConditionVariableEntry waiter;
-	entry->condition.Add(&waiter);
-	locker.Unlock();
+	UserMutexWaiter* waiter = user_mutex_next_waiter(bucket, key);
+	if (waiter == NULL) {
+		// Nobody is actually waiting at present.
+		user_atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING, isWired);
+		return B_OK;
+	}
+
+	int32 oldValue = 0;
+	if ((flags & B_USER_MUTEX_UNBLOCK_ALL) == 0 && !waiter->requeued) {
+		// This is not merely an unblock, but a hand-off.
+		if (user_atomic_or(mutex, B_USER_MUTEX_LOCKED, isWired, &oldValue)
+				!= B_OK) {
+			return B_BAD_ADDRESS;
+		}
+		if ((oldValue & B_USER_MUTEX_LOCKED) != 0)
+			return B_OK;
+	}
+
+	if ((flags & B_USER_MUTEX_UNBLOCK_ALL) != 0
+			|| (oldValue & B_USER_MUTEX_DISABLED) != 0) {
+		// unblock all waiting threads
+		while (waiter != NULL) {
+			UserMutexWaiter* next = user_mutex_next_waiter(bucket, key, waiter);
+			user_mutex_wake(bucket, waiter, B_OK);
+			waiter = next;
+		}
+	} else
+		user_mutex_wake(bucket, waiter, B_OK);
+
+	if (!user_mutex_has_waiters(bucket, key))
+		user_atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING, isWired);
 
-	return waiter.Wait(flags, timeout);
+	return B_OK;
 }
 
 
-static bool
-user_mutex_prepare_to_lock(UserMutexEntry* entry, int32* mutex, bool isWired)
+static status_t
+user_mutex_unblock(int32* mutex, const UserMutexContextFetcher& fetcher,
+	uint32 flags)
 {
-	ASSERT_READ_LOCKED_RW_LOCK(&entry->lock);
-
-	int32 oldValue = user_atomic_or(mutex,
-		B_USER_MUTEX_LOCKED | B_USER_MUTEX_WAITING, isWired);
-	if ((oldValue & B_USER_MUTEX_LOCKED) == 0
-			|| (oldValue & B_USER_MUTEX_DISABLED) != 0) {
-		// possibly unset waiting flag
-		if ((oldValue & B_USER_MUTEX_WAITING) == 0) {
-			rw_lock_read_unlock(&entry->lock);
-			rw_lock_write_lock(&entry->lock);
-			if (entry->condition.EntriesCount() == 0)
-				user_atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING, isWired);
-			rw_lock_write_unlock(&entry->lock);
-			rw_lock_read_lock(&entry->lock);
-		}
-		return true;
+	const UserMutexKey key = fetcher.Key();
+	UserMutexBucket* bucket = user_mutex_bucket(key);
+
+	InterruptsSpinLocker locker(bucket->lock);
+	while (user_mutex_unblock_locked(bucket, key, mutex, flags,
+			fetcher.IsWired()) == B_BAD_ADDRESS) {
+		if (user_mutex_fault_in(mutex, locker) != B_OK)
+			return B_BAD_ADDRESS;
 	}
 
-	return false;
+	return B_OK;
 }
 
 
 static status_t
-user_mutex_lock_locked(UserMutexEntry* entry, int32* mutex,
-	uint32 flags, bigtime_t timeout, ReadLocker& locker, bool isWired)
+user_mutex_lock(int32* mutex, const UserMutexContextFetcher& fetcher,
+	uint32 flags, bigtime_t timeout)
 {
-	if (user_mutex_prepare_to_lock(entry, mutex, isWired))
+	const bool isWired = fetcher.IsWired();
+	UserMutexWaiter waiter(fetcher.Key());
+	UserMutexBucket* bucket = user_mutex_bucket(waiter.key);
+
+	InterruptsSpinLocker locker(bucket->lock);
+
+	status_t status;
+	while ((status = user_mutex_prepare_to_lock(bucket, waiter.key, mutex,
+			isWired)) == B_BAD_ADDRESS) {
+		if (user_mutex_fault_in(mutex, locker) != B_OK)
+			return B_BAD_ADDRESS;
+	}
+	if (status == B_OK)
 		return B_OK;
 
-	status_t error = user_mutex_wait_locked(entry, flags, timeout, locker);
+	user_mutex_enqueue(bucket, waiter);
+	status = user_mutex_wait_locked(waiter, flags, timeout, locker);
 
 	// possibly unset waiting flag
-	if (error != B_OK && entry->condition.EntriesCount() == 0) {
-		WriteLocker writeLocker(entry->lock);
-		if (entry->condition.EntriesCount() == 0)
-			user_atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING, isWired);
+	if (locker.IsLocked() && !waiter.requeued
+			&& !user_mutex_has_waiters(bucket, waiter.key)) {
+		user_atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING, isWired);
 	}
 
-	return error;
+	return status;
+}
+
+
+
+// #pragma mark - priority inheritance
+
+
+static inline thread_id
+user_mutex_pi_owner(int32 value)
+{
+	return value & ~(int32)B_USER_MUTEX_PI_WAITING;
 }
 
 
+/*!	Called when \a owner starts to own another contended priority
+	inheritance mutex, whose waiters have at most the given \a priority.
+	sUserMutexPILock must be held.
+*/
 static void
-user_mutex_unblock(UserMutexEntry* entry, int32* mutex, uint32 flags, bool isWired)
+user_mutex_pi_acquire(Thread* owner, int32 priority)
 {
-	WriteLocker entryLocker(entry->lock);
-	if (entry->condition.EntriesCount() == 0) {
-		// Nobody is actually waiting at present.
-		user_atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING, isWired);
+	if (owner->user_mutex_pi.count++ == 0)
+		owner->user_mutex_pi.priority = owner->priority;
+
+	if (priority > owner->priority)
+		scheduler_set_thread_priority(owner, priority);
+}
+
+
+static void
+user_mutex_pi_boost(Thread* owner, int32 priority)
+{
+	if (owner->user_mutex_pi.count > 0 && priority > owner->priority)
+		scheduler_set_thread_priority(owner, priority);
+}
+
+
+/*!	Called when \a owner no longer owns a contended priority inheritance
+	mutex. Since we don't track which waiter caused a boost, the original
+	priority is only restored once it doesn't own any of them anymore.
+	sUserMutexPILock must be held.
+*/
+static void
+user_mutex_pi_release(Thread* owner)
+{
+	if (owner->user_mutex_pi.count == 0)
 		return;
+
+	if (--owner->user_mutex_pi.count == 0
+		&& owner->priority != owner->user_mutex_pi.priority) {
+		scheduler_set_thread_priority(owner, owner->user_mutex_pi.priority);
 	}
+}
 
-	int32 oldValue = 0;
-	if ((flags & B_USER_MUTEX_UNBLOCK_ALL) == 0) {
-		// This is not merely an unblock, but a hand-off.
-		oldValue = user_atomic_or(mutex, B_USER_MUTEX_LOCKED, isWired);
-		if ((oldValue & B_USER_MUTEX_LOCKED) != 0)
-			return;
+
+/*!	Checks whether the owner stored in the value of a locked priority
+	inheritance mutex can be trusted, since userland can write anything into
+	it. The owner has to be an existing thread of the current team, unless
+	the mutex is shared. If the mutex is already contended, the owner must
+	also be the one the kernel recorded for its waiters.
+	sUserMutexPILock must be held.
+*/
+static status_t
+user_mutex_pi_check_owner(int32 value, UserMutexBucket* bucket,
+	const UserMutexKey& key)
+{
+	const thread_id ownerID = user_mutex_pi_owner(value);
+
+	Thread* owner = Thread::Get(ownerID);
+	if (owner == NULL)
+		return B_BAD_VALUE;
+	BReference<Thread> ownerReference(owner, true);
+
+	if (key.context != &sSharedUserMutexContext
+		&& owner->team != thread_get_current_thread()->team) {
+		return B_BAD_VALUE;
 	}
 
-	if ((flags & B_USER_MUTEX_UNBLOCK_ALL) != 0
-			|| (oldValue & B_USER_MUTEX_DISABLED) != 0) {
-		// unblock all waiting threads
-		entry->condition.NotifyAll(B_OK);
-	} else {
-		if (!entry->condition.NotifyOne(B_OK))
-			user_atomic_and(mutex, ~(int32)B_USER_MUTEX_LOCKED, isWired);
+	InterruptsSpinLocker locker(bucket->lock);
+	UserMutexWaiter* waiter = user_mutex_next_waiter(bucket, key);
+	if (waiter != NULL ? waiter->pi_owner != ownerID
+			: (value & (int32)B_USER_MUTEX_PI_WAITING) != 0) {
+		return B_BAD_VALUE;
 	}
 
-	if (entry->condition.EntriesCount() == 0)
-		user_atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING, isWired);
+	return B_OK;
 }
 
 
+/*!	Locks a priority inheritance mutex. Its value is the ID of the owning
+	thread, or 0 if it is unlocked. Userland only ever changes it from 0 to
+	its own ID and back; once B_USER_MUTEX_PI_WAITING is set, all changes
+	happen in the kernel, with sUserMutexPILock held.
+*/
 static status_t
-user_mutex_sem_acquire_locked(UserMutexEntry* entry, int32* sem,
-	uint32 flags, bigtime_t timeout, ReadLocker& locker, bool isWired)
+user_mutex_pi_lock(int32* mutex, const UserMutexContextFetcher& fetcher,
+	uint32 flags, bigtime_t timeout)
 {
-	// The semaphore may have been released in the meantime, and we also
-	// need to mark it as contended if it isn't already.
-	int32 oldValue = user_atomic_get(sem, isWired);
-	while (oldValue > -1) {
-		int32 value = user_atomic_test_and_set(sem, oldValue - 1, oldValue, isWired);
-		if (value == oldValue && value > 0)
-			return B_OK;
-		oldValue = value;
-	}
+	const bool isWired = fetcher.IsWired();
+	UserMutexWaiter waiter(fetcher.Key());
+	UserMutexBucket* bucket = user_mutex_bucket(waiter.key);
+	Thread* thread = waiter.thread;
 
-	return user_mutex_wait_locked(entry, flags,
-		timeout, locker);
-}
+	MutexLocker piLocker(sUserMutexPILock);
+
+	// lock the mutex, or mark it as contended
+	bool newlyContended = false;
+	int32 value;
+	if (user_atomic_get(mutex, isWired, &value) != B_OK)
+		return B_BAD_ADDRESS;
 
+	while (true) {
+		int32 oldValue;
+		if (value == 0) {
+			if (user_atomic_test_and_set(mutex, thread->id, 0, isWired,
+					&oldValue) != B_OK) {
+				return B_BAD_ADDRESS;
+			}
+			if (oldValue == 0)
+				return B_OK;
+			value = oldValue;
+			continue;
+		}
 
-static void
-user_mutex_sem_release(UserMutexEntry* entry, int32* sem, bool isWired)
-{
-	WriteLocker entryLocker(entry->lock);
-	if (entry->condition.NotifyOne(B_OK) == 0) {
-		// no waiters - mark as uncontended and release
-		int32 oldValue = user_atomic_get(sem, isWired);
-		while (true) {
-			int32 inc = oldValue < 0 ? 2 : 1;
-			int32 value = user_atomic_test_and_set(sem, oldValue + inc, oldValue, isWired);
-			if (value == oldValue)
-				return;
-			oldValue = value;
+		if (user_mutex_pi_owner(value) == thread->id)
+			return EDEADLK;
+
+		status_t status = user_mutex_pi_check_owner(value, bucket,
+			waiter.key);
+		if (status != B_OK)
+			return status;
+
+		if ((value & (int32)B_USER_MUTEX_PI_WAITING) != 0)
+			break;
+
+		if (user_atomic_test_and_set(mutex,
+				value | (int32)B_USER_MUTEX_PI_WAITING, value, isWired,
+				&oldValue) != B_OK) {
+			return B_BAD_ADDRESS;
 		}
+		if (oldValue == value) {
+			newlyContended = true;
+			break;
+		}
+		value = oldValue;
 	}
 
-	if (entry->condition.EntriesCount() == 0) {
-		// mark the semaphore uncontended
-		user_atomic_test_and_set(sem, 0, -1, isWired);
+	waiter.pi_owner = user_mutex_pi_owner(value);
+
+	Thread* owner = Thread::Get(waiter.pi_owner);
+	if (owner != NULL) {
+		BReference<Thread> ownerReference(owner, true);
+		if (newlyContended)
+			user_mutex_pi_acquire(owner, thread->priority);
+		else
+			user_mutex_pi_boost(owner, thread->priority);
 	}
-}
 
+	InterruptsSpinLocker locker(bucket->lock);
+	user_mutex_enqueue(bucket, waiter);
+	locker.Unlock();
+	piLocker.Unlock();
 
-// #pragma mark - syscalls
+	// the owner may have handed the mutex over already
+	if (!user_mutex_lock_waiter_bucket(waiter, locker))
+		return waiter.status;
 
+	status_t error = user_mutex_block(waiter, flags, timeout, locker);
 
-struct UserMutexContextFetcher {
-	UserMutexContextFetcher(int32* mutex, uint32 flags)
-		:
-		fInitStatus(B_OK),
-		fShared((flags & B_USER_MUTEX_SHARED) != 0),
-		fAddress(0)
-	{
-		if (!fShared) {
-			fContext = get_team_user_mutex_context();
-			if (fContext == NULL) {
-				fInitStatus = B_NO_MEMORY;
-				return;
+	piLocker.Lock();
+	if (!user_mutex_dequeue(waiter, locker))
+		return waiter.status;
+
+	const bool lastWaiter = !user_mutex_has_waiters(bucket, waiter.key);
+	locker.Unlock();
+
+	if (lastWaiter) {
+		// The mutex is not contended anymore. Its owner is the one recorded
+		// for the waiters, whatever userland put into the mutex meanwhile.
+		if (user_atomic_and(mutex, ~(int32)B_USER_MUTEX_PI_WAITING, isWired)
+				== B_OK) {
+			owner = Thread::Get(waiter.pi_owner);
+			if (owner != NULL) {
+				BReference<Thread> ownerReference(owner, true);
+				user_mutex_pi_release(owner);
 			}
+		}
+	}
 
-			fAddress = (addr_t)mutex;
-		} else {
-			fContext = &sSharedUserMutexContext;
+	return error;
+}
 
-			// wire the page and get the physical address
-			fInitStatus = vm_wire_page(B_CURRENT_TEAM, (addr_t)mutex, true,
-				&fWiringInfo);
-			if (fInitStatus != B_OK)
-				return;
-			fAddress = fWiringInfo.physicalAddress;
+
+/*!	Unlocks a priority inheritance mutex owned by the current thread, and
+	hands it over to the waiter with the highest priority, if any.
+*/
+static status_t
+user_mutex_pi_unlock(int32* mutex, const UserMutexContextFetcher& fetcher)
+{
+	const bool isWired = fetcher.IsWired();
+	const UserMutexKey key = fetcher.Key();
+	UserMutexBucket* bucket = user_mutex_bucket(key);
+	Thread* thread = thread_get_current_thread();
+
+	MutexLocker piLocker(sUserMutexPILock);
+
+	int32 value;
+	if (user_atomic_get(mutex, isWired, &value) != B_OK)
+		return B_BAD_ADDRESS;
+
+	while (true) {
+		if (user_mutex_pi_owner(value) != thread->id)
+			return B_NOT_ALLOWED;
+		if ((value & (int32)B_USER_MUTEX_PI_WAITING) != 0)
+			break;
+
+		// not contended after all
+		int32 oldValue;
+		if (user_atomic_test_and_set(mutex, 0, value, isWired, &oldValue)
+				!= B_OK) {
+			return B_BAD_ADDRESS;
 		}
+		if (oldValue == value)
+			return B_OK;
+		value = oldValue;
 	}
 
-	~UserMutexContextFetcher()
-	{
-		if (fInitStatus != B_OK)
-			return;
+	// Find the waiter with the highest priority. Since waiters need the PI
+	// lock to dequeue themselves, they cannot go away in the meantime.
+	InterruptsSpinLocker locker(bucket->lock);
+	UserMutexWaiter* next = user_mutex_next_waiter(bucket, key);
+	if (next != NULL && next->pi_owner != thread->id) {
+		// we don't own it as far as the waiters are concerned
+		return B_NOT_ALLOWED;
+	}
 
-		if (fShared)
-			vm_unwire_page(&fWiringInfo);
+	bool moreWaiters = false;
+	int32 remainingPriority = 0;
+	if (next != NULL) {
+		UserMutexWaiter* waiter = next;
+		while ((waiter = user_mutex_next_waiter(bucket, key, waiter))
+				!= NULL) {
+			UserMutexWaiter* other = waiter;
+			if (waiter->thread->priority > next->thread->priority)
+				std::swap(other, next);
+
+			moreWaiters = true;
+			remainingPriority = std::max(remainingPriority,
+				other->thread->priority);
+		}
 	}
+	locker.Unlock();
 
-	status_t InitCheck() const
-		{ return fInitStatus; }
+	int32 newValue = 0;
+	BReference<Thread> newOwner;
+	if (next != NULL) {
+		newOwner.SetTo(next->thread);
+		newValue = next->thread->id;
+		if (moreWaiters)
+			newValue |= (int32)B_USER_MUTEX_PI_WAITING;
+	}
 
-	struct user_mutex_context* Context() const
-		{ return fContext; }
+	int32 oldValue;
+	if (user_atomic_test_and_set(mutex, newValue, value, isWired, &oldValue)
+			!= B_OK) {
+		return B_BAD_ADDRESS;
+	}
+	if (oldValue != value) {
+		// only the kernel may change a contended mutex
+		return B_BAD_VALUE;
+	}
 
-	generic_addr_t Address() const
-		{ return fAddress; }
+	user_mutex_pi_release(thread);
 
-	bool IsWired() const
-		{ return fShared; }
+	if (next != NULL) {
+		if (moreWaiters)
+			user_mutex_pi_acquire(newOwner.Get(), remainingPriority);
 
-private:
-	status_t fInitStatus;
-	bool fShared;
-	struct user_mutex_context* fContext;
-	VMPageWiringInfo fWiringInfo;
-	generic_addr_t fAddress;
-};
+		locker.Lock();
+		user_mutex_wake(bucket, next, B_OK);
+
+		// the remaining waiters now wait for the new owner
+		UserMutexWaiter* waiter = NULL;
+		while ((waiter = user_mutex_next_waiter(bucket, key, waiter)) != NULL)
+			waiter->pi_owner = newOwner->id;
+	}
+
+	return B_OK;
+}
+
+
+// #pragma mark - condition variables & semaphores
 
 
 static status_t
-user_mutex_lock(int32* mutex, const char* name, uint32 flags, bigtime_t timeout)
+user_mutex_switch_lock(int32* fromMutex,
+	const UserMutexContextFetcher& fromFetcher, uint32 fromFlags,
+	int32* toMutex, const UserMutexContextFetcher& toFetcher, uint32 toFlags,
+	bigtime_t timeout)
 {
-	UserMutexContextFetcher contextFetcher(mutex, flags);
-	if (contextFetcher.InitCheck() != B_OK)
-		return contextFetcher.InitCheck();
+	const bool isWired = toFetcher.IsWired();
+	UserMutexWaiter waiter(toFetcher.Key());
+	UserMutexBucket* bucket = user_mutex_bucket(waiter.key);
+
+	// lock the second mutex, or queue up for it
+	InterruptsSpinLocker locker(bucket->lock);
+
+	status_t status;
+	while ((status = user_mutex_prepare_to_lock(bucket, waiter.key, toMutex,
+			isWired)) == B_BAD_ADDRESS) {
+		if (user_mutex_fault_in(toMutex, locker) != B_OK)
+			return B_BAD_ADDRESS;
+	}
+	if (status != B_OK)
+		user_mutex_enqueue(bucket, waiter);
+	locker.Unlock();
 
-	// get the lock
-	UserMutexEntry* entry = get_user_mutex_entry(contextFetcher.Context(),
-		contextFetcher.Address());
-	if (entry == NULL)
-		return B_NO_MEMORY;
-	status_t error = B_OK;
-	{
-		ReadLocker entryLocker(entry->lock);
-		error = user_mutex_lock_locked(entry, mutex,
-			flags, timeout, entryLocker, contextFetcher.IsWired());
+	// unlock the first mutex
+	if ((fromFlags & B_USER_MUTEX_PRIO_INHERIT) != 0)
+		user_mutex_pi_unlock(fromMutex, fromFetcher);
+	else {
+		int32 oldValue;
+		if (user_atomic_and(fromMutex, ~(int32)B_USER_MUTEX_LOCKED,
+				fromFetcher.IsWired(), &oldValue) == B_OK
+			&& (oldValue & B_USER_MUTEX_WAITING) != 0) {
+			user_mutex_unblock(fromMutex, fromFetcher, fromFlags);
+		}
 	}
-	put_user_mutex_entry(contextFetcher.Context(), entry);
 
-	return error;
+	if (status == B_OK)
+		return B_OK;
+
+	if (!user_mutex_lock_waiter_bucket(waiter, locker))
+		return waiter.status;
+
+	status = user_mutex_wait_locked(waiter, toFlags, timeout, locker);
+	if (!locker.IsLocked())
+		return status;
+
+	// A requeued waiter has been signalled already, it only waited for the
+	// mutex it was moved to, which the caller locks on its own.
+	if (waiter.requeued)
+		return B_OK;
+
+	// possibly unset waiting flag
+	if (!user_mutex_has_waiters(bucket, waiter.key))
+		user_atomic_and(toMutex, ~(int32)B_USER_MUTEX_WAITING, isWired);
+
+	return status;
 }
 
 
+/*!	Wakes up the first waiter of \a fromMutex, and moves all others over to
+	\a toMutex, where they are woken one by one as it gets unlocked. The
+	waiters have to lock \a toMutex themselves afterwards.
+	Returns \c B_BAD_ADDRESS in case of a page fault.
+*/
 static status_t
-user_mutex_switch_lock(int32* fromMutex, uint32 fromFlags,
-	int32* toMutex, const char* name, uint32 toFlags, bigtime_t timeout)
+user_mutex_requeue_locked(int32* fromMutex,
+	const UserMutexContextFetcher& fromFetcher, UserMutexBucket* fromBucket,
+	int32* toMutex, const UserMutexContextFetcher& toFetcher,
+	UserMutexBucket* toBucket)
 {
-	UserMutexContextFetcher fromFetcher(fromMutex, fromFlags);
-	if (fromFetcher.InitCheck() != B_OK)
-		return fromFetcher.InitCheck();
+	const UserMutexKey fromKey = fromFetcher.Key();
+	const UserMutexKey toKey = toFetcher.Key();
 
-	UserMutexContextFetcher toFetcher(toMutex, toFlags);
-	if (toFetcher.InitCheck() != B_OK)
-		return toFetcher.InitCheck();
+	UserMutexWaiter* first = user_mutex_next_waiter(fromBucket, fromKey);
+	if (first == NULL) {
+		user_atomic_and(fromMutex, ~(int32)B_USER_MUTEX_WAITING,
+			fromFetcher.IsWired());
+		return B_OK;
+	}
 
-	// unlock the first mutex and lock the second one
-	UserMutexEntry* fromEntry = NULL,
-		*toEntry = get_user_mutex_entry(toFetcher.Context(), toFetcher.Address());
-	if (toEntry == NULL)
-		return B_NO_MEMORY;
-	status_t error = B_OK;
-	{
-		ConditionVariableEntry waiter;
+	UserMutexWaiter* waiter = user_mutex_next_waiter(fromBucket, fromKey,
+		first);
+	if (waiter != NULL && user_atomic_or(toMutex, B_USER_MUTEX_WAITING,
+			toFetcher.IsWired()) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+
+	user_mutex_wake(fromBucket, first, B_OK);
+
+	while (waiter != NULL) {
+		UserMutexWaiter* next = user_mutex_next_waiter(fromBucket, fromKey,
+			waiter);
+
+		fromBucket->waiters.Remove(waiter);
+		waiter->key = toKey;
+		waiter->requeued = true;
+		toBucket->waiters.Add(waiter);
+		atomic_pointer_set(&waiter->bucket, toBucket);
+
+		waiter = next;
+	}
+
+	user_atomic_and(fromMutex, ~(int32)B_USER_MUTEX_WAITING,
+		fromFetcher.IsWired());
+	return B_OK;
+}
 
-		bool alreadyLocked = false;
+
+static status_t
+user_mutex_requeue(int32* fromMutex,
+	const UserMutexContextFetcher& fromFetcher, int32* toMutex,
+	const UserMutexContextFetcher& toFetcher)
+{
+	UserMutexBucket* fromBucket = user_mutex_bucket(fromFetcher.Key());
+	UserMutexBucket* toBucket = user_mutex_bucket(toFetcher.Key());
+
+	while (true) {
+		status_t status;
 		{
-			ReadLocker entryLocker(toEntry->lock);
-			alreadyLocked = user_mutex_prepare_to_lock(toEntry, toMutex,
-				toFetcher.IsWired());
-			if (!alreadyLocked)
-				toEntry->condition.Add(&waiter);
+			InterruptsLocker interruptsLocker;
+			user_mutex_lock_buckets(fromBucket, toBucket);
+			status = user_mutex_requeue_locked(fromMutex, fromFetcher,
+				fromBucket, toMutex, toFetcher, toBucket);
+			user_mutex_unlock_buckets(fromBucket, toBucket);
 		}
 
-		const int32 oldValue = user_atomic_and(fromMutex, ~(int32)B_USER_MUTEX_LOCKED,
-			fromFetcher.IsWired());
-		if ((oldValue & B_USER_MUTEX_WAITING) != 0) {
-			fromEntry = get_user_mutex_entry(fromFetcher.Context(),
-				fromFetcher.Address(), true);
-			 if (fromEntry != NULL) {
-				 user_mutex_unblock(fromEntry, fromMutex, fromFlags,
-					 fromFetcher.IsWired());
-			 }
+		if (status != B_BAD_ADDRESS)
+			return status;
+		if (user_mutex_fault_in(toMutex) != B_OK)
+			return B_BAD_ADDRESS;
+	}
+}
+
+
+/*!	Takes one from the semaphore, or marks it as contended.
+	Returns \c B_OK if that worked, \c B_WOULD_BLOCK if the caller needs to
+	wait, or \c B_BAD_ADDRESS in case of a page fault.
+*/
+static status_t
+user_mutex_sem_prepare_to_acquire(int32* sem, bool isWired)
+{
+	// The semaphore may have been released in the meantime, and we also
+	// need to mark it as contended if it isn't already.
+	int32 oldValue;
+	if (user_atomic_get(sem, isWired, &oldValue) != B_OK)
+		return B_BAD_ADDRESS;
+
+	while (oldValue > -1) {
+		int32 value;
+		if (user_atomic_test_and_set(sem, oldValue - 1, oldValue, isWired,
+				&value) != B_OK) {
+			return B_BAD_ADDRESS;
 		}
+		if (value == oldValue && value > 0)
+			return B_OK;
+		oldValue = value;
+	}
+
+	return B_WOULD_BLOCK;
+}
+
+
+static status_t
+user_mutex_sem_acquire(int32* sem, const UserMutexContextFetcher& fetcher,
+	uint32 flags, bigtime_t timeout)
+{
+	UserMutexWaiter waiter(fetcher.Key());
+	UserMutexBucket* bucket = user_mutex_bucket(waiter.key);
 
-		if (!alreadyLocked)
-			error = waiter.Wait(toFlags, timeout);
+	InterruptsSpinLocker locker(bucket->lock);
+
+	status_t status;
+	while ((status = user_mutex_sem_prepare_to_acquire(sem,
+			fetcher.IsWired())) == B_BAD_ADDRESS) {
+		if (user_mutex_fault_in(sem, locker) != B_OK)
+			return B_BAD_ADDRESS;
 	}
-	put_user_mutex_entry(fromFetcher.Context(), fromEntry);
-	put_user_mutex_entry(toFetcher.Context(), toEntry);
+	if (status == B_OK)
+		return B_OK;
 
-	return error;
+	user_mutex_enqueue(bucket, waiter);
+	return user_mutex_wait_locked(waiter, flags, timeout, locker);
 }
 
 
+static status_t
+user_mutex_sem_release_locked(UserMutexBucket* bucket,
+	const UserMutexKey& key, int32* sem, bool isWired)
+{
+	UserMutexWaiter* waiter = user_mutex_next_waiter(bucket, key);
+	if (waiter == NULL) {
+		// no waiters - mark as uncontended and release
+		int32 oldValue;
+		if (user_atomic_get(sem, isWired, &oldValue) != B_OK)
+			return B_BAD_ADDRESS;
+
+		while (true) {
+			int32 inc = oldValue < 0 ? 2 : 1;
+			if (oldValue > INT32_MAX - inc)
+				return B_BAD_VALUE;
+
+			int32 value;
+			if (user_atomic_test_and_set(sem, oldValue + inc, oldValue,
+					isWired, &value) != B_OK) {
+				return B_BAD_ADDRESS;
+			}
+			if (value == oldValue)
+				return B_OK;
+			oldValue = value;
+		}
+	}
+
+	user_mutex_wake(bucket, waiter, B_OK);
+
+	if (!user_mutex_has_waiters(bucket, key)) {
+		// mark the semaphore uncontended
+		user_atomic_test_and_set(sem, 0, -1, isWired);
+	}
+
+	return B_OK;
+}
+
+
+static status_t
+user_mutex_sem_release(int32* sem, const UserMutexContextFetcher& fetcher)
+{
+	const UserMutexKey key = fetcher.Key();
+	UserMutexBucket* bucket = user_mutex_bucket(key);
+
+	InterruptsSpinLocker locker(bucket->lock);
+
+	status_t status;
+	while ((status = user_mutex_sem_release_locked(bucket, key, sem,
+			fetcher.IsWired())) == B_BAD_ADDRESS) {
+		if (user_mutex_fault_in(sem, locker) != B_OK)
+			return B_BAD_ADDRESS;
+	}
+
+	return status;
+}
+
+
+// #pragma mark - syscalls
+
+
 status_t
 _user_mutex_lock(int32* mutex, const char* name, uint32 flags,
 	bigtime_t timeout)
@@ -600,8 +1220,18 @@ _user_mutex_lock(int32* mutex, const char* name, uint32 flags,
 
 	syscall_restart_handle_timeout_pre(flags, timeout);
 
-	status_t error = user_mutex_lock(mutex, name, flags | B_CAN_INTERRUPT,
-		timeout);
+	UserMutexContextFetcher contextFetcher(mutex, flags);
+	if (contextFetcher.InitCheck() != B_OK)
+		return contextFetcher.InitCheck();
+
+	status_t error;
+	if ((flags & B_USER_MUTEX_PRIO_INHERIT) != 0) {
+		error = user_mutex_pi_lock(mutex, contextFetcher,
+			flags | B_CAN_INTERRUPT, timeout);
+	} else {
+		error = user_mutex_lock(mutex, contextFetcher, flags | B_CAN_INTERRUPT,
+			timeout);
+	}
 
 	return syscall_restart_handle_timeout_post(error, timeout);
 }
@@ -616,23 +1246,11 @@ _user_mutex_unblock(int32* mutex, uint32 flags)
 	UserMutexContextFetcher contextFetcher(mutex, flags);
 	if (contextFetcher.InitCheck() != B_OK)
 		return contextFetcher.InitCheck();
-	struct user_mutex_context* context = contextFetcher.Context();
-
-	// In the case where there is no entry, we must hold the read lock until we
-	// unset WAITING, because otherwise some other thread could initiate a wait.
-	ReadLocker tableReadLocker(context->lock);
-	UserMutexEntry* entry = get_user_mutex_entry(context,
-		contextFetcher.Address(), true, true);
-	if (entry == NULL) {
-		user_atomic_and(mutex, ~(int32)B_USER_MUTEX_WAITING, contextFetcher.IsWired());
-		tableReadLocker.Unlock();
-	} else {
-		tableReadLocker.Unlock();
-		user_mutex_unblock(entry, mutex, flags, contextFetcher.IsWired());
-	}
-	put_user_mutex_entry(context, entry);
 
-	return B_OK;
+	if ((flags & B_USER_MUTEX_PRIO_INHERIT) != 0)
+		return user_mutex_pi_unlock(mutex, contextFetcher);
+
+	return user_mutex_unblock(mutex, contextFetcher, flags);
 }
 
 
@@ -646,8 +1264,45 @@ _user_mutex_switch_lock(int32* fromMutex, uint32 fromFlags,
 		return B_BAD_ADDRESS;
 	}
 
-	return user_mutex_switch_lock(fromMutex, fromFlags, toMutex, name,
-		toFlags | B_CAN_INTERRUPT, timeout);
+	if ((toFlags & B_USER_MUTEX_PRIO_INHERIT) != 0)
+		return B_BAD_VALUE;
+
+	UserMutexContextFetcher fromFetcher(fromMutex, fromFlags);
+	if (fromFetcher.InitCheck() != B_OK)
+		return fromFetcher.InitCheck();
+
+	UserMutexContextFetcher toFetcher(toMutex, toFlags);
+	if (toFetcher.InitCheck() != B_OK)
+		return toFetcher.InitCheck();
+
+	return user_mutex_switch_lock(fromMutex, fromFetcher, fromFlags, toMutex,
+		toFetcher, toFlags | B_CAN_INTERRUPT, timeout);
+}
+
+
+status_t
+_user_mutex_requeue(int32* fromMutex, uint32 fromFlags, int32* toMutex,
+	uint32 toFlags)
+{
+	if (fromMutex == NULL || !IS_USER_ADDRESS(fromMutex)
+			|| (addr_t)fromMutex % 4 != 0 || toMutex == NULL
+			|| !IS_USER_ADDRESS(toMutex) || (addr_t)toMutex % 4 != 0) {
+		return B_BAD_ADDRESS;
+	}
+
+	// waking requeued waiters doesn't hand off priority inheritance mutexes
+	if (((fromFlags | toFlags) & B_USER_MUTEX_PRIO_INHERIT) != 0)
+		return B_BAD_VALUE;
+
+	UserMutexContextFetcher fromFetcher(fromMutex, fromFlags);
+	if (fromFetcher.InitCheck() != B_OK)
+		return fromFetcher.InitCheck();
+
+	UserMutexContextFetcher toFetcher(toMutex, toFlags);
+	if (toFetcher.InitCheck() != B_OK)
+		return toFetcher.InitCheck();
+
+	return user_mutex_requeue(fromMutex, fromFetcher, toMutex, toFetcher);
 }
 
 
@@ -663,18 +1318,9 @@ _user_mutex_sem_acquire(int32* sem, const char* name, uint32 flags,
 	UserMutexContextFetcher contextFetcher(sem, flags);
 	if (contextFetcher.InitCheck() != B_OK)
 		return contextFetcher.InitCheck();
-	struct user_mutex_context* context = contextFetcher.Context();
 
-	UserMutexEntry* entry = get_user_mutex_entry(context, contextFetcher.Address());
-	if (entry == NULL)
-		return B_NO_MEMORY;
-	status_t error;
-	{
-		ReadLocker entryLocker(entry->lock);
-		error = user_mutex_sem_acquire_locked(entry, sem,
-			flags | B_CAN_INTERRUPT, timeout, entryLocker, contextFetcher.IsWired());
-	}
-	put_user_mutex_entry(context, entry);
+	status_t error = user_mutex_sem_acquire(sem, contextFetcher,
+		flags | B_CAN_INTERRUPT, timeout);
 
 	return syscall_restart_handle_timeout_post(error, timeout);
 }
@@ -689,14 +1335,6 @@ _user_mutex_sem_release(int32* sem, uint32 flags)
 	UserMutexContextFetcher contextFetcher(sem, flags);
 	if (contextFetcher.InitCheck() != B_OK)
 		return contextFetcher.InitCheck();
-	struct user_mutex_context* context = contextFetcher.Context();
 
-	UserMutexEntry* entry = get_user_mutex_entry(context,
-		contextFetcher.Address());
-	{
-		user_mutex_sem_release(entry, sem, contextFetcher.IsWired());
-	}
-	put_user_mutex_entry(context, entry);
-
-	return B_OK;
+	return user_mutex_sem_release(sem, contextFetcher);
 }
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Keeps track of the memory nodes of NUMA machines: which physical memory
+	and which CPUs belong to which node, and how far the nodes are apart.
+	The topology is provided by the architecture specific code once it has
+	been able to retrieve it from the firmware; until then, and on machines
+	without multiple nodes, everything belongs to node 0.
+*/
+
+
+#include <numa.h>
+
+#include <debug.h>
+#include <kscheduler.h>
+#include <smp.h>
+#include <vm/vm_page.h>
+
+
+#define MAX_NUMA_MEMORY_RANGES	32
+
+
+static int32 sNodeCount = 1;
+static numa_memory_range sMemoryRanges[MAX_NUMA_MEMORY_RANGES];
+static int32 sMemoryRangeCount = 0;
+static int32 sCPUNodes[SMP_MAX_CPUS];
+static uint8 sDistances[NUMA_MAX_NODES][NUMA_MAX_NODES];
+static int32 sNodesByDistance[NUMA_MAX_NODES][NUMA_MAX_NODES];
+
+
+static int
+dump_numa(int argc, char** argv)
+{
+	kprintf("%" B_PRId32 " memory nodes\n", sNodeCount);
+
+	for (int32 node = 0; node < sNodeCount; node++) {
+		kprintf("node %" B_PRId32 ":\n  cpus:", node);
+		for (int32 cpu = 0; cpu < smp_get_num_cpus(); cpu++) {
+			if (sCPUNodes[cpu] == node)
+				kprintf(" %" B_PRId32, cpu);
+		}
+
+		kprintf("\n  memory:\n");
+		for (int32 i = 0; i < sMemoryRangeCount; i++) {
+			if (sMemoryRanges[i].node != node)
+				continue;
+
+			kprintf("    %#" B_PRIxPHYSADDR " - %#" B_PRIxPHYSADDR "\n",
+				sMemoryRanges[i].start, sMemoryRanges[i].end);
+		}
+
+		kprintf("  distances:");
+		for (int32 other = 0; other < sNodeCount; other++)
+			kprintf(" %" B_PRIu8, sDistances[node][other]);
+		kprintf("\n");
+	}
+
+	return 0;
+}
+
+
+//	#pragma mark - private kernel API
+
+
+/*!	Sets the NUMA topology of the machine. May only be called once.
+	\param nodeCount The number of memory nodes.
+	\param ranges The physical memory ranges and the nodes they belong to;
+		memory not covered by any range is considered to belong to node 0.
+		Only the first \c MAX_NUMA_MEMORY_RANGES ranges are used.
+	\param cpuNodes The node of each CPU, indexed by the CPU number.
+	\param distances The \a nodeCount x \a nodeCount matrix of relative
+		distances between the nodes, as defined by the ACPI SLIT. May be
+		\c NULL.
+*/
+status_t
+numa_set_topology(int32 nodeCount, const numa_memory_range* ranges,
+	int32 rangeCount, const int32* cpuNodes, const uint8* distances)
+{
+	if (nodeCount < 1 || nodeCount > NUMA_MAX_NODES || rangeCount < 0)
+		return B_BAD_VALUE;
+	if (nodeCount == 1)
+		return B_OK;
+
+	// check everything before anything is changed
+	for (int32 i = 0; i < rangeCount; i++) {
+		if (ranges[i].node < 0 || ranges[i].node >= nodeCount
+			|| ranges[i].end <= ranges[i].start)
+			return B_BAD_VALUE;
+	}
+
+	if (rangeCount > MAX_NUMA_MEMORY_RANGES) {
+		dprintf("numa: only using %d of %" B_PRId32 " memory ranges, the "
+			"remaining memory is considered to belong to node 0\n",
+			MAX_NUMA_MEMORY_RANGES, rangeCount);
+		rangeCount = MAX_NUMA_MEMORY_RANGES;
+	}
+
+	// keep the memory ranges sorted by address
+	for (int32 i = 0; i < rangeCount; i++) {
+		int32 index = sMemoryRangeCount++;
+		while (index > 0 && sMemoryRanges[index - 1].start > ranges[i].start) {
+			sMemoryRanges[index] = sMemoryRanges[index - 1];
+			index--;
+		}
+		sMemoryRanges[index] = ranges[i];
+	}
+
+	for (int32 cpu = 0; cpu < smp_get_num_cpus(); cpu++) {
+		if (cpuNodes[cpu] >= 0 && cpuNodes[cpu] < nodeCount)
+			sCPUNodes[cpu] = cpuNodes[cpu];
+	}
+
+	for (int32 from = 0; from < nodeCount; from++) {
+		for (int32 to = 0; to < nodeCount; to++) {
+			uint8 distance = distances != NULL
+				? distances[from * nodeCount + to] : 0;
+			if (from == to)
+				distance = NUMA_LOCAL_DISTANCE;
+			else if (distance <= NUMA_LOCAL_DISTANCE)
+				distance = NUMA_REMOTE_DISTANCE;
+			sDistances[from][to] = distance;
+		}
+	}
+
+	// sort the nodes by their distance to each node, so that allocations can
+	// fall back to the closest one
+	for (int32 from = 0; from < nodeCount; from++) {
+		int32* nodes = sNodesByDistance[from];
+		for (int32 to = 0; to < nodeCount; to++) {
+			int32 index = to;
+			while (index > 0
+				&& sDistances[from][nodes[index - 1]] > sDistances[from][to]) {
+				nodes[index] = nodes[index - 1];
+				index--;
+			}
+			nodes[index] = to;
+		}
+	}
+
+	sNodeCount = nodeCount;
+
+	dprintf("numa: %" B_PRId32 " memory nodes, %" B_PRId32 " memory ranges\n",
+		nodeCount, rangeCount);
+
+	add_debugger_command("numa", &dump_numa,
+		"Dumps the NUMA topology of the machine");
+
+	// move the free pages to their nodes, and let the scheduler know
+	vm_page_init_numa();
+	scheduler_update_numa_topology();
+
+	return B_OK;
+}
+
+
+int32
+numa_node_count(void)
+{
+	return sNodeCount;
+}
+
+
+int32
+numa_cpu_node(int32 cpu)
+{
+	return sCPUNodes[cpu];
+}
+
+
+/*!	Returns the node the physical page with the given number belongs to. */
+int32
+numa_physical_page_node(phys_addr_t pageNumber)
+{
+	phys_addr_t address = pageNumber * B_PAGE_SIZE;
+
+	int32 left = 0;
+	int32 right = sMemoryRangeCount - 1;
+	while (left <= right) {
+		int32 index = (left + right) / 2;
+		const numa_memory_range& range = sMemoryRanges[index];
+
+		if (address < range.start)
+			right = index - 1;
+		else if (address >= range.end)
+			left = index + 1;
+		else
+			return range.node;
+	}
+
+	return 0;
+}
+
+
+int32
+numa_node_distance(int32 from, int32 to)
+{
+	if (sNodeCount == 1)
+		return NUMA_LOCAL_DISTANCE;
+
+	return sDistances[from][to];
+}
+
+
+/*!	Returns all nodes ordered by their distance to \a node, starting with
+	\a node itself.
+*/
+const int32*
+numa_nodes_by_distance(int32 node)
+{
+	return sNodesByDistance[node];
+}
@@ -28,6 +28,7 @@
 #include <heap.h>
 #include <kernel.h>
 #include <Notifications.h>
+#include <port_defs.h>
 #include <sem.h>
 #include <syscall_restart.h>
 #include <team.h>
@@ -90,12 +91,31 @@
 
 namespace {
 
+/*!	Describes a message whose data has not been copied into the kernel, but
+	is still in the writer's buffer. The writer keeps the buffer locked in
+	memory, and waits until a reader has copied the data directly out of it.
+	Lives on the writer's stack, and is protected by the port's lock.
+*/
+struct port_shared_buffer {
+	ConditionVariable	condition;
+		// notified when the message is done
+	const void*			address;
+	size_t				size;
+	physical_entry*		entries;
+	uint32				entry_count;
+	bool				copying;
+		// a reader is copying the data right now
+	bool				done;
+		// the writer can unlock its buffer again
+};
+
 struct port_message : DoublyLinkedListLinkImpl<port_message> {
 	int32				code;
 	size_t				size;
 	uid_t				sender;
 	gid_t				sender_group;
 	team_id				sender_team;
+	port_shared_buffer*	shared;
 	char				buffer[0];
 };
 
@@ -131,6 +151,9 @@ struct Port : public KernelReferenceable {
 	ConditionVariable	write_condition;
 	int32				total_count;
 		// messages read from port since creation
+	int32				waiting_readers;
+		// threads waiting in read_port(), accessed atomically
+	port_stats			stats;
 	select_info*		select_infos;
 	MessageList			messages;
 
@@ -143,8 +166,11 @@ struct Port : public KernelReferenceable {
 		read_count(0),
 		write_count(queueLength),
 		total_count(0),
+		waiting_readers(0),
 		select_infos(NULL)
 	{
+		memset(&stats, 0, sizeof(stats));
+
 		// id is initialized when the caller adds the port to the hash table
 
 		mutex_init_etc(&lock, name, MUTEX_FLAG_CLONE_NAME);
@@ -445,6 +471,13 @@ static const size_t kBufferGrowRate = kInitialPortBufferSize;
 #define MAX_QUEUE_LENGTH 4096
 #define PORT_MAX_MESSAGE_SIZE (256 * 1024)
 
+// Messages from userland at least this large are not copied into the kernel
+// if a reader is already waiting; it copies them from the writer's pages.
+static const size_t kSharedMessageThreshold = 32 * 1024;
+// How long the writer waits for a reader to pick up a shared message, before
+// it copies it into the kernel after all.
+static const bigtime_t kSharedMessageTimeout = 20000;
+
 static int32 sMaxPorts = 4096;
 static int32 sUsedPorts;
 
@@ -545,13 +578,22 @@ _dump_port_info(Port* port)
 	kprintf(" read_count:      %" B_PRIu32 "\n", port->read_count);
 	kprintf(" write_count:     %" B_PRId32 "\n", port->write_count);
 	kprintf(" total count:     %" B_PRId32 "\n", port->total_count);
+	kprintf(" bytes written:   %" B_PRIu64 "\n", port->stats.bytes_written);
+	kprintf(" bytes read:      %" B_PRIu64 "\n", port->stats.bytes_read);
+	kprintf(" shared messages: %" B_PRIu32 "\n",
+		port->stats.shared_messages);
+	kprintf(" read waits:      %" B_PRIu32 "\n", port->stats.read_waits);
+	kprintf(" write waits:     %" B_PRIu32 "\n", port->stats.write_waits);
+	kprintf(" lock contention: %" B_PRIu32 "\n",
+		port->stats.lock_contention);
 
 	if (!port->messages.IsEmpty()) {
 		kprintf("messages:\n");
 
 		MessageList::Iterator iterator = port->messages.GetIterator();
 		while (port_message* message = iterator.Next()) {
-			kprintf(" %p  %08" B_PRIx32 "  %ld\n", message, message->code, message->size);
+			kprintf(" %p  %08" B_PRIx32 "  %ld%s\n", message, message->code,
+				message->size, message->shared != NULL ? "  (shared)" : "");
 		}
 	}
 
@@ -636,8 +678,13 @@ get_locked_port(port_id id) GCC_2_NRV(portRef)
 	}
 
 	if (portRef != NULL && portRef->state == Port::kActive) {
+		if (mutex_trylock(&portRef->lock) == B_OK)
+			return portRef;
+
 		if (mutex_lock(&portRef->lock) != B_OK)
 			portRef.Unset();
+		else
+			portRef->stats.lock_contention++;
 	} else
 		portRef.Unset();
 
@@ -737,6 +784,7 @@ get_port_message(int32 code, size_t bufferSize, uint32 flags, bigtime_t timeout,
 		if (message != NULL) {
 			message->code = code;
 			message->size = bufferSize;
+			message->shared = NULL;
 
 			*_message = message;
 			return B_OK;
@@ -768,6 +816,29 @@ fill_port_info(Port* port, port_info* info, size_t size)
 }
 
 
+/*!	Copies the data of a shared message directly out of the writer's pages.
+	The caller must make sure the writer keeps them locked in the meantime.
+*/
+static status_t
+copy_shared_port_message(port_shared_buffer* shared, void* buffer,
+	size_t size, bool userCopy)
+{
+	size_t offset = 0;
+	for (uint32 i = 0; i < shared->entry_count && offset < size; i++) {
+		size_t bytes = std::min((size_t)shared->entries[i].size,
+			size - offset);
+		status_t status = vm_memcpy_from_physical((uint8*)buffer + offset,
+			shared->entries[i].address, bytes, userCopy);
+		if (status != B_OK)
+			return status;
+
+		offset += bytes;
+	}
+
+	return B_OK;
+}
+
+
 static ssize_t
 copy_port_message(port_message* message, int32* _code, void* buffer,
 	size_t bufferSize, bool userCopy)
@@ -779,7 +850,12 @@ copy_port_message(port_message* message, int32* _code, void* buffer,
 	if (_code != NULL)
 		*_code = message->code;
 
-	if (size > 0) {
+	if (size > 0 && message->shared != NULL) {
+		status_t status = copy_shared_port_message(message->shared, buffer,
+			size, userCopy);
+		if (status != B_OK)
+			return status;
+	} else if (size > 0) {
 		if (userCopy) {
 			status_t status = user_memcpy(buffer, message->buffer, size);
 			if (status != B_OK)
@@ -792,6 +868,107 @@ copy_port_message(port_message* message, int32* _code, void* buffer,
 }
 
 
+/*!	Locks the writer's buffer in memory and gets its physical pages, so that
+	a reader can copy the message data directly from there.
+*/
+static status_t
+prepare_shared_port_message(const void* buffer, size_t size,
+	port_shared_buffer& shared)
+{
+	uint32 entryCount = size / B_PAGE_SIZE + 2;
+	shared.entries
+		= (physical_entry*)malloc(entryCount * sizeof(physical_entry));
+	if (shared.entries == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = lock_memory_etc(B_CURRENT_TEAM, (void*)buffer, size, 0);
+	if (status != B_OK) {
+		free(shared.entries);
+		return status;
+	}
+
+	status = get_memory_map_etc(B_CURRENT_TEAM, buffer, size, shared.entries,
+		&entryCount);
+	if (status != B_OK) {
+		unlock_memory_etc(B_CURRENT_TEAM, (void*)buffer, size, 0);
+		free(shared.entries);
+		return status;
+	}
+
+	shared.condition.Init(&shared, "port shared message");
+	shared.address = buffer;
+	shared.size = size;
+	shared.entry_count = entryCount;
+	shared.copying = false;
+	shared.done = false;
+	return B_OK;
+}
+
+
+/*!	Unlocks the writer's buffer again, after prepare_shared_port_message()
+	succeeded.
+*/
+static void
+release_shared_port_message(port_shared_buffer* shared)
+{
+	unlock_memory_etc(B_CURRENT_TEAM, (void*)shared->address, shared->size, 0);
+	free(shared->entries);
+}
+
+
+typedef CObjectDeleter<port_shared_buffer, void, release_shared_port_message>
+	SharedPortMessageReleaser;
+
+
+/*!	Waits until a reader has copied the shared \a message. If no reader picks
+	it up in time, or if the wait is interrupted or times out according to
+	\a flags and \a timeout, the data is copied into the message after all,
+	so that the writer does not depend on the reader any longer. Once a
+	reader has started copying, we wait for it to finish uninterruptibly,
+	though, as that does not take long.
+	The port must be locked, and will be unlocked when this function returns.
+*/
+static void
+finish_shared_port_message(Port* port, port_message* message,
+	port_shared_buffer& shared, uint32 flags, bigtime_t timeout,
+	MutexLocker& locker)
+{
+	bigtime_t deadline = system_time() + kSharedMessageTimeout;
+	if ((flags & B_ABSOLUTE_TIMEOUT) != 0)
+		deadline = std::min(deadline, timeout);
+
+	while (!shared.done) {
+		ConditionVariableEntry entry;
+		shared.condition.Add(&entry);
+		const bool copying = shared.copying;
+		locker.Unlock();
+
+		status_t status;
+		if (copying)
+			status = entry.Wait();
+		else {
+			status = entry.Wait(B_ABSOLUTE_TIMEOUT
+					| (flags & (B_CAN_INTERRUPT | B_KILL_CAN_INTERRUPT)),
+				deadline);
+		}
+
+		locker.Lock();
+		if (shared.done || shared.copying || status == B_OK)
+			continue;
+
+		// No reader showed up -- the pages are still locked, so this cannot
+		// fail. If the port is gone, nobody is ever going to read it anyway.
+		if (port->state == Port::kActive)
+			user_memcpy(message->buffer, shared.address, shared.size);
+
+		message->shared = NULL;
+		shared.done = true;
+	}
+
+	locker.Unlock();
+}
+
+
 static void
 uninit_port(Port* port)
 {
@@ -1358,6 +1535,7 @@ _get_port_message_info_etc(port_id id, port_message_info* info,
 
 		ConditionVariableEntry entry;
 		portRef->read_condition.Add(&entry);
+		portRef->stats.read_waits++;
 
 		locker.Unlock();
 
@@ -1467,11 +1645,14 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 		// We need to wait for a message to appear
 		ConditionVariableEntry entry;
 		portRef->read_condition.Add(&entry);
+		portRef->stats.read_waits++;
+		atomic_add(&portRef->waiting_readers, 1);
 
 		locker.Unlock();
 
 		// block if no message, or, if B_TIMEOUT flag set, block with timeout
 		status_t status = entry.Wait(flags, timeout);
+		atomic_add(&portRef->waiting_readers, -1);
 
 		// re-lock
 		BReference<Port> newPortRef = get_locked_port(id);
@@ -1522,12 +1703,28 @@ read_port_etc(port_id id, int32* _code, void* buffer, size_t bufferSize,
 		// make one spot in queue available again for write
 
 	T(Read(portRef, message->code, std::min(bufferSize, message->size)));
+	portRef->stats.bytes_read += std::min(bufferSize, message->size);
+
+	// The writer of a shared message must not unlock its buffer while we're
+	// still copying from it.
+	port_shared_buffer* shared = message->shared;
+	if (shared != NULL) {
+		shared->copying = true;
+		portRef->stats.shared_messages++;
+	}
 
 	locker.Unlock();
 
 	size_t size = copy_port_message(message, _code, buffer, bufferSize,
 		userCopy);
 
+	if (shared != NULL) {
+		locker.Lock();
+		shared->done = true;
+		shared->condition.NotifyAll();
+		locker.Unlock();
+	}
+
 	put_port_message(message);
 	return size;
 }
@@ -1577,6 +1774,23 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 	status_t status;
 	port_message* message = NULL;
 
+	// If a reader is already waiting for a large message, let it copy the
+	// data directly from our buffer instead of copying it twice. Locking the
+	// buffer may fault its pages in, so it has to be done before we lock the
+	// port.
+	port_shared_buffer shared;
+	SharedPortMessageReleaser sharedReleaser;
+	if (userCopy && vecCount == 1 && bufferSize >= kSharedMessageThreshold
+		&& msgVecs[0].iov_len >= bufferSize
+		&& ((flags & B_RELATIVE_TIMEOUT) == 0 || timeout > 0)) {
+		BReference<Port> port = get_port(id);
+		if (port != NULL && atomic_get(&port->waiting_readers) > 0
+			&& prepare_shared_port_message(msgVecs[0].iov_base, bufferSize,
+				shared) == B_OK) {
+			sharedReleaser.SetTo(&shared);
+		}
+	}
+
 	// get the port
 	BReference<Port> portRef = get_locked_port(id);
 	if (portRef == NULL) {
@@ -1599,6 +1813,7 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 		// We need to block in order to wait for a free message slot
 		ConditionVariableEntry entry;
 		portRef->write_condition.Add(&entry);
+		portRef->stats.write_waits++;
 
 		locker.Unlock();
 
@@ -1640,6 +1855,12 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 	message->sender_group = getegid();
 	message->sender_team = team_get_current_team_id();
 
+	// the reader might have been served by someone else in the meantime
+	if (sharedReleaser.IsSet() && atomic_get(&portRef->waiting_readers) > 0) {
+		message->shared = &shared;
+		bufferSize = 0;
+	}
+
 	if (bufferSize > 0) {
 		size_t offset = 0;
 		for (uint32 i = 0; i < vecCount; i++) {
@@ -1667,12 +1888,19 @@ writev_port_etc(port_id id, int32 msgCode, const iovec* msgVecs,
 
 	portRef->messages.Add(message);
 	portRef->read_count++;
+	portRef->stats.bytes_written += message->size;
 
 	T(Write(id, portRef->read_count, portRef->write_count, message->code,
 		message->size, B_OK));
 
 	notify_port_select_events(portRef, B_EVENT_READ);
 	portRef->read_condition.NotifyOne();
+
+	if (message->shared != NULL) {
+		finish_shared_port_message(portRef, message, shared, flags, timeout,
+			locker);
+	}
+
 	return B_OK;
 
 error:
@@ -1963,3 +2191,28 @@ _user_get_port_message_info_etc(port_id port, port_message_info *userInfo,
 
 	return syscall_restart_handle_timeout_post(error, timeout);
 }
+
+
+status_t
+_user_get_port_stats(port_id id, struct port_stats *userStats,
+	size_t statsSize)
+{
+	if (userStats == NULL || statsSize != sizeof(port_stats))
+		return B_BAD_VALUE;
+	if (!IS_USER_ADDRESS(userStats))
+		return B_BAD_ADDRESS;
+	if (!sPortsActive || id < 0)
+		return B_BAD_PORT_ID;
+
+	BReference<Port> portRef = get_locked_port(id);
+	if (portRef == NULL)
+		return B_BAD_PORT_ID;
+
+	port_stats stats = portRef->stats;
+	mutex_unlock(&portRef->lock);
+
+	if (user_memcpy(userStats, &stats, sizeof(stats)) != B_OK)
+		return B_BAD_ADDRESS;
+
+	return B_OK;
+}
@@ -48,8 +48,19 @@ choose_core(const ThreadData* threadData)
 {
 	SCHEDULER_ENTER_FUNCTION();
 
+	// on NUMA machines, prefer an idle core on the memory node the thread
+	// has been running on
+	PackageEntry* package = NULL;
+	if (numa_node_count() > 1) {
+		CoreEntry* home = threadData->Core();
+		if (home == NULL)
+			home = CoreEntry::GetCore(smp_get_current_cpu());
+		package = PackageEntry::GetMostIdlePackage(home->Node());
+	}
+
 	// wake new package
-	PackageEntry* package = gIdlePackageList.Last();
+	if (package == NULL)
+		package = gIdlePackageList.Last();
 	if (package == NULL) {
 		// wake new core
 		package = PackageEntry::GetMostIdlePackage();
@@ -119,12 +130,13 @@ rebalance(const ThreadData* threadData)
 	// the current one.
 	int32 coreLoad = core->GetLoad();
 	int32 otherLoad = other->GetLoad();
-	if (other == core || otherLoad + kLoadDifference >= coreLoad)
+	int32 loadDifference = migration_load_difference(core, other);
+	if (other == core || otherLoad + loadDifference >= coreLoad)
 		return core;
 
 	// Check whether migrating the current thread would result in both core
 	// loads become closer to the average.
-	int32 difference = coreLoad - otherLoad - kLoadDifference;
+	int32 difference = coreLoad - otherLoad - loadDifference;
 	ASSERT(difference > 0);
 
 	int32 threadLoad = threadData->GetLoad() / core->CPUCount();
@@ -188,6 +200,9 @@ scheduler_mode_operations gSchedulerLowLatencyMode = {
 
 	5000,
 
+	0,
+	0,
+
 	switch_to_mode,
 	set_cpu_enabled,
 	has_cache_expired,
@@ -172,7 +172,9 @@ rebalance(const ThreadData* threadData)
 
 		int32 coreNewLoad = coreLoad - threadLoad;
 		int32 otherNewLoad = other->GetLoad() + threadLoad;
-		return coreNewLoad - otherNewLoad >= kLoadDifference / 2 ? other : core;
+		return coreNewLoad - otherNewLoad
+				>= migration_load_difference(core, other) / 2
+			? other : core;
 	}
 
 	if (coreLoad >= kMediumLoad)
@@ -270,6 +272,9 @@ scheduler_mode_operations gSchedulerPowerSavingMode = {
 
 	20000,
 
+	0,
+	0,
+
 	switch_to_mode,
 	set_cpu_enabled,
 	has_cache_expired,
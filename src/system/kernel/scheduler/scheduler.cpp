@@ -24,9 +24,11 @@
 #include <kscheduler.h>
 #include <listeners.h>
 #include <load_tracking.h>
+#include <numa.h>
 #include <scheduler_defs.h>
 #include <smp.h>
 #include <timer.h>
+#include <tracepoint.h>
 #include <util/Random.h>
 
 #include "scheduler_common.h"
@@ -66,6 +68,7 @@ spinlock gSchedulerListenersLock = B_SPINLOCK_INITIALIZER;
 static scheduler_mode_operations* sSchedulerModes[] = {
 	&gSchedulerLowLatencyMode,
 	&gSchedulerPowerSavingMode,
+	&gSchedulerThroughputMode,
 };
 
 // Since CPU IDs used internally by the kernel bear no relation to the actual
@@ -101,6 +104,8 @@ enqueue(Thread* thread, bool newOne)
 
 	int32 threadPriority = threadData->GetEffectivePriority();
 	T(EnqueueThread(thread, threadPriority));
+	TRACEPOINT(B_TRACEPOINT_SCHEDULER, B_TRACEPOINT_THREAD_ENQUEUED,
+		thread->id, threadPriority);
 
 	CPUEntry* targetCPU = NULL;
 	CoreEntry* targetCore = NULL;
@@ -127,7 +132,15 @@ enqueue(Thread* thread, bool newOne)
 	NotifySchedulerListeners(&SchedulerListener::ThreadEnqueuedInRunQueue,
 		thread);
 
+	// As in CPUEntry::ChooseNextThread(), a running thread that is neither
+	// idle nor a batch thread is only preempted by a thread whose priority
+	// is sufficiently higher. Only those run above the batch priority.
 	int32 heapPriority = CPUPriorityHeap::GetKey(targetCPU);
+	if (heapPriority > gCurrentMode->batch_priority
+		&& threadPriority < B_FIRST_REAL_TIME_PRIORITY) {
+		heapPriority += gCurrentMode->wakeup_preemption_margin;
+	}
+
 	if (threadPriority > heapPriority
 		|| (threadPriority == heapPriority && rescheduleNeeded)
 		|| wasRunQueueEmpty) {
@@ -219,6 +232,45 @@ scheduler_set_thread_priority(Thread *thread, int32 priority)
 }
 
 
+/*!	Recomputes the effective priority of \a thread after the scheduler mode
+	has changed, and moves it within the run queue accordingly.
+*/
+static void
+update_thread_priority(Thread* thread)
+{
+	InterruptsSpinLocker _(thread->scheduler_lock);
+	SchedulerModeLocker modeLocker;
+
+	SCHEDULER_ENTER_FUNCTION();
+
+	ThreadData* threadData = thread->scheduler_data;
+	if (threadData == NULL)
+		return;
+
+	int32 oldPriority = threadData->GetEffectivePriority();
+	threadData->UpdateEffectivePriority();
+	int32 priority = threadData->GetEffectivePriority();
+	if (priority == oldPriority)
+		return;
+
+	if (thread->state == B_THREAD_RUNNING) {
+		ASSERT(threadData->Core() != NULL);
+		ASSERT(thread->cpu != NULL);
+		CPUEntry* cpu = &gCPUEntries[thread->cpu->cpu_num];
+
+		CoreCPUHeapLocker _(threadData->Core());
+		cpu->UpdatePriority(priority);
+	} else if (thread->state == B_THREAD_READY) {
+		T(RemoveThread(thread));
+		NotifySchedulerListeners(&SchedulerListener::ThreadRemovedFromRunQueue,
+			thread);
+
+		if (threadData->Dequeue())
+			enqueue(thread, true);
+	}
+}
+
+
 void
 scheduler_reschedule_ici()
 {
@@ -251,6 +303,8 @@ continue_cpu_timers(Thread* thread, cpu_ent* cpu)
 		|| thread->team->HasActiveCPUTimeUserTimers()) {
 		user_timer_continue_cpu_timers(thread, cpu->previous_thread);
 	}
+
+	thread_publish_cpu_time(thread);
 }
 
 
@@ -261,7 +315,8 @@ thread_resumes(Thread* thread)
 
 	release_spinlock(&cpu->previous_thread->scheduler_lock);
 
-	// continue CPU time based user timers
+	// continue CPU time based user timers and let userland know where its
+	// CPU time clock stands
 	continue_cpu_timers(thread, cpu);
 
 	// notify the user debugger code
@@ -277,6 +332,7 @@ scheduler_new_thread_entry(Thread* thread)
 
 	SpinLocker locker(thread->time_lock);
 	thread->last_time = system_time();
+	thread_publish_cpu_time(thread);
 }
 
 
@@ -410,6 +466,13 @@ reschedule(int32 nextState)
 		if (oldThreadShouldMigrate)
 			enqueueOldThread = false;
 
+		// Rather than going idle, pull a thread from a busier core of the
+		// same package.
+		if (!gSingleCore && core->QueueDepth() == 0
+			&& (!enqueueOldThread || oldThreadData->IsIdle())) {
+			cpu->StealThread();
+		}
+
 		nextThreadData
 			= cpu->ChooseNextThread(enqueueOldThread ? oldThreadData : NULL,
 				putOldThreadAtBack);
@@ -444,6 +507,8 @@ reschedule(int32 nextState)
 		nextThread->id);
 
 	T(ScheduleThread(nextThread, oldThread));
+	TRACEPOINT(B_TRACEPOINT_SCHEDULER, B_TRACEPOINT_THREAD_SWITCH,
+		oldThread->id, nextThread->id);
 
 	// notify listeners
 	NotifySchedulerListeners(&SchedulerListener::ThreadScheduled,
@@ -548,20 +613,34 @@ status_t
 scheduler_set_operation_mode(scheduler_mode mode)
 {
 	if (mode != SCHEDULER_MODE_LOW_LATENCY
-		&& mode != SCHEDULER_MODE_POWER_SAVING) {
+		&& mode != SCHEDULER_MODE_POWER_SAVING
+		&& mode != SCHEDULER_MODE_THROUGHPUT) {
 		return B_BAD_VALUE;
 	}
 
 	dprintf("scheduler: switching to %s mode\n", sSchedulerModes[mode]->name);
 
-	InterruptsBigSchedulerLocker _;
+	InterruptsBigSchedulerLocker locker;
 
+	const bool initialMode = gCurrentMode == NULL;
 	gCurrentModeID = mode;
 	gCurrentMode = sSchedulerModes[mode];
 	gCurrentMode->switch_to_mode();
 
 	ThreadData::ComputeQuantumLengths();
 
+	locker.Unlock();
+
+	// The modes floor the effective priorities differently, so existing
+	// threads need to have theirs recomputed.
+	if (!initialMode) {
+		ThreadListIterator iterator;
+		while (Thread* thread = iterator.Next()) {
+			BReference<Thread> threadReference(thread, true);
+			update_thread_priority(thread);
+		}
+	}
+
 	return B_OK;
 }
 
@@ -781,6 +860,21 @@ scheduler_update_policy()
 }
 
 
+/*!	Called once the memory nodes of the machine are known. Assigns the cores
+	and packages to the node of their first CPU.
+*/
+void
+scheduler_update_numa_topology()
+{
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = cpuCount - 1; i >= 0; i--) {
+		int32 node = numa_cpu_node(i);
+		gCoreEntries[sCPUToCore[i]].SetNode(node);
+		gPackageEntries[sCPUToPackage[i]].SetNode(node);
+	}
+}
+
+
 // #pragma mark - SchedulerListener
 
 
@@ -873,3 +967,23 @@ _user_get_scheduler_mode()
 	return gCurrentModeID;
 }
 
+
+ssize_t
+_user_get_scheduler_core_stats(scheduler_core_stats* userStats, size_t size)
+{
+	if (userStats == NULL || !IS_USER_ADDRESS(userStats))
+		return B_BAD_ADDRESS;
+
+	int32 count = std::min(gCoreCount,
+		int32(size / sizeof(scheduler_core_stats)));
+	for (int32 i = 0; i < count; i++) {
+		scheduler_core_stats stats;
+		gCoreEntries[i].GetStats(&stats);
+
+		if (user_memcpy(userStats + i, &stats, sizeof(stats)) != B_OK)
+			return B_BAD_ADDRESS;
+	}
+
+	return count;
+}
+
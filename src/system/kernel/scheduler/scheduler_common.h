@@ -42,6 +42,10 @@ const int kVeryHighLoad = (kMaxLoad + kHighLoad) / 2;
 
 const int kLoadDifference = kMaxLoad * 20 / 100;
 
+// A thread that ran less than this long ago is likely to still have its data
+// in the caches of its core, and is not stolen by idle CPUs of other cores.
+const bigtime_t kCacheHotTime = 500;
+
 extern bool gSingleCore;
 extern bool gTrackCoreLoad;
 extern bool gTrackCPULoad;
@@ -6,6 +6,7 @@
 
 #include "scheduler_cpu.h"
 
+#include <scheduler_defs.h>
 #include <util/AutoLock.h>
 
 #include <algorithm>
@@ -241,6 +242,14 @@ CPUEntry::ChooseNextThread(ThreadData* oldThread, bool putAtBack)
 		sharedPriority = sharedThread->GetEffectivePriority();
 
 	int32 rest = std::max(pinnedPriority, sharedPriority);
+
+	// Unless it is a batch thread, let the old thread finish its quantum
+	// if the waiting threads' priority is not much higher.
+	if (oldThread != NULL && !putAtBack && !oldThread->IsIdle()
+		&& !oldThread->IsBatch() && rest < B_FIRST_REAL_TIME_PRIORITY) {
+		oldPriority += gCurrentMode->wakeup_preemption_margin;
+	}
+
 	if (oldPriority > rest || (!putAtBack && oldPriority == rest))
 		return oldThread;
 
@@ -256,6 +265,44 @@ CPUEntry::ChooseNextThread(ThreadData* oldThread, bool putAtBack)
 }
 
 
+/*!	Called when the CPU is about to run its idle thread. Moves a thread that
+	waits in the run queue of the busiest other core of the same package to
+	the run queue of this CPU's core, where ChooseNextThread() will find it.
+	Returns whether a thread has been moved.
+*/
+bool
+CPUEntry::StealThread()
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	ASSERT(!gSingleCore);
+
+	CoreEntry* victim = _ChooseStealVictim();
+	if (victim == NULL)
+		return false;
+
+	ThreadData* threadData = victim->PickThreadToSteal(this);
+	if (threadData == NULL)
+		return false;
+
+	Thread* thread = threadData->GetThread();
+	TRACE("cpu %" B_PRId32 " steals thread %" B_PRId32 " from core %" B_PRId32
+		"\n", fCPUNumber, thread->id, victim->ID());
+
+	CoreEntry* targetCore = fCore;
+	CPUEntry* targetCPU = this;
+	threadData->ChooseCoreAndCPU(targetCore, targetCPU);
+	ASSERT(targetCore == fCore);
+
+	bool wasRunQueueEmpty;
+	threadData->Enqueue(wasRunQueueEmpty);
+	fCore->ThreadStolen();
+
+	release_spinlock(&thread->scheduler_lock);
+	return true;
+}
+
+
 void
 CPUEntry::TrackActivity(ThreadData* oldThreadData, ThreadData* nextThreadData)
 {
@@ -316,6 +363,37 @@ CPUEntry::StartQuantumTimer(ThreadData* thread, bool wasPreempted)
 }
 
 
+/*!	Returns the core of this CPU's package with the most threads waiting that
+	none of its own idle CPUs is going to pick up, or \c NULL if there is no
+	such core.
+*/
+CoreEntry*
+CPUEntry::_ChooseStealVictim() const
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	PackageEntry* package = fCore->Package();
+
+	CoreEntry* victim = NULL;
+	int32 victimDepth = 0;
+	for (int32 i = 0; i < gCoreCount; i++) {
+		CoreEntry* core = &gCoreEntries[i];
+		if (core == fCore || core->Package() != package
+			|| core->CPUCount() == 0) {
+			continue;
+		}
+
+		int32 depth = core->QueueDepth() - core->IdleCPUCount();
+		if (depth > victimDepth) {
+			victim = core;
+			victimDepth = depth;
+		}
+	}
+
+	return victim;
+}
+
+
 void
 CPUEntry::_RequestPerformanceLevel(ThreadData* threadData)
 {
@@ -360,8 +438,17 @@ CPUEntry::_RescheduleEvent(timer* /* unused */)
 /* static */ int32
 CPUEntry::_UpdateLoadEvent(timer* /* unused */)
 {
-	CoreEntry::GetCore(smp_get_current_cpu())->ChangeLoad(0);
-	CPUEntry::GetCPU(smp_get_current_cpu())->fUpdateLoadEvent = false;
+	CPUEntry* cpu = CPUEntry::GetCPU(smp_get_current_cpu());
+	cpu->fCore->ChangeLoad(0);
+	cpu->fUpdateLoadEvent = false;
+
+	// While idle, keep looking for threads to steal from busier cores. In
+	// power saving mode the CPU is rather left alone.
+	if (gCurrentModeID != SCHEDULER_MODE_POWER_SAVING
+		&& cpu->CanStealThread()) {
+		get_cpu_struct()->invoke_scheduler = true;
+		get_cpu_struct()->preempted = true;
+	}
 	return B_HANDLED_INTERRUPT;
 }
 
@@ -402,6 +489,7 @@ CPUPriorityHeap::Dump()
 
 CoreEntry::CoreEntry()
 	:
+	fNode(0),
 	fCPUCount(0),
 	fIdleCPUCount(0),
 	fThreadCount(0),
@@ -410,7 +498,10 @@ CoreEntry::CoreEntry()
 	fCurrentLoad(0),
 	fLoadMeasurementEpoch(0),
 	fHighLoad(false),
-	fLastLoadUpdate(0)
+	fLastLoadUpdate(0),
+	fStealCount(0),
+	fStolenCount(0),
+	fCacheHotSkipCount(0)
 {
 	B_INITIALIZE_SPINLOCK(&fCPULock);
 	B_INITIALIZE_SPINLOCK(&fQueueLock);
@@ -462,6 +553,64 @@ CoreEntry::Remove(ThreadData* thread)
 }
 
 
+/*!	Removes a thread that may run on \a cpu and whose cache is not hot
+	anymore from the run queue, so that \a cpu can run it instead. Only the
+	first few threads of the queue are considered.
+	Returns the thread with its \c scheduler_lock held, or \c NULL.
+*/
+ThreadData*
+CoreEntry::PickThreadToSteal(CPUEntry* cpu)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	const int32 kMaxCandidates = 8;
+
+	CoreRunQueueLocker _(this);
+
+	int32 candidates = 0;
+	ThreadRunQueue::ConstIterator iterator = fRunQueue.GetConstIterator();
+	while (iterator.HasNext() && candidates++ < kMaxCandidates) {
+		ThreadData* threadData = iterator.Next();
+		if (threadData->IsCacheHot()) {
+			atomic_add64(&fCacheHotSkipCount, 1);
+			continue;
+		}
+
+		CPUSet mask = threadData->GetCPUMask();
+		if (!mask.IsEmpty() && !mask.GetBit(cpu->ID()))
+			continue;
+
+		// The scheduler lock is usually acquired before the run queue lock,
+		// so we must not wait for it here.
+		Thread* thread = threadData->GetThread();
+		if (!try_acquire_spinlock(&thread->scheduler_lock))
+			continue;
+
+		Remove(threadData);
+		atomic_add64(&fStolenCount, 1);
+		return threadData;
+	}
+
+	return NULL;
+}
+
+
+void
+CoreEntry::GetStats(scheduler_core_stats* stats)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	stats->core = fCoreID;
+	stats->package = fPackage->ID();
+	stats->cpu_count = fCPUCount;
+	stats->queue_depth = fThreadCount;
+	stats->load = fCPUCount > 0 ? GetLoad() : 0;
+	stats->steals = atomic_get64(&fStealCount);
+	stats->stolen = atomic_get64(&fStolenCount);
+	stats->cache_hot_skips = atomic_get64(&fCacheHotSkipCount);
+}
+
+
 void
 CoreEntry::AddCPU(CPUEntry* cpu)
 {
@@ -647,6 +796,7 @@ CoreLoadHeap::Dump()
 
 PackageEntry::PackageEntry()
 	:
+	fNode(0),
 	fIdleCoreCount(0),
 	fCoreCount(0)
 {
@@ -714,9 +864,10 @@ DebugDumper::DumpCoreLoadHeapEntry(CoreEntry* entry)
 	thread_map(DebugDumper::_AnalyzeCoreThreads, &threadsData);
 
 	kprintf("%4" B_PRId32 " %11" B_PRId32 "%% %11" B_PRId32 "%% %11" B_PRId32
-		"%% %7" B_PRId32 " %5" B_PRIu32 "\n", entry->ID(), entry->fLoad / 10,
-		entry->fCurrentLoad / 10, threadsData.fLoad, entry->ThreadCount(),
-		entry->fLoadMeasurementEpoch);
+		"%% %7" B_PRId32 " %5" B_PRIu32 " %6" B_PRId64 " %6" B_PRId64 "\n",
+		entry->ID(), entry->fLoad / 10, entry->fCurrentLoad / 10,
+		threadsData.fLoad, entry->ThreadCount(), entry->fLoadMeasurementEpoch,
+		entry->fStealCount, entry->fStolenCount);
 }
 
 
@@ -769,7 +920,8 @@ dump_run_queue(int /* argc */, char** /* argv */)
 static int
 dump_cpu_heap(int /* argc */, char** /* argv */)
 {
-	kprintf("core average_load current_load threads_load threads epoch\n");
+	kprintf("core average_load current_load threads_load threads epoch "
+		"steals stolen\n");
 	gCoreLoadHeap.Dump();
 	kprintf("\n");
 	gCoreHighLoadHeap.Dump();
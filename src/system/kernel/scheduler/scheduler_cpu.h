@@ -8,6 +8,7 @@
 
 #include <OS.h>
 
+#include <numa.h>
 #include <smp.h>
 #include <thread.h>
 #include <util/AutoLock.h>
@@ -22,6 +23,9 @@
 #include "scheduler_profiler.h"
 
 
+struct scheduler_core_stats;
+
+
 namespace Scheduler {
 
 
@@ -79,6 +83,8 @@ public:
 
 						ThreadData*		ChooseNextThread(ThreadData* oldThread,
 											bool putAtBack);
+						bool			StealThread();
+	inline				bool			CanStealThread() const;
 
 						void			TrackActivity(ThreadData* oldThreadData,
 											ThreadData* nextThreadData);
@@ -92,6 +98,8 @@ private:
 						void			_RequestPerformanceLevel(
 											ThreadData* threadData);
 
+						CoreEntry*		_ChooseStealVictim() const;
+
 	static				int32			_RescheduleEvent(timer* /* unused */);
 	static				int32			_UpdateLoadEvent(timer* /* unused */);
 
@@ -130,6 +138,9 @@ public:
 
 	inline				int32			ID() const	{ return fCoreID; }
 	inline				PackageEntry*	Package() const	{ return fPackage; }
+	inline				int32			Node() const	{ return fNode; }
+	inline				void			SetNode(int32 node)
+											{ fNode = node; }
 	inline				int32			CPUCount() const
 											{ return fCPUCount; }
 	inline				const CPUSet&	CPUMask() const
@@ -141,6 +152,10 @@ public:
 	inline				CPUPriorityHeap*	CPUHeap();
 
 	inline				int32			ThreadCount() const;
+	inline				int32			QueueDepth() const
+											{ return fThreadCount; }
+	inline				int32			IdleCPUCount() const
+											{ return fIdleCPUCount; }
 
 	inline				void			LockRunQueue();
 	inline				void			UnlockRunQueue();
@@ -152,6 +167,11 @@ public:
 						void			Remove(ThreadData* thread);
 						ThreadData*		PeekThread() const;
 
+						ThreadData*		PickThreadToSteal(CPUEntry* cpu);
+	inline				void			ThreadStolen();
+
+						void			GetStats(scheduler_core_stats* stats);
+
 	inline				bigtime_t		GetActiveTime() const;
 	inline				void			IncreaseActiveTime(
 											bigtime_t activeTime);
@@ -183,6 +203,7 @@ private:
 
 						int32			fCoreID;
 						PackageEntry*	fPackage;
+						int32			fNode;
 
 						int32			fCPUCount;
 						CPUSet			fCPUSet;
@@ -204,6 +225,10 @@ private:
 						bigtime_t		fLastLoadUpdate;
 						rw_spinlock		fLoadLock;
 
+						int64			fStealCount;
+						int64			fStolenCount;
+						int64			fCacheHotSkipCount;
+
 						friend class DebugDumper;
 } CACHE_LINE_ALIGN;
 
@@ -230,19 +255,27 @@ public:
 
 						void				Init(int32 id);
 
+	inline				int32				ID() const	{ return fPackageID; }
+
 	inline				void				CoreGoesIdle(CoreEntry* core);
 	inline				void				CoreWakesUp(CoreEntry* core);
 
+	inline				int32				Node() const	{ return fNode; }
+	inline				void				SetNode(int32 node)
+												{ fNode = node; }
+
 	inline				CoreEntry*			GetIdleCore(int32 index = 0) const;
 
 						void				AddIdleCore(CoreEntry* core);
 						void				RemoveIdleCore(CoreEntry* core);
 
-	static inline		PackageEntry*		GetMostIdlePackage();
+	static inline		PackageEntry*		GetMostIdlePackage(
+												int32 node = -1);
 	static inline		PackageEntry*		GetLeastIdlePackage();
 
 private:
 						int32				fPackageID;
+						int32				fNode;
 
 						DoublyLinkedList<CoreEntry>	fIdleCores;
 						int32				fIdleCoreCount;
@@ -315,6 +348,14 @@ CPUEntry::UnlockRunQueue()
 }
 
 
+inline bool
+CPUEntry::CanStealThread() const
+{
+	SCHEDULER_ENTER_FUNCTION();
+	return !gSingleCore && _ChooseStealVictim() != NULL;
+}
+
+
 /* static */ inline CPUEntry*
 CPUEntry::GetCPU(int32 cpu)
 {
@@ -355,6 +396,14 @@ CoreEntry::ThreadCount() const
 }
 
 
+inline void
+CoreEntry::ThreadStolen()
+{
+	SCHEDULER_ENTER_FUNCTION();
+	atomic_add64(&fStealCount, 1);
+}
+
+
 inline void
 CoreEntry::LockRunQueue()
 {
@@ -553,18 +602,27 @@ PackageEntry::GetIdleCore(int32 index) const
 }
 
 
+/*!	Returns the package with the most idle cores, or \c NULL if there are
+	no idle cores. If \a node is not negative, only the packages on that
+	memory node are considered.
+*/
 /* static */ inline PackageEntry*
-PackageEntry::GetMostIdlePackage()
+PackageEntry::GetMostIdlePackage(int32 node)
 {
 	SCHEDULER_ENTER_FUNCTION();
 
-	PackageEntry* current = &gPackageEntries[0];
-	for (int32 i = 1; i < gPackageCount; i++) {
-		if (gPackageEntries[i].fIdleCoreCount > current->fIdleCoreCount)
-			current = &gPackageEntries[i];
+	PackageEntry* current = NULL;
+	for (int32 i = 0; i < gPackageCount; i++) {
+		PackageEntry* package = &gPackageEntries[i];
+		if (node >= 0 && package->fNode != node)
+			continue;
+		if (current == NULL
+			|| package->fIdleCoreCount > current->fIdleCoreCount) {
+			current = package;
+		}
 	}
 
-	if (current->fIdleCoreCount == 0)
+	if (current == NULL || current->fIdleCoreCount == 0)
 		return NULL;
 
 	return current;
@@ -592,6 +650,19 @@ PackageEntry::GetLeastIdlePackage()
 }
 
 
+/*!	Returns by how much more \a from must be loaded than \a to before a
+	thread is worth migrating between them. Moving a thread to another
+	memory node leaves its memory behind, so the threshold grows with the
+	distance between the nodes.
+*/
+inline int32
+migration_load_difference(const CoreEntry* from, const CoreEntry* to)
+{
+	return kLoadDifference * numa_node_distance(from->Node(), to->Node())
+		/ NUMA_LOCAL_DISTANCE;
+}
+
+
 }	// namespace Scheduler
 
 
@@ -19,6 +19,12 @@ struct scheduler_mode_operations {
 
 	bigtime_t				maximum_latency;
 
+	// how much higher than that of the running thread the priority of
+	// a woken up thread has to be to preempt it before its quantum ends
+	int32					wakeup_preemption_margin;
+	// threads with this priority or lower are batch threads, 0 if none
+	int32					batch_priority;
+
 	void					(*switch_to_mode)();
 	void					(*set_cpu_enabled)(int32 cpu, bool enabled);
 	bool					(*has_cache_expired)(
@@ -32,6 +38,7 @@ struct scheduler_mode_operations {
 
 extern struct scheduler_mode_operations gSchedulerLowLatencyMode;
 extern struct scheduler_mode_operations gSchedulerPowerSavingMode;
+extern struct scheduler_mode_operations gSchedulerThroughputMode;
 
 
 namespace Scheduler {
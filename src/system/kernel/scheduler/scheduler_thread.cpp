@@ -24,6 +24,7 @@ ThreadData::_InitBase()
 
 	fWentSleep = 0;
 	fWentSleepActive = 0;
+	fLastRunTime = 0;
 
 	fEnqueued = false;
 	fReady = false;
@@ -151,6 +152,7 @@ ThreadData::Dump() const
 	kprintf("\tneeded_load:\t\t%" B_PRId32 "%%\n", fNeededLoad / 10);
 	kprintf("\twent_sleep:\t\t%" B_PRId64 "\n", fWentSleep);
 	kprintf("\twent_sleep_active:\t%" B_PRId64 "\n", fWentSleepActive);
+	kprintf("\tlast_run:\t\t%" B_PRId64 "\n", fLastRunTime);
 	kprintf("\tcore:\t\t\t%" B_PRId32 "\n",
 		fCore != NULL ? fCore->ID() : -1);
 	if (fCore != NULL && HasCacheExpired())
@@ -213,7 +215,7 @@ ThreadData::ComputeQuantum() const
 		threadCount /= fCore->CPUCount();
 
 	bigtime_t quantum = fBaseQuantum;
-	if (threadCount < kMaximumQuantumLengthsCount)
+	if (threadCount < kMaximumQuantumLengthsCount && !IsBatch())
 		quantum = std::min(sMaximumQuantumLengths[threadCount], quantum);
 	return quantum;
 }
@@ -307,6 +309,10 @@ ThreadData::_ComputeEffectivePriority() const
 		fEffectivePriority -= _GetPenalty();
 		if (fEffectivePriority > 0)
 			fEffectivePriority -= fAdditionalPenalty % fEffectivePriority;
+		if (gCurrentMode->batch_priority > 0 && !IsBatch()) {
+			fEffectivePriority = std::max(fEffectivePriority,
+				gCurrentMode->batch_priority + 1);
+		}
 
 		ASSERT(fEffectivePriority < B_FIRST_REAL_TIME_PRIORITY);
 		ASSERT(fEffectivePriority >= B_LOWEST_ACTIVE_PRIORITY);
@@ -43,8 +43,10 @@ public:
 
 	inline	bool		IsRealTime() const;
 	inline	bool		IsIdle() const;
+	inline	bool		IsBatch() const;
 
 	inline	bool		HasCacheExpired() const;
+	inline	bool		IsCacheHot() const;
 	inline	CoreEntry*	Rebalance() const;
 
 	inline	int32		GetEffectivePriority() const;
@@ -54,6 +56,7 @@ public:
 
 	inline	void		CancelPenalty();
 	inline	bool		ShouldCancelPenalty() const;
+	inline	void		UpdateEffectivePriority();
 
 			bool		ChooseCoreAndCPU(CoreEntry*& targetCore,
 							CPUEntry*& targetCPU);
@@ -108,6 +111,7 @@ private:
 
 			bigtime_t	fWentSleep;
 			bigtime_t	fWentSleepActive;
+			bigtime_t	fLastRunTime;
 
 			bool		fEnqueued;
 			bool		fReady;
@@ -151,7 +155,12 @@ ThreadData::_GetMinimalPriority() const
 	const int32 kMinimalPriority = B_LOWEST_ACTIVE_PRIORITY;
 
 	int32 priority = GetPriority() / kDivisor;
-	return std::max(std::min(priority, kMaximalPriority), kMinimalPriority);
+	priority = std::max(std::min(priority, kMaximalPriority), kMinimalPriority);
+
+	// penalties never push other threads down to the batch threads
+	if (gCurrentMode->batch_priority > 0 && !IsBatch())
+		priority = std::max(priority, gCurrentMode->batch_priority + 1);
+	return priority;
 }
 
 
@@ -169,6 +178,13 @@ ThreadData::IsIdle() const
 }
 
 
+inline bool
+ThreadData::IsBatch() const
+{
+	return GetPriority() <= gCurrentMode->batch_priority && !IsIdle();
+}
+
+
 inline bool
 ThreadData::HasCacheExpired() const
 {
@@ -177,6 +193,17 @@ ThreadData::HasCacheExpired() const
 }
 
 
+/*!	Returns whether the thread has run so recently that moving it to another
+	core would throw away a warm cache.
+*/
+inline bool
+ThreadData::IsCacheHot() const
+{
+	SCHEDULER_ENTER_FUNCTION();
+	return system_time() - fLastRunTime < kCacheHotTime;
+}
+
+
 inline CoreEntry*
 ThreadData::Rebalance() const
 {
@@ -231,7 +258,8 @@ ThreadData::StopCPUTime()
 
 	// User time is tracked in thread_at_kernel_entry()
 	SpinLocker threadTimeLocker(fThread->time_lock);
-	fThread->kernel_time += system_time() - fThread->last_time;
+	fLastRunTime = system_time();
+	fThread->kernel_time += fLastRunTime - fThread->last_time;
 	fThread->last_time = 0;
 	threadTimeLocker.Unlock();
 
@@ -269,6 +297,21 @@ ThreadData::ShouldCancelPenalty() const
 }
 
 
+inline void
+ThreadData::UpdateEffectivePriority()
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (IsIdle() || IsRealTime())
+		return;
+
+	// the minimal priority depends on the mode, too
+	fPriorityPenalty = std::min(fPriorityPenalty,
+		std::max(GetPriority() - _GetMinimalPriority(), int32(0)));
+	_ComputeEffectivePriority();
+}
+
+
 inline void
 ThreadData::SetStolenInterruptTime(bigtime_t interruptTime)
 {
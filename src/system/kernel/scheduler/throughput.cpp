@@ -0,0 +1,204 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <util/AutoLock.h>
+
+#include "scheduler_common.h"
+#include "scheduler_cpu.h"
+#include "scheduler_modes.h"
+#include "scheduler_profiler.h"
+#include "scheduler_thread.h"
+
+
+using namespace Scheduler;
+
+
+// Batch jobs keep their working set in the cache of their core for a long
+// time, so they may stay there even after having slept for a while.
+const bigtime_t kCacheExpire = 250000;
+
+
+static void
+switch_to_mode()
+{
+}
+
+
+static void
+set_cpu_enabled(int32 /* cpu */, bool /* enabled */)
+{
+}
+
+
+static bool
+has_cache_expired(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+	if (threadData->WentSleepActive() == 0)
+		return false;
+	CoreEntry* core = threadData->Core();
+	bigtime_t activeTime = core->GetActiveTime();
+	return activeTime - threadData->WentSleepActive() > kCacheExpire;
+}
+
+
+static CoreEntry*
+choose_least_loaded_core(PackageEntry* package, const CPUSet& mask)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	const bool useMask = !mask.IsEmpty();
+
+	ReadSpinLocker coreLocker(gCoreHeapsLock);
+	int32 index = 0;
+	CoreEntry* core;
+	do {
+		core = gCoreLoadHeap.PeekMinimum(index++);
+	} while (core != NULL && ((useMask && !core->CPUMask().Matches(mask))
+			|| (package != NULL && core->Package() != package)));
+	if (core == NULL && package == NULL) {
+		index = 0;
+		do {
+			core = gCoreHighLoadHeap.PeekMinimum(index++);
+		} while (useMask && core != NULL && !core->CPUMask().Matches(mask));
+	}
+
+	return core;
+}
+
+
+static CoreEntry*
+choose_core(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	// Threads that are created or woken up by another thread usually work on
+	// the same data. Keep them in the package of the current CPU, so that they
+	// share its caches, as long as it has a core that isn't highly loaded.
+	PackageEntry* package
+		= CoreEntry::GetCore(smp_get_current_cpu())->Package();
+
+	CPUSet mask = threadData->GetCPUMask();
+	const bool useMask = !mask.IsEmpty();
+
+	int32 index = 0;
+	CoreEntry* core;
+	do {
+		core = package->GetIdleCore(index++);
+	} while (useMask && core != NULL && !core->CPUMask().Matches(mask));
+
+	if (core == NULL)
+		core = choose_least_loaded_core(package, mask);
+
+	if (core == NULL) {
+		package = PackageEntry::GetMostIdlePackage();
+		if (package == NULL)
+			package = gIdlePackageList.Last();
+
+		if (package != NULL) {
+			index = 0;
+			do {
+				core = package->GetIdleCore(index++);
+			} while (useMask && core != NULL
+				&& !core->CPUMask().Matches(mask));
+		}
+	}
+
+	if (core == NULL)
+		core = choose_least_loaded_core(NULL, mask);
+
+	ASSERT(core != NULL);
+	return core;
+}
+
+
+static CoreEntry*
+rebalance(const ThreadData* threadData)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	CoreEntry* core = threadData->Core();
+	ASSERT(core != NULL);
+
+	CoreEntry* other = choose_least_loaded_core(NULL,
+		threadData->GetCPUMask());
+	ASSERT(other != NULL);
+
+	// Moving a thread away from its cache costs more than a somewhat uneven
+	// load, so demand twice the usual difference.
+	int32 coreLoad = core->GetLoad();
+	int32 otherLoad = other->GetLoad();
+	int32 loadDifference = migration_load_difference(core, other) * 2;
+	if (other == core || otherLoad + loadDifference >= coreLoad)
+		return core;
+
+	int32 difference = coreLoad - otherLoad - loadDifference;
+	ASSERT(difference > 0);
+
+	int32 threadLoad = threadData->GetLoad() / core->CPUCount();
+	return difference >= threadLoad ? other : core;
+}
+
+
+static void
+rebalance_irqs(bool idle)
+{
+	SCHEDULER_ENTER_FUNCTION();
+
+	if (idle)
+		return;
+
+	cpu_ent* cpu = get_cpu_struct();
+	SpinLocker locker(cpu->irqs_lock);
+
+	irq_assignment* chosen = NULL;
+	irq_assignment* irq = (irq_assignment*)list_get_first_item(&cpu->irqs);
+
+	int32 totalLoad = 0;
+	while (irq != NULL) {
+		if (chosen == NULL || chosen->load < irq->load)
+			chosen = irq;
+		totalLoad += irq->load;
+		irq = (irq_assignment*)list_get_next_item(&cpu->irqs, irq);
+	}
+
+	locker.Unlock();
+
+	if (chosen == NULL || totalLoad < kLowLoad)
+		return;
+
+	CoreEntry* other = choose_least_loaded_core(NULL, CPUSet());
+	ASSERT(other != NULL);
+
+	CoreEntry* core = CoreEntry::GetCore(cpu->cpu_num);
+	if (other == core)
+		return;
+	if (other->GetLoad() + kLoadDifference >= core->GetLoad())
+		return;
+
+	assign_io_interrupt_to_cpu(chosen->irq, other->CPUHeap()->PeekRoot()->ID());
+}
+
+
+scheduler_mode_operations gSchedulerThroughputMode = {
+	"throughput",
+
+	4000,
+	1000,
+	{ 2, 4 },
+
+	40000,
+
+	5,
+	B_LOW_PRIORITY,
+
+	switch_to_mode,
+	set_cpu_enabled,
+	has_cache_expired,
+	choose_core,
+	rebalance,
+	rebalance_irqs,
+};
@@ -28,7 +28,8 @@ object_cache_return_object_wrapper(object_depot* depot, void* cookie,
 {
 	ObjectCache* cache = (ObjectCache*)cookie;
 
-	MutexLocker _(cache->lock);
+	cache->LockForSlabAccess();
+	MutexLocker _(cache->lock, true);
 	cache->ReturnObjectToSlab(cache->ObjectSlab(object), object, flags);
 }
 
@@ -81,6 +82,11 @@ ObjectCache::Init(const char* name, size_t objectSize, size_t alignment,
 	usage = 0;
 	this->maximum = maximum;
 
+	slab_allocations = 0;
+	slab_frees = 0;
+	contended_locks = 0;
+	lock_wait_time = 0;
+
 	this->flags = flags;
 
 	resize_request = NULL;
@@ -206,6 +212,8 @@ ObjectCache::ReturnObjectToSlab(slab* source, void* object, uint32 flags)
 
 	ParanoiaChecker _(source);
 
+	slab_frees++;
+
 #if KDEBUG >= 1
 	uint8* objectsStart = (uint8*)source->pages + source->offset;
 	if (object < objectsStart
@@ -64,6 +64,12 @@ struct ObjectCache : DoublyLinkedListLinkImpl<ObjectCache> {
 			size_t				maximum;
 			uint32				flags;
 
+			// statistics of the slab layer, protected by the lock
+			size_t				slab_allocations;
+			size_t				slab_frees;
+			size_t				contended_locks;
+			bigtime_t			lock_wait_time;
+
 			ResizeRequest*		resize_request;
 
 			ObjectCacheResizeEntry* resize_entry_can_wait;
@@ -109,6 +115,7 @@ public:
 
 			bool				Lock()	{ return mutex_lock(&lock) == B_OK; }
 			void				Unlock()	{ mutex_unlock(&lock); }
+	inline	void				LockForSlabAccess();
 
 			status_t			AllocatePages(void** pages, uint32 flags);
 			void				FreePages(void* pages);
@@ -162,6 +169,22 @@ check_cache_quota(ObjectCache* cache)
 }
 
 
+/*!	Locks the cache for allocating objects from or returning objects to its
+	slabs, and keeps track of how often and how long it had to wait for that.
+*/
+inline void
+ObjectCache::LockForSlabAccess()
+{
+	if (mutex_trylock(&lock) == B_OK)
+		return;
+
+	bigtime_t start = system_time();
+	mutex_lock(&lock);
+	contended_locks++;
+	lock_wait_time += system_time() - start;
+}
+
+
 #if !SLAB_OBJECT_CACHE_ALLOCATION_TRACKING
 
 inline status_t
@@ -10,6 +10,7 @@
 #include <slab/ObjectDepot.h>
 
 #include <algorithm>
+#include <string.h>
 
 #include <interrupts.h>
 #include <slab/Slab.h>
@@ -42,9 +43,35 @@ public:
 struct depot_cpu_store {
 	DepotMagazine*	loaded;
 	DepotMagazine*	previous;
+
+	// statistics, only updated by the owning CPU with interrupts disabled
+	uint64			hits;
+	uint64			misses;
+	uint64			stores;
+	uint64			store_misses;
+	uint64			exchanges;
 };
 
 
+// The full and empty magazines of a depot are kept in lock-free stacks. To
+// avoid the ABA problem, the head pointer is combined with a generation
+// count that is incremented with every change. Magazines are only freed with
+// the depot's outer lock write-locked, so a magazine that has been popped by
+// another CPU in the meantime can still be safely read.
+#ifdef __HAIKU_ARCH_64_BIT
+	// kernel addresses are sign-extended from bit 47
+#	define STACK_TAG_SHIFT		48
+#else
+#	define STACK_TAG_SHIFT		32
+#endif
+#define STACK_POINTER_MASK		(((uint64)1 << STACK_TAG_SHIFT) - 1)
+
+// every time the depot stacks were contended this many times, the capacity
+// of new magazines is increased
+static const int32 kContentionResizeThreshold = 1024;
+static const size_t kMaxMagazineCapacityFactor = 4;
+
+
 RANGE_MARKER_FUNCTION_BEGIN(SlabObjectDepot)
 
 
@@ -99,16 +126,94 @@ DepotMagazine::ContainsObject(void* object) const
 // #pragma mark -
 
 
+static inline DepotMagazine*
+stack_magazine(int64 head)
+{
+#ifdef __HAIKU_ARCH_64_BIT
+	return (DepotMagazine*)(addr_t)(((int64)((uint64)head
+		<< (64 - STACK_TAG_SHIFT))) >> (64 - STACK_TAG_SHIFT));
+#else
+	return (DepotMagazine*)(addr_t)((uint64)head & STACK_POINTER_MASK);
+#endif
+}
+
+
+static inline int64
+stack_head(DepotMagazine* magazine, int64 previousHead)
+{
+	uint64 tag = ((uint64)previousHead >> STACK_TAG_SHIFT) + 1;
+	return (int64)((tag << STACK_TAG_SHIFT)
+		| ((uint64)(addr_t)magazine & STACK_POINTER_MASK));
+}
+
+
+/*!	Called whenever an operation on the depot stacks had to be retried.
+	Frequent contention means that the CPUs exchange their magazines too
+	often, so magazines allocated from now on get a larger capacity.
+*/
+static void
+note_contention(object_depot* depot)
+{
+	int32 contention = atomic_add(&depot->contention, 1) + 1;
+	if ((contention % kContentionResizeThreshold) != 0)
+		return;
+
+	size_t capacity = depot->magazine_capacity;
+	if (capacity < depot->max_magazine_capacity) {
+		depot->magazine_capacity = std::min(capacity + capacity / 2,
+			depot->max_magazine_capacity);
+	}
+}
+
+
+static void
+push_magazine(object_depot* depot, int64* stack, DepotMagazine* magazine)
+{
+	int64 head = atomic_get64(stack);
+	while (true) {
+		magazine->next = stack_magazine(head);
+
+		int64 oldHead = atomic_test_and_set64(stack,
+			stack_head(magazine, head), head);
+		if (oldHead == head)
+			return;
+
+		head = oldHead;
+		note_contention(depot);
+	}
+}
+
+
+/*!	The caller must have read-locked the depot's outer lock. */
+static DepotMagazine*
+pop_magazine(object_depot* depot, int64* stack)
+{
+	int64 head = atomic_get64(stack);
+	while (DepotMagazine* magazine = stack_magazine(head)) {
+		int64 oldHead = atomic_test_and_set64(stack,
+			stack_head(magazine->next, head), head);
+		if (oldHead == head)
+			return magazine;
+
+		head = oldHead;
+		note_contention(depot);
+	}
+
+	return NULL;
+}
+
+
 static DepotMagazine*
 alloc_magazine(object_depot* depot, uint32 flags)
 {
+	size_t capacity = depot->magazine_capacity;
 	DepotMagazine* magazine = (DepotMagazine*)slab_internal_alloc(
-		sizeof(DepotMagazine) + depot->magazine_capacity * sizeof(void*),
-		flags);
+		sizeof(DepotMagazine) + capacity * sizeof(void*), flags);
 	if (magazine) {
 		magazine->next = NULL;
 		magazine->current_round = 0;
-		magazine->round_count = depot->magazine_capacity;
+		magazine->round_count = capacity;
+		atomic_add(&depot->magazine_allocations, 1);
 	}
 
 	return magazine;
@@ -123,10 +228,19 @@ free_magazine(DepotMagazine* magazine, uint32 flags)
 
 
 static void
-empty_magazine(object_depot* depot, DepotMagazine* magazine, uint32 flags)
+return_magazine_objects(object_depot* depot, DepotMagazine* magazine,
+	uint32 flags)
 {
 	for (uint16 i = 0; i < magazine->current_round; i++)
 		depot->return_object(depot, depot->cookie, magazine->rounds[i], flags);
+	magazine->current_round = 0;
+}
+
+
+static void
+empty_magazine(object_depot* depot, DepotMagazine* magazine, uint32 flags)
+{
+	return_magazine_objects(depot, magazine, flags);
 	free_magazine(magazine, flags);
 }
 
@@ -136,16 +250,16 @@ exchange_with_full(object_depot* depot, DepotMagazine*& magazine)
 {
 	ASSERT(magazine->IsEmpty());
 
-	SpinLocker _(depot->inner_lock);
-
-	if (depot->full == NULL)
+	DepotMagazine* full = pop_magazine(depot, &depot->full);
+	if (full == NULL)
 		return false;
 
-	depot->full_count--;
-	depot->empty_count++;
+	atomic_add(&depot->full_count, -1);
 
-	_push(depot->empty, magazine);
-	magazine = _pop(depot->full);
+	push_magazine(depot, &depot->empty, magazine);
+	atomic_add(&depot->empty_count, 1);
+
+	magazine = full;
 	return true;
 }
 
@@ -156,23 +270,24 @@ exchange_with_empty(object_depot* depot, DepotMagazine*& magazine,
 {
 	ASSERT(magazine == NULL || magazine->IsFull());
 
-	SpinLocker _(depot->inner_lock);
-
-	if (depot->empty == NULL)
+	DepotMagazine* empty = pop_magazine(depot, &depot->empty);
+	if (empty == NULL)
 		return false;
 
-	depot->empty_count--;
+	atomic_add(&depot->empty_count, -1);
 
+	freeMagazine = NULL;
 	if (magazine != NULL) {
-		if (depot->full_count < depot->max_count) {
-			_push(depot->full, magazine);
-			depot->full_count++;
-			freeMagazine = NULL;
-		} else
+		// the limit may be exceeded a bit when racing with other CPUs
+		if ((size_t)atomic_add(&depot->full_count, 1) < depot->max_count)
+			push_magazine(depot, &depot->full, magazine);
+		else {
+			atomic_add(&depot->full_count, -1);
 			freeMagazine = magazine;
+		}
 	}
 
-	magazine = _pop(depot->empty);
+	magazine = empty;
 	return true;
 }
 
@@ -180,10 +295,8 @@ exchange_with_empty(object_depot* depot, DepotMagazine*& magazine,
 static void
 push_empty_magazine(object_depot* depot, DepotMagazine* magazine)
 {
-	SpinLocker _(depot->inner_lock);
-
-	_push(depot->empty, magazine);
-	depot->empty_count++;
+	push_magazine(depot, &depot->empty, magazine);
+	atomic_add(&depot->empty_count, 1);
 }
 
 
@@ -202,14 +315,18 @@ object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
 	uint32 flags, void* cookie, void (*return_object)(object_depot* depot,
 		void* cookie, void* object, uint32 flags))
 {
-	depot->full = NULL;
-	depot->empty = NULL;
+	depot->full = 0;
+	depot->empty = 0;
 	depot->full_count = depot->empty_count = 0;
 	depot->max_count = maxCount;
 	depot->magazine_capacity = capacity;
+	depot->min_magazine_capacity = capacity;
+	depot->max_magazine_capacity = std::min(
+		capacity * kMaxMagazineCapacityFactor, (size_t)UINT16_MAX);
+	depot->contention = 0;
+	depot->magazine_allocations = 0;
 
 	rw_lock_init(&depot->outer_lock, "object depot");
-	B_INITIALIZE_SPINLOCK(&depot->inner_lock);
 
 	int cpuCount = smp_get_num_cpus();
 	depot->stores = (depot_cpu_store*)slab_internal_alloc(
@@ -219,10 +336,7 @@ object_depot_init(object_depot* depot, size_t capacity, size_t maxCount,
 		return B_NO_MEMORY;
 	}
 
-	for (int i = 0; i < cpuCount; i++) {
-		depot->stores[i].loaded = NULL;
-		depot->stores[i].previous = NULL;
-	}
+	memset(depot->stores, 0, sizeof(depot_cpu_store) * cpuCount);
 
 	depot->cookie = cookie;
 	depot->return_object = return_object;
@@ -257,19 +371,27 @@ object_depot_obtain(object_depot* depot)
 	// if it's not empty, or from the previous magazine if it's full
 	// and finally from the Slab if the magazine depot has no full magazines.
 
-	if (store->loaded == NULL)
+	if (store->loaded == NULL) {
+		store->misses++;
 		return NULL;
+	}
 
 	while (true) {
-		if (!store->loaded->IsEmpty())
+		if (!store->loaded->IsEmpty()) {
+			store->hits++;
 			return store->loaded->Pop();
+		}
 
-		if (store->previous
-			&& (store->previous->IsFull()
-				|| exchange_with_full(depot, store->previous))) {
+		if (store->previous && store->previous->IsFull()) {
+			std::swap(store->previous, store->loaded);
+		} else if (store->previous
+			&& exchange_with_full(depot, store->previous)) {
+			store->exchanges++;
 			std::swap(store->previous, store->loaded);
-		} else
+		} else {
+			store->misses++;
 			return NULL;
+		}
 	}
 }
 
@@ -288,24 +410,33 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 	// we return the object directly to the slab.
 
 	while (true) {
-		if (store->loaded != NULL && store->loaded->Push(object))
+		if (store->loaded != NULL && store->loaded->Push(object)) {
+			store->stores++;
 			return;
+		}
 
 		DepotMagazine* freeMagazine = NULL;
-		if ((store->previous != NULL && store->previous->IsEmpty())
-			|| exchange_with_empty(depot, store->previous, freeMagazine)) {
+		if (store->previous != NULL && store->previous->IsEmpty()) {
+			std::swap(store->loaded, store->previous);
+		} else if (exchange_with_empty(depot, store->previous, freeMagazine)) {
+			store->exchanges++;
 			std::swap(store->loaded, store->previous);
 
 			if (freeMagazine != NULL) {
-				// Free the magazine that didn't have space in the list
+				// Return the objects of the magazine that didn't have space in
+				// the list. Another CPU might still be looking at it in
+				// pop_magazine(), so it must not be freed here; it is reused
+				// as an empty magazine instead.
 				interruptsLocker.Unlock();
 				readLocker.Unlock();
 
-				empty_magazine(depot, freeMagazine, flags);
+				return_magazine_objects(depot, freeMagazine, flags);
 
 				readLocker.Lock();
 				interruptsLocker.Lock();
 
+				push_empty_magazine(depot, freeMagazine);
+
 				store = object_depot_cpu(depot);
 			}
 		} else {
@@ -316,6 +447,9 @@ object_depot_store(object_depot* depot, void* object, uint32 flags)
 			DepotMagazine* magazine = alloc_magazine(depot, flags);
 			if (magazine == NULL) {
 				depot->return_object(depot, depot->cookie, object, flags);
+
+				InterruptsLocker _;
+				object_depot_cpu(depot)->store_misses++;
 				return;
 			}
 
@@ -355,11 +489,16 @@ object_depot_make_empty(object_depot* depot, uint32 flags)
 
 	// detach the depot's full and empty magazines
 
-	DepotMagazine* fullMagazines = depot->full;
-	depot->full = NULL;
+	DepotMagazine* fullMagazines = stack_magazine(depot->full);
+	depot->full = stack_head(NULL, depot->full);
+	depot->full_count = 0;
+
+	DepotMagazine* emptyMagazines = stack_magazine(depot->empty);
+	depot->empty = stack_head(NULL, depot->empty);
+	depot->empty_count = 0;
 
-	DepotMagazine* emptyMagazines = depot->empty;
-	depot->empty = NULL;
+	// start over with small magazines
+	depot->magazine_capacity = depot->min_magazine_capacity;
 
 	writeLocker.Unlock();
 
@@ -398,8 +537,8 @@ object_depot_contains_object(object_depot* depot, void* object)
 		}
 	}
 
-	for (DepotMagazine* magazine = depot->full; magazine != NULL;
-			magazine = magazine->next) {
+	for (DepotMagazine* magazine = stack_magazine(depot->full);
+			magazine != NULL; magazine = magazine->next) {
 		if (magazine->ContainsObject(object))
 			return true;
 	}
@@ -410,23 +549,57 @@ object_depot_contains_object(object_depot* depot, void* object)
 #endif // PARANOID_KERNEL_FREE
 
 
+/*!	Sums up the statistics of all CPUs. The values are not synchronized with
+	the CPUs updating them, so they are only approximate.
+*/
+void
+object_depot_get_stats(object_depot* depot, object_depot_stats* stats)
+{
+	memset(stats, 0, sizeof(object_depot_stats));
+
+	int cpuCount = smp_get_num_cpus();
+	for (int i = 0; i < cpuCount; i++) {
+		const depot_cpu_store& store = depot->stores[i];
+		stats->hits += store.hits;
+		stats->misses += store.misses;
+		stats->stores += store.stores;
+		stats->store_misses += store.store_misses;
+		stats->exchanges += store.exchanges;
+	}
+
+	stats->contention = (uint32)depot->contention;
+	stats->magazine_capacity = depot->magazine_capacity;
+	stats->full_magazines = depot->full_count;
+}
+
+
 // #pragma mark - private kernel API
 
 
 void
 dump_object_depot(object_depot* depot)
 {
-	kprintf("  full:     %p, count %lu\n", depot->full, depot->full_count);
-	kprintf("  empty:    %p, count %lu\n", depot->empty, depot->empty_count);
+	kprintf("  full:     %p, count %" B_PRId32 "\n",
+		stack_magazine(depot->full), depot->full_count);
+	kprintf("  empty:    %p, count %" B_PRId32 "\n",
+		stack_magazine(depot->empty), depot->empty_count);
 	kprintf("  max full: %lu\n", depot->max_count);
-	kprintf("  capacity: %lu\n", depot->magazine_capacity);
+	kprintf("  capacity: %lu (%lu - %lu)\n", depot->magazine_capacity,
+		depot->min_magazine_capacity, depot->max_magazine_capacity);
+	kprintf("  contention: %" B_PRIu32 ", %" B_PRId32 " magazines allocated\n",
+		(uint32)depot->contention, depot->magazine_allocations);
 	kprintf("  stores:\n");
 
 	int cpuCount = smp_get_num_cpus();
 
 	for (int i = 0; i < cpuCount; i++) {
-		kprintf("  [%d] loaded:   %p\n", i, depot->stores[i].loaded);
-		kprintf("      previous: %p\n", depot->stores[i].previous);
+		const depot_cpu_store& store = depot->stores[i];
+		kprintf("  [%d] loaded:   %p\n", i, store.loaded);
+		kprintf("      previous: %p\n", store.previous);
+		kprintf("      hits %" B_PRIu64 ", misses %" B_PRIu64 ", stores %"
+			B_PRIu64 ", store misses %" B_PRIu64 ", exchanges %" B_PRIu64
+			"\n", store.hits, store.misses, store.stores, store.store_misses,
+			store.exchanges);
 	}
 }
 
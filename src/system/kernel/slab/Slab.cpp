@@ -13,13 +13,17 @@
 #include <new>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <KernelExport.h>
 
+#include <AutoDeleter.h>
 #include <condition_variable.h>
 #include <elf.h>
+#include <generic_syscall.h>
 #include <kernel.h>
 #include <low_resource_manager.h>
+#include <object_cache_stats.h>
 #include <slab/ObjectDepot.h>
 #include <smp.h>
 #include <tracing.h>
@@ -255,9 +259,72 @@ dump_slab(::slab* slab)
 }
 
 
+static void
+get_object_cache_stats(ObjectCache* cache, object_cache_stats& stats)
+{
+	memset(&stats, 0, sizeof(stats));
+	strlcpy(stats.name, cache->name, sizeof(stats.name));
+	stats.object_size = cache->object_size;
+	stats.used_objects = cache->used_count;
+	stats.total_objects = cache->total_objects;
+	stats.usage = cache->usage;
+
+	if ((cache->flags & CACHE_NO_DEPOT) == 0) {
+		object_depot_stats depotStats;
+		object_depot_get_stats(&cache->depot, &depotStats);
+
+		stats.depot_hits = depotStats.hits;
+		stats.depot_misses = depotStats.misses;
+		stats.depot_stores = depotStats.stores;
+		stats.depot_store_misses = depotStats.store_misses;
+		stats.magazine_exchanges = depotStats.exchanges;
+		stats.depot_contention = depotStats.contention;
+		stats.magazine_capacity = depotStats.magazine_capacity;
+		stats.full_magazines = depotStats.full_magazines;
+	}
+
+	stats.slab_allocations = cache->slab_allocations;
+	stats.slab_frees = cache->slab_frees;
+	stats.contended_locks = cache->contended_locks;
+	stats.lock_wait_time = cache->lock_wait_time;
+}
+
+
+static void
+dump_slab_stats()
+{
+	kprintf("%22s %10s %10s %10s %10s %8s %5s %10s %10s %8s %10s\n", "name",
+		"depot hit", "miss", "store", "miss", "exchange", "mag", "slab alloc",
+		"free", "contend", "wait (us)");
+
+	ObjectCacheList::Iterator it = sObjectCaches.GetIterator();
+	while (ObjectCache* cache = it.Next()) {
+		object_cache_stats stats;
+		get_object_cache_stats(cache, stats);
+
+		kprintf("%22s %10" B_PRIu64 " %10" B_PRIu64 " %10" B_PRIu64 " %10"
+			B_PRIu64 " %8" B_PRIu64 " %5" B_PRIu32 " %10" B_PRIu64 " %10"
+			B_PRIu64 " %8" B_PRIu64 " %10" B_PRId64 "\n", stats.name,
+			stats.depot_hits, stats.depot_misses, stats.depot_stores,
+			stats.depot_store_misses, stats.magazine_exchanges,
+			stats.magazine_capacity, stats.slab_allocations, stats.slab_frees,
+			stats.contended_locks, stats.lock_wait_time);
+	}
+}
+
+
 static int
 dump_slabs(int argc, char* argv[])
 {
+	if (argc == 2 && strcmp(argv[1], "--stats") == 0) {
+		dump_slab_stats();
+		return 0;
+	}
+	if (argc > 1) {
+		print_debugger_command_usage(argv[0]);
+		return 0;
+	}
+
 	kprintf("%*s %22s %8s %8s %8s %6s %8s %8s %8s\n",
 		B_PRINTF_POINTER_WIDTH + 2, "address", "name", "objsize", "align",
 		"usage", "empty", "usedobj", "total", "flags");
@@ -1248,7 +1315,8 @@ object_cache_alloc(object_cache* cache, uint32 flags)
 		}
 	}
 
-	MutexLocker locker(cache->lock);
+	cache->LockForSlabAccess();
+	MutexLocker locker(cache->lock, true);
 	slab* source = NULL;
 
 	while (true) {
@@ -1276,6 +1344,7 @@ object_cache_alloc(object_cache* cache, uint32 flags)
 	object_link* link = _pop(source->free);
 	source->count--;
 	cache->used_count++;
+	cache->slab_allocations++;
 
 	if (cache->total_objects - cache->used_count < cache->min_object_reserve)
 		increase_object_reserve(cache);
@@ -1335,7 +1404,8 @@ object_cache_free(object_cache* cache, void* object, uint32 flags)
 		return;
 	}
 
-	MutexLocker _(cache->lock);
+	cache->LockForSlabAccess();
+	MutexLocker _(cache->lock, true);
 	cache->ReturnObjectToSlab(cache->ObjectSlab(object), object, flags);
 }
 
@@ -1377,7 +1447,11 @@ slab_init_post_area()
 {
 	MemoryManager::InitPostArea();
 
-	add_debugger_command("slabs", dump_slabs, "list all object caches");
+	add_debugger_command_etc("slabs", dump_slabs, "list all object caches",
+		"[ --stats ]\n"
+		"Lists all object caches. If \"--stats\" is given, the statistics of\n"
+		"the per-CPU magazine layer and the slab layer of each cache are\n"
+		"printed instead.\n", 0);
 	add_debugger_command("slab_cache", dump_cache_info,
 		"dump information about a specific object cache");
 	add_debugger_command("slab_depot", dump_object_depot,
@@ -1431,6 +1505,73 @@ slab_init_post_sem()
 }
 
 
+static status_t
+object_cache_syscall(const char* subsystem, uint32 function, void* buffer,
+	size_t bufferSize)
+{
+	switch (function) {
+		case GET_OBJECT_CACHE_STATS:
+		{
+			if (geteuid() != 0)
+				return B_NOT_ALLOWED;
+
+			object_cache_stats_request request;
+			if (bufferSize != sizeof(request))
+				return B_BAD_VALUE;
+			if (!IS_USER_ADDRESS(buffer)
+				|| user_memcpy(&request, buffer, sizeof(request)) != B_OK
+				|| (request.count > 0 && !IS_USER_ADDRESS(request.stats))) {
+				return B_BAD_ADDRESS;
+			}
+
+			// The statistics are collected into a kernel buffer first, since
+			// a page fault while copying them out could end up in
+			// object_cache_low_memory(), which needs the cache list lock.
+			MutexLocker locker(sObjectCacheListLock);
+			uint32 statsCount = std::min(request.count,
+				(uint32)sObjectCaches.Count());
+			locker.Unlock();
+
+			object_cache_stats* stats = NULL;
+			if (statsCount > 0) {
+				stats = (object_cache_stats*)malloc(
+					statsCount * sizeof(object_cache_stats));
+				if (stats == NULL)
+					return B_NO_MEMORY;
+			}
+			MemoryDeleter statsDeleter(stats);
+
+			locker.Lock();
+
+			uint32 count = 0;
+			ObjectCacheList::Iterator it = sObjectCaches.GetIterator();
+			while (ObjectCache* cache = it.Next()) {
+				if (count < statsCount)
+					get_object_cache_stats(cache, stats[count]);
+				count++;
+			}
+
+			locker.Unlock();
+
+			if (statsCount > 0) {
+				if (user_memcpy(request.stats, stats,
+						std::min(count, statsCount) * sizeof(*stats))
+						!= B_OK) {
+					return B_BAD_ADDRESS;
+				}
+			}
+
+			request.count = count;
+			if (user_memcpy(buffer, &request, sizeof(request)) != B_OK)
+				return B_BAD_ADDRESS;
+			return B_OK;
+		}
+	}
+
+	return B_BAD_HANDLER;
+}
+
+
 void
 slab_init_post_thread()
 {
@@ -1446,6 +1587,9 @@ slab_init_post_thread()
 	}
 
 	resume_thread(objectCacheResizer);
+
+	register_generic_syscall(OBJECT_CACHE_SYSCALLS, &object_cache_syscall, 1,
+		0);
 }
 
 
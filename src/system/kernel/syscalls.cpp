@@ -29,6 +29,7 @@
 #include <fs/node_monitor.h>
 #include <generic_syscall.h>
 #include <interrupts.h>
+#include <io_ring.h>
 #include <kernel.h>
 #include <kimage.h>
 #include <ksignal.h>
@@ -45,6 +46,7 @@
 #include <sys/resource.h>
 #include <system_profiler.h>
 #include <thread.h>
+#include <tracepoint.h>
 #include <tracing.h>
 #include <user_atomic.h>
 #include <user_mutex.h>
@@ -15,6 +15,7 @@
 #include <team.h>
 
 #include <errno.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -45,6 +46,7 @@
 #include <posix/xsi_semaphore.h>
 #include <safemode.h>
 #include <sem.h>
+#include <spawn_defs.h>
 #include <syscall_process_info.h>
 #include <syscall_load_image.h>
 #include <syscall_restart.h>
@@ -86,6 +88,7 @@ struct team_arg {
 	uint32	flags;
 	port_id	error_port;
 	uint32	error_token;
+	spawn_args*	spawn;
 };
 
 #define TEAM_ARGS_FLAG_NO_ASLR	0x01
@@ -1487,6 +1490,7 @@ free_team_arg(struct team_arg* teamArg)
 {
 	if (teamArg != NULL) {
 		free(teamArg->flat_args);
+		free(teamArg->spawn);
 		free(teamArg->path);
 		free(teamArg);
 	}
@@ -1517,6 +1521,7 @@ create_team_arg(struct team_arg** _teamArg, const char* path, char** flatArgs,
 	teamArg->umask = umask;
 	teamArg->error_port = port;
 	teamArg->error_token = token;
+	teamArg->spawn = NULL;
 
 	// determine the flags from the environment
 	const char* const* env = flatArgs + argCount + 1;
@@ -1532,6 +1537,85 @@ create_team_arg(struct team_arg** _teamArg, const char* path, char** flatArgs,
 }
 
 
+/*!	Applies the posix_spawn() attributes and file actions in \a args to the
+	team of the calling thread, the main thread of a team that has not yet
+	loaded its image. The paths are taken from \a userArgs, the copy of
+	\a args on the new team's stack, so that the file actions can simply be
+	performed by the respective syscall functions.
+*/
+static status_t
+apply_spawn_args(const spawn_args* args, const char* userArgs)
+{
+	if ((args->flags & POSIX_SPAWN_SETSID) != 0) {
+		pid_t result = _user_setsid();
+		if (result < 0)
+			return result;
+	}
+
+	if ((args->flags & POSIX_SPAWN_SETPGROUP) != 0) {
+		pid_t result = _user_setpgid(0, args->process_group);
+		if (result < 0)
+			return result;
+	}
+
+	sigprocmask(SIG_SETMASK, &args->signal_mask, NULL);
+
+	for (uint32 i = 0; i < args->action_count; i++) {
+		const spawn_file_action& action = args->actions[i];
+		const char* path = userArgs + action.path_offset;
+		status_t status = B_OK;
+
+		switch (action.type) {
+			case SPAWN_FILE_ACTION_OPEN:
+			{
+				int fd = _user_open(-1, path, action.open_mode,
+					action.permissions);
+				if (fd < 0 || fd == action.fd) {
+					status = fd;
+					break;
+				}
+
+				status = _user_dup2(fd, action.fd, 0);
+				_user_close(fd);
+				break;
+			}
+
+			case SPAWN_FILE_ACTION_CLOSE:
+				status = _user_close(action.fd);
+				break;
+
+			case SPAWN_FILE_ACTION_DUP2:
+				if (action.source_fd == action.fd) {
+					// the descriptor shall survive the exec nevertheless
+					status = _user_fcntl(action.fd, F_SETFD, 0);
+				} else
+					status = _user_dup2(action.source_fd, action.fd, 0);
+				break;
+
+			case SPAWN_FILE_ACTION_CHDIR:
+				status = _user_setcwd(-1, path);
+				break;
+
+			case SPAWN_FILE_ACTION_FCHDIR:
+				status = _user_setcwd(action.fd, NULL);
+				break;
+
+			default:
+				status = B_BAD_VALUE;
+				break;
+		}
+
+		if (status < 0)
+			return status;
+	}
+
+	// The I/O context was inherited including the close-on-exec descriptors,
+	// as the file actions may still refer to them.
+	vfs_exec_io_context(thread_get_current_thread()->team->io_context);
+	return B_OK;
+}
+
+
 static status_t
 team_create_thread_start_internal(void* args)
 {
@@ -1562,6 +1646,8 @@ team_create_thread_start_internal(void* args)
 	// sizeof(user_space_program_args)	| argument structure for the runtime
 	//									| loader
 	// flat arguments size				| flat process arguments and environment
+	// spawn arguments size				| posix_spawn() attributes and file
+	//									| actions, if any
 
 	// TODO: ENV_SIZE is a) limited, and b) not used after libroot copied it to
 	// the heap
@@ -1597,6 +1683,26 @@ team_create_thread_start_internal(void* args)
 		return B_BAD_ADDRESS;
 	}
 
+	if (teamArgs->spawn != NULL) {
+		char* userSpawnArgs = (char*)userArgs + teamArgs->flat_args_size;
+		err = user_memcpy(userSpawnArgs, teamArgs->spawn,
+			teamArgs->spawn->size);
+		if (err == B_OK)
+			err = apply_spawn_args(teamArgs->spawn, userSpawnArgs);
+		if (err != B_OK) {
+			free_team_arg(teamArgs);
+
+			// tell the waiting parent why the team could not be started
+			TeamLocker teamLocker(team);
+			if (team->loading_info != NULL) {
+				team->loading_info->result = err;
+				team->loading_info->condition.NotifyAll();
+				team->loading_info = NULL;
+			}
+			return err;
+		}
+	}
+
 	free_team_arg(teamArgs);
 		// the arguments are already on the user stack, we no longer need
 		// them in this form
@@ -1687,11 +1793,17 @@ team_create_thread_start(void* args)
 }
 
 
+/*!	Creates a new team running the image given by \a _flatArgs.
+	If \a spawnArgs is given, the function takes over its ownership, and
+	applies the attributes and file actions to the new team before its image
+	is loaded.
+*/
 static thread_id
 load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 	int32 envCount, int32 priority, team_id parentID, uint32 flags,
-	port_id errorPort, uint32 errorToken)
+	port_id errorPort, uint32 errorToken, spawn_args* spawnArgs = NULL)
 {
+	MemoryDeleter spawnArgsDeleter(spawnArgs);
 	char** flatArgs = _flatArgs;
 	thread_id thread;
 	status_t status;
@@ -1751,6 +1863,23 @@ load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 	// inherit the parent's user/group
 	inherit_parent_user_and_group(team, parent);
 
+	if (spawnArgs != NULL) {
+		if ((spawnArgs->flags & POSIX_SPAWN_RESETIDS) != 0) {
+			team->effective_uid = team->real_uid;
+			team->effective_gid = team->real_gid;
+		}
+
+		// like exec*() would, keep the dispositions that aren't handlers
+		team->InheritSignalActions(parent);
+		team->ResetSignalsOnExec();
+		if ((spawnArgs->flags & POSIX_SPAWN_SETSIGDEF) != 0) {
+			for (uint32 i = 1; i <= MAX_SIGNAL_NUMBER; i++) {
+				if ((spawnArgs->default_signals & SIGNAL_TO_MASK(i)) != 0)
+					team->SignalActionFor(i).sa_handler = SIG_DFL;
+			}
+		}
+	}
+
 	// get a reference to the parent's I/O context -- we need it to create ours
 	parentIOContext = (parent->id == B_SYSTEM_TEAM) ? NULL : parent->io_context;
 	if (parentIOContext != NULL)
@@ -1768,13 +1897,15 @@ load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 		goto err1;
 
 	_flatArgs = NULL;
+	teamArgs->spawn = (spawn_args*)spawnArgsDeleter.Detach();
 		// args are owned by the team_arg structure now
 
 	team->SetArgs(path, teamArgs->flat_args + 1, argCount - 1);
 
 	// create a new io_context for this team
 	// remove any fds that have the CLOEXEC flag set (emulating BeOS behaviour)
-	team->io_context = vfs_new_io_context(parentIOContext, true);
+	// -- when spawning, that's done only after the file actions
+	team->io_context = vfs_new_io_context(parentIOContext, spawnArgs == NULL);
 	if (team->io_context == NULL) {
 		status = B_NO_MEMORY;
 		goto err2;
@@ -1838,6 +1969,8 @@ load_image_internal(char**& _flatArgs, size_t flatArgsSize, int32 argCount,
 			threadName, B_NORMAL_PRIORITY, teamArgs, teamID, mainThread);
 		threadAttributes.additional_stack_size = sizeof(user_space_program_args)
 			+ teamArgs->flat_args_size;
+		if (teamArgs->spawn != NULL)
+			threadAttributes.additional_stack_size += teamArgs->spawn->size;
 		thread = thread_create_thread(threadAttributes, false);
 		if (thread < 0) {
 			status = thread;
@@ -4321,6 +4454,81 @@ _user_load_image(const char* const* userFlatArgs, size_t flatArgsSize,
 }
 
 
+thread_id
+_user_spawn_image(const char* const* userFlatArgs, size_t flatArgsSize,
+	int32 argCount, int32 envCount, int32 priority, uint32 flags,
+	const spawn_args* userSpawnArgs)
+{
+	if (argCount < 1)
+		return B_BAD_VALUE;
+
+	// copy the spawn arguments
+	uint32 size;
+	if (userSpawnArgs == NULL || !IS_USER_ADDRESS(userSpawnArgs)
+		|| user_memcpy(&size, &userSpawnArgs->size, sizeof(size)) != B_OK) {
+		return B_BAD_ADDRESS;
+	}
+	if (size < sizeof(spawn_args) || size > MAX_SPAWN_ARGS_SIZE)
+		return B_BAD_VALUE;
+
+	spawn_args* spawnArgs = (spawn_args*)malloc(size);
+	if (spawnArgs == NULL)
+		return B_NO_MEMORY;
+	MemoryDeleter spawnArgsDeleter(spawnArgs);
+
+	if (user_memcpy(spawnArgs, userSpawnArgs, size) != B_OK)
+		return B_BAD_ADDRESS;
+	spawnArgs->size = size;
+
+	// check it -- all paths must be within the block and null-terminated
+	if ((spawnArgs->flags & ~(POSIX_SPAWN_RESETIDS | POSIX_SPAWN_SETPGROUP
+			| POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK
+			| POSIX_SPAWN_SETSID)) != 0
+		|| spawnArgs->action_count > (size - sizeof(spawn_args))
+			/ sizeof(spawn_file_action)) {
+		return B_BAD_VALUE;
+	}
+
+	const uint32 pathsOffset = sizeof(spawn_args)
+		+ spawnArgs->action_count * sizeof(spawn_file_action);
+	for (uint32 i = 0; i < spawnArgs->action_count; i++) {
+		spawn_file_action& action = spawnArgs->actions[i];
+		if (action.type != SPAWN_FILE_ACTION_OPEN
+			&& action.type != SPAWN_FILE_ACTION_CHDIR) {
+			action.path_offset = 0;
+			continue;
+		}
+		if (action.path_offset < pathsOffset || action.path_offset >= size
+			|| strnlen((char*)spawnArgs + action.path_offset,
+				size - action.path_offset) == size - action.path_offset) {
+			return B_BAD_VALUE;
+		}
+	}
+
+	// without an explicit mask, the new team inherits ours
+	if ((spawnArgs->flags & POSIX_SPAWN_SETSIGMASK) == 0) {
+		spawnArgs->signal_mask = thread_get_current_thread()->sig_block_mask;
+		spawnArgs->flags |= POSIX_SPAWN_SETSIGMASK;
+	}
+
+	// copy and relocate the flat arguments
+	char** flatArgs;
+	status_t error = copy_user_process_args(userFlatArgs, flatArgsSize,
+		argCount, envCount, flatArgs);
+	if (error != B_OK)
+		return error;
+
+	thread_id thread = load_image_internal(flatArgs, _ALIGN(flatArgsSize),
+		argCount, envCount, priority, B_CURRENT_TEAM, flags, -1, 0,
+		(spawn_args*)spawnArgsDeleter.Detach());
+
+	free(flatArgs);
+		// load_image_internal() unset our variable if it took over ownership
+
+	return thread;
+}
+
+
 void
 _user_exit_team(status_t returnValue)
 {
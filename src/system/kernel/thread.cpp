@@ -321,6 +321,9 @@ Thread::Thread(const char* name, thread_id threadID, struct cpu_ent* cpu)
 	msg.write_sem = -1;
 	msg.read_sem = -1;
 
+	user_mutex_pi.count = 0;
+	user_mutex_pi.priority = -1;
+
 	// add to thread table -- yet invisible
 	InterruptsWriteSpinLocker threadHashLocker(sThreadHashLock);
 	sThreadHash.Insert(this);
@@ -753,6 +756,10 @@ enter_userspace(Thread* thread, UserThreadEntryArguments* args)
 	userThread->pending_signals = 0;
 	arch_cpu_disable_user_access();
 
+	InterruptsSpinLocker timeLocker(thread->time_lock);
+	thread_publish_cpu_time(thread);
+	timeLocker.Unlock();
+
 	// initialize default TLS fields
 	addr_t tls[TLS_FIRST_FREE_SLOT];
 	memset(tls, 0, sizeof(tls));
@@ -2491,6 +2498,33 @@ thread_at_kernel_exit_no_signals(void)
 }
 
 
+/*!	Publishes the thread's current CPU time clock in its user_thread, so
+	that userland can compute it without entering the kernel, as long as
+	the thread keeps running. Only the time since \c last_time is missing
+	from the snapshot.
+	The caller must hold the thread's \c time_lock, and \a thread must
+	either be the current thread or belong to the current team.
+*/
+void
+thread_publish_cpu_time(Thread* thread)
+{
+	user_thread* userThread = thread->user_thread;
+	if (userThread == NULL)
+		return;
+
+	bigtime_t cpuTime = thread->CPUTime(true);
+
+	arch_cpu_enable_user_access();
+	atomic_add(&userThread->cpu_time_version, 1);
+	memory_write_barrier();
+	userThread->cpu_time = cpuTime;
+	userThread->cpu_time_since = thread->last_time;
+	memory_write_barrier();
+	atomic_add(&userThread->cpu_time_version, 1);
+	arch_cpu_disable_user_access();
+}
+
+
 void
 thread_reset_for_exec(void)
 {
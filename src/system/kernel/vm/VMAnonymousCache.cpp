@@ -39,6 +39,7 @@
 #include <fs/KPath.h>
 #include <fs_info.h>
 #include <fs_interface.h>
+#include <generic_syscall.h>
 #include <heap.h>
 #include <kernel_daemon.h>
 #include <slab/Slab.h>
@@ -56,6 +57,11 @@
 #include <vm/vm_page.h>
 #include <vm/vm_priv.h>
 #include <vm/VMAddressSpace.h>
+#include <vm_compressed_swap.h>
+
+#ifdef ZSTD_ENABLED
+#	include <zstd.h>
+#endif
 
 #include "IORequest.h"
 
@@ -84,6 +90,20 @@
 #define SWAP_BLOCK_SHIFT 5		/* 1 << SWAP_BLOCK_SHIFT == SWAP_BLOCK_PAGES */
 #define SWAP_BLOCK_MASK  (SWAP_BLOCK_PAGES - 1)
 
+// slot indices from here on refer to the compressed swap pool
+#define COMPRESSED_SWAP_SLOT_BASE	0x80000000
+
+// granularity of the allocations in the compressed swap pool
+#define COMPRESSED_SWAP_CHUNK_SIZE	128
+
+// pages that don't compress at least this well are written to the swap files
+#define COMPRESSED_SWAP_MAX_SIZE	(B_PAGE_SIZE * 3 / 4)
+
+// maximum (average) number of pages stored per page of the pool
+#define COMPRESSED_SWAP_SLOTS_PER_PAGE	8
+
+#define COMPRESSED_SWAP_LEVEL		1
+
 
 static const char* const kDefaultSwapPath = "/var/swap";
 
@@ -157,6 +177,42 @@ static mutex sAvailSwapSpaceLock;
 
 static object_cache* sSwapBlockCache;
 
+#ifdef ZSTD_ENABLED
+struct compressed_swap_slot {
+	radix_slot_t	chunk;		// RADIX_SLOT_NONE for zero pages
+	uint16			size;
+};
+
+struct compressed_swap_pool {
+	mutex					lock;
+	area_id					area;
+	uint8*					chunks;
+	uint32					chunk_count;
+	radix_bitmap*			chunk_bitmap;
+	compressed_swap_slot*	slots;
+	swap_addr_t				slot_count;
+	radix_bitmap*			slot_bitmap;
+
+	ZSTD_CCtx*				compress_context;
+	ZSTD_DCtx*				decompress_context;
+	void*					compress_workspace;
+	void*					decompress_workspace;
+	uint8*					page_buffer;
+	uint8*					compress_buffer;
+
+	uint64					stored_pages;
+	uint64					zero_pages;
+	uint64					compressed_size;
+	uint64					stores;
+	uint64					rejects;
+	uint64					pool_reads;
+};
+
+static compressed_swap_pool* sCompressedSwapPool;
+#endif
+
+static int64 sSwapFileReads;
+
 
 #if SWAP_TRACING
 namespace SwapTracing {
@@ -256,6 +312,22 @@ dump_swap_info(int argc, char** argv)
 	kprintf("used:      %9" B_PRIu32 "\n", totalSwapPages - freeSwapPages);
 	kprintf("free:      %9" B_PRIu32 "\n", freeSwapPages);
 
+#ifdef ZSTD_ENABLED
+	compressed_swap_pool* pool = sCompressedSwapPool;
+	if (pool != NULL) {
+		kprintf("\n");
+		kprintf("compressed swap pool: %p, %" B_PRIu32 " chunks, %" B_PRIu32
+			" free\n", pool, pool->chunk_count, pool->chunk_bitmap->free_slots);
+		kprintf("stored:    %9" B_PRIu64 " (%" B_PRIu64 " zero pages, %"
+			B_PRIu64 " bytes compressed)\n", pool->stored_pages,
+			pool->zero_pages, pool->compressed_size);
+		kprintf("stores:    %9" B_PRIu64 " (%" B_PRIu64 " rejected)\n",
+			pool->stores, pool->rejects);
+		kprintf("reads:     %9" B_PRIu64 " (%" B_PRId64 " from swap files)\n",
+			pool->pool_reads, sSwapFileReads);
+	}
+#endif
+
 	return 0;
 }
 
@@ -329,12 +401,355 @@ find_swap_file(swap_addr_t slotIndex)
 }
 
 
+static inline bool
+is_compressed_swap_slot(swap_addr_t slotIndex)
+{
+	return slotIndex != SWAP_SLOT_NONE
+		&& slotIndex >= COMPRESSED_SWAP_SLOT_BASE;
+}
+
+
+#ifdef ZSTD_ENABLED
+
+
+static inline bool
+compressed_swap_available()
+{
+	return sCompressedSwapPool != NULL;
+}
+
+
+static void
+compressed_swap_pool_delete(compressed_swap_pool* pool)
+{
+	if (pool->area >= 0)
+		delete_area(pool->area);
+	if (pool->chunk_bitmap != NULL)
+		radix_bitmap_destroy(pool->chunk_bitmap);
+	if (pool->slot_bitmap != NULL)
+		radix_bitmap_destroy(pool->slot_bitmap);
+	free(pool->slots);
+	free(pool->compress_workspace);
+	free(pool->decompress_workspace);
+	free(pool->page_buffer);
+	free(pool->compress_buffer);
+	mutex_destroy(&pool->lock);
+	delete pool;
+}
+
+
+/*!	Sets aside \a size bytes of memory for the compressed swap pool. Pages
+	written to swap are compressed and kept in the pool, as long as they
+	compress well and there is room left; only the others are written to
+	the swap files.
+*/
+static status_t
+compressed_swap_init(off_t size)
+{
+	size = ROUNDDOWN(size, B_PAGE_SIZE);
+	if (size <= 0)
+		return B_BAD_VALUE;
+
+	uint64 slotCount = size / B_PAGE_SIZE * COMPRESSED_SWAP_SLOTS_PER_PAGE;
+	uint64 chunkCount = size / COMPRESSED_SWAP_CHUNK_SIZE;
+	if (slotCount >= SWAP_SLOT_NONE - COMPRESSED_SWAP_SLOT_BASE
+		|| chunkCount >= RADIX_SLOT_NONE) {
+		return B_BAD_VALUE;
+	}
+
+	compressed_swap_pool* pool = new(std::nothrow) compressed_swap_pool();
+	if (pool == NULL)
+		return B_NO_MEMORY;
+
+	mutex_init(&pool->lock, "compressed swap pool");
+	pool->chunk_count = chunkCount;
+	pool->slot_count = slotCount;
+
+	ZSTD_compressionParameters parameters = ZSTD_getCParams(
+		COMPRESSED_SWAP_LEVEL, B_PAGE_SIZE, 0);
+	size_t compressWorkspaceSize
+		= ZSTD_estimateCCtxSize_usingCParams(parameters);
+	size_t decompressWorkspaceSize = ZSTD_estimateDCtxSize();
+
+	pool->area = create_area("compressed swap pool", (void**)&pool->chunks,
+		B_ANY_KERNEL_ADDRESS, size, B_FULL_LOCK,
+		B_KERNEL_READ_AREA | B_KERNEL_WRITE_AREA);
+	pool->chunk_bitmap = radix_bitmap_create(chunkCount);
+	pool->slot_bitmap = radix_bitmap_create(slotCount);
+	pool->slots = (compressed_swap_slot*)malloc(
+		slotCount * sizeof(compressed_swap_slot));
+	pool->compress_workspace = malloc(compressWorkspaceSize);
+	pool->decompress_workspace = malloc(decompressWorkspaceSize);
+	pool->page_buffer = (uint8*)malloc(B_PAGE_SIZE);
+	pool->compress_buffer = (uint8*)malloc(COMPRESSED_SWAP_MAX_SIZE);
+	if (pool->area < 0 || pool->chunk_bitmap == NULL
+		|| pool->slot_bitmap == NULL || pool->slots == NULL
+		|| pool->compress_workspace == NULL
+		|| pool->decompress_workspace == NULL || pool->page_buffer == NULL
+		|| pool->compress_buffer == NULL) {
+		compressed_swap_pool_delete(pool);
+		return B_NO_MEMORY;
+	}
+
+	pool->compress_context = ZSTD_initStaticCCtx(pool->compress_workspace,
+		compressWorkspaceSize);
+	pool->decompress_context = ZSTD_initStaticDCtx(
+		pool->decompress_workspace, decompressWorkspaceSize);
+	if (pool->compress_context == NULL || pool->decompress_context == NULL) {
+		compressed_swap_pool_delete(pool);
+		return B_ERROR;
+	}
+
+	sCompressedSwapPool = pool;
+	return B_OK;
+}
+
+
+static bool
+is_zero_page(const uint8* buffer)
+{
+	const uint64* data = (const uint64*)buffer;
+	for (size_t i = 0; i < B_PAGE_SIZE / sizeof(uint64); i++) {
+		if (data[i] != 0)
+			return false;
+	}
+
+	return true;
+}
+
+
+/*!	Tries to store the page at \a address in the compressed swap pool.
+	Returns the slot index of the stored page in \a _slotIndex, or an error,
+	if the page has to be written to the swap files instead.
+*/
+static status_t
+compressed_swap_store(generic_addr_t address, generic_size_t length,
+	uint32 flags, swap_addr_t* _slotIndex)
+{
+	compressed_swap_pool* pool = sCompressedSwapPool;
+	if (pool == NULL)
+		return B_NOT_SUPPORTED;
+
+	MutexLocker locker(pool->lock);
+
+	radix_slot_t slot = radix_bitmap_alloc(pool->slot_bitmap, 1);
+	if (slot == RADIX_SLOT_NONE) {
+		pool->rejects++;
+		return B_NO_MEMORY;
+	}
+
+	length = min_c(length, B_PAGE_SIZE);
+	if ((flags & B_PHYSICAL_IO_REQUEST) != 0) {
+		status_t status = vm_memcpy_from_physical(pool->page_buffer, address,
+			length, false);
+		if (status != B_OK) {
+			radix_bitmap_dealloc(pool->slot_bitmap, slot, 1);
+			return status;
+		}
+	} else
+		memcpy(pool->page_buffer, (void*)(addr_t)address, length);
+	if (length < B_PAGE_SIZE)
+		memset(pool->page_buffer + length, 0, B_PAGE_SIZE - length);
+
+	compressed_swap_slot& entry = pool->slots[slot];
+
+	if (is_zero_page(pool->page_buffer)) {
+		entry.chunk = RADIX_SLOT_NONE;
+		entry.size = 0;
+		pool->zero_pages++;
+	} else {
+		size_t size = ZSTD_compressCCtx(pool->compress_context,
+			pool->compress_buffer, COMPRESSED_SWAP_MAX_SIZE, pool->page_buffer,
+			B_PAGE_SIZE, COMPRESSED_SWAP_LEVEL);
+
+		radix_slot_t chunk = RADIX_SLOT_NONE;
+		if (!ZSTD_isError(size)) {
+			chunk = radix_bitmap_alloc(pool->chunk_bitmap,
+				(size + COMPRESSED_SWAP_CHUNK_SIZE - 1)
+					/ COMPRESSED_SWAP_CHUNK_SIZE);
+		}
+		if (chunk == RADIX_SLOT_NONE) {
+			// the page doesn't compress well enough, or the pool is full
+			radix_bitmap_dealloc(pool->slot_bitmap, slot, 1);
+			pool->rejects++;
+			return B_NO_MEMORY;
+		}
+
+		memcpy(pool->chunks + (size_t)chunk * COMPRESSED_SWAP_CHUNK_SIZE,
+			pool->compress_buffer, size);
+		entry.chunk = chunk;
+		entry.size = size;
+		pool->compressed_size += size;
+	}
+
+	pool->stored_pages++;
+	pool->stores++;
+
+	*_slotIndex = COMPRESSED_SWAP_SLOT_BASE + slot;
+	return B_OK;
+}
+
+
+static status_t
+compressed_swap_load(swap_addr_t slotIndex, const generic_io_vec& vec,
+	uint32 flags)
+{
+	compressed_swap_pool* pool = sCompressedSwapPool;
+	ASSERT(pool != NULL);
+
+	MutexLocker locker(pool->lock);
+
+	compressed_swap_slot& entry
+		= pool->slots[slotIndex - COMPRESSED_SWAP_SLOT_BASE];
+	if (entry.size == 0)
+		memset(pool->page_buffer, 0, B_PAGE_SIZE);
+	else {
+		size_t size = ZSTD_decompressDCtx(pool->decompress_context,
+			pool->page_buffer, B_PAGE_SIZE,
+			pool->chunks + (size_t)entry.chunk * COMPRESSED_SWAP_CHUNK_SIZE,
+			entry.size);
+		if (ZSTD_isError(size) || size != B_PAGE_SIZE) {
+			panic("compressed_swap_load(): slot %#" B_PRIx32 " is corrupt: "
+				"%s\n", slotIndex, ZSTD_getErrorName(size));
+			return B_IO_ERROR;
+		}
+	}
+
+	generic_size_t length = min_c(vec.length, B_PAGE_SIZE);
+	if ((flags & B_PHYSICAL_IO_REQUEST) != 0) {
+		status_t status = vm_memcpy_to_physical(vec.base, pool->page_buffer,
+			length, false);
+		if (status != B_OK)
+			return status;
+	} else
+		memcpy((void*)(addr_t)vec.base, pool->page_buffer, length);
+
+	pool->pool_reads++;
+	return B_OK;
+}
+
+
+static void
+compressed_swap_free(swap_addr_t slotIndex)
+{
+	compressed_swap_pool* pool = sCompressedSwapPool;
+	ASSERT(pool != NULL);
+
+	MutexLocker locker(pool->lock);
+
+	radix_slot_t slot = slotIndex - COMPRESSED_SWAP_SLOT_BASE;
+	compressed_swap_slot& entry = pool->slots[slot];
+	if (entry.size == 0)
+		pool->zero_pages--;
+	else {
+		radix_bitmap_dealloc(pool->chunk_bitmap, entry.chunk,
+			(entry.size + COMPRESSED_SWAP_CHUNK_SIZE - 1)
+				/ COMPRESSED_SWAP_CHUNK_SIZE);
+		pool->compressed_size -= entry.size;
+	}
+
+	radix_bitmap_dealloc(pool->slot_bitmap, slot, 1);
+	pool->stored_pages--;
+}
+
+
+static status_t
+compressed_swap_control(const char* subsystem, uint32 function, void* buffer,
+	size_t bufferSize)
+{
+	switch (function) {
+		case GET_COMPRESSED_SWAP_INFO:
+		{
+			if (bufferSize != sizeof(compressed_swap_info))
+				return B_BAD_VALUE;
+
+			compressed_swap_info info = {};
+			info.file_reads = sSwapFileReads;
+
+			compressed_swap_pool* pool = sCompressedSwapPool;
+			if (pool != NULL) {
+				MutexLocker locker(pool->lock);
+
+				info.pool_size
+					= (uint64)pool->chunk_count * COMPRESSED_SWAP_CHUNK_SIZE;
+				info.used_size = (uint64)(pool->chunk_count
+					- pool->chunk_bitmap->free_slots)
+						* COMPRESSED_SWAP_CHUNK_SIZE;
+				info.stored_pages = pool->stored_pages;
+				info.zero_pages = pool->zero_pages;
+				info.compressed_size = pool->compressed_size;
+				info.stores = pool->stores;
+				info.rejects = pool->rejects;
+				info.pool_reads = pool->pool_reads;
+			}
+
+			if (!IS_USER_ADDRESS(buffer)
+				|| user_memcpy(buffer, &info, sizeof(info)) != B_OK) {
+				return B_BAD_ADDRESS;
+			}
+			return B_OK;
+		}
+	}
+
+	return B_BAD_HANDLER;
+}
+
+
+#else	// !ZSTD_ENABLED
+
+
+static inline bool
+compressed_swap_available()
+{
+	return false;
+}
+
+
+static status_t
+compressed_swap_init(off_t size)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+static status_t
+compressed_swap_store(generic_addr_t address, generic_size_t length,
+	uint32 flags, swap_addr_t* _slotIndex)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+static status_t
+compressed_swap_load(swap_addr_t slotIndex, const generic_io_vec& vec,
+	uint32 flags)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
+static void
+compressed_swap_free(swap_addr_t slotIndex)
+{
+}
+
+
+#endif	// !ZSTD_ENABLED
+
+
 static void
 swap_slot_dealloc(swap_addr_t slotIndex, uint32 count)
 {
 	if (slotIndex == SWAP_SLOT_NONE)
 		return;
 
+	if (is_compressed_swap_slot(slotIndex)) {
+		// pages in the compressed pool are always stored individually
+		ASSERT(count == 1);
+		compressed_swap_free(slotIndex);
+		return;
+	}
+
 	mutex_lock(&sSwapFileListLock);
 	swap_file* swapFile = find_swap_file(slotIndex);
 	slotIndex -= swapFile->first_slot;
@@ -781,6 +1196,16 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 
 	for (uint32 i = 0, j = 0; i < count; i = j) {
 		swap_addr_t startSlotIndex = _SwapBlockGetAddress(pageIndex + i);
+		if (is_compressed_swap_slot(startSlotIndex)) {
+			j = i + 1;
+
+			status_t status = compressed_swap_load(startSlotIndex, vecs[i],
+				flags);
+			if (status != B_OK)
+				return status;
+			continue;
+		}
+
 		for (j = i + 1; j < count; j++) {
 			swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + j);
 			if (slotIndex != startSlotIndex + j - i)
@@ -799,6 +1224,8 @@ VMAnonymousCache::Read(off_t offset, const generic_io_vec* vecs, size_t count,
 			vecs + i, j - i, flags, _numBytes);
 		if (status != B_OK)
 			return status;
+
+		atomic_add64(&sSwapFileReads, j - i);
 	}
 
 	return B_OK;
@@ -816,11 +1243,16 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 	page_num_t totalPages = 0;
 	for (uint32 i = 0; i < count; i++) {
 		page_num_t pageCount = (vecs[i].length + B_PAGE_SIZE - 1) >> PAGE_SHIFT;
-		swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex + totalPages);
-		if (slotIndex != SWAP_SLOT_NONE) {
-			swap_slot_dealloc(slotIndex, pageCount);
-			_SwapBlockFree(pageIndex + totalPages, pageCount);
-			fAllocatedSwapSize -= pageCount * B_PAGE_SIZE;
+		for (page_num_t j = 0; j < pageCount; j++) {
+			// The slots of the pages are not necessarily contiguous, as some
+			// might be in the compressed swap pool.
+			swap_addr_t slotIndex
+				= _SwapBlockGetAddress(pageIndex + totalPages + j);
+			if (slotIndex != SWAP_SLOT_NONE) {
+				swap_slot_dealloc(slotIndex, 1);
+				_SwapBlockFree(pageIndex + totalPages + j, 1);
+				fAllocatedSwapSize -= B_PAGE_SIZE;
+			}
 		}
 
 		totalPages += pageCount;
@@ -841,47 +1273,45 @@ VMAnonymousCache::Write(off_t offset, const generic_io_vec* vecs, size_t count,
 
 		generic_addr_t vectorBase = vecs[i].base;
 		generic_size_t vectorLength = vecs[i].length;
-		page_num_t n = pageCount;
-
-		for (page_num_t j = 0; j < pageCount; j += n) {
-			swap_addr_t slotIndex;
-			// try to allocate n slots, if fail, try to allocate n/2
-			while ((slotIndex = swap_slot_alloc(n)) == SWAP_SLOT_NONE && n >= 2)
-				n >>= 1;
-
-			if (slotIndex == SWAP_SLOT_NONE)
-				panic("VMAnonymousCache::Write(): can't allocate swap space\n");
-
-			T(WritePage(this, pageIndex, slotIndex));
-				// TODO: Assumes that only one page is written.
-
-			swap_file* swapFile = find_swap_file(slotIndex);
-
-			off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
-
-			generic_size_t length = (phys_addr_t)n * B_PAGE_SIZE;
-			generic_io_vec vector[1];
-			vector->base = vectorBase;
-			vector->length = length;
-
-			status_t status = vfs_write_pages(swapFile->vnode, swapFile->cookie,
-				pos, vector, 1, flags, &length);
-			if (status != B_OK) {
-				locker.Lock();
-				fAllocatedSwapSize -= (off_t)pagesLeft * B_PAGE_SIZE;
-				locker.Unlock();
 
-				swap_slot_dealloc(slotIndex, n);
-				return status;
+		for (page_num_t j = 0; j < pageCount;) {
+			// Store as many pages as possible in the compressed swap pool, and
+			// write the runs of pages that didn't fit to the swap files.
+			page_num_t runEnd = j;
+			swap_addr_t compressedSlotIndex = SWAP_SLOT_NONE;
+			while (runEnd < pageCount
+				&& compressed_swap_store(vectorBase + runEnd * B_PAGE_SIZE,
+					vectorLength - runEnd * B_PAGE_SIZE, flags,
+					&compressedSlotIndex) != B_OK) {
+				runEnd++;
 			}
 
-			_SwapBlockBuild(pageIndex + totalPages, slotIndex, n);
-			pagesLeft -= n;
+			if (runEnd > j) {
+				page_num_t pagesWritten;
+				status_t status = _WriteSwapFilePages(
+					pageIndex + totalPages + j, vectorBase + j * B_PAGE_SIZE,
+					runEnd - j, flags, pagesWritten);
+				pagesLeft -= pagesWritten;
+				if (status != B_OK) {
+					locker.Lock();
+					fAllocatedSwapSize -= (off_t)pagesLeft * B_PAGE_SIZE;
+					locker.Unlock();
+
+					swap_slot_dealloc(compressedSlotIndex, 1);
+					return status;
+				}
+			}
 
-			if (n != pageCount) {
-				vectorBase = vectorBase + n * B_PAGE_SIZE;
-				vectorLength -= n * B_PAGE_SIZE;
+			if (compressedSlotIndex != SWAP_SLOT_NONE) {
+				T(WritePage(this, pageIndex + totalPages + runEnd,
+					compressedSlotIndex));
+				_SwapBlockBuild(pageIndex + totalPages + runEnd,
+					compressedSlotIndex, 1);
+				pagesLeft--;
+				runEnd++;
 			}
+
+			j = runEnd;
 		}
 
 		totalPages += pageCount;
@@ -907,6 +1337,37 @@ VMAnonymousCache::WriteAsync(off_t offset, const generic_io_vec* vecs,
 	swap_addr_t slotIndex = _SwapBlockGetAddress(pageIndex);
 	bool newSlot = slotIndex == SWAP_SLOT_NONE;
 
+	if (compressed_swap_available()
+		&& (newSlot || is_compressed_swap_slot(slotIndex))) {
+		// Try the compressed swap pool first. Since pages in the pool are
+		// never overwritten in place, a page already stored there always
+		// gets a new slot.
+		status_t status = _WriteCompressed(pageIndex, slotIndex, vecs[0],
+			numBytes, flags);
+		if (status == B_OK) {
+			_callback->IOFinished(B_OK, false, numBytes);
+			return B_OK;
+		}
+		if (status != B_NO_MEMORY && status != B_NOT_SUPPORTED) {
+			_callback->IOFinished(status, true, 0);
+			return status;
+		}
+
+		if (!newSlot) {
+			// the page doesn't fit into the pool anymore, move it to the
+			// swap files
+			swap_slot_dealloc(slotIndex, 1);
+			_SwapBlockFree(pageIndex, 1);
+
+			AutoLocker<VMCache> locker(this);
+			fAllocatedSwapSize -= B_PAGE_SIZE;
+			locker.Unlock();
+
+			slotIndex = SWAP_SLOT_NONE;
+			newSlot = true;
+		}
+	}
+
 	// If the page doesn't have any swap space yet, allocate it.
 	if (newSlot) {
 		AutoLocker<VMCache> locker(this);
@@ -951,6 +1412,48 @@ VMAnonymousCache::WriteAsync(off_t offset, const generic_io_vec* vecs,
 }
 
 
+/*!	Stores the page at \a pageIndex in the compressed swap pool, replacing
+	its previous swap slot \a oldSlotIndex, if any.
+	Returns \c B_NO_MEMORY or \c B_NOT_SUPPORTED, if the page has to be
+	written to the swap files instead.
+*/
+status_t
+VMAnonymousCache::_WriteCompressed(page_num_t pageIndex,
+	swap_addr_t oldSlotIndex, const generic_io_vec& vec,
+	generic_size_t numBytes, uint32 flags)
+{
+	bool newSlot = oldSlotIndex == SWAP_SLOT_NONE;
+	if (newSlot) {
+		AutoLocker<VMCache> locker(this);
+		if (fAllocatedSwapSize + B_PAGE_SIZE > fCommittedSwapSize)
+			return B_ERROR;
+
+		fAllocatedSwapSize += B_PAGE_SIZE;
+	}
+
+	swap_addr_t slotIndex;
+	status_t status = compressed_swap_store(vec.base, numBytes, flags,
+		&slotIndex);
+	if (status != B_OK) {
+		if (newSlot) {
+			AutoLocker<VMCache> locker(this);
+			fAllocatedSwapSize -= B_PAGE_SIZE;
+		}
+		return status;
+	}
+
+	T(WritePage(this, pageIndex, slotIndex));
+
+	if (!newSlot) {
+		swap_slot_dealloc(oldSlotIndex, 1);
+		_SwapBlockFree(pageIndex, 1);
+	}
+	_SwapBlockBuild(pageIndex, slotIndex, 1);
+
+	return B_OK;
+}
+
+
 bool
 VMAnonymousCache::CanWritePage(off_t offset)
 {
@@ -1071,6 +1574,55 @@ VMAnonymousCache::DeleteObject()
 }
 
 
+/*!	Writes the \a pageCount pages at \a vectorBase to newly allocated slots
+	in the swap files. The swap space must already be accounted for in
+	fAllocatedSwapSize. The number of pages that have been written
+	successfully is returned in \a _pagesWritten, even on error.
+*/
+status_t
+VMAnonymousCache::_WriteSwapFilePages(off_t pageIndex,
+	generic_addr_t vectorBase, page_num_t pageCount, uint32 flags,
+	page_num_t& _pagesWritten)
+{
+	page_num_t n = pageCount;
+	_pagesWritten = 0;
+
+	for (page_num_t j = 0; j < pageCount; j += n) {
+		swap_addr_t slotIndex;
+		// try to allocate n slots, if fail, try to allocate n/2
+		while ((slotIndex = swap_slot_alloc(n)) == SWAP_SLOT_NONE && n >= 2)
+			n >>= 1;
+
+		if (slotIndex == SWAP_SLOT_NONE)
+			panic("VMAnonymousCache::Write(): can't allocate swap space\n");
+
+		T(WritePage(this, pageIndex + j, slotIndex));
+			// TODO: Assumes that only one page is written.
+
+		swap_file* swapFile = find_swap_file(slotIndex);
+
+		off_t pos = (off_t)(slotIndex - swapFile->first_slot) * B_PAGE_SIZE;
+
+		generic_size_t length = (phys_addr_t)n * B_PAGE_SIZE;
+		generic_io_vec vector[1];
+		vector->base = vectorBase + j * B_PAGE_SIZE;
+		vector->length = length;
+
+		status_t status = vfs_write_pages(swapFile->vnode, swapFile->cookie,
+			pos, vector, 1, flags, &length);
+		if (status != B_OK) {
+			swap_slot_dealloc(slotIndex, n);
+			return status;
+		}
+
+		_SwapBlockBuild(pageIndex + j, slotIndex, n);
+		_pagesWritten += n;
+	}
+
+	return B_OK;
+}
+
+
 void
 VMAnonymousCache::_SwapBlockBuild(off_t startPageIndex,
 	swap_addr_t startSlotIndex, uint32 count)
@@ -1490,6 +2042,14 @@ swap_file_add(const char* path)
 		swap->first_slot = sSwapFileList.Last()->last_slot + 1;
 		swap->last_slot = swap->first_slot + pageCount;
 	}
+	if ((uint64)swap->first_slot + pageCount > COMPRESSED_SWAP_SLOT_BASE) {
+		// the slots above are used by the compressed swap pool
+		mutex_unlock(&sSwapFileListLock);
+		radix_bitmap_destroy(swap->bmp);
+		delete swap;
+		close(fd);
+		return B_BAD_VALUE;
+	}
 	sSwapFileList.Add(swap);
 	sSwapFileCount++;
 	mutex_unlock(&sSwapFileListLock);
@@ -1587,6 +2147,11 @@ swap_init(void)
 		"Print infos about the swap usage",
 		"\n"
 		"Print infos about the swap usage.\n", 0);
+
+#ifdef ZSTD_ENABLED
+	register_generic_syscall(COMPRESSED_SWAP_SYSCALLS,
+		&compressed_swap_control, 1, 0);
+#endif
 }
 
 
@@ -1601,6 +2166,7 @@ swap_init_post_modules()
 	bool swapEnabled = true;
 	bool swapAutomatic = true;
 	off_t swapSize = 0;
+	off_t compressedSwapSize = 0;
 
 	dev_t swapDeviceID = -1;
 	VolumeInfo selectedVolume = {};
@@ -1613,6 +2179,10 @@ swap_init_post_modules()
 
 		// TODO: Some kind of BFS uuid would be great here :)
 		const char* enabled = get_driver_parameter(settings, "vm", NULL, NULL);
+		const char* compressedSize = get_driver_parameter(settings,
+			"swap_compressed_size", NULL, NULL);
+		if (compressedSize != NULL)
+			compressedSwapSize = atoll(compressedSize);
 
 		if (enabled != NULL) {
 			swapEnabled = get_driver_boolean_parameter(settings, "vm",
@@ -1671,6 +2241,15 @@ swap_init_post_modules()
 		return;
 	}
 
+	if (compressedSwapSize > 0) {
+		status_t error = compressed_swap_init(compressedSwapSize);
+		if (error != B_OK) {
+			dprintf("%s: Failed to set up a %" B_PRIdOFF " bytes compressed "
+				"swap pool: %s\n", __func__, compressedSwapSize,
+				strerror(error));
+		}
+	}
+
 	if (!swapAutomatic && swapDeviceID < 0) {
 		// If user-specified swap, and no swap device has been chosen yet...
 		KDiskDeviceManager::CreateDefault();
@@ -90,6 +90,14 @@ private:
 									swap_addr_t slotIndex, uint32 count);
 			void				_SwapBlockFree(off_t pageIndex, uint32 count);
 			swap_addr_t			_SwapBlockGetAddress(off_t pageIndex);
+			status_t			_WriteCompressed(page_num_t pageIndex,
+									swap_addr_t oldSlotIndex,
+									const generic_io_vec& vec,
+									generic_size_t numBytes, uint32 flags);
+			status_t			_WriteSwapFilePages(off_t pageIndex,
+									generic_addr_t vectorBase,
+									page_num_t pageCount, uint32 flags,
+									page_num_t& _pagesWritten);
 			status_t			_Commit(off_t size, int priority);
 
 			void				_MergePagesSmallerConsumer(
@@ -14,6 +14,10 @@
 #include <vm/VMCache.h>
 
 
+int32 gMappedLargePagesCount;
+int32 gSplitLargePagesCount;
+
+
 // #pragma mark - VMTranslationMap
 
 
@@ -39,6 +43,36 @@ VMTranslationMap::DebugMarkRangePresent(addr_t start, addr_t end,
 }
 
 
+/*!	Returns the size of the large pages MapLargePage() can map, or \c 0, if
+	the architecture doesn't support them.
+	The default implementation returns \c 0.
+*/
+size_t
+VMTranslationMap::LargePageSize() const
+{
+	return 0;
+}
+
+
+/*!	Maps a physically contiguous range of LargePageSize() bytes with a single
+	large page. Both addresses must be aligned to the large page size.
+	The map must be locked, and the caller must have reserved as many pages
+	as MaxPagesNeededToMap() returns for the range.
+	Returns \c B_BUSY, if the range is already partially mapped with normal
+	pages; the caller is expected to fall back to Map() in this case.
+	The translation map is free to split a large page into normal pages
+	again, when only a part of it is unmapped or protected later on.
+	The default implementation returns \c B_NOT_SUPPORTED.
+*/
+status_t
+VMTranslationMap::MapLargePage(addr_t virtualAddress,
+	phys_addr_t physicalAddress, uint32 attributes, uint32 memoryType,
+	vm_page_reservation* reservation)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
 /*!	Unmaps a range of pages of an area.
 
 	The default implementation just iterates over all virtual pages of the
@@ -45,6 +45,7 @@
 #include <system_info.h>
 #include <thread.h>
 #include <team.h>
+#include <tracepoint.h>
 #include <tracing.h>
 #include <util/AutoLock.h>
 #include <util/BitUtils.h>
@@ -58,6 +59,7 @@
 #include "VMAddressSpaceLocking.h"
 #include "VMAnonymousCache.h"
 #include "VMAnonymousNoSwapCache.h"
+#include "VMPageQueue.h"
 #include "IORequest.h"
 
 
@@ -705,6 +707,124 @@ map_page(VMArea* area, vm_page* page, addr_t address, uint32 protection,
 }
 
 
+/*!	Inserts the \a count physically contiguous pages starting with \a page
+	into the area's cache at \a offset, and wires and maps them at
+	\a address. If the run spans exactly one large page, and both addresses
+	are suitably aligned, it is mapped with a single large page.
+	The caller must have reserved enough pages the translation map
+	implementation might need to map the run.
+	The area's cache must be locked.
+*/
+static void
+map_wired_page_run(VMArea* area, vm_page* page, page_num_t count,
+	addr_t address, off_t offset, uint32 protection,
+	vm_page_reservation* reservation)
+{
+	VMTranslationMap* map = area->address_space->TranslationMap();
+	phys_addr_t physicalAddress
+		= (phys_addr_t)page->physical_page_number * B_PAGE_SIZE;
+	size_t largePageSize = map->LargePageSize();
+
+	map->Lock();
+
+	bool mappedLarge = false;
+	if (largePageSize != 0 && count * B_PAGE_SIZE == largePageSize
+		&& address % largePageSize == 0
+		&& physicalAddress % largePageSize == 0) {
+		mappedLarge = map->MapLargePage(address, physicalAddress, protection,
+			area->MemoryType(), reservation) == B_OK;
+	}
+
+	for (page_num_t i = 0; i < count; i++, address += B_PAGE_SIZE,
+			offset += B_PAGE_SIZE, physicalAddress += B_PAGE_SIZE) {
+		page = vm_lookup_page(physicalAddress / B_PAGE_SIZE);
+		if (page == NULL)
+			panic("couldn't lookup physical page just allocated\n");
+
+		if (!mappedLarge) {
+			status_t status = map->Map(address, physicalAddress, protection,
+				area->MemoryType(), reservation);
+			if (status < B_OK)
+				panic("couldn't map physical page in page run\n");
+		}
+
+		area->cache->InsertPage(page, offset);
+		increment_page_wired_count(page);
+
+		DEBUG_PAGE_ACCESS_END(page);
+	}
+
+	map->Unlock();
+}
+
+
+/*!	Frees the \a count physically contiguous pages starting with \a page,
+	which must have been allocated with vm_page_allocate_page_run() and not
+	yet been inserted into a cache. If \a reservation is given, the pages are
+	added to it, otherwise they are unreserved.
+*/
+static void
+free_page_run(vm_page* page, page_num_t count,
+	vm_page_reservation* reservation)
+{
+	page_num_t pageNumber = page->physical_page_number;
+	for (page_num_t i = 0; i < count; i++) {
+		page = vm_lookup_page(pageNumber + i);
+		if (page == NULL)
+			panic("couldn't lookup physical page just allocated\n");
+
+		vm_page_free_etc(NULL, page, reservation);
+	}
+}
+
+
+/*!	Returns the virtual address alignment an area mapping the physical range
+	[\a physicalAddress, \a physicalAddress + \a size) should get, so that
+	it can be mapped with large pages, or 0, if that isn't possible anyway.
+*/
+static size_t
+large_page_alignment(VMTranslationMap* map, uint32 addressSpec,
+	phys_addr_t physicalAddress, addr_t size)
+{
+	size_t largePageSize = map->LargePageSize();
+	if (largePageSize == 0 || size < largePageSize
+		|| physicalAddress % largePageSize != 0
+		|| addressSpec == B_EXACT_ADDRESS) {
+		return 0;
+	}
+
+	return largePageSize;
+}
+
+
+/*!	Maps the physical range [\a physicalAddress, \a physicalAddress + \a size)
+	at \a address, using large pages wherever the alignment of both addresses
+	allows it. The map must be locked.
+*/
+static void
+map_physical_range(VMTranslationMap* map, addr_t address,
+	phys_addr_t physicalAddress, addr_t size, uint32 protection,
+	uint32 memoryType, vm_page_reservation* reservation)
+{
+	size_t largePageSize = map->LargePageSize();
+
+	for (addr_t offset = 0; offset < size;) {
+		if (largePageSize != 0 && size - offset >= largePageSize
+			&& (address + offset) % largePageSize == 0
+			&& (physicalAddress + offset) % largePageSize == 0
+			&& map->MapLargePage(address + offset, physicalAddress + offset,
+				protection, memoryType, reservation) == B_OK) {
+			offset += largePageSize;
+			continue;
+		}
+
+		map->Map(address + offset, physicalAddress + offset, protection,
+			memoryType, reservation);
+		offset += B_PAGE_SIZE;
+	}
+}
+
+
 /*!	If \a preserveModified is \c true, the caller must hold the lock of the
 	page's cache.
 */
@@ -1737,6 +1857,7 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	// For full lock or contiguous areas we're also going to map the pages and
 	// thus need to reserve pages for the mapping backend upfront.
 	addr_t reservedMapPages = 0;
+	size_t largePageSize = 0;
 	if (wiring == B_FULL_LOCK || wiring == B_CONTIGUOUS) {
 		AddressSpaceWriteLocker locker;
 		status_t status = locker.SetTo(team);
@@ -1745,6 +1866,26 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 
 		VMTranslationMap* map = locker.AddressSpace()->TranslationMap();
 		reservedMapPages = map->MaxPagesNeededToMap(0, size - 1);
+
+		// Large pages are only used for wired memory -- pageable memory is
+		// paged in and out one page at a time anyway.
+		if ((protection & B_LARGE_PAGES) != 0 && !isStack
+			&& (flags & CREATE_AREA_DONT_WAIT) == 0
+			&& map->LargePageSize() != 0 && size >= map->LargePageSize()) {
+			largePageSize = map->LargePageSize();
+		}
+	}
+
+	// To be able to use large pages, the area itself needs to be aligned
+	// accordingly.
+	virtual_address_restrictions largePageAddressRestrictions;
+	if (largePageSize != 0
+		&& virtualAddressRestrictions->address_specification
+			!= B_EXACT_ADDRESS
+		&& virtualAddressRestrictions->alignment < largePageSize) {
+		largePageAddressRestrictions = *virtualAddressRestrictions;
+		largePageAddressRestrictions.alignment = largePageSize;
+		virtualAddressRestrictions = &largePageAddressRestrictions;
 	}
 
 	int priority;
@@ -1775,12 +1916,36 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	VMAddressSpace* addressSpace;
 	status_t status;
 
+	// For full lock areas that shall use large pages, try to allocate
+	// suitably aligned page runs first. We take what we can get; the rest
+	// of the area is backed by normal pages.
+	VMPageQueue::PageList largePageRuns;
+	page_num_t largePageRunCount = 0;
+	page_num_t largePageRunPages = largePageSize / B_PAGE_SIZE;
+	if (wiring == B_FULL_LOCK && largePageSize != 0) {
+		physical_address_restrictions runRestrictions = {};
+		runRestrictions.alignment = largePageSize;
+
+		for (addr_t i = size / largePageSize; i > 0; i--) {
+			vm_page* run = vm_page_allocate_page_run(
+				PAGE_STATE_WIRED | pageAllocFlags, largePageRunPages,
+				&runRestrictions, priority);
+			if (run == NULL)
+				break;
+
+			largePageRuns.Add(run);
+			largePageRunCount++;
+		}
+	}
+
 	// For full lock areas reserve the pages before locking the address
 	// space. E.g. block caches can't release their memory while we hold the
 	// address space lock.
 	page_num_t reservedPages = reservedMapPages;
-	if (wiring == B_FULL_LOCK)
-		reservedPages += size / B_PAGE_SIZE;
+	if (wiring == B_FULL_LOCK) {
+		reservedPages += size / B_PAGE_SIZE
+			- largePageRunCount * largePageRunPages;
+	}
 
 	vm_page_reservation reservation;
 	if (reservedPages > 0) {
@@ -1798,8 +1963,20 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 	if (wiring == B_CONTIGUOUS) {
 		// we try to allocate the page run here upfront as this may easily
 		// fail for obvious reasons
-		page = vm_page_allocate_page_run(PAGE_STATE_WIRED | pageAllocFlags,
-			size / B_PAGE_SIZE, physicalAddressRestrictions, priority);
+		if (largePageSize != 0
+			&& physicalAddressRestrictions->alignment < largePageSize
+			&& physicalAddressRestrictions->boundary == 0) {
+			// try a run suitably aligned for large pages first
+			physical_address_restrictions runRestrictions
+				= *physicalAddressRestrictions;
+			runRestrictions.alignment = largePageSize;
+			page = vm_page_allocate_page_run(PAGE_STATE_WIRED | pageAllocFlags,
+				size / B_PAGE_SIZE, &runRestrictions, priority);
+		}
+		if (page == NULL) {
+			page = vm_page_allocate_page_run(PAGE_STATE_WIRED | pageAllocFlags,
+				size / B_PAGE_SIZE, physicalAddressRestrictions, priority);
+		}
 		if (page == NULL) {
 			status = B_NO_MEMORY;
 			goto err0;
@@ -1858,6 +2035,22 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 		{
 			// Allocate and map all pages for this area
 
+			if (largePageRunCount > 0) {
+				// Return the runs that can't be mapped as large pages within
+				// the area (i.e. when it was placed at an unaligned exact
+				// address). Their pages go into our reservation, since that
+				// doesn't cover them yet.
+				addr_t largeStart = ROUNDUP(area->Base(), largePageSize);
+				addr_t largeEnd = ROUNDDOWN(area->Base() + area->Size(),
+					largePageSize);
+				page_num_t usableRuns = largeEnd > largeStart
+					? (largeEnd - largeStart) / largePageSize : 0;
+				for (; largePageRunCount > usableRuns; largePageRunCount--) {
+					free_page_run(largePageRuns.RemoveHead(),
+						largePageRunPages, &reservation);
+				}
+			}
+
 			off_t offset = 0;
 			for (addr_t address = area->Base();
 					address < area->Base() + (area->Size() - 1);
@@ -1872,6 +2065,18 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 #	endif
 					continue;
 #endif
+				if (largePageRunCount > 0 && address % largePageSize == 0
+					&& area->Base() + area->Size() - address
+						>= largePageSize) {
+					map_wired_page_run(area, largePageRuns.RemoveHead(),
+						largePageRunPages, address, offset, protection,
+						&reservation);
+					largePageRunCount--;
+					address += largePageSize - B_PAGE_SIZE;
+					offset += largePageSize - B_PAGE_SIZE;
+					continue;
+				}
+
 				vm_page* page = vm_page_allocate_page(&reservation,
 					PAGE_STATE_WIRED | pageAllocFlags);
 				cache->InsertPage(page, offset);
@@ -1929,34 +2134,30 @@ vm_create_anonymous_area(team_id team, const char *name, addr_t size,
 		case B_CONTIGUOUS:
 		{
 			// We have already allocated our continuous pages run, so we can now
-			// just map them in the address space
-			VMTranslationMap* map = addressSpace->TranslationMap();
+			// just map them in the address space. Where the alignment allows
+			// it, large pages are used.
 			phys_addr_t physicalAddress
 				= (phys_addr_t)page->physical_page_number * B_PAGE_SIZE;
 			addr_t virtualAddress = area->Base();
+			addr_t end = area->Base() + area->Size();
 			off_t offset = 0;
 
-			map->Lock();
-
-			for (virtualAddress = area->Base(); virtualAddress < area->Base()
-					+ (area->Size() - 1); virtualAddress += B_PAGE_SIZE,
-					offset += B_PAGE_SIZE, physicalAddress += B_PAGE_SIZE) {
-				page = vm_lookup_page(physicalAddress / B_PAGE_SIZE);
-				if (page == NULL)
-					panic("couldn't lookup physical page just allocated\n");
-
-				status = map->Map(virtualAddress, physicalAddress, protection,
-					area->MemoryType(), &reservation);
-				if (status < B_OK)
-					panic("couldn't map physical page in page run\n");
+			while (virtualAddress < end) {
+				page_num_t count = 1;
+				if (largePageSize != 0 && virtualAddress % largePageSize == 0
+					&& physicalAddress % largePageSize == 0
+					&& end - virtualAddress >= largePageSize) {
+					count = largePageSize / B_PAGE_SIZE;
+				}
 
-				cache->InsertPage(page, offset);
-				increment_page_wired_count(page);
+				map_wired_page_run(area,
+					vm_lookup_page(physicalAddress / B_PAGE_SIZE), count,
+					virtualAddress, offset, protection, &reservation);
 
-				DEBUG_PAGE_ACCESS_END(page);
+				virtualAddress += count * B_PAGE_SIZE;
+				physicalAddress += count * B_PAGE_SIZE;
+				offset += count * B_PAGE_SIZE;
 			}
-
-			map->Unlock();
 			break;
 		}
 
@@ -1989,6 +2190,8 @@ err1:
 	}
 
 err0:
+	while (vm_page* run = largePageRuns.RemoveHead())
+		free_page_run(run, largePageRunPages, NULL);
 	if (reservedPages > 0)
 		vm_page_unreserve_pages(&reservation);
 	if (reservedMemory > 0)
@@ -2039,6 +2242,11 @@ vm_map_physical_memory(team_id team, const char* name, void** _address,
 	virtual_address_restrictions addressRestrictions = {};
 	addressRestrictions.address = *_address;
 	addressRestrictions.address_specification = addressSpec & ~B_MEMORY_TYPE_MASK;
+	if (!alreadyWired) {
+		addressRestrictions.alignment = large_page_alignment(
+			locker.AddressSpace()->TranslationMap(),
+			addressRestrictions.address_specification, physicalAddress, size);
+	}
 	status = map_backing_store(locker.AddressSpace(), cache, 0, name, size,
 		B_FULL_LOCK, protection, 0, REGION_NO_PRIVATE_MAP, CREATE_AREA_DONT_COMMIT_MEMORY,
 		&addressRestrictions, true, &area, _address);
@@ -2088,12 +2296,8 @@ vm_map_physical_memory(team_id team, const char* name, void** _address,
 				? VM_PRIORITY_SYSTEM : VM_PRIORITY_USER);
 
 		map->Lock();
-
-		for (addr_t offset = 0; offset < size; offset += B_PAGE_SIZE) {
-			map->Map(area->Base() + offset, physicalAddress + offset,
-				protection, area->MemoryType(), &reservation);
-		}
-
+		map_physical_range(map, area->Base(), physicalAddress, size,
+			protection, area->MemoryType(), &reservation);
 		map->Unlock();
 
 		vm_page_unreserve_pages(&reservation);
@@ -2365,6 +2569,16 @@ _vm_map_file(team_id team, const char* name, void** _address,
 			protectionMax = protection | (B_USER_PROTECTION & ~B_WRITE_AREA);
 	}
 
+	// The file system must be able to write back the pages of a shared
+	// mapping that is, or may later become, writable
+	if (mapping == REGION_NO_PRIVATE_MAP
+		&& ((protection | protectionMax)
+			& (B_WRITE_AREA | B_KERNEL_WRITE_AREA)) != 0) {
+		status_t status = vfs_prepare_writable_mapping(fd, kernel);
+		if (status != B_OK)
+			return status;
+	}
+
 	// get the vnode for the object, this also grabs a ref to it
 	struct vnode* vnode = NULL;
 	status_t status = vfs_get_vnode_from_fd(fd, kernel, &vnode);
@@ -2605,6 +2819,25 @@ vm_clone_area(team_id team, const char* name, void** address,
 	VMArea* newArea;
 	addressRestrictions.address = *address;
 	addressRestrictions.address_specification = addressSpec;
+
+	phys_addr_t physicalAddress = 0;
+	if (sourceArea->cache_type == CACHE_TYPE_DEVICE
+		&& sourceArea->wiring == B_FULL_LOCK) {
+		// we don't have actual pages to map but a physical area -- look up
+		// its address, so that we can align the clone for large pages
+		VMTranslationMap* map = sourceArea->address_space->TranslationMap();
+		map->Lock();
+
+		uint32 oldProtection;
+		map->Query(sourceArea->Base(), &physicalAddress, &oldProtection);
+
+		map->Unlock();
+
+		addressRestrictions.alignment = large_page_alignment(
+			targetAddressSpace->TranslationMap(), addressSpec, physicalAddress,
+			sourceArea->Size());
+	}
+
 	status = map_backing_store(targetAddressSpace, cache,
 		sourceArea->cache_offset, name, sourceArea->Size(),
 		sourceArea->wiring, protection, protectionMax,
@@ -2624,17 +2857,7 @@ vm_clone_area(team_id team, const char* name, void** address,
 		// we need to map in everything at this point
 		if (sourceArea->cache_type == CACHE_TYPE_DEVICE) {
 			// we don't have actual pages to map but a physical area
-			VMTranslationMap* map
-				= sourceArea->address_space->TranslationMap();
-			map->Lock();
-
-			phys_addr_t physicalAddress;
-			uint32 oldProtection;
-			map->Query(sourceArea->Base(), &physicalAddress, &oldProtection);
-
-			map->Unlock();
-
-			map = targetAddressSpace->TranslationMap();
+			VMTranslationMap* map = targetAddressSpace->TranslationMap();
 			size_t reservePages = map->MaxPagesNeededToMap(newArea->Base(),
 				newArea->Base() + (newArea->Size() - 1));
 
@@ -2643,13 +2866,9 @@ vm_clone_area(team_id team, const char* name, void** address,
 				targetAddressSpace == VMAddressSpace::Kernel()
 					? VM_PRIORITY_SYSTEM : VM_PRIORITY_USER);
 			map->Lock();
-
-			for (addr_t offset = 0; offset < newArea->Size();
-					offset += B_PAGE_SIZE) {
-				map->Map(newArea->Base() + offset, physicalAddress + offset,
-					protection, newArea->MemoryType(), &reservation);
-			}
-
+			map_physical_range(map, newArea->Base(), physicalAddress,
+				newArea->Size(), protection, newArea->MemoryType(),
+				&reservation);
 			map->Unlock();
 			vm_page_unreserve_pages(&reservation);
 		} else {
@@ -4125,6 +4344,8 @@ vm_page_fault(addr_t address, addr_t faultAddress, bool isWrite, bool isExecute,
 		faultAddress));
 
 	TPF(PageFaultStart(address, isWrite, isUser, faultAddress));
+	TRACEPOINT(B_TRACEPOINT_VM, B_TRACEPOINT_PAGE_FAULT_BEGIN, address,
+		isWrite);
 
 	addr_t pageAddress = ROUNDDOWN(address, B_PAGE_SIZE);
 	VMAddressSpace* addressSpace = NULL;
@@ -4166,6 +4387,8 @@ vm_page_fault(addr_t address, addr_t faultAddress, bool isWrite, bool isExecute,
 			isUser, NULL);
 	}
 
+	TRACEPOINT(B_TRACEPOINT_VM, B_TRACEPOINT_PAGE_FAULT_END, address, status);
+
 	if (status < B_OK) {
 		if (!isUser) {
 			dprintf("vm_page_fault: vm_soft_fault returned error '%s' on fault at "
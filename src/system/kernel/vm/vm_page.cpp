@@ -26,7 +26,10 @@
 #include <elf.h>
 #include <heap.h>
 #include <kernel.h>
+#include <generic_syscall.h>
 #include <low_resource_manager.h>
+#include <numa.h>
+#include <smp.h>
 #include <thread.h>
 #include <tracing.h>
 #include <util/AutoLock.h>
@@ -37,6 +40,7 @@
 #include <vm/VMAddressSpace.h>
 #include <vm/VMArea.h>
 #include <vm/VMCache.h>
+#include <vm_page_magazines.h>
 
 #include "IORequest.h"
 #include "PageCacheLocker.h"
@@ -66,6 +70,11 @@
 #define SCRUB_SIZE 32
 	// this many pages will be cleared at once in the page scrubber thread
 
+#define PAGE_MAGAZINE_SIZE	64
+	// maximum number of free and of clear pages each CPU keeps around
+#define PAGE_MAGAZINE_BATCH	32
+	// this many pages are moved between the queues and a magazine at once
+
 #define MAX_PAGE_WRITER_IO_PRIORITY				B_URGENT_DISPLAY_PRIORITY
 	// maximum I/O priority of the page writer
 #define MAX_PAGE_WRITER_IO_PRIORITY_THRESHOLD	10000
@@ -103,9 +112,16 @@ static const int32 kPageUsageDecline = 1;
 int32 gMappedPagesCount;
 
 static VMPageQueue sPageQueues[PAGE_STATE_FIRST_UNQUEUED];
+	// the entries for free and clear pages are unused, see below
+
+// Free and clear pages are queued per memory node, so that they can be
+// allocated on the node of the CPU that is going to use them. Until the NUMA
+// topology is known (and on machines without one), all of them belong to
+// node 0.
+static VMPageQueue sFreePageQueues[NUMA_MAX_NODES];
+static VMPageQueue sClearPageQueues[NUMA_MAX_NODES];
+static int32 sPageNodeCount = 1;
 
-static VMPageQueue& sFreePageQueue = sPageQueues[PAGE_STATE_FREE];
-static VMPageQueue& sClearPageQueue = sPageQueues[PAGE_STATE_CLEAR];
 static VMPageQueue& sModifiedPageQueue = sPageQueues[PAGE_STATE_MODIFIED];
 static VMPageQueue& sInactivePageQueue = sPageQueues[PAGE_STATE_INACTIVE];
 static VMPageQueue& sActivePageQueue = sPageQueues[PAGE_STATE_ACTIVE];
@@ -133,6 +149,36 @@ static mutex sPageDeficitLock = MUTEX_INITIALIZER("page deficit");
 static rw_lock sFreePageQueuesLock
 	= RW_LOCK_INITIALIZER("free/clear page queues");
 
+// Each CPU caches a few free and clear pages, so that most allocations and
+// frees don't need to touch sFreePageQueuesLock and the queues. The pages in
+// a magazine keep their PAGE_STATE_FREE/PAGE_STATE_CLEAR state and are still
+// accounted for in sUnreservedFreePages, they are just not in a queue. A
+// magazine only holds pages of its CPU's memory node.
+// Magazines are only refilled with the free page queues lock read-locked;
+// whoever needs to see all free pages in the queues increments
+// sPageMagazinesDisabled and drains all magazines with the lock write-locked.
+struct page_magazine {
+	uint32		count;
+	vm_page*	pages[PAGE_MAGAZINE_SIZE];
+};
+
+struct CACHE_LINE_ALIGN cpu_page_magazines {
+	spinlock		lock;
+	page_magazine	free;
+	page_magazine	clear;
+
+	uint64			hits;
+	uint64			misses;
+	uint64			refills;
+	uint64			drains;
+};
+
+static cpu_page_magazines sPageMagazines[SMP_MAX_CPUS];
+static int32 sPageMagazinesDisabled = 1;
+	// enabled in vm_page_init_post_thread()
+
+static page_num_t count_page_magazine_pages();
+
 #ifdef TRACK_PAGE_USAGE_STATS
 static page_num_t sPageUsageArrays[512];
 static page_num_t* sPageUsage = sPageUsageArrays;
@@ -760,6 +806,48 @@ private:
 #endif	// VM_PAGE_ALLOCATION_TRACKING_AVAILABLE
 
 
+/*!	Returns the memory node whose queues the free page \a page belongs to.
+*/
+static inline int32
+page_node(const vm_page* page)
+{
+	if (sPageNodeCount == 1)
+		return 0;
+
+	return numa_physical_page_node(page->physical_page_number);
+}
+
+
+/*!	Returns the memory node whose free pages \a cpu should use.
+*/
+static inline int32
+cpu_page_node(int32 cpu)
+{
+	if (sPageNodeCount == 1)
+		return 0;
+
+	return numa_cpu_node(cpu);
+}
+
+
+static inline VMPageQueue&
+free_page_queue(int32 node, bool clear)
+{
+	return clear ? sClearPageQueues[node] : sFreePageQueues[node];
+}
+
+
+static page_num_t
+count_free_queue_pages(bool clear)
+{
+	page_num_t count = 0;
+	for (int32 i = 0; i < sPageNodeCount; i++)
+		count += free_page_queue(i, clear).Count();
+
+	return count;
+}
+
+
 static void
 list_page(vm_page* page)
 {
@@ -829,8 +917,6 @@ find_page(int argc, char **argv)
 		const char*	name;
 		VMPageQueue*	queue;
 	} pageQueueInfos[] = {
-		{ "free",		&sFreePageQueue },
-		{ "clear",		&sClearPageQueue },
 		{ "modified",	&sModifiedPageQueue },
 		{ "active",		&sActivePageQueue },
 		{ "inactive",	&sInactivePageQueue },
@@ -849,6 +935,21 @@ find_page(int argc, char **argv)
 	address = strtoul(argv[index], NULL, 0);
 	page = (vm_page*)address;
 
+	for (int32 node = 0; node < sPageNodeCount; node++) {
+		for (int32 clear = 0; clear < 2; clear++) {
+			VMPageQueue* queue = &free_page_queue(node, clear != 0);
+			VMPageQueue::Iterator it = queue->GetIterator();
+			while (vm_page* p = it.Next()) {
+				if (p == page) {
+					kprintf("found page %p in queue %p (%s, node %" B_PRId32
+						")\n", page, queue, clear != 0 ? "clear" : "free",
+						node);
+					return 0;
+				}
+			}
+		}
+	}
+
 	for (i = 0; pageQueueInfos[i].name; i++) {
 		VMPageQueue::Iterator it = pageQueueInfos[i].queue->GetIterator();
 		while (vm_page* p = it.Next()) {
@@ -1060,16 +1161,27 @@ dump_page_queue(int argc, char **argv)
 	struct VMPageQueue *queue;
 
 	if (argc < 2) {
-		kprintf("usage: page_queue <address/name> [list]\n");
+		kprintf("usage: page_queue <address/name[:node]> [list]\n");
 		return 0;
 	}
 
+	// the free and clear queues of other memory nodes are selected by
+	// appending the node, e.g. "free:1"
+	int32 node = 0;
+	if (const char* colon = strchr(argv[1], ':')) {
+		node = strtoul(colon + 1, NULL, 0);
+		if (node >= sPageNodeCount) {
+			kprintf("page_queue: invalid node %" B_PRId32 ".\n", node);
+			return 0;
+		}
+	}
+
 	if (strlen(argv[1]) >= 2 && argv[1][0] == '0' && argv[1][1] == 'x')
 		queue = (VMPageQueue*)strtoul(argv[1], NULL, 16);
-	else if (!strcmp(argv[1], "free"))
-		queue = &sFreePageQueue;
-	else if (!strcmp(argv[1], "clear"))
-		queue = &sClearPageQueue;
+	else if (!strncmp(argv[1], "free", 4))
+		queue = &free_page_queue(node, false);
+	else if (!strncmp(argv[1], "clear", 5))
+		queue = &free_page_queue(node, true);
 	else if (!strcmp(argv[1], "modified"))
 		queue = &sModifiedPageQueue;
 	else if (!strcmp(argv[1], "active"))
@@ -1186,6 +1298,8 @@ dump_page_stats(int argc, char **argv)
 	kprintf("unsatisfied page reservations: %" B_PRId32 "\n",
 		sUnsatisfiedPageReservations);
 	kprintf("mapped pages: %" B_PRId32 "\n", gMappedPagesCount);
+	kprintf("mapped large pages: %" B_PRId32 " (split: %" B_PRId32 ")\n",
+		gMappedLargePagesCount, gSplitLargePagesCount);
 	kprintf("longest free pages run: %" B_PRIuPHYSADDR " pages (at %"
 		B_PRIuPHYSADDR ")\n", longestFreeRun.Length(),
 		sPages[longestFreeRun.start].physical_page_number);
@@ -1202,10 +1316,15 @@ dump_page_stats(int argc, char **argv)
 			waiter->requested, waiter->reserved, waiter->dontTouch);
 	}
 
-	kprintf("\nfree queue: %p, count = %" B_PRIuPHYSADDR "\n", &sFreePageQueue,
-		sFreePageQueue.Count());
-	kprintf("clear queue: %p, count = %" B_PRIuPHYSADDR "\n", &sClearPageQueue,
-		sClearPageQueue.Count());
+	kprintf("\n");
+	for (int32 node = 0; node < sPageNodeCount; node++) {
+		kprintf("free queue (node %" B_PRId32 "): %p, count = %"
+			B_PRIuPHYSADDR "\n", node, &free_page_queue(node, false),
+			free_page_queue(node, false).Count());
+		kprintf("clear queue (node %" B_PRId32 "): %p, count = %"
+			B_PRIuPHYSADDR "\n", node, &free_page_queue(node, true),
+			free_page_queue(node, true).Count());
+	}
 	kprintf("modified queue: %p, count = %" B_PRIuPHYSADDR " (%" B_PRId32
 		" temporary, %" B_PRIuPHYSADDR " swappable, " "inactive: %"
 		B_PRIuPHYSADDR ")\n", &sModifiedPageQueue, sModifiedPageQueue.Count(),
@@ -1216,6 +1335,18 @@ dump_page_stats(int argc, char **argv)
 		&sInactivePageQueue, sInactivePageQueue.Count());
 	kprintf("cached queue: %p, count = %" B_PRIuPHYSADDR "\n",
 		&sCachedPageQueue, sCachedPageQueue.Count());
+
+	kprintf("\nper-CPU page magazines (%s, %" B_PRIuPHYSADDR " pages):\n",
+		sPageMagazinesDisabled != 0 ? "disabled" : "enabled",
+		count_page_magazine_pages());
+	for (int32 i = 0; i < smp_get_num_cpus(); i++) {
+		cpu_page_magazines& magazines = sPageMagazines[i];
+		kprintf("  cpu %2" B_PRId32 ": free: %3" B_PRIu32 ", clear: %3" B_PRIu32
+			", hits: %" B_PRIu64 ", misses: %" B_PRIu64 ", refills: %"
+			B_PRIu64 ", drains: %" B_PRIu64 "\n", i, magazines.free.count,
+			magazines.clear.count, magazines.hits, magazines.misses,
+			magazines.refills, magazines.drains);
+	}
 	return 0;
 }
 
@@ -1551,6 +1682,299 @@ unreserve_pages(uint32 count)
 }
 
 
+/*!	Removes a page from the free and clear queues. The queues of the current
+	CPU's memory node are tried first, then those of the other nodes by their
+	distance. Within a node, clear pages are preferred if \a clear is
+	\c true, free pages otherwise.
+	The caller must have read-locked the free page queues lock; if it has
+	write-locked it, \a locked must be \c true.
+*/
+static vm_page*
+remove_free_queue_page(bool clear, bool locked)
+{
+	const int32* nodes
+		= numa_nodes_by_distance(cpu_page_node(smp_get_current_cpu()));
+
+	for (int32 i = 0; i < sPageNodeCount; i++) {
+		VMPageQueue& queue = free_page_queue(nodes[i], clear);
+		VMPageQueue& otherQueue = free_page_queue(nodes[i], !clear);
+
+		vm_page* page = locked
+			? queue.RemoveHead() : queue.RemoveHeadUnlocked();
+		if (page == NULL) {
+			page = locked
+				? otherQueue.RemoveHead() : otherQueue.RemoveHeadUnlocked();
+		}
+		if (page != NULL)
+			return page;
+	}
+
+	return NULL;
+}
+
+
+static inline int
+init_allocated_page(vm_page* page, uint32 flags)
+{
+	if (page->CacheRef() != NULL)
+		panic("supposed to be free page %p has cache @! page %p; cache _cache", page, page);
+
+	DEBUG_PAGE_ACCESS_START(page);
+
+	int oldPageState = page->State();
+	page->SetState(flags & VM_PAGE_ALLOC_STATE);
+	page->busy = (flags & VM_PAGE_ALLOC_BUSY) != 0;
+	page->usage_count = 0;
+	page->accessed = false;
+	page->modified = false;
+
+	return oldPageState;
+}
+
+
+/*!	Moves up to \a count pages from the head of \a queue into \a magazine.
+	The caller must hold the free page queues lock and the magazine's lock.
+*/
+static uint32
+refill_page_magazine(page_magazine& magazine, VMPageQueue& queue,
+	uint32 count)
+{
+	SpinLocker queueLocker(queue.GetLock());
+
+	uint32 moved = 0;
+	while (moved < count && magazine.count < PAGE_MAGAZINE_SIZE) {
+		vm_page* page = queue.RemoveHead();
+		if (page == NULL)
+			break;
+
+		magazine.pages[magazine.count++] = page;
+		moved++;
+	}
+
+	return moved;
+}
+
+
+/*!	Moves the \a count coldest pages of \a magazine back into \a queue.
+	The caller must hold the free page queues lock and the magazine's lock.
+*/
+static void
+drain_page_magazine(page_magazine& magazine, VMPageQueue& queue, uint32 count)
+{
+	count = std::min(count, magazine.count);
+	if (count == 0)
+		return;
+
+	SpinLocker queueLocker(queue.GetLock());
+
+	// the pages at the bottom have been in the magazine the longest
+	for (uint32 i = count; i-- > 0;)
+		queue.Prepend(magazine.pages[i]);
+
+	magazine.count -= count;
+	memmove(magazine.pages, magazine.pages + count,
+		magazine.count * sizeof(vm_page*));
+}
+
+
+/*!	Moves all pages from all per-CPU magazines back into the free and clear
+	queues. The caller must have write-locked the free page queues lock.
+*/
+static void
+drain_page_magazines()
+{
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++) {
+		cpu_page_magazines& magazines = sPageMagazines[i];
+		InterruptsSpinLocker locker(magazines.lock);
+
+		if (magazines.free.count + magazines.clear.count > 0)
+			magazines.drains++;
+
+		int32 node = cpu_page_node(i);
+		drain_page_magazine(magazines.free, free_page_queue(node, false),
+			magazines.free.count);
+		drain_page_magazine(magazines.clear, free_page_queue(node, true),
+			magazines.clear.count);
+	}
+}
+
+
+/*!	Keeps the per-CPU magazines from being refilled or filled by freed pages
+	until enable_page_magazines() is called. Must be called before
+	write-locking the free page queues lock; after locking, the caller needs
+	to call drain_page_magazines() to get every free page into the queues.
+*/
+static inline void
+disable_page_magazines()
+{
+	atomic_add(&sPageMagazinesDisabled, 1);
+}
+
+
+static inline void
+enable_page_magazines()
+{
+	atomic_add(&sPageMagazinesDisabled, -1);
+}
+
+
+/*!	Takes a page from the current CPU's magazines and initializes it for
+	allocation with \a flags. If \a refill is \c true, the caller must have
+	read-locked the free page queues lock, and an empty magazine is refilled
+	from the queues first.
+	Returns \c NULL, if no page could be found this way.
+*/
+static vm_page*
+allocate_page_from_magazine(uint32 flags, bool refill, int& oldPageState)
+{
+	InterruptsLocker interruptsLocker;
+	cpu_page_magazines& magazines = sPageMagazines[smp_get_current_cpu()];
+	SpinLocker locker(magazines.lock);
+
+	// The flag can only change while the free page queues lock is
+	// write-locked, and the magazines are empty while it is set.
+	if (refill && atomic_get(&sPageMagazinesDisabled) != 0)
+		return NULL;
+
+	bool clear = (flags & VM_PAGE_ALLOC_CLEAR) != 0;
+	int32 node = cpu_page_node(smp_get_current_cpu());
+
+	page_magazine* magazine = clear ? &magazines.clear : &magazines.free;
+	page_magazine* otherMagazine = clear ? &magazines.free : &magazines.clear;
+	VMPageQueue* queue = &free_page_queue(node, clear);
+	VMPageQueue* otherQueue = &free_page_queue(node, !clear);
+
+	if (magazine->count == 0 && otherMagazine->count == 0) {
+		if (!refill)
+			return NULL;
+
+		magazines.misses++;
+
+		if (refill_page_magazine(*magazine, *queue, PAGE_MAGAZINE_BATCH) == 0
+			&& refill_page_magazine(*otherMagazine, *otherQueue,
+				PAGE_MAGAZINE_BATCH) == 0) {
+			return NULL;
+		}
+
+		magazines.refills++;
+	} else
+		magazines.hits++;
+
+	if (magazine->count == 0)
+		magazine = otherMagazine;
+
+	vm_page* page = magazine->pages[--magazine->count];
+	oldPageState = init_allocated_page(page, flags);
+	return page;
+}
+
+
+/*!	Puts a page that is to be freed into the current CPU's magazine.
+	Returns \c false, if the magazine is full or the magazines are disabled;
+	the page is left untouched in this case.
+*/
+static bool
+free_page_to_magazine(vm_page* page, bool clear)
+{
+	InterruptsLocker interruptsLocker;
+	cpu_page_magazines& magazines = sPageMagazines[smp_get_current_cpu()];
+	SpinLocker locker(magazines.lock);
+
+	// Checked with the magazine lock held, so that either the page is added
+	// before drain_page_magazines() empties this magazine, or we see that the
+	// magazines have been disabled.
+	if (atomic_get(&sPageMagazinesDisabled) != 0)
+		return false;
+
+	// pages of other memory nodes go back to their own queues
+	if (page_node(page) != cpu_page_node(smp_get_current_cpu()))
+		return false;
+
+	page_magazine& magazine = clear ? magazines.clear : magazines.free;
+	if (magazine.count == PAGE_MAGAZINE_SIZE)
+		return false;
+
+	DEBUG_PAGE_ACCESS_END(page);
+
+	page->SetState(clear ? PAGE_STATE_CLEAR : PAGE_STATE_FREE);
+	magazine.pages[magazine.count++] = page;
+	return true;
+}
+
+
+/*!	Moves a batch of pages from the current CPU's full magazine back into
+	the queue. The caller must have read-locked the free page queues lock.
+*/
+static void
+trim_page_magazine(bool clear)
+{
+	InterruptsLocker interruptsLocker;
+	cpu_page_magazines& magazines = sPageMagazines[smp_get_current_cpu()];
+	SpinLocker locker(magazines.lock);
+
+	page_magazine& magazine = clear ? magazines.clear : magazines.free;
+	if (magazine.count < PAGE_MAGAZINE_SIZE)
+		return;
+
+	drain_page_magazine(magazine,
+		free_page_queue(cpu_page_node(smp_get_current_cpu()), clear),
+		PAGE_MAGAZINE_BATCH);
+	magazines.drains++;
+}
+
+
+static page_num_t
+count_page_magazine_pages()
+{
+	page_num_t count = 0;
+
+	int32 cpuCount = smp_get_num_cpus();
+	for (int32 i = 0; i < cpuCount; i++)
+		count += sPageMagazines[i].free.count + sPageMagazines[i].clear.count;
+
+	return count;
+}
+
+
+static status_t
+page_magazines_control(const char* subsystem, uint32 function, void* buffer,
+	size_t bufferSize)
+{
+	switch (function) {
+		case GET_VM_PAGE_MAGAZINE_INFO:
+		{
+			if (bufferSize != sizeof(vm_page_magazine_info))
+				return B_BAD_VALUE;
+
+			vm_page_magazine_info info = {};
+			info.cpu_count = smp_get_num_cpus();
+			info.magazine_size = PAGE_MAGAZINE_SIZE;
+
+			for (uint32 i = 0; i < info.cpu_count; i++) {
+				cpu_page_magazines& magazines = sPageMagazines[i];
+				InterruptsSpinLocker locker(magazines.lock);
+
+				info.free_pages += magazines.free.count;
+				info.clear_pages += magazines.clear.count;
+				info.hits += magazines.hits;
+				info.misses += magazines.misses;
+				info.refills += magazines.refills;
+				info.drains += magazines.drains;
+			}
+
+			if (!IS_USER_ADDRESS(buffer)
+				|| user_memcpy(buffer, &info, sizeof(info)) != B_OK) {
+				return B_BAD_ADDRESS;
+			}
+			return B_OK;
+		}
+	}
+
+	return B_BAD_HANDLER;
+}
+
+
 static void
 free_page(vm_page* page, bool clear)
 {
@@ -1601,16 +2025,24 @@ free_page(vm_page* page, bool clear)
 	page->allocation_tracking_info.Clear();
 #endif
 
+	if (free_page_to_magazine(page, clear)) {
+		if (!clear)
+			sFreePageCondition.NotifyAll();
+		return;
+	}
+
 	ReadLocker locker(sFreePageQueuesLock);
 
+	trim_page_magazine(clear);
+
 	DEBUG_PAGE_ACCESS_END(page);
 
 	if (clear) {
 		page->SetState(PAGE_STATE_CLEAR);
-		sClearPageQueue.PrependUnlocked(page);
+		free_page_queue(page_node(page), true).PrependUnlocked(page);
 	} else {
 		page->SetState(PAGE_STATE_FREE);
-		sFreePageQueue.PrependUnlocked(page);
+		free_page_queue(page_node(page), false).PrependUnlocked(page);
 		sFreePageCondition.NotifyAll();
 	}
 
@@ -1776,7 +2208,10 @@ mark_page_range_in_use(page_num_t startPage, page_num_t length, bool wired)
 		length = sNumPages - startPage;
 	}
 
+	disable_page_magazines();
+
 	WriteLocker locker(sFreePageQueuesLock);
+	drain_page_magazines();
 
 	for (page_num_t i = 0; i < length; i++) {
 		vm_page *page = &sPages[startPage + i];
@@ -1790,8 +2225,8 @@ mark_page_range_in_use(page_num_t startPage, page_num_t length, bool wired)
 				ASSERT(gKernelStartup);
 
 				DEBUG_PAGE_ACCESS_START(page);
-				VMPageQueue& queue = page->State() == PAGE_STATE_FREE
-					? sFreePageQueue : sClearPageQueue;
+				VMPageQueue& queue = free_page_queue(page_node(page),
+					page->State() == PAGE_STATE_CLEAR);
 				queue.Remove(page);
 				page->SetState(wired ? PAGE_STATE_WIRED : PAGE_STATE_UNUSED);
 				page->busy = false;
@@ -1814,6 +2249,9 @@ mark_page_range_in_use(page_num_t startPage, page_num_t length, bool wired)
 		}
 	}
 
+	locker.Unlock();
+	enable_page_magazines();
+
 	return B_OK;
 }
 
@@ -1833,7 +2271,7 @@ page_scrubber(void *unused)
 
 	ConditionVariableEntry entry;
 	for (;;) {
-		while (sFreePageQueue.Count() == 0
+		while (count_free_queue_pages(false) == 0
 				|| atomic_get(&sUnreservedFreePages)
 					< (int32)sFreePagesTarget) {
 			sFreePageCondition.Add(&entry);
@@ -1855,8 +2293,14 @@ page_scrubber(void *unused)
 
 		vm_page *page[SCRUB_SIZE];
 		int32 scrubCount = 0;
+		int32 node = 0;
 		for (int32 i = 0; i < reserved; i++) {
-			page[i] = sFreePageQueue.RemoveHeadUnlocked();
+			page[i] = NULL;
+			for (; node < sPageNodeCount; node++) {
+				page[i] = free_page_queue(node, false).RemoveHeadUnlocked();
+				if (page[i] != NULL)
+					break;
+			}
 			if (page[i] == NULL)
 				break;
 
@@ -1888,7 +2332,7 @@ page_scrubber(void *unused)
 			page[i]->SetState(PAGE_STATE_CLEAR);
 			page[i]->busy = false;
 			DEBUG_PAGE_ACCESS_END(page[i]);
-			sClearPageQueue.PrependUnlocked(page[i]);
+			free_page_queue(page_node(page[i]), true).PrependUnlocked(page[i]);
 		}
 
 		locker.Unlock();
@@ -2694,7 +3138,7 @@ free_cached_pages(uint32 pagesToFree, bool dontWait)
 			ReadLocker locker(sFreePageQueuesLock);
 			page->SetState(PAGE_STATE_FREE);
 			DEBUG_PAGE_ACCESS_END(page);
-			sFreePageQueue.PrependUnlocked(page);
+			free_page_queue(page_node(page), false).PrependUnlocked(page);
 			locker.Unlock();
 
 			TA(StolenPage());
@@ -3403,8 +3847,10 @@ vm_page_init(kernel_args *args)
 	sInactivePageQueue.Init("inactive pages queue");
 	sActivePageQueue.Init("active pages queue");
 	sCachedPageQueue.Init("cached pages queue");
-	sFreePageQueue.Init("free pages queue");
-	sClearPageQueue.Init("clear pages queue");
+	for (int32 i = 0; i < NUMA_MAX_NODES; i++) {
+		sFreePageQueues[i].Init("free pages queue");
+		sClearPageQueues[i].Init("clear pages queue");
+	}
 
 	new (&sPageReservationWaiters) PageReservationWaiterList;
 
@@ -3419,7 +3865,7 @@ vm_page_init(kernel_args *args)
 	// initialize the free page table
 	for (uint32 i = 0; i < sNumPages; i++) {
 		sPages[i].Init(sPhysicalPageOffset + i);
-		sFreePageQueue.Append(&sPages[i]);
+		sFreePageQueues[0].Append(&sPages[i]);
 
 #if VM_PAGE_ALLOCATION_TRACKING_AVAILABLE
 		sPages[i].allocation_tracking_info.Clear();
@@ -3547,11 +3993,57 @@ vm_page_init_post_area(kernel_args *args)
 }
 
 
+/*!	Called once the NUMA topology of the machine is known: distributes the
+	free and clear pages, which are all in the queues of node 0 until then,
+	to the queues of the memory nodes they belong to.
+*/
+void
+vm_page_init_numa(void)
+{
+	int32 nodeCount = numa_node_count();
+	if (nodeCount <= 1 || sPageNodeCount != 1)
+		return;
+
+	disable_page_magazines();
+	WriteLocker locker(sFreePageQueuesLock);
+
+	drain_page_magazines();
+
+	// page_node() only knows about the other nodes once sPageNodeCount has
+	// been set, so ask for the node directly
+	for (int32 clear = 0; clear < 2; clear++) {
+		VMPageQueue& queue = free_page_queue(0, clear != 0);
+		page_num_t count = queue.Count();
+		for (page_num_t i = 0; i < count; i++) {
+			vm_page* page = queue.RemoveHead();
+			free_page_queue(numa_physical_page_node(page->physical_page_number),
+				clear != 0).Append(page);
+		}
+	}
+
+	sPageNodeCount = nodeCount;
+
+	locker.Unlock();
+	enable_page_magazines();
+
+	for (int32 i = 0; i < nodeCount; i++) {
+		dprintf("vm_page: node %" B_PRId32 ": %" B_PRIuPHYSADDR " free pages\n",
+			i, free_page_queue(i, false).Count()
+				+ free_page_queue(i, true).Count());
+	}
+}
+
+
 status_t
 vm_page_init_post_thread(kernel_args *args)
 {
 	new (&sFreePageCondition) ConditionVariable;
 
+	// from now on, pages may be cached in the per-CPU magazines
+	enable_page_magazines();
+	register_generic_syscall(VM_PAGE_MAGAZINE_SYSCALLS,
+		&page_magazines_control, 1, 0);
+
 	// create a kernel thread to clear out pages
 
 	thread_id thread = spawn_kernel_thread(&page_scrubber, "page scrubber",
@@ -3652,69 +4144,66 @@ vm_page_try_reserve_pages(vm_page_reservation* reservation, uint32 count,
 }
 
 
-vm_page *
-vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
+/*!	Slow path of vm_page_allocate_page(): refills the current CPU's magazine
+	from the queues, or takes a page from them directly, if that's not
+	possible.
+*/
+static vm_page*
+allocate_page_from_queues(uint32 flags, int& oldPageState)
 {
-	uint32 pageState = flags & VM_PAGE_ALLOC_STATE;
-	ASSERT(pageState != PAGE_STATE_FREE);
-	ASSERT(pageState != PAGE_STATE_CLEAR);
-
-	ASSERT(reservation->count > 0);
-	reservation->count--;
-
-	VMPageQueue* queue;
-	VMPageQueue* otherQueue;
-
-	if ((flags & VM_PAGE_ALLOC_CLEAR) != 0) {
-		queue = &sClearPageQueue;
-		otherQueue = &sFreePageQueue;
-	} else {
-		queue = &sFreePageQueue;
-		otherQueue = &sClearPageQueue;
-	}
-
 	ReadLocker locker(sFreePageQueuesLock);
 
-	vm_page* page = queue->RemoveHeadUnlocked();
-	if (page == NULL) {
-		// if the primary queue was empty, grab the page from the
-		// secondary queue
-		page = otherQueue->RemoveHeadUnlocked();
+	vm_page* page = allocate_page_from_magazine(flags, true, oldPageState);
+	if (page != NULL)
+		return page;
 
-		if (page == NULL) {
-			// Unlikely, but possible: the page we have reserved has moved
-			// between the queues after we checked the first queue. Grab the
-			// write locker to make sure this doesn't happen again.
-			locker.Unlock();
-			WriteLocker writeLocker(sFreePageQueuesLock);
+	bool clear = (flags & VM_PAGE_ALLOC_CLEAR) != 0;
 
-			page = queue->RemoveHead();
-			if (page == NULL)
-				otherQueue->RemoveHead();
+	// if the primary queue is empty, this grabs the page from the secondary
+	// queue, or from the queues of the other memory nodes
+	page = remove_free_queue_page(clear, false);
+	if (page == NULL) {
+		// Unlikely, but possible: the page we have reserved has moved
+		// between the queues after we checked the first queue, or it is
+		// sitting in another CPU's magazine. Grab the write locker to make
+		// sure this doesn't happen again.
+		locker.Unlock();
+		WriteLocker writeLocker(sFreePageQueuesLock);
 
-			if (page == NULL) {
-				panic("Had reserved page, but there is none!");
-				return NULL;
-			}
+		drain_page_magazines();
 
-			// downgrade to read lock
-			locker.Lock();
+		page = remove_free_queue_page(clear, true);
+		if (page == NULL) {
+			panic("Had reserved page, but there is none!");
+			return NULL;
 		}
+
+		// downgrade to read lock
+		locker.Lock();
 	}
 
-	if (page->CacheRef() != NULL)
-		panic("supposed to be free page %p has cache @! page %p; cache _cache", page, page);
+	oldPageState = init_allocated_page(page, flags);
+	return page;
+}
 
-	DEBUG_PAGE_ACCESS_START(page);
 
-	int oldPageState = page->State();
-	page->SetState(pageState);
-	page->busy = (flags & VM_PAGE_ALLOC_BUSY) != 0;
-	page->usage_count = 0;
-	page->accessed = false;
-	page->modified = false;
+vm_page *
+vm_page_allocate_page(vm_page_reservation* reservation, uint32 flags)
+{
+	uint32 pageState = flags & VM_PAGE_ALLOC_STATE;
+	ASSERT(pageState != PAGE_STATE_FREE);
+	ASSERT(pageState != PAGE_STATE_CLEAR);
 
-	locker.Unlock();
+	ASSERT(reservation->count > 0);
+	reservation->count--;
+
+	// try the current CPU's magazines first
+	int oldPageState;
+	vm_page* page = allocate_page_from_magazine(flags, false, oldPageState);
+	if (page == NULL)
+		page = allocate_page_from_queues(flags, oldPageState);
+	if (page == NULL)
+		return NULL;
 
 	if (pageState < PAGE_STATE_FIRST_UNQUEUED)
 		sPageQueues[pageState].AppendUnlocked(page);
@@ -3745,14 +4234,14 @@ allocate_page_run_cleanup(VMPageQueue::PageList& freePages,
 		page->busy = false;
 		page->SetState(PAGE_STATE_FREE);
 		DEBUG_PAGE_ACCESS_END(page);
-		sFreePageQueue.PrependUnlocked(page);
+		free_page_queue(page_node(page), false).PrependUnlocked(page);
 	}
 
 	while (vm_page* page = clearPages.RemoveTail()) {
 		page->busy = false;
 		page->SetState(PAGE_STATE_CLEAR);
 		DEBUG_PAGE_ACCESS_END(page);
-		sClearPageQueue.PrependUnlocked(page);
+		free_page_queue(page_node(page), true).PrependUnlocked(page);
 	}
 
 	sFreePageCondition.NotifyAll();
@@ -3801,12 +4290,12 @@ allocate_page_run(page_num_t start, page_num_t length, uint32 flags,
 		switch (page.State()) {
 			case PAGE_STATE_CLEAR:
 				DEBUG_PAGE_ACCESS_START(&page);
-				sClearPageQueue.Remove(&page);
+				free_page_queue(page_node(&page), true).Remove(&page);
 				clearPages.Add(&page);
 				break;
 			case PAGE_STATE_FREE:
 				DEBUG_PAGE_ACCESS_START(&page);
-				sFreePageQueue.Remove(&page);
+				free_page_queue(page_node(&page), false).Remove(&page);
 				freePages.Add(&page);
 				break;
 			case PAGE_STATE_CACHED:
@@ -3983,7 +4472,11 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 	vm_page_reservation reservation;
 	vm_page_reserve_pages(&reservation, length, priority);
 
+	// we need to see all free pages in the queues while scanning
+	disable_page_magazines();
+
 	WriteLocker freeClearQueueLocker(sFreePageQueuesLock);
+	drain_page_magazines();
 
 	// First we try to get a run with free pages only. If that fails, we also
 	// consider cached pages. If there are only few free pages and many cached
@@ -4025,6 +4518,7 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 				end, restrictions->alignment, restrictions->boundary);
 
 			freeClearQueueLocker.Unlock();
+			enable_page_magazines();
 			vm_page_unreserve_pages(&reservation);
 			return NULL;
 		}
@@ -4044,6 +4538,7 @@ vm_page_allocate_page_run(uint32 flags, page_num_t length,
 		if (foundRun) {
 			i = allocate_page_run(start, length, flags, freeClearQueueLocker);
 			if (i == length) {
+				enable_page_magazines();
 				reservation.count = 0;
 				return &sPages[start];
 			}
@@ -4230,8 +4725,8 @@ vm_page_get_stats(system_info *info)
 	//	active + inactive + unused + wired + modified + cached + free + clear
 	// So taking out the cached (including modified non-temporary), free and
 	// clear ones leaves us with all used pages.
-	uint32 subtractPages = info->cached_pages + sFreePageQueue.Count()
-		+ sClearPageQueue.Count();
+	uint32 subtractPages = info->cached_pages + count_free_queue_pages(false)
+		+ count_free_queue_pages(true) + count_page_magazine_pages();
 	info->used_pages = subtractPages > info->max_pages
 		? 0 : info->max_pages - subtractPages;
 
@@ -38,7 +38,17 @@ __arch_init_time(real_time_data* data, bool setDefaults)
 bigtime_t
 __arch_get_system_time_offset(struct real_time_data *data)
 {
-	//we don't use atomic_get64 because memory is read-only, maybe find another way to lock
-	return data->arch_data.system_time_offset;
+	// The commpage is read-only, so we can't use atomic_get64() here. The
+	// kernel increments the version before and after changing the offset.
+	int32 version;
+	bigtime_t offset;
+	do {
+		version = atomic_get(&data->arch_data.version);
+		offset = data->arch_data.system_time_offset;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((version & 1) != 0
+		|| version != atomic_get(&data->arch_data.version));
+
+	return offset;
 }
 
@@ -199,9 +199,13 @@ private:
 };
 
 
+/*!	Loads the image at \a path into a new team. If \a spawnArgs is given,
+	the kernel applies those posix_spawn() attributes and file actions to the
+	team before its image is loaded.
+*/
 thread_id
 __load_image_at_path(const char* path, int32 argCount, const char **args,
-	const char **environ)
+	const char **environ, const struct spawn_args* spawnArgs)
 {
 	char invoker[B_FILE_NAME_LENGTH];
 	char **newArgs = NULL;
@@ -235,8 +239,13 @@ __load_image_at_path(const char* path, int32 argCount, const char **args,
 		&envCount, path, &flatArgs, &flatArgsSize);
 
 	if (status == B_OK) {
-		thread = _kern_load_image(flatArgs, flatArgsSize, argCount, envCount,
-			B_NORMAL_PRIORITY, B_WAIT_TILL_LOADED, -1, 0);
+		if (spawnArgs != NULL) {
+			thread = _kern_spawn_image(flatArgs, flatArgsSize, argCount,
+				envCount, B_NORMAL_PRIORITY, B_WAIT_TILL_LOADED, spawnArgs);
+		} else {
+			thread = _kern_load_image(flatArgs, flatArgsSize, argCount,
+				envCount, B_NORMAL_PRIORITY, B_WAIT_TILL_LOADED, -1, 0);
+		}
 
 		free(flatArgs);
 	} else
@@ -250,7 +259,7 @@ __load_image_at_path(const char* path, int32 argCount, const char **args,
 thread_id
 load_image(int32 argCount, const char **args, const char **environ)
 {
-	return __load_image_at_path(args[0], argCount, args, environ);
+	return __load_image_at_path(args[0], argCount, args, environ, NULL);
 }
 
 
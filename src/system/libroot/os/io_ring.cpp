@@ -0,0 +1,130 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#include <io_ring_private.h>
+
+#include <unistd.h>
+
+#include <syscalls.h>
+
+
+status_t
+io_ring_init(io_ring* ring, uint32 entries)
+{
+	io_ring_params params;
+	int fd = _kern_io_ring_create(entries, 0, &params);
+	if (fd < 0)
+		return fd;
+
+	io_ring_header* header = (io_ring_header*)params.address;
+
+	ring->fd = fd;
+	ring->area = params.area;
+	ring->header = header;
+	ring->submissions
+		= (io_ring_sqe*)((uint8*)params.address + header->sq_offset);
+	ring->completions
+		= (io_ring_cqe*)((uint8*)params.address + header->cq_offset);
+	ring->submission_mask = header->sq_entries - 1;
+	ring->completion_mask = header->cq_entries - 1;
+	ring->submission_tail = atomic_get((int32*)&header->sq_tail);
+	return B_OK;
+}
+
+
+void
+io_ring_destroy(io_ring* ring)
+{
+	close(ring->fd);
+	delete_area(ring->area);
+
+	ring->fd = -1;
+	ring->area = -1;
+	ring->header = NULL;
+}
+
+
+/*!	Returns the next free submission queue entry, or \c NULL if the queue is
+	full. The entry is passed to the kernel with the next io_ring_submit().
+*/
+io_ring_sqe*
+io_ring_get_sqe(io_ring* ring)
+{
+	uint32 head = atomic_get((int32*)&ring->header->sq_head);
+	if (ring->submission_tail - head >= ring->header->sq_entries)
+		return NULL;
+
+	return &ring->submissions[ring->submission_tail++
+		& ring->submission_mask];
+}
+
+
+int32
+io_ring_submit(io_ring* ring)
+{
+	return io_ring_submit_and_wait(ring, 0);
+}
+
+
+/*!	Submits all entries retrieved with io_ring_get_sqe() so far, and waits
+	until at least \a wait completions are available.
+	Returns the number of submitted entries.
+*/
+int32
+io_ring_submit_and_wait(io_ring* ring, uint32 wait)
+{
+	atomic_set((int32*)&ring->header->sq_tail, ring->submission_tail);
+
+	uint32 pending = ring->submission_tail
+		- atomic_get((int32*)&ring->header->sq_head);
+
+	return _kern_io_ring_enter(ring->fd, pending, wait,
+		wait > 0 ? IO_RING_ENTER_WAIT : 0, 0);
+}
+
+
+/*!	Returns the oldest available completion without waiting for one, or
+	\c B_WOULD_BLOCK if there is none yet.
+*/
+status_t
+io_ring_peek_cqe(io_ring* ring, io_ring_cqe** _completion)
+{
+	uint32 head = atomic_get((int32*)&ring->header->cq_head);
+	if (head == (uint32)atomic_get((int32*)&ring->header->cq_tail))
+		return B_WOULD_BLOCK;
+
+	*_completion = &ring->completions[head & ring->completion_mask];
+	return B_OK;
+}
+
+
+/*!	Waits for a completion to become available. Returns \c B_WOULD_BLOCK
+	if there is nothing left in flight that could complete.
+*/
+status_t
+io_ring_wait_cqe(io_ring* ring, io_ring_cqe** _completion, uint32 flags,
+	bigtime_t timeout)
+{
+	if (io_ring_peek_cqe(ring, _completion) == B_OK)
+		return B_OK;
+
+	status_t status = _kern_io_ring_enter(ring->fd, 0, 1,
+		IO_RING_ENTER_WAIT | flags, timeout);
+	if (status < B_OK)
+		return status;
+
+	return io_ring_peek_cqe(ring, _completion);
+}
+
+
+/*!	Marks the completion retrieved with io_ring_peek_cqe() or
+	io_ring_wait_cqe() as consumed, so that its slot can be reused.
+*/
+void
+io_ring_cqe_seen(io_ring* ring, io_ring_cqe* completion)
+{
+	atomic_add((int32*)&ring->header->cq_head, 1);
+}
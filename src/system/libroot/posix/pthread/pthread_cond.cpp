@@ -57,6 +57,18 @@ pthread_cond_destroy(pthread_cond_t* cond)
 }
 
 
+static inline uint32
+mutex_flags(pthread_mutex_t* mutex)
+{
+	uint32 flags = 0;
+	if ((mutex->flags & MUTEX_FLAG_SHARED) != 0)
+		flags |= B_USER_MUTEX_SHARED;
+	if ((mutex->flags & MUTEX_FLAG_PRIO_INHERIT) != 0)
+		flags |= B_USER_MUTEX_PRIO_INHERIT;
+	return flags;
+}
+
+
 static status_t
 cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, uint32 flags,
 	bigtime_t timeout)
@@ -84,8 +96,8 @@ cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, uint32 flags,
 	if ((cond->flags & COND_FLAG_SHARED) != 0)
 		flags |= B_USER_MUTEX_SHARED;
 	status_t status = _kern_mutex_switch_lock((int32*)&mutex->lock,
-		((mutex->flags & MUTEX_FLAG_SHARED) ? B_USER_MUTEX_SHARED : 0),
-		(int32*)&cond->lock, "pthread condition", flags, timeout);
+		mutex_flags(mutex), (int32*)&cond->lock, "pthread condition", flags,
+		timeout);
 
 	if (status == B_INTERRUPTED) {
 		// EINTR is not an allowed return value. We either have to restart
@@ -114,14 +126,27 @@ cond_signal(pthread_cond_t* cond, bool broadcast)
 		return;
 
 	uint32 flags = 0;
-	if (broadcast)
-		flags |= B_USER_MUTEX_UNBLOCK_ALL;
 	if ((cond->flags & COND_FLAG_SHARED) != 0)
 		flags |= B_USER_MUTEX_SHARED;
 
 	// release the condition lock
-	if ((atomic_and((int32*)&cond->lock, ~(int32)B_USER_MUTEX_LOCKED) & B_USER_MUTEX_WAITING) != 0)
-		_kern_mutex_unblock((int32*)&cond->lock, flags);
+	if ((atomic_and((int32*)&cond->lock, ~(int32)B_USER_MUTEX_LOCKED) & B_USER_MUTEX_WAITING) == 0)
+		return;
+
+	pthread_mutex_t* mutex = cond->mutex;
+	if (broadcast && mutex != NULL
+		&& (mutex->flags & MUTEX_FLAG_PRIO_INHERIT) == 0) {
+		// Only wake up one waiter, and move the others over to the mutex:
+		// they would just contend for it otherwise. They are woken up one
+		// by one as the mutex gets unlocked.
+		_kern_mutex_requeue((int32*)&cond->lock, flags, (int32*)&mutex->lock,
+			mutex_flags(mutex));
+		return;
+	}
+
+	if (broadcast)
+		flags |= B_USER_MUTEX_UNBLOCK_ALL;
+	_kern_mutex_unblock((int32*)&cond->lock, flags);
 }
 
 
@@ -24,7 +24,8 @@
 
 static const pthread_mutexattr pthread_mutexattr_default = {
 	PTHREAD_MUTEX_DEFAULT,
-	false
+	false,
+	PTHREAD_PRIO_NONE
 };
 
 
@@ -38,6 +39,8 @@ pthread_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* _attr)
 	mutex->owner = -1;
 	mutex->owner_count = 0;
 	mutex->flags = attr->type | (attr->process_shared ? MUTEX_FLAG_SHARED : 0);
+	if (attr->protocol == PTHREAD_PRIO_INHERIT)
+		mutex->flags |= MUTEX_FLAG_PRIO_INHERIT;
 
 	return 0;
 }
@@ -74,7 +77,13 @@ __pthread_mutex_lock(pthread_mutex_t* mutex, uint32 flags, bigtime_t timeout)
 	}
 
 	// set the locked flag
-	const int32 oldValue = atomic_test_and_set((int32*)&mutex->lock, B_USER_MUTEX_LOCKED, 0);
+	int32 oldValue;
+	if ((mutex->flags & MUTEX_FLAG_PRIO_INHERIT) != 0) {
+		// the kernel needs to know the owner to boost its priority
+		oldValue = atomic_test_and_set((int32*)&mutex->lock, thisThread, 0);
+		flags |= B_USER_MUTEX_PRIO_INHERIT;
+	} else
+		oldValue = atomic_test_and_set((int32*)&mutex->lock, B_USER_MUTEX_LOCKED, 0);
 	if (oldValue != 0) {
 		// someone else has the lock or is at least waiting for it
 		if (timeout < 0)
@@ -155,7 +164,8 @@ pthread_mutex_timedlock(pthread_mutex_t* mutex, const struct timespec* abstime)
 int
 pthread_mutex_unlock(pthread_mutex_t* mutex)
 {
-	if (mutex->owner != find_thread(NULL))
+	thread_id thisThread = find_thread(NULL);
+	if (mutex->owner != thisThread)
 		return EPERM;
 
 	if (MUTEX_TYPE(mutex) == PTHREAD_MUTEX_RECURSIVE
@@ -166,6 +176,16 @@ pthread_mutex_unlock(pthread_mutex_t* mutex)
 
 	mutex->owner = -1;
 
+	if ((mutex->flags & MUTEX_FLAG_PRIO_INHERIT) != 0) {
+		// the kernel hands the mutex over to the next waiter, if there is one
+		if (atomic_test_and_set((int32*)&mutex->lock, 0, thisThread)
+				!= thisThread) {
+			_kern_mutex_unblock((int32*)&mutex->lock, B_USER_MUTEX_PRIO_INHERIT
+				| ((mutex->flags & MUTEX_FLAG_SHARED) ? B_USER_MUTEX_SHARED : 0));
+		}
+		return 0;
+	}
+
 	// clear the locked flag
 	int32 oldValue = atomic_and((int32*)&mutex->lock,
 		~(int32)B_USER_MUTEX_LOCKED);
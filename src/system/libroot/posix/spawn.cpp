@@ -15,6 +15,7 @@
 
 #include <libroot_private.h>
 #include <signal_defs.h>
+#include <spawn_defs.h>
 #include <syscalls.h>
 
 
@@ -557,9 +558,115 @@ fail:
 }
 
 
+static const char*
+file_action_path(const struct _file_action *action)
+{
+	if (action->type == file_action_open)
+		return action->action.open_action.path;
+	if (action->type == file_action_chdir)
+		return action->action.chdir_action.path;
+	return NULL;
+}
+
+
+/*!	Flattens the attributes and file actions into a block the kernel applies
+	to the new team itself, before its image is loaded.
+*/
+static int
+flatten_spawn_args(const posix_spawn_file_actions_t *_actions,
+	const posix_spawnattr_t *_attr, spawn_args **_args)
+{
+	struct _posix_spawn_file_actions *actions
+		= _actions != NULL ? *_actions : NULL;
+	struct _posix_spawnattr *attr = _attr != NULL ? *_attr : NULL;
+	int count = actions != NULL ? actions->count : 0;
+
+	size_t pathOffset = sizeof(spawn_args) + count * sizeof(spawn_file_action);
+	size_t size = pathOffset;
+	for (int i = 0; i < count; i++) {
+		const char *path = file_action_path(&actions->actions[i]);
+		if (path != NULL)
+			size += strlen(path) + 1;
+	}
+	if (size > MAX_SPAWN_ARGS_SIZE)
+		return E2BIG;
+
+	spawn_args *args = (spawn_args*)calloc(1, size);
+	if (args == NULL)
+		return ENOMEM;
+
+	args->size = size;
+	if (attr != NULL) {
+		args->flags = attr->flags;
+		args->process_group = attr->pgroup;
+		args->signal_mask = attr->sigmask;
+		args->default_signals = attr->sigdefault;
+	}
+
+	args->action_count = count;
+	for (int i = 0; i < count; i++) {
+		const struct _file_action *action = &actions->actions[i];
+		spawn_file_action &flatAction = args->actions[i];
+
+		flatAction.fd = action->fd;
+		switch (action->type) {
+			case file_action_open:
+				flatAction.type = SPAWN_FILE_ACTION_OPEN;
+				flatAction.open_mode = action->action.open_action.oflag;
+				flatAction.permissions = action->action.open_action.mode;
+				break;
+			case file_action_close:
+				flatAction.type = SPAWN_FILE_ACTION_CLOSE;
+				break;
+			case file_action_dup2:
+				flatAction.type = SPAWN_FILE_ACTION_DUP2;
+				flatAction.source_fd = action->action.dup2_action.srcfd;
+				break;
+			case file_action_chdir:
+				flatAction.type = SPAWN_FILE_ACTION_CHDIR;
+				break;
+			case file_action_fchdir:
+				flatAction.type = SPAWN_FILE_ACTION_FCHDIR;
+				break;
+		}
+
+		const char *path = file_action_path(action);
+		if (path != NULL) {
+			size_t length = strlen(path) + 1;
+			memcpy((char*)args + pathOffset, path, length);
+			flatAction.path_offset = pathOffset;
+			pathOffset += length;
+		}
+	}
+
+	*_args = args;
+	return 0;
+}
+
+
+static bool
+changes_directory(const posix_spawn_file_actions_t *_actions)
+{
+	if (_actions == NULL)
+		return false;
+
+	struct _posix_spawn_file_actions *actions = *_actions;
+	for (int i = 0; i < actions->count; i++) {
+		if (actions->actions[i].type == file_action_chdir
+			|| actions->actions[i].type == file_action_fchdir) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
 static int
 spawn_using_load_image(pid_t *_pid, const char *_path,
-	char *const argv[], char *const envp[], bool envpath)
+	const posix_spawn_file_actions_t *actions,
+	const posix_spawnattr_t *attrp, char *const argv[], char *const envp[],
+	bool envpath)
 {
 	const char* path;
 	// if envpath is specified but the path contains '/', don't search PATH
@@ -578,12 +685,19 @@ spawn_using_load_image(pid_t *_pid, const char *_path,
 	while (argv[argCount] != NULL)
 		argCount++;
 
+	spawn_args *spawnArgs;
+	int err = flatten_spawn_args(actions, attrp, &spawnArgs);
+	if (err != 0)
+		return err;
+
 	thread_id thread = __load_image_at_path(path, argCount, (const char**)argv,
-		(const char**)(envp != NULL ? envp : environ));
+		(const char**)(envp != NULL ? envp : environ), spawnArgs);
+	free(spawnArgs);
 	if (thread < 0)
 		return thread;
 
-	*_pid = thread;
+	if (_pid != NULL)
+		*_pid = thread;
 	return resume_thread(thread);
 }
 
@@ -594,13 +708,21 @@ do_posix_spawn(pid_t *_pid, const char *path,
 	const posix_spawnattr_t *attrp, char *const argv[], char *const envp[],
 	bool envpath)
 {
-	if ((actions == NULL || (*actions)->count == 0)
-			&& (attrp == NULL || (*attrp)->flags == 0)) {
-		return spawn_using_load_image(_pid, path, argv, envp, envpath);
-	} else {
+	if ((actions != NULL && *actions == NULL)
+		|| (attrp != NULL && *attrp == NULL)) {
+		return EINVAL;
+	}
+
+	// The executable is looked up before the file actions are applied, so a
+	// relative path after a change of the working directory needs a child
+	// of our own.
+	if (path[0] != '/' && changes_directory(actions)) {
 		return spawn_using_fork(_pid, path, actions, attrp, argv, envp,
 			envpath);
 	}
+
+	return spawn_using_load_image(_pid, path, actions, attrp, argv, envp,
+		envpath);
 }
 
 
@@ -18,6 +18,7 @@
 #include <syscall_clock_info.h>
 #include <syscall_utils.h>
 #include <time_private.h>
+#include <user_thread.h>
 
 #include <syscalls.h>
 
@@ -54,6 +55,36 @@ clock_getres(clockid_t clockID, struct timespec* resolution)
 }
 
 
+/*!	Computes the calling thread's CPU time from the snapshot the kernel
+	publishes in the user_thread whenever the thread is scheduled.
+	Returns \c false if there is no valid snapshot yet.
+*/
+static bool
+get_thread_cpu_time(bigtime_t& _time)
+{
+	user_thread* thread = get_user_thread();
+
+	int32 version;
+	bigtime_t cpuTime;
+	bigtime_t since;
+	bigtime_t now;
+	do {
+		version = atomic_get(&thread->cpu_time_version);
+		cpuTime = thread->cpu_time;
+		since = thread->cpu_time_since;
+		now = system_time();
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	} while ((version & 1) != 0
+		|| version != atomic_get(&thread->cpu_time_version));
+
+	if (since == 0)
+		return false;
+
+	_time = cpuTime + now - since;
+	return true;
+}
+
+
 int
 clock_gettime(clockid_t clockID, struct timespec* time)
 {
@@ -65,8 +96,11 @@ clock_gettime(clockid_t clockID, struct timespec* time)
 		case CLOCK_REALTIME:
 			microSeconds = real_time_clock_usecs();
 			break;
-		case CLOCK_PROCESS_CPUTIME_ID:
 		case CLOCK_THREAD_CPUTIME_ID:
+			if (get_thread_cpu_time(microSeconds))
+				break;
+			// fall through
+		case CLOCK_PROCESS_CPUTIME_ID:
 		default:
 		{
 			status_t error = _kern_get_clock(clockID, &microSeconds);
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+
+#include <syscall_utils.h>
+
+#include <errno_private.h>
+#include <syscalls.h>
+
+
+ssize_t
+splice(int inFD, off_t* inOffset, int outFD, off_t* outOffset, size_t length,
+	unsigned int flags)
+{
+	// all flags are only hints
+	RETURN_AND_SET_ERRNO_TEST_CANCEL(_kern_splice(inFD, inOffset, outFD,
+		outOffset, length, 0));
+}
+
+
+ssize_t
+sendfile(int outFD, int inFD, off_t* offset, size_t count)
+{
+	RETURN_AND_SET_ERRNO_TEST_CANCEL(_kern_splice(inFD, offset, outFD, NULL,
+		count, 0));
+}
+
+
+ssize_t
+copy_file_range(int inFD, off_t* inOffset, int outFD, off_t* outOffset,
+	size_t length, unsigned int flags)
+{
+	RETURN_AND_SET_ERRNO(_kern_copy_file_range(inFD, inOffset, outFD,
+		outOffset, length, flags));
+}
@@ -27,6 +27,7 @@
 #include "add_ons.h"
 #include "commpage.h"
 #include "elf_load_image.h"
+#include "elf_prelink_cache.h"
 #include "elf_symbol_lookup.h"
 #include "elf_tls.h"
 #include "elf_versioning.h"
@@ -284,6 +285,7 @@ static status_t
 relocate_image(image_t *rootImage, image_t *image)
 {
 	SymbolLookupCache cache(image);
+	prelink_cache_restore(image, &cache);
 
 	status_t status = arch_relocate_image(rootImage, image, &cache);
 	if (status < B_OK) {
@@ -291,6 +293,8 @@ relocate_image(image_t *rootImage, image_t *image)
 		return status;
 	}
 
+	prelink_cache_record(image, &cache);
+
 	_kern_image_relocated(image->id);
 	image_event(image, IMAGE_EVENT_RELOCATED);
 	return B_OK;
@@ -567,7 +571,13 @@ load_program(char const *path, void **_entry)
 	// This results in the desired symbol resolution for dlopen()ed libraries.
 	set_image_flags_recursively(gProgramImage, RTLD_GLOBAL);
 
+	// Runtime loader add-ons may patch symbols, so the bindings can only be
+	// cached without them.
+	if (sPreloadedAddonCount == 0)
+		prelink_cache_open(gProgramImage);
+
 	status = relocate_dependencies(gProgramImage);
+	prelink_cache_close(status == B_OK);
 	if (status < B_OK)
 		goto err;
 
@@ -0,0 +1,470 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	A persistent cache of the symbol bindings of a program.
+
+	Resolving the symbols a program and its libraries refer to is the most
+	expensive part of starting it. Since the libraries are loaded at random
+	addresses, the resolved values themselves can't be reused, but the
+	bindings can: for each symbol an image refers to, the cache stores which
+	image of the dependency set defines it, and at which symbol table index.
+	The value is then just that symbol's value plus the load delta of its
+	image.
+
+	The cache is only used if it is owned by root and not writable by anyone
+	else, if the program's images are the very same files, in the same
+	order, as when it was written, and if no package has been activated or
+	deactivated since. Otherwise, or if any runtime loader
+	add-on could interfere with the symbol resolution, the symbols are
+	resolved as usual, and the cache is rewritten.
+*/
+
+
+#include "elf_prelink_cache.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+
+#include <directories.h>
+#include <PackagesDirectoryDefs.h>
+#include <syscalls.h>
+#include <vm_defs.h>
+
+#include "elf_symbol_lookup.h"
+#include "images.h"
+
+
+#define PRELINK_CACHE_DIRECTORY	kSystemCacheDirectory "/runtime_loader"
+
+static const uint32 kCacheMagic = 'rldC';
+static const uint32 kCacheVersion = 1;
+
+static const uint32 kMaxCachedImages = 1024;
+
+// values for cache_binding::image, besides image indices
+static const uint16 kNoBinding = 0xffff;
+static const uint16 kNullBinding = 0xfffe;
+	// an unresolved weak symbol
+
+static const char* const kActivationFiles[] = {
+	kSystemPackagesDirectory "/" PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/"
+		PACKAGES_DIRECTORY_ACTIVATION_FILE,
+	kUserPackagesDirectory "/" PACKAGES_DIRECTORY_ADMIN_DIRECTORY "/"
+		PACKAGES_DIRECTORY_ACTIVATION_FILE
+};
+static const uint32 kActivationFileCount
+	= sizeof(kActivationFiles) / sizeof(kActivationFiles[0]);
+
+
+struct cache_header {
+	uint32		magic;
+	uint32		version;
+	uint32		size;
+	uint32		image_count;
+	uint32		binding_count;
+	uint32		_reserved;
+	bigtime_t	activation_times[kActivationFileCount];
+	char		program_path[B_PATH_NAME_LENGTH];
+};
+
+struct cache_image {
+	dev_t		device;
+	uint32		_reserved;
+	ino_t		node;
+	bigtime_t	modification_time;
+	uint32		first_binding;
+	uint32		binding_count;
+};
+
+struct cache_binding {
+	uint32		symbol;		// index in the defining image's symbol table
+	uint16		image;		// index of the defining image
+	uint16		_reserved;
+};
+
+
+static bool sActive;
+static image_t** sImages;
+static uint32 sImageCount;
+static bigtime_t sActivationTimes[kActivationFileCount];
+static char sCachePath[B_PATH_NAME_LENGTH];
+
+// set if the cache could be used
+static area_id sCacheArea = -1;
+static const cache_image* sCachedImages;
+static const cache_binding* sCachedBindings;
+
+// set if the cache has to be written
+static cache_binding** sRecordedBindings;
+
+
+static bigtime_t
+modification_time(const char* path)
+{
+	struct stat st;
+	if (_kern_read_stat(AT_FDCWD, path, true, &st, sizeof(st)) != B_OK)
+		return 0;
+
+	return (bigtime_t)st.st_mtim.tv_sec * 1000000 + st.st_mtim.tv_nsec / 1000;
+}
+
+
+static uint32
+symbol_table_size(image_t* image)
+{
+	// the same as the size of the image's SymbolLookupCache
+	return image->symhash != NULL ? image->symhash[1] : 0;
+}
+
+
+static int32
+image_index(image_t* image)
+{
+	for (uint32 i = 0; i < sImageCount; i++) {
+		if (sImages[i] == image)
+			return i;
+	}
+
+	return -1;
+}
+
+
+static bool
+validate_cache(const cache_header* header, size_t size)
+{
+	if (size < sizeof(cache_header) || header->magic != kCacheMagic
+		|| header->version != kCacheVersion || header->size != size
+		|| header->image_count != sImageCount
+		|| memcmp(header->activation_times, sActivationTimes,
+			sizeof(sActivationTimes)) != 0
+		|| strncmp(header->program_path, sImages[0]->path,
+			sizeof(header->program_path)) != 0) {
+		return false;
+	}
+
+	if ((uint64)sizeof(cache_header) + sImageCount * sizeof(cache_image)
+			+ (uint64)header->binding_count * sizeof(cache_binding) != size) {
+		return false;
+	}
+
+	const cache_image* images = (const cache_image*)(header + 1);
+	for (uint32 i = 0; i < sImageCount; i++) {
+		const cache_image& cachedImage = images[i];
+		image_t* image = sImages[i];
+
+		if (cachedImage.device != image->device
+			|| cachedImage.node != image->node
+			|| cachedImage.modification_time != image->modification_time
+			|| cachedImage.binding_count != symbol_table_size(image)
+			|| cachedImage.first_binding > header->binding_count
+			|| cachedImage.binding_count
+				> header->binding_count - cachedImage.first_binding) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+
+static void
+map_cache()
+{
+	int fd = _kern_open(AT_FDCWD, sCachePath, O_RDONLY, 0);
+	if (fd < 0)
+		return;
+
+	struct stat st;
+	void* address;
+	area_id area = -1;
+	// Only a cache written by root can be trusted, as anyone else could
+	// redirect the program's symbols.
+	if (_kern_read_stat(fd, NULL, true, &st, sizeof(st)) == B_OK
+		&& S_ISREG(st.st_mode) && st.st_uid == 0
+		&& (st.st_mode & (S_IWGRP | S_IWOTH)) == 0
+		&& st.st_size >= (off_t)sizeof(cache_header)
+		&& st.st_size <= (off_t)UINT32_MAX) {
+		area = _kern_map_file("prelink cache", &address, B_ANY_ADDRESS,
+			st.st_size, B_READ_AREA, REGION_NO_PRIVATE_MAP, false, fd, 0);
+	}
+	_kern_close(fd);
+
+	if (area < 0)
+		return;
+
+	const cache_header* header = (const cache_header*)address;
+	if (!validate_cache(header, st.st_size)) {
+		_kern_delete_area(area);
+		return;
+	}
+
+	sCacheArea = area;
+	sCachedImages = (const cache_image*)(header + 1);
+	sCachedBindings = (const cache_binding*)(sCachedImages + sImageCount);
+}
+
+
+static void
+write_cache()
+{
+	uint32 bindingCount = 0;
+	for (uint32 i = 0; i < sImageCount; i++) {
+		uint32 count = symbol_table_size(sImages[i]);
+		if (count > 0 && sRecordedBindings[i] == NULL)
+			return;
+		bindingCount += count;
+	}
+
+	size_t headerSize = sizeof(cache_header)
+		+ sImageCount * sizeof(cache_image);
+	cache_header* header = (cache_header*)malloc(headerSize);
+	if (header == NULL)
+		return;
+
+	memset(header, 0, headerSize);
+	header->magic = kCacheMagic;
+	header->version = kCacheVersion;
+	header->size = headerSize + bindingCount * sizeof(cache_binding);
+	header->image_count = sImageCount;
+	header->binding_count = bindingCount;
+	memcpy(header->activation_times, sActivationTimes,
+		sizeof(sActivationTimes));
+	strlcpy(header->program_path, sImages[0]->path,
+		sizeof(header->program_path));
+
+	cache_image* images = (cache_image*)(header + 1);
+	uint32 firstBinding = 0;
+	for (uint32 i = 0; i < sImageCount; i++) {
+		images[i].device = sImages[i]->device;
+		images[i].node = sImages[i]->node;
+		images[i].modification_time = sImages[i]->modification_time;
+		images[i].first_binding = firstBinding;
+		images[i].binding_count = symbol_table_size(sImages[i]);
+		firstBinding += images[i].binding_count;
+	}
+
+	// Write to a temporary file first, so that other teams never see a
+	// partially written cache.
+	char tempPath[B_PATH_NAME_LENGTH];
+	snprintf(tempPath, sizeof(tempPath), "%s.%" B_PRId32, sCachePath,
+		find_thread(NULL));
+
+	_kern_create_dir(AT_FDCWD, PRELINK_CACHE_DIRECTORY, 0755);
+
+	int fd = _kern_open(AT_FDCWD, tempPath, O_WRONLY | O_CREAT | O_TRUNC,
+		0644);
+	if (fd < 0) {
+		free(header);
+		return;
+	}
+
+	bool success = _kern_write(fd, -1, header, headerSize)
+		== (ssize_t)headerSize;
+	for (uint32 i = 0; success && i < sImageCount; i++) {
+		size_t size = images[i].binding_count * sizeof(cache_binding);
+		if (size > 0) {
+			success = _kern_write(fd, -1, sRecordedBindings[i], size)
+				== (ssize_t)size;
+		}
+	}
+
+	_kern_close(fd);
+	free(header);
+
+	if (!success || _kern_rename(AT_FDCWD, tempPath, AT_FDCWD, sCachePath)
+			!= B_OK) {
+		_kern_unlink(AT_FDCWD, tempPath);
+	}
+}
+
+
+// #pragma mark -
+
+
+/*!	Prepares the symbol binding cache for the program \a programImage, whose
+	dependencies must have been loaded already.
+*/
+void
+prelink_cache_open(image_t* programImage)
+{
+	// don't let others influence the symbol resolution of set-id programs
+	if (_kern_getuid(false) != _kern_getuid(true)
+		|| _kern_getgid(false) != _kern_getgid(true)) {
+		return;
+	}
+
+	image_queue_t& loadedImages = get_loaded_images();
+	if (loadedImages.head != programImage)
+		return;
+
+	uint32 count = 0;
+	for (image_t* image = loadedImages.head; image != NULL;
+			image = image->next) {
+		count++;
+	}
+	if (count > kMaxCachedImages)
+		return;
+
+	sImages = (image_t**)malloc(count * sizeof(image_t*));
+	if (sImages == NULL)
+		return;
+
+	sImageCount = 0;
+	for (image_t* image = loadedImages.head; image != NULL;
+			image = image->next) {
+		sImages[sImageCount++] = image;
+	}
+
+	for (uint32 i = 0; i < kActivationFileCount; i++)
+		sActivationTimes[i] = modification_time(kActivationFiles[i]);
+
+	snprintf(sCachePath, sizeof(sCachePath), "%s/%08" B_PRIx32 "%08" B_PRIx32,
+		PRELINK_CACHE_DIRECTORY, elf_hash(programImage->path),
+		elf_gnuhash(programImage->path));
+
+	map_cache();
+
+	if (sCacheArea < 0) {
+		// nobody would use a cache written by anyone but root
+		if (_kern_getuid(true) != 0) {
+			free(sImages);
+			sImages = NULL;
+			return;
+		}
+
+		sRecordedBindings = (cache_binding**)calloc(sImageCount,
+			sizeof(cache_binding*));
+		if (sRecordedBindings == NULL) {
+			free(sImages);
+			sImages = NULL;
+			return;
+		}
+	}
+
+	sActive = true;
+}
+
+
+/*!	Ends the use of the cache. If it could not be used, and \a writeBack is
+	\c true, the bindings recorded while relocating are written to it.
+*/
+void
+prelink_cache_close(bool writeBack)
+{
+	if (!sActive)
+		return;
+
+	if (sCacheArea >= 0) {
+		_kern_delete_area(sCacheArea);
+		sCacheArea = -1;
+	} else {
+		if (writeBack)
+			write_cache();
+
+		for (uint32 i = 0; i < sImageCount; i++)
+			free(sRecordedBindings[i]);
+		free(sRecordedBindings);
+		sRecordedBindings = NULL;
+	}
+
+	free(sImages);
+	sImages = NULL;
+	sImageCount = 0;
+	sActive = false;
+}
+
+
+/*!	Fills the symbol lookup \a cache of \a image with the cached bindings,
+	before the image is relocated.
+*/
+void
+prelink_cache_restore(image_t* image, SymbolLookupCache* cache)
+{
+	if (!sActive || sCacheArea < 0)
+		return;
+
+	int32 index = image_index(image);
+	if (index < 0)
+		return;
+
+	const cache_image& cachedImage = sCachedImages[index];
+	const cache_binding* bindings
+		= sCachedBindings + cachedImage.first_binding;
+	uint32 count = std::min((size_t)cachedImage.binding_count,
+		cache->TableSize());
+
+	for (uint32 i = 0; i < count; i++) {
+		const cache_binding& binding = bindings[i];
+		if (binding.image == kNullBinding) {
+			cache->SetSymbolValueAt(i, 0, NULL, 0);
+			continue;
+		}
+		if (binding.image >= sImageCount)
+			continue;
+
+		image_t* definingImage = sImages[binding.image];
+		if (binding.symbol >= symbol_table_size(definingImage))
+			continue;
+
+		addr_t value = SYMBOL(definingImage, binding.symbol)->st_value;
+		if (SYMBOL(image, i)->Type() != STT_TLS)
+			value += definingImage->regions[0].delta;
+
+		cache->SetSymbolValueAt(i, value, definingImage, binding.symbol);
+	}
+}
+
+
+/*!	Remembers the bindings \a image has been relocated with, to be written
+	to the cache.
+*/
+void
+prelink_cache_record(image_t* image, SymbolLookupCache* cache)
+{
+	if (!sActive || sRecordedBindings == NULL)
+		return;
+
+	int32 index = image_index(image);
+	size_t count = cache->TableSize();
+	if (index < 0 || count != symbol_table_size(image) || count == 0)
+		return;
+
+	cache_binding* bindings
+		= (cache_binding*)malloc(count * sizeof(cache_binding));
+	if (bindings == NULL)
+		return;
+
+	for (size_t i = 0; i < count; i++) {
+		cache_binding& binding = bindings[i];
+		binding.symbol = 0;
+		binding.image = kNoBinding;
+		binding._reserved = 0;
+
+		if (!cache->IsSymbolValueCached(i))
+			continue;
+
+		image_t* definingImage;
+		cache->SymbolValueAt(i, &definingImage);
+		if (definingImage == NULL) {
+			binding.image = kNullBinding;
+			continue;
+		}
+
+		int32 definingIndex = image_index(definingImage);
+		if (definingIndex >= 0) {
+			binding.symbol = cache->DefinitionAt(i);
+			binding.image = definingIndex;
+		}
+	}
+
+	free(sRecordedBindings[index]);
+	sRecordedBindings[index] = bindings;
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+#ifndef ELF_PRELINK_CACHE_H
+#define ELF_PRELINK_CACHE_H
+
+
+#include "runtime_loader_private.h"
+
+
+struct SymbolLookupCache;
+
+
+void	prelink_cache_open(image_t* programImage);
+void	prelink_cache_close(bool writeBack);
+
+void	prelink_cache_restore(image_t* image, SymbolLookupCache* cache);
+void	prelink_cache_record(image_t* image, SymbolLookupCache* cache);
+
+
+#endif	// ELF_PRELINK_CACHE_H
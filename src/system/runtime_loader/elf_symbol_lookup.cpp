@@ -666,7 +666,9 @@ resolve_symbol(image_t* rootImage, image_t* image, elf_sym* sym,
 		return B_MISSING_SYMBOL;
 	}
 
-	cache->SetSymbolValueAt(index, (addr_t)location, sharedImage);
+	cache->SetSymbolValueAt(index, (addr_t)location, sharedImage,
+		sharedImage != NULL && sharedSym != NULL
+			? sharedSym - sharedImage->syms : 0);
 
 	if (symbolImage)
 		*symbolImage = sharedImage;
@@ -50,22 +50,27 @@ struct SymbolLookupCache {
 		fTableSize(image->symhash != NULL ? image->symhash[1] : 0),
 		fValues(NULL),
 		fDSOs(NULL),
+		fDefinitions(NULL),
 		fValuesResolved(NULL)
 	{
 		if (fTableSize > 0) {
 			fValues = (addr_t*)malloc(sizeof(addr_t) * fTableSize);
 			fDSOs = (image_t**)malloc(sizeof(image_t*) * fTableSize);
+			fDefinitions = (uint32*)malloc(sizeof(uint32) * fTableSize);
 
 			size_t elementCount = (fTableSize + 31) / 32;
 			fValuesResolved = (uint32*)malloc(4 * elementCount);
 
-			if (fValues == NULL || fDSOs == NULL || fValuesResolved == NULL) {
+			if (fValues == NULL || fDSOs == NULL || fDefinitions == NULL
+				|| fValuesResolved == NULL) {
 				free(fValuesResolved);
 				fValuesResolved = NULL;
 				free(fValues);
 				fValues = NULL;
 				free(fDSOs);
 				fDSOs = NULL;
+				free(fDefinitions);
+				fDefinitions = NULL;
 				fTableSize = 0;
 			} else {
 				memset(fValuesResolved, 0, 4 * elementCount);
@@ -78,6 +83,12 @@ struct SymbolLookupCache {
 		free(fValuesResolved);
 		free(fValues);
 		free(fDSOs);
+		free(fDefinitions);
+	}
+
+	size_t TableSize() const
+	{
+		return fTableSize;
 	}
 
 	bool IsSymbolValueCached(size_t index) const
@@ -98,11 +109,18 @@ struct SymbolLookupCache {
 		return fValues[index];
 	}
 
-	void SetSymbolValueAt(size_t index, addr_t value, image_t* image)
+	uint32 DefinitionAt(size_t index) const
+	{
+		return fDefinitions[index];
+	}
+
+	void SetSymbolValueAt(size_t index, addr_t value, image_t* image,
+		uint32 definition)
 	{
 		if (index < fTableSize) {
 			fValues[index] = value;
 			fDSOs[index] = image;
+			fDefinitions[index] = definition;
 			fValuesResolved[index / 32] |= 1 << (index % 32);
 		}
 	}
@@ -111,6 +129,8 @@ private:
 	size_t		fTableSize;
 	addr_t*		fValues;
 	image_t**	fDSOs;
+	uint32*		fDefinitions;
+		// index of the symbol in fDSOs[index] the value was taken from
 	uint32*		fValuesResolved;
 };
 
@@ -493,10 +493,14 @@ register_image(image_t* image, int fd, const char* path)
 	if (_kern_read_stat(fd, NULL, false, &stat, sizeof(struct stat)) == B_OK) {
 		info.basic_info.device = stat.st_dev;
 		info.basic_info.node = stat.st_ino;
+		image->modification_time = (bigtime_t)stat.st_mtim.tv_sec * 1000000
+			+ stat.st_mtim.tv_nsec / 1000;
 	} else {
 		info.basic_info.device = -1;
 		info.basic_info.node = -1;
 	}
+	image->device = info.basic_info.device;
+	image->node = info.basic_info.node;
 
 	// We may have split segments into separate regions. Compute the correct
 	// segments for the image info.
@@ -5,6 +5,9 @@
 
 #include <stdio.h>
 
+#include <set>
+#include <vector>
+
 #define DEBUG_QUERY
 #define PRINT(expr) printf expr
 #define __out(message...) PRINT((message))
@@ -14,14 +17,142 @@
 #include <file_systems/QueryParser.h>
 
 
-class Entry;
+using QueryParser::IndexStatistics;
+using QueryParser::NodeIDSet;
+
+
+static int sFailures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+				#condition); \
+			sFailures++; \
+		} \
+	} while (false)
+
+
+/*!	A volume that keeps its entries, and an index for each of their
+	attributes, in memory. All attributes are of type int32.
+*/
+class Volume {
+public:
+	static	const int32		kAttributeCount = 3;
+
+	struct Entry {
+		ino_t				id;
+		char				name[32];
+		int32				values[kAttributeCount];
+	};
+
+	struct IndexEntry {
+		int32				key;
+		Entry*				entry;
+
+		bool operator<(const IndexEntry& other) const
+		{
+			if (key != other.key)
+				return key < other.key;
+			return entry->id < other.entry->id;
+		}
+	};
+
+	typedef std::vector<IndexEntry> Index;
+
+public:
+							Volume();
+							~Volume();
+
+			Entry*			AddEntry(int32 a, int32 b, int32 c);
+
+	static	int32			AttributeFor(const char* name);
+
+			Index&			IndexAt(int32 attribute)
+								{ return fIndices[attribute]; }
+			IndexStatistics*& StatisticsAt(int32 attribute)
+								{ return fStatistics[attribute]; }
+
+			int32			CountStatisticsBuilt(int32 attribute) const
+								{ return fStatisticsBuilt[attribute]; }
+			void			StatisticsBuilt(int32 attribute)
+								{ fStatisticsBuilt[attribute]++; }
+
+private:
+			std::vector<Entry*> fEntries;
+			Index			fIndices[kAttributeCount];
+			IndexStatistics* fStatistics[kAttributeCount];
+			int32			fStatisticsBuilt[kAttributeCount];
+};
+
+
+typedef Volume::Entry Entry;
+
+
+Volume::Volume()
+{
+	for (int32 i = 0; i < kAttributeCount; i++) {
+		fStatistics[i] = NULL;
+		fStatisticsBuilt[i] = 0;
+	}
+}
+
+
+Volume::~Volume()
+{
+	for (size_t i = 0; i < fEntries.size(); i++)
+		delete fEntries[i];
+	for (int32 i = 0; i < kAttributeCount; i++)
+		delete fStatistics[i];
+}
+
+
+Entry*
+Volume::AddEntry(int32 a, int32 b, int32 c)
+{
+	Entry* entry = new Entry;
+	entry->id = fEntries.size() + 2;
+	snprintf(entry->name, sizeof(entry->name), "entry%" B_PRIdINO, entry->id);
+	entry->values[0] = a;
+	entry->values[1] = b;
+	entry->values[2] = c;
+	fEntries.push_back(entry);
+
+	// like a file system, keep the index statistics up to date
+	for (int32 i = 0; i < kAttributeCount; i++) {
+		IndexEntry indexEntry = { entry->values[i], entry };
+		fIndices[i].insert(std::upper_bound(fIndices[i].begin(),
+			fIndices[i].end(), indexEntry), indexEntry);
+
+		if (fStatistics[i] != NULL) {
+			fStatistics[i]->KeyAdded(&entry->values[i],
+				sizeof(entry->values[i]));
+		}
+	}
+
+	return entry;
+}
+
+
+/*static*/ int32
+Volume::AttributeFor(const char* name)
+{
+	if (name[0] >= 'a' && name[0] < 'a' + kAttributeCount && name[1] == '\0')
+		return name[0] - 'a';
+
+	return -1;
+}
 
 
 class Query {
 public:
-	static	status_t		Create(void* volume, const char* queryString,
+	static	status_t		Create(Volume* volume, const char* queryString,
 								uint32 flags, port_id port, uint32 token,
 								Query*& _query);
+							~Query();
+
+			status_t		GetNextEntry(struct dirent* dirent, size_t size);
+			status_t		Explain(char* buffer, size_t size);
 
 private:
 	struct QueryPolicy;
@@ -29,43 +160,49 @@ private:
 	typedef QueryParser::Query<QueryPolicy> QueryImpl;
 
 private:
-							Query();
+							Query(Volume* volume);
 
 			status_t		_Init(const char* queryString, uint32 flags,
 								port_id port, uint32 token);
 
 private:
+			Volume*			fVolume;
 			QueryImpl*		fImpl;
 };
 
 
 struct Query::QueryPolicy {
-	typedef Query Context;
+	typedef ::Volume Context;
 	typedef ::Entry Entry;
 	typedef ::Entry Node;
 	typedef void* NodeHolder;
 
 	struct Index {
-		Query*		query;
+		Volume*		volume;
+		int32		attribute;
 
 		Index(Context* context)
 			:
-			query(context)
+			volume(context),
+			attribute(-1)
 		{
 		}
 	};
 
 	struct IndexIterator {
-		Entry* entry;
+		Volume::Index*	index;
+		size_t			position;
+		Entry*			entry;
 	};
 
 	static const int32 kMaxFileNameLength = B_FILE_NAME_LENGTH;
+	static const size_t kMaxIndexKeyLength = B_FILE_NAME_LENGTH;
 
 	// Entry interface
 
 	static ino_t EntryGetParentID(Entry* entry)
 	{
-		return -1;
+		return 1;
 	}
 
 	static Node* EntryGetNode(Entry* entry)
@@ -75,48 +212,86 @@ struct Query::QueryPolicy {
 
 	static ino_t EntryGetNodeID(Entry* entry)
 	{
-		return -1;
+		return entry->id;
 	}
 
 	static ssize_t EntryGetName(Entry* entry, void* buffer, size_t bufferSize)
 	{
-		return B_ERROR;
+		size_t nameLength = strlen(entry->name);
+		if (nameLength >= bufferSize)
+			return B_BUFFER_OVERFLOW;
+
+		memcpy(buffer, entry->name, nameLength + 1);
+		return nameLength + 1;
 	}
 
 	static const char* EntryGetNameNoCopy(NodeHolder& holder, Entry* entry)
 	{
-		return NULL;
+		return entry->name;
 	}
 
 	// Index interface
 
 	static status_t IndexSetTo(Index& index, const char* attribute)
 	{
-		return B_ERROR;
+		index.attribute = Volume::AttributeFor(attribute);
+		return index.attribute >= 0 ? B_OK : B_ENTRY_NOT_FOUND;
 	}
 
 	static void IndexUnset(Index& index)
 	{
+		index.attribute = -1;
 	}
 
 	static int32 IndexGetSize(Index& index)
 	{
-		return 0;
+		return index.volume->IndexAt(index.attribute).size();
 	}
 
 	static type_code IndexGetType(Index& index)
 	{
-		return 0;
+		return B_INT32_TYPE;
 	}
 
 	static int32 IndexGetKeySize(Index& index)
 	{
-		return 0;
+		return sizeof(int32);
 	}
 
 	static IndexIterator* IndexCreateIterator(Index& index)
 	{
-		return NULL;
+		IndexIterator* iterator = new(std::nothrow) IndexIterator;
+		if (iterator == NULL)
+			return NULL;
+
+		iterator->index = &index.volume->IndexAt(index.attribute);
+		iterator->position = 0;
+		iterator->entry = NULL;
+		return iterator;
+	}
+
+	static status_t IndexGetStatistics(Index& index,
+		QueryParser::IndexStatistics& statistics)
+	{
+		IndexStatistics* indexStatistics
+			= index.volume->StatisticsAt(index.attribute);
+		if (indexStatistics == NULL)
+			return B_ENTRY_NOT_FOUND;
+
+		statistics = *indexStatistics;
+		return B_OK;
+	}
+
+	static void IndexSetStatistics(Index& index,
+		const QueryParser::IndexStatistics& statistics)
+	{
+		IndexStatistics*& indexStatistics
+			= index.volume->StatisticsAt(index.attribute);
+		if (indexStatistics == NULL)
+			indexStatistics = new IndexStatistics;
+
+		*indexStatistics = statistics;
+		index.volume->StatisticsBuilt(index.attribute);
 	}
 
 	// IndexIterator interface
@@ -129,13 +304,36 @@ struct Query::QueryPolicy {
 	static status_t IndexIteratorFind(IndexIterator* indexIterator,
 		const void* value, size_t size)
 	{
-		return B_ERROR;
+		if (size != sizeof(int32))
+			return B_BAD_VALUE;
+
+		int32 key = *(const int32*)value;
+		Volume::Index& index = *indexIterator->index;
+
+		size_t position = 0;
+		while (position < index.size() && index[position].key < key)
+			position++;
+
+		indexIterator->position = position;
+		if (position == index.size() || index[position].key != key)
+			return B_ENTRY_NOT_FOUND;
+
+		return B_OK;
 	}
 
 	static status_t IndexIteratorFetchNextEntry(IndexIterator* indexIterator,
 		void* value, size_t* _valueLength, size_t bufferSize, size_t* duplicate)
 	{
-		return B_ERROR;
+		Volume::Index& index = *indexIterator->index;
+		if (indexIterator->position >= index.size())
+			return B_ENTRY_NOT_FOUND;
+
+		const Volume::IndexEntry& entry = index[indexIterator->position++];
+		memcpy(value, &entry.key, sizeof(int32));
+		*_valueLength = sizeof(int32);
+		*duplicate = 0;
+		indexIterator->entry = entry.entry;
+		return B_OK;
 	}
 
 	static status_t IndexIteratorGetEntry(Context* context, IndexIterator* indexIterator,
@@ -145,6 +343,11 @@ struct Query::QueryPolicy {
 		return B_OK;
 	}
 
+	static ino_t IndexIteratorGetNodeID(IndexIterator* indexIterator)
+	{
+		return indexIterator->entry->id;
+	}
+
 	static void IndexIteratorSkipDuplicates(IndexIterator* indexIterator)
 	{
 	}
@@ -172,7 +375,14 @@ struct Query::QueryPolicy {
 	static status_t NodeGetAttribute(NodeHolder& nodeHolder, Node* node,
 		const char* attribute, void* buffer, size_t* _size, int32* _type)
 	{
-		return B_ERROR;
+		int32 index = Volume::AttributeFor(attribute);
+		if (index < 0 || *_size < sizeof(int32))
+			return B_ENTRY_NOT_FOUND;
+
+		memcpy(buffer, &node->values[index], sizeof(int32));
+		*_size = sizeof(int32);
+		*_type = B_INT32_TYPE;
+		return B_OK;
 	}
 
 	static Entry* NodeGetFirstReferrer(Node* node)
@@ -195,10 +405,10 @@ struct Query::QueryPolicy {
 
 
 /*static*/ status_t
-Query::Create(void* volume, const char* queryString, uint32 flags,
+Query::Create(Volume* volume, const char* queryString, uint32 flags,
 	port_id port, uint32 token, Query*& _query)
 {
-	Query* query = new(std::nothrow) Query();
+	Query* query = new(std::nothrow) Query(volume);
 	if (query == NULL)
 		return B_NO_MEMORY;
 
@@ -213,18 +423,25 @@ Query::Create(void* volume, const char* queryString, uint32 flags,
 }
 
 
-Query::Query()
+Query::Query(Volume* volume)
 	:
+	fVolume(volume),
 	fImpl(NULL)
 {
 }
 
 
+Query::~Query()
+{
+	delete fImpl;
+}
+
+
 status_t
 Query::_Init(const char* queryString, uint32 flags, port_id port, uint32 token)
 {
-	status_t error = QueryImpl::Create(this, queryString, flags, port, token,
-		fImpl);
+	status_t error = QueryImpl::Create(fVolume, queryString, flags, port,
+		token, fImpl);
 	if (error != B_OK)
 		return error;
 
@@ -232,12 +449,349 @@ Query::_Init(const char* queryString, uint32 flags, port_id port, uint32 token)
 }
 
 
+status_t
+Query::GetNextEntry(struct dirent* dirent, size_t size)
+{
+	return fImpl->GetNextEntry(dirent, size);
+}
+
+
+status_t
+Query::Explain(char* buffer, size_t size)
+{
+	return fImpl->Explain(buffer, size);
+}
+
+
+//	#pragma mark - tests
+
+
+/*!	Runs the query, and returns the IDs of the entries it found, in the
+	order it found them.
+*/
+static std::vector<ino_t>
+run_query(Volume& volume, const char* queryString, char* plan = NULL,
+	size_t planSize = 0)
+{
+	std::vector<ino_t> ids;
+
+	Query* query;
+	status_t status = Query::Create(&volume, queryString, 0, -1, 0, query);
+	CHECK(status == B_OK);
+	if (status != B_OK)
+		return ids;
+
+	if (plan != NULL)
+		CHECK(query->Explain(plan, planSize) == B_OK);
+
+	union {
+		struct dirent	dirent;
+		char			buffer[sizeof(struct dirent) + B_FILE_NAME_LENGTH];
+	} entry;
+	while (query->GetNextEntry(&entry.dirent, sizeof(entry)) == B_OK)
+		ids.push_back(entry.dirent.d_ino);
+
+	delete query;
+	return ids;
+}
+
+
+static bool
+contains_all_once(const std::vector<ino_t>& ids)
+{
+	std::set<ino_t> unique(ids.begin(), ids.end());
+	return unique.size() == ids.size();
+}
+
+
+static void
+test_node_id_set()
+{
+	NodeIDSet set;
+	const ino_t ids[] = { 9, 3, 7, 3, 1, 9, 5 };
+	for (size_t i = 0; i < B_COUNT_OF(ids); i++)
+		CHECK(set.Add(ids[i], 100) == B_OK);
+	CHECK(set.Count() == 7);
+
+	// sorting removes the duplicates
+	set.Sort();
+	CHECK(set.Count() == 5);
+	CHECK(set.Contains(1) && set.Contains(3) && set.Contains(5)
+		&& set.Contains(7) && set.Contains(9));
+	CHECK(!set.Contains(0) && !set.Contains(4) && !set.Contains(10));
+
+	NodeIDSet other;
+	const ino_t otherIDs[] = { 2, 3, 4, 9, 11 };
+	for (size_t i = 0; i < B_COUNT_OF(otherIDs); i++)
+		CHECK(other.Add(otherIDs[i], 100) == B_OK);
+	other.Sort();
+
+	NodeIDSet intersection;
+	for (size_t i = 0; i < B_COUNT_OF(ids); i++)
+		intersection.Add(ids[i], 100);
+	intersection.Sort();
+	intersection.IntersectWith(other);
+	CHECK(intersection.Count() == 2);
+	CHECK(intersection.Contains(3) && intersection.Contains(9));
+	CHECK(!intersection.Contains(1) && !intersection.Contains(2));
+
+	// merging keeps the set sorted and free of duplicates
+	CHECK(set.MergeWith(other, 100) == B_OK);
+	CHECK(set.Count() == 8);
+	const ino_t merged[] = { 1, 2, 3, 4, 5, 7, 9, 11 };
+	for (size_t i = 0; i < B_COUNT_OF(merged); i++)
+		CHECK(set.Contains(merged[i]));
+	CHECK(!set.Contains(6) && !set.Contains(8) && !set.Contains(10));
+
+	// the sets don't grow beyond the given limit
+	NodeIDSet limited;
+	for (int32 i = 0; i < 300; i++)
+		CHECK(limited.Add(i, 300) == B_OK);
+	CHECK(limited.Add(300, 300) == B_BUFFER_OVERFLOW);
+	CHECK(limited.Count() == 300);
+	limited.Sort();
+	CHECK(limited.MergeWith(other, 302) == B_BUFFER_OVERFLOW);
+	CHECK(limited.Count() == 300);
+
+	set.MakeEmpty();
+	CHECK(set.Count() == 0 && !set.Contains(1));
+}
+
+
+static bool
+is_close(int64 estimate, int64 expected, int64 tolerance)
+{
+	return estimate >= expected - tolerance && estimate <= expected + tolerance;
+}
+
+
+static void
+test_cardinality_estimates()
+{
+	// 10000 distinct keys 0..9999, and 2000 more entries of key 5000
+	IndexStatistics statistics;
+	statistics.Reset(B_INT32_TYPE);
+	for (int32 key = 0; key < 10000; key++) {
+		statistics.AddKey(&key, sizeof(key), true);
+		if (key == 5000) {
+			for (int32 i = 0; i < 2000; i++)
+				statistics.AddKey(&key, sizeof(key), false);
+		}
+	}
+	statistics.Finish();
+
+	CHECK(statistics.IsValid());
+	CHECK(!statistics.IsStale(B_INT32_TYPE));
+	CHECK(statistics.IsStale(B_INT64_TYPE));
+	CHECK(statistics.EntryCount() == 12000);
+	CHECK(statistics.DistinctCount() == 10000);
+	CHECK(statistics.SampleCount() >= IndexStatistics::kBucketCount);
+
+	// a bucket is 12000 / 32..64 entries
+	const int64 tolerance = 12000 / IndexStatistics::kBucketCount;
+
+	int32 key = 2500;
+	CHECK(is_close(statistics.EstimateLess(&key, sizeof(key), false), 2500,
+		tolerance));
+	key = 7500;
+	CHECK(is_close(statistics.EstimateLess(&key, sizeof(key), true), 9500,
+		tolerance));
+	key = -1;
+	CHECK(statistics.EstimateLess(&key, sizeof(key), false) == 0);
+
+	// a rare key is estimated by the number of distinct keys, a frequent one
+	// by the buckets it fills
+	key = 1234;
+	CHECK(statistics.EstimateEqual(&key, sizeof(key)) <= 2);
+	key = 5000;
+	CHECK(is_close(statistics.EstimateEqual(&key, sizeof(key)), 2000,
+		2 * tolerance));
+
+	// Adding keys updates the buckets they fall into, without a rebuild:
+	// 3000 more entries below 1000.
+	for (int32 i = 0; i < 3000; i++) {
+		key = i % 1000;
+		statistics.KeyAdded(&key, sizeof(key));
+	}
+	CHECK(statistics.EntryCount() == 15000);
+
+	// the key is assumed to be in the middle of its bucket, which got a lot
+	// larger, though
+	key = 1000;
+	CHECK(is_close(statistics.EstimateLess(&key, sizeof(key), false), 4000,
+		2 * tolerance));
+	key = 9000;
+	CHECK(is_close(statistics.EstimateLess(&key, sizeof(key), false), 14000,
+		tolerance));
+	CHECK(!statistics.IsStale(B_INT32_TYPE));
+
+	// removing them again, too
+	for (int32 i = 0; i < 2000; i++) {
+		key = i % 1000;
+		statistics.KeyRemoved(&key, sizeof(key));
+	}
+	CHECK(statistics.EntryCount() == 13000);
+	key = 1000;
+	CHECK(is_close(statistics.EstimateLess(&key, sizeof(key), false), 2000,
+		tolerance));
+
+	// After as many changes as half the entries they were built from, the
+	// bucket boundaries may no longer fit, and the statistics are stale.
+	for (int32 i = 0; i < 1100; i++) {
+		key = 20000 + i;
+		statistics.KeyAdded(&key, sizeof(key));
+	}
+	CHECK(statistics.IsStale(B_INT32_TYPE));
+
+	// string keys can be estimated by their prefix
+	IndexStatistics strings;
+	strings.Reset(B_STRING_TYPE);
+	char name[16];
+	for (char first = 'a'; first <= 'z'; first++) {
+		for (int32 i = 0; i < 100; i++) {
+			snprintf(name, sizeof(name), "%c%03" B_PRId32, first, i);
+			strings.AddKey(name, strlen(name), true);
+		}
+	}
+	strings.Finish();
+
+	CHECK(strings.EntryCount() == 2600);
+	CHECK(is_close(strings.EstimatePrefix("m", 1), 100,
+		2600 / IndexStatistics::kBucketCount));
+	CHECK(strings.EstimatePrefix("", 0) == 2600);
+}
+
+
+/*!	Fills the volume with \a count entries, where "a" is the ID modulo 4,
+	"b" is the ID modulo 50, and "c" is the ID modulo 10.
+*/
+static void
+fill_volume(Volume& volume, int32 count)
+{
+	for (int32 i = 0; i < count; i++)
+		volume.AddEntry(i % 4, i % 50, i % 10);
+}
+
+
+static void
+test_intersection_order()
+{
+	Volume volume;
+	fill_volume(volume, 10000);
+
+	// b == 7 matches 200 entries, c == 7 1000, and a == 3 2500: the planner
+	// should iterate the index of "b", and intersect it with "c" first.
+	char plan[1024];
+	std::vector<ino_t> ids = run_query(volume, "((a==3)&&(b==7))&&(c==7)",
+		plan, sizeof(plan));
+
+	const char* iterate = strstr(plan, "iterate b ==");
+	const char* intersectC = strstr(plan, "intersect c ==");
+	const char* intersectA = strstr(plan, "intersect a ==");
+	CHECK(iterate != NULL);
+	CHECK(intersectC != NULL && intersectA != NULL);
+	CHECK(iterate < intersectC && intersectC < intersectA);
+	CHECK(strstr(plan, "iterate a") == NULL && strstr(plan, "iterate c") == NULL);
+	if (sFailures > 0)
+		printf("plan:\n%s", plan);
+
+	// the entries with (ID - 2) % 100 == 7
+	CHECK(ids.size() == 100);
+	CHECK(contains_all_once(ids));
+	for (size_t i = 0; i < ids.size(); i++)
+		CHECK((ids[i] - 2) % 100 == 7);
+
+	// the same query in a different order gets the same plan
+	char otherPlan[1024];
+	run_query(volume, "(c==7)&&((b==7)&&(a==3))", otherPlan,
+		sizeof(otherPlan));
+	iterate = strstr(otherPlan, "iterate b ==");
+	intersectC = strstr(otherPlan, "intersect c ==");
+	intersectA = strstr(otherPlan, "intersect a ==");
+	CHECK(iterate != NULL && intersectC != NULL && intersectA != NULL);
+	CHECK(iterate < intersectC && intersectC < intersectA);
+}
+
+
+static void
+test_or_deduplication()
+{
+	Volume volume;
+	fill_volume(volume, 10000);
+
+	// every entry with b == 7 also has c == 7
+	char plan[1024];
+	std::vector<ino_t> ids = run_query(volume, "(b==7)||(c==7)", plan,
+		sizeof(plan));
+	CHECK(strstr(plan, "merge by node ID") != NULL);
+	CHECK(ids.size() == 1000);
+	CHECK(contains_all_once(ids));
+
+	// partially overlapping: a == 3 and c == 7 share every other entry
+	ids = run_query(volume, "(a==3)||(c==7)");
+	CHECK(ids.size() == 2500 + 1000 - 500);
+	CHECK(contains_all_once(ids));
+
+	// the same equation twice
+	ids = run_query(volume, "(c==3)||(c==3)");
+	CHECK(ids.size() == 1000);
+	CHECK(contains_all_once(ids));
+}
+
+
+static void
+test_statistics_maintenance()
+{
+	Volume volume;
+	fill_volume(volume, 10000);
+
+	// the statistics are only built by the first query
+	run_query(volume, "(a==3)&&(b==7)");
+	CHECK(volume.CountStatisticsBuilt(0) == 1);
+	CHECK(volume.CountStatisticsBuilt(1) == 1);
+	CHECK(volume.CountStatisticsBuilt(2) == 0);
+
+	run_query(volume, "(a==1)&&(b==8)");
+	CHECK(volume.CountStatisticsBuilt(0) == 1);
+	CHECK(volume.CountStatisticsBuilt(1) == 1);
+
+	// changes to the index are applied to the statistics
+	for (int32 i = 0; i < 1000; i++)
+		volume.AddEntry(3, 7, 7);
+
+	char plan[1024];
+	std::vector<ino_t> ids = run_query(volume, "(a==3)&&(b==7)", plan,
+		sizeof(plan));
+	CHECK(volume.CountStatisticsBuilt(0) == 1);
+	CHECK(volume.CountStatisticsBuilt(1) == 1);
+	CHECK(ids.size() == 1100);
+	CHECK(volume.StatisticsAt(1)->EntryCount() == 11000);
+
+	// until there were too many of them
+	for (int32 i = 0; i < 5000; i++)
+		volume.AddEntry(i % 4, 100 + i % 50, i % 10);
+
+	run_query(volume, "(a==3)&&(b==7)");
+	CHECK(volume.CountStatisticsBuilt(0) == 2);
+	CHECK(volume.CountStatisticsBuilt(1) == 2);
+	CHECK(volume.StatisticsAt(1)->EntryCount() == 16000);
+}
+
+
 int
 main(int argc, char* argv[])
 {
+	test_node_id_set();
+	test_cardinality_estimates();
+	test_intersection_order();
+	test_or_deduplication();
+	test_statistics_maintenance();
+
+	// parse any queries given on the command line
+	Volume volume;
 	for (int i = 1; i < argc; i++) {
 		Query* query;
-		status_t error = Query::Create(NULL, argv[i], 0, 0, 0, query);
+		status_t error = Query::Create(&volume, argv[i], 0, -1, 0, query);
 		if (error != B_OK) {
 			fprintf(stderr, "Error creating query %d: %s\n", i - 1, strerror(error));
 			continue;
@@ -245,5 +799,11 @@ main(int argc, char* argv[])
 		delete query;
 	}
 
+	if (sFailures > 0) {
+		fprintf(stderr, "%d checks failed\n", sFailures);
+		return 1;
+	}
+
+	printf("All tests passed.\n");
 	return 0;
 }
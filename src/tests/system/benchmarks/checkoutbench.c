@@ -0,0 +1,250 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Simulates a "git checkout" of a source tree: many small files are spread
+ * over a number of directories, then read back like "git status" would do,
+ * a part of them is rewritten with a different size, and finally the tree
+ * is removed again. The time of each phase, and the number of blocks the
+ * tree occupied on the volume are printed.
+ * On a BFS volume initialized with the "inline_data" option, most of the
+ * files keep their data in their inode.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <fs_info.h>
+#include <OS.h>
+
+#define BASE_DIR		"/tmp/checkoutbench"
+#define DIRECTORIES		50
+#define FILES			100
+#define MAX_FILE_SIZE	8192
+
+static int sDirectories = DIRECTORIES;
+static int sFiles = FILES;
+static char sBuffer[MAX_FILE_SIZE];
+
+
+static void
+usage(void)
+{
+	printf("checkoutbench [-h] [directories [files-per-directory]]\n");
+	exit(1);
+}
+
+
+/*!	Most source files are tiny; about one in eight is larger than what fits
+	into an inode.
+*/
+static size_t
+file_size(int directory, int file, int generation)
+{
+	unsigned seed = directory * 7919 + file * 104729 + generation * 31;
+
+	seed = seed * 1103515245 + 12345;
+	if ((seed >> 16) % 8 == 0)
+		return 2048 + (seed >> 8) % (MAX_FILE_SIZE - 2048);
+
+	return (seed >> 8) % 1024;
+}
+
+
+static bigtime_t
+elapsed_since(struct timeval* before)
+{
+	struct timeval after;
+
+	gettimeofday(&after, NULL);
+	return 1000000LL * (after.tv_sec - before->tv_sec)
+		+ after.tv_usec - before->tv_usec;
+}
+
+
+static off_t
+used_blocks(dev_t device)
+{
+	fs_info info;
+
+	if (fs_stat_dev(device, &info) != 0) {
+		perror("fs_stat_dev");
+		exit(1);
+	}
+
+	return info.total_blocks - info.free_blocks;
+}
+
+
+static void
+write_file(int directory, int file, int generation)
+{
+	char path[PATH_MAX];
+	size_t size = file_size(directory, file, generation);
+	int fd;
+
+	snprintf(path, sizeof(path), "%s/dir%d/file%d.c", BASE_DIR, directory,
+		file);
+	fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+	if (fd < 0) {
+		perror("open");
+		exit(1);
+	}
+
+	memset(sBuffer, 'a' + generation % 26, size);
+	if (write(fd, sBuffer, size) != (ssize_t)size) {
+		perror("write");
+		exit(1);
+	}
+	close(fd);
+}
+
+
+static void
+checkout(int generation)
+{
+	char path[PATH_MAX];
+	int i, j;
+
+	for (i = 0; i < sDirectories; i++) {
+		snprintf(path, sizeof(path), "%s/dir%d", BASE_DIR, i);
+		if (generation == 0 && mkdir(path, 0755) != 0) {
+			perror("mkdir");
+			exit(1);
+		}
+
+		for (j = 0; j < sFiles; j++) {
+			// when switching branches, only some files change
+			if (generation == 0 || j % 4 == 0)
+				write_file(i, j, generation);
+		}
+	}
+}
+
+
+static void
+status(void)
+{
+	char path[PATH_MAX];
+	struct stat st;
+	int i, j;
+
+	for (i = 0; i < sDirectories; i++) {
+		for (j = 0; j < sFiles; j++) {
+			int fd;
+
+			snprintf(path, sizeof(path), "%s/dir%d/file%d.c", BASE_DIR, i,
+				j);
+			if (stat(path, &st) != 0) {
+				perror("stat");
+				exit(1);
+			}
+
+			fd = open(path, O_RDONLY);
+			if (fd < 0
+				|| read(fd, sBuffer, sizeof(sBuffer)) != (ssize_t)st.st_size) {
+				fprintf(stderr, "reading %s failed\n", path);
+				exit(1);
+			}
+			close(fd);
+		}
+	}
+}
+
+
+static void
+remove_tree(void)
+{
+	char path[PATH_MAX];
+	int i, j;
+
+	for (i = 0; i < sDirectories; i++) {
+		for (j = 0; j < sFiles; j++) {
+			snprintf(path, sizeof(path), "%s/dir%d/file%d.c", BASE_DIR, i,
+				j);
+			unlink(path);
+		}
+
+		snprintf(path, sizeof(path), "%s/dir%d", BASE_DIR, i);
+		rmdir(path);
+	}
+	rmdir(BASE_DIR);
+}
+
+
+static void
+print_phase(const char* name, struct timeval* before, int files)
+{
+	bigtime_t elapsed = elapsed_since(before);
+
+	printf("%-10s %8" B_PRId64 " us, %6" B_PRId64 " us per file\n", name,
+		elapsed, elapsed / files);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	struct timeval before;
+	dev_t device;
+	off_t blocks;
+	int files;
+
+	if (argc > 1) {
+		if (argv[1][0] == '-')
+			usage();
+		sDirectories = atoi(argv[1]);
+	}
+	if (argc > 2)
+		sFiles = atoi(argv[2]);
+	if (argc > 3 || sDirectories < 1 || sFiles < 1)
+		usage();
+
+	files = sDirectories * sFiles;
+
+	if (mkdir(BASE_DIR, 0755) != 0) {
+		fprintf(stderr, "mkdir(\"%s\"): %s\n", BASE_DIR, strerror(errno));
+		return 1;
+	}
+
+	device = dev_for_path(BASE_DIR);
+	if (device < 0) {
+		fprintf(stderr, "dev_for_path: %s\n", strerror(device));
+		return 1;
+	}
+
+	sync();
+	blocks = used_blocks(device);
+
+	gettimeofday(&before, NULL);
+	checkout(0);
+	sync();
+	print_phase("checkout", &before, files);
+
+	printf("%-10s %8" B_PRIdOFF " blocks for %d files\n", "space",
+		used_blocks(device) - blocks, files);
+
+	gettimeofday(&before, NULL);
+	status();
+	print_phase("status", &before, files);
+
+	gettimeofday(&before, NULL);
+	checkout(1);
+	sync();
+	print_phase("switch", &before, sDirectories * ((sFiles + 3) / 4));
+
+	gettimeofday(&before, NULL);
+	remove_tree();
+	sync();
+	print_phase("remove", &before, files);
+
+	return 0;
+}
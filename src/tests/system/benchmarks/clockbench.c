@@ -0,0 +1,148 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Measures the per-call cost of the common clocks. Except for the process
+ * CPU time clock, all of them should be served from the commpage and the
+ * user_thread without entering the kernel; the bare syscall cost is
+ * measured for reference.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <OS.h>
+
+#define ITERATIONS	2000000
+
+
+static bigtime_t
+run_syscall(void)
+{
+	bigtime_t before = system_time();
+	int i;
+
+	for (i = 0; i < ITERATIONS; i++)
+		is_computer_on();
+
+	return system_time() - before;
+}
+
+
+static bigtime_t
+run_system_time(void)
+{
+	bigtime_t before = system_time();
+	int i;
+
+	for (i = 0; i < ITERATIONS; i++)
+		system_time();
+
+	return system_time() - before;
+}
+
+
+static bigtime_t
+run_real_time_clock(void)
+{
+	bigtime_t before = system_time();
+	int i;
+
+	for (i = 0; i < ITERATIONS; i++)
+		real_time_clock_usecs();
+
+	return system_time() - before;
+}
+
+
+static bigtime_t
+run_gettimeofday(void)
+{
+	bigtime_t before = system_time();
+	struct timeval tv;
+	int i;
+
+	for (i = 0; i < ITERATIONS; i++)
+		gettimeofday(&tv, NULL);
+
+	return system_time() - before;
+}
+
+
+static bigtime_t
+run_clock_gettime(clockid_t clock)
+{
+	bigtime_t before = system_time();
+	struct timespec ts;
+	int i;
+
+	for (i = 0; i < ITERATIONS; i++) {
+		if (clock_gettime(clock, &ts) != 0) {
+			fprintf(stderr, "clock_gettime(%d) failed\n", (int)clock);
+			exit(1);
+		}
+	}
+
+	return system_time() - before;
+}
+
+
+static void
+check_thread_cpu_time(void)
+{
+	struct timespec first, second;
+	bigtime_t firstTime, secondTime;
+	thread_info info;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &first);
+	snooze(100000);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &second);
+
+	firstTime = (bigtime_t)first.tv_sec * 1000000 + first.tv_nsec / 1000;
+	secondTime = (bigtime_t)second.tv_sec * 1000000 + second.tv_nsec / 1000;
+	if (secondTime < firstTime || secondTime - firstTime > 50000) {
+		fprintf(stderr, "thread CPU time advanced while sleeping: %lld -> "
+			"%lld\n", (long long)firstTime, (long long)secondTime);
+		exit(1);
+	}
+
+	get_thread_info(find_thread(NULL), &info);
+	if (info.user_time + info.kernel_time + 1000 < secondTime) {
+		fprintf(stderr, "thread CPU time ahead of the kernel: %lld > %lld\n",
+			(long long)secondTime,
+			(long long)(info.user_time + info.kernel_time));
+		exit(1);
+	}
+}
+
+
+static void
+print_result(const char* name, bigtime_t elapsed)
+{
+	printf("%-32s %5lld nanoseconds per call\n", name,
+		(long long)(1000 * elapsed / ITERATIONS));
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	check_thread_cpu_time();
+
+	print_result("syscall", run_syscall());
+	print_result("system_time", run_system_time());
+	print_result("real_time_clock_usecs", run_real_time_clock());
+	print_result("gettimeofday", run_gettimeofday());
+	print_result("CLOCK_MONOTONIC", run_clock_gettime(CLOCK_MONOTONIC));
+	print_result("CLOCK_REALTIME", run_clock_gettime(CLOCK_REALTIME));
+	print_result("CLOCK_THREAD_CPUTIME_ID",
+		run_clock_gettime(CLOCK_THREAD_CPUTIME_ID));
+	print_result("CLOCK_PROCESS_CPUTIME_ID",
+		run_clock_gettime(CLOCK_PROCESS_CPUTIME_ID));
+
+	return 0;
+}
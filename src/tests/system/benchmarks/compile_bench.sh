@@ -1,5 +1,21 @@
 #!/bin/sh
 
+# Compiles a fixed set of small programs and prints the wall-clock time it
+# took. With "-j jobs", that many compilers run in parallel, which is what a
+# build server does; "-r runs" repeats the whole build. To compare the
+# scheduler modes, switch the mode in ProcessController between the runs.
+
+jobs=1
+runs=1
+while getopts "j:r:" option; do
+	case $option in
+		j)	jobs=$OPTARG;;
+		r)	runs=$OPTARG;;
+		*)	echo "usage: $0 [-j jobs] [-r runs]" >&2
+			exit 1;;
+	esac
+done
+
 testDir=/tmp/compile_bench
 rm -rf $testDir
 mkdir -p $testDir
@@ -19,16 +35,17 @@ EOF
 
 compile_all()
 {
-	for f in $(seq 100); do
-		echo -n .
-		g++ -o $f ${f}.cpp
-	done
+	seq 100 | xargs -P $jobs -I % g++ -o % %.cpp
 }
 
 for f in $(seq 100); do
 	cp hello_world.cpp ${f}.cpp
 done
 
-time compile_all
+for run in $(seq $runs); do
+	echo "run $run, $jobs job(s):"
+	time compile_all
+	rm -f $(seq 100)
+done
 
 rm -rf $testDir
@@ -6,8 +6,43 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/time.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
+/*
+ * Starts the given program with "--help" the given number of times, waiting
+ * for each instance to exit. Unlike re-executing this program, this shows
+ * the cost of loading a program's libraries.
+ */
+static void
+time_program(const char *program, int iter)
+{
+	struct timeval before, after;
+	unsigned long elapsed;
+	int i;
+
+	gettimeofday(&before, NULL);
+	for (i = 0; i < iter; i++) {
+		int status;
+		pid_t child = fork();
+		if (child < 0)
+			errx(1, "fork failed");
+		if (child == 0) {
+			freopen("/dev/null", "w", stdout);
+			execl(program, program, "--help", NULL);
+			_exit(127);
+		}
+		if (waitpid(child, &status, 0) != child
+			|| (WIFEXITED(status) && WEXITSTATUS(status) == 127))
+			errx(1, "could not run %s", program);
+	}
+	gettimeofday(&after, NULL);
+
+	elapsed = 1000000 * (after.tv_sec - before.tv_sec)
+		+ after.tv_usec - before.tv_usec;
+	printf("time: %lu microseconds\n", elapsed / iter);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -18,9 +53,13 @@ main(int argc, char *argv[])
         int iter, count;
 
 	if (argc < 2)
-		errx(1, "Usage: %s iterations", argv[0]);
+		errx(1, "Usage: %s iterations [program]", argv[0]);
 
 	iter = atoi(argv[1]);
+	if (iter > 0 && argc > 2) {
+		time_program(argv[2], iter);
+		return (0);
+	}
 	if (iter > 0) {  
 		gettimeofday(&before, NULL);
 		time = 1000000 * before.tv_sec + before.tv_usec;
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Compares small reads issued as one syscall each against the same reads
+ * submitted in batches through an I/O ring. The bare syscall cost is
+ * measured like syscallbench does, for reference.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#include <io_ring_private.h>
+
+#define ITERATIONS	500000
+#define READ_SIZE	64
+#define RING_SIZE	256
+
+
+static char sBuffer[READ_SIZE];
+
+
+static void
+usage(void)
+{
+	printf("ioringbench [-h] [file]\n");
+	exit(1);
+}
+
+
+static unsigned long
+elapsed_since(const struct timeval* before)
+{
+	struct timeval after;
+	gettimeofday(&after, NULL);
+
+	return 1000000 * (after.tv_sec - before->tv_sec)
+		+ after.tv_usec - before->tv_usec;
+}
+
+
+static unsigned long
+run_syscalls(void)
+{
+	struct timeval before;
+	int i;
+
+	gettimeofday(&before, NULL);
+	for (i = 0; i < ITERATIONS; i++)
+		is_computer_on();
+
+	return elapsed_since(&before);
+}
+
+
+static unsigned long
+run_reads(int fd)
+{
+	struct timeval before;
+	int i;
+
+	gettimeofday(&before, NULL);
+	for (i = 0; i < ITERATIONS; i++) {
+		if (pread(fd, sBuffer, READ_SIZE, 0) != READ_SIZE) {
+			fprintf(stderr, "read failed: %s\n", strerror(errno));
+			exit(1);
+		}
+	}
+
+	return elapsed_since(&before);
+}
+
+
+static unsigned long
+run_ring(int fd, int batch, int nop)
+{
+	struct timeval before;
+	unsigned long elapsed;
+	io_ring ring;
+	status_t status;
+	int i;
+
+	status = io_ring_init(&ring, RING_SIZE);
+	if (status != B_OK) {
+		fprintf(stderr, "io_ring_init: %s\n", strerror(status));
+		exit(1);
+	}
+
+	gettimeofday(&before, NULL);
+	for (i = 0; i < ITERATIONS; i += batch) {
+		io_ring_cqe* completion;
+		int j;
+
+		for (j = 0; j < batch; j++) {
+			io_ring_sqe* entry = io_ring_get_sqe(&ring);
+			if (nop)
+				io_ring_prep_nop(entry);
+			else
+				io_ring_prep_read(entry, fd, sBuffer, READ_SIZE, 0);
+		}
+
+		io_ring_submit(&ring);
+
+		for (j = 0; j < batch; j++) {
+			if (io_ring_peek_cqe(&ring, &completion) != B_OK
+				|| (!nop && completion->result != READ_SIZE)) {
+				fprintf(stderr, "ring read failed\n");
+				exit(1);
+			}
+			io_ring_cqe_seen(&ring, completion);
+		}
+	}
+
+	elapsed = elapsed_since(&before);
+	io_ring_destroy(&ring);
+	return elapsed;
+}
+
+
+static void
+print_result(const char* name, unsigned long elapsed)
+{
+	printf("%-24s %5ld nanoseconds per operation\n", name,
+		1000 * elapsed / ITERATIONS);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	static const int kBatchSizes[] = {1, 10, 50, 250};
+	const char* path = "/dev/zero";
+	char name[64];
+	unsigned int i;
+	int fd;
+
+	if (argc > 2 || (argc == 2 && argv[1][0] == '-'))
+		usage();
+	if (argc == 2)
+		path = argv[1];
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "could not open %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	print_result("syscall", run_syscalls());
+	print_result("read", run_reads(fd));
+
+	for (i = 0; i < sizeof(kBatchSizes) / sizeof(kBatchSizes[0]); i++) {
+		snprintf(name, sizeof(name), "ring nop, batch %d", kBatchSizes[i]);
+		print_result(name, run_ring(fd, kBatchSizes[i], 1));
+	}
+
+	for (i = 0; i < sizeof(kBatchSizes) / sizeof(kBatchSizes[0]); i++) {
+		snprintf(name, sizeof(name), "ring read, batch %d", kBatchSizes[i]);
+		print_result(name, run_ring(fd, kBatchSizes[i], 0));
+	}
+
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Measures query performance on a BFS volume: a number of files get two
+ * indexed attributes, and then queries that combine both indices with AND
+ * (index intersection) and OR (union of several index iterators) are run
+ * repeatedly. The plan BFS chose for each query is printed as well.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <fs_attr.h>
+#include <fs_index.h>
+#include <fs_info.h>
+#include <fs_query.h>
+#include <OS.h>
+#include <TypeConstants.h>
+
+#include "bfs_control.h"
+
+#define BASE_DIR	"/tmp/querybench"
+#define SENDERS		100
+#define FILES		5000
+#define ITERATIONS	20
+
+static const char* kSenderIndex = "querybench:sender";
+static const char* kTimeIndex = "querybench:time";
+
+static dev_t sDevice;
+static int sFiles = FILES;
+static int sIterations = ITERATIONS;
+static bool sCreatedSenderIndex;
+static bool sCreatedTimeIndex;
+
+
+static void
+usage(void)
+{
+	printf("querybench [-h] [files [iterations]]\n");
+	exit(1);
+}
+
+
+static bool
+create_index(const char* name, uint32 type)
+{
+	if (fs_create_index(sDevice, name, type, 0) == 0)
+		return true;
+	if (errno != B_FILE_EXISTS) {
+		fprintf(stderr, "fs_create_index(\"%s\"): %s\n", name,
+			strerror(errno));
+		exit(1);
+	}
+	return false;
+}
+
+
+static void
+create_files(void)
+{
+	char path[PATH_MAX];
+	int i;
+
+	if (mkdir(BASE_DIR, 0755) != 0 && errno != EEXIST) {
+		perror("mkdir");
+		exit(1);
+	}
+
+	sDevice = dev_for_path(BASE_DIR);
+	if (sDevice < 0) {
+		fprintf(stderr, "dev_for_path: %s\n", strerror(sDevice));
+		exit(1);
+	}
+
+	sCreatedSenderIndex = create_index(kSenderIndex, B_STRING_TYPE);
+	sCreatedTimeIndex = create_index(kTimeIndex, B_INT64_TYPE);
+
+	for (i = 0; i < sFiles; i++) {
+		char sender[32];
+		int64 time = i;
+		int fd;
+
+		snprintf(path, sizeof(path), "%s/file%d", BASE_DIR, i);
+		fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0644);
+		if (fd < 0) {
+			perror("open");
+			exit(1);
+		}
+
+		snprintf(sender, sizeof(sender), "sender%d", i % SENDERS);
+		if (fs_write_attr(fd, kSenderIndex, B_STRING_TYPE, 0, sender,
+				strlen(sender) + 1) < 0
+			|| fs_write_attr(fd, kTimeIndex, B_INT64_TYPE, 0, &time,
+				sizeof(time)) < 0) {
+			perror("fs_write_attr");
+			exit(1);
+		}
+		close(fd);
+	}
+}
+
+
+static void
+remove_files(void)
+{
+	char path[PATH_MAX];
+	int i;
+
+	for (i = 0; i < sFiles; i++) {
+		snprintf(path, sizeof(path), "%s/file%d", BASE_DIR, i);
+		unlink(path);
+	}
+	rmdir(BASE_DIR);
+
+	if (sCreatedSenderIndex)
+		fs_remove_index(sDevice, kSenderIndex);
+	if (sCreatedTimeIndex)
+		fs_remove_index(sDevice, kTimeIndex);
+}
+
+
+static int
+run_query(const char* query)
+{
+	struct dirent* entry;
+	DIR* cookie;
+	int count = 0;
+
+	cookie = fs_open_query(sDevice, query, 0);
+	if (cookie == NULL) {
+		fprintf(stderr, "fs_open_query(\"%s\"): %s\n", query,
+			strerror(errno));
+		exit(1);
+	}
+
+	while ((entry = fs_read_query(cookie)) != NULL)
+		count++;
+
+	fs_close_query(cookie);
+	return count;
+}
+
+
+static void
+explain_query(const char* query)
+{
+	char plan[4096];
+	int fd;
+
+	fd = open(BASE_DIR, O_RDONLY);
+	if (fd < 0) {
+		perror("open");
+		exit(1);
+	}
+
+	strlcpy(plan, query, sizeof(plan));
+	if (ioctl(fd, BFS_IOCTL_EXPLAIN_QUERY, plan, sizeof(plan)) != 0)
+		printf("  no plan: %s\n", strerror(errno));
+	else
+		printf("%s", plan);
+
+	close(fd);
+}
+
+
+static void
+benchmark_query(const char* name, const char* query)
+{
+	struct timeval before, after;
+	unsigned long elapsed;
+	int count;
+	int i;
+
+	// the first run gathers the index statistics
+	count = run_query(query);
+
+	gettimeofday(&before, NULL);
+	for (i = 0; i < sIterations; i++)
+		run_query(query);
+	gettimeofday(&after, NULL);
+
+	elapsed = 1000000 * (after.tv_sec - before.tv_sec);
+	elapsed += after.tv_usec - before.tv_usec;
+
+	printf("%s: %s\n", name, query);
+	explain_query(query);
+	printf("  %d entries, %lu microseconds per query\n\n", count,
+		elapsed / sIterations);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	char query[256];
+
+	if (argc > 1) {
+		if (argv[1][0] == '-')
+			usage();
+		sFiles = atoi(argv[1]);
+	}
+	if (argc > 2)
+		sIterations = atoi(argv[2]);
+	if (argc > 3 || sFiles < 1 || sIterations < 1)
+		usage();
+
+	create_files();
+
+	snprintf(query, sizeof(query), "(%s==\"sender7\")&&(%s<%d)",
+		kSenderIndex, kTimeIndex, sFiles / 2);
+	benchmark_query("intersection", query);
+
+	snprintf(query, sizeof(query), "(%s>=%d)&&(%s==\"sender7\")",
+		kTimeIndex, sFiles / 4, kSenderIndex);
+	benchmark_query("intersection", query);
+
+	snprintf(query, sizeof(query), "(%s==\"sender7\")||(%s<%d)",
+		kSenderIndex, kTimeIndex, SENDERS);
+	benchmark_query("union", query);
+
+	remove_files();
+	return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Measures how long it takes to start a program and wait for it, using
+ * fork() + exec(), vfork() + exec(), and posix_spawn() with and without file
+ * actions. The parent touches a configurable amount of memory first, to show
+ * how the cost of duplicating its address space adds up.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define ITERATIONS	200
+
+extern char** environ;
+
+static char* sArgs[] = { "/bin/true", NULL };
+
+
+static void
+usage(void)
+{
+	printf("spawnbench [-h] [heap size in KB]\n");
+	exit(1);
+}
+
+
+static unsigned long
+elapsed_since(const struct timeval* before)
+{
+	struct timeval after;
+	gettimeofday(&after, NULL);
+
+	return 1000000 * (after.tv_sec - before->tv_sec)
+		+ after.tv_usec - before->tv_usec;
+}
+
+
+static void
+wait_for(pid_t child)
+{
+	int status;
+
+	if (waitpid(child, &status, 0) != child || !WIFEXITED(status)
+		|| WEXITSTATUS(status) != 0) {
+		fprintf(stderr, "child %d failed\n", (int)child);
+		exit(1);
+	}
+}
+
+
+static unsigned long
+run_fork(int useVfork)
+{
+	struct timeval before;
+	int i;
+
+	gettimeofday(&before, NULL);
+	for (i = 0; i < ITERATIONS; i++) {
+		pid_t child = useVfork ? vfork() : fork();
+		if (child < 0) {
+			fprintf(stderr, "fork failed: %s\n", strerror(errno));
+			exit(1);
+		}
+		if (child == 0) {
+			execve(sArgs[0], sArgs, environ);
+			_exit(127);
+		}
+
+		wait_for(child);
+	}
+
+	return elapsed_since(&before);
+}
+
+
+static unsigned long
+run_spawn(int withActions)
+{
+	posix_spawn_file_actions_t actions;
+	struct timeval before;
+	int i;
+
+	posix_spawn_file_actions_init(&actions);
+	if (withActions) {
+		posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY,
+			0);
+		posix_spawn_file_actions_adddup2(&actions, 2, 1);
+	}
+
+	gettimeofday(&before, NULL);
+	for (i = 0; i < ITERATIONS; i++) {
+		pid_t child;
+		int error = posix_spawn(&child, sArgs[0], &actions, NULL, sArgs,
+			environ);
+		if (error != 0) {
+			fprintf(stderr, "posix_spawn failed: %s\n", strerror(error));
+			exit(1);
+		}
+
+		wait_for(child);
+	}
+
+	posix_spawn_file_actions_destroy(&actions);
+	return elapsed_since(&before);
+}
+
+
+static void
+print_result(const char* name, unsigned long elapsed)
+{
+	printf("%-28s %6ld microseconds per program\n", name,
+		elapsed / ITERATIONS);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	long heapSize = 0;
+	char* heap = NULL;
+	long i;
+
+	if (argc > 2 || (argc == 2 && argv[1][0] == '-'))
+		usage();
+	if (argc == 2)
+		heapSize = atol(argv[1]) * 1024;
+
+	if (heapSize > 0) {
+		heap = (char*)malloc(heapSize);
+		if (heap == NULL) {
+			fprintf(stderr, "could not allocate %ld bytes\n", heapSize);
+			return 1;
+		}
+		for (i = 0; i < heapSize; i += 4096)
+			heap[i] = (char)i;
+	}
+
+	printf("parent heap: %ld KB\n", heapSize / 1024);
+	print_result("fork + exec", run_fork(0));
+	print_result("vfork + exec", run_fork(1));
+	print_result("posix_spawn", run_spawn(0));
+	print_result("posix_spawn with actions", run_spawn(1));
+
+	free(heap);
+	return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Measures path resolution throughput: several threads concurrently stat()
+ * the leaves of a deep directory tree, so that almost all time is spent
+ * looking up path components in the VFS entry cache.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+#define BASE_DIR	"/tmp/statbench"
+#define DEPTH		16
+#define FILES		8
+#define ITERATIONS	200000
+
+static char sPaths[FILES][PATH_MAX];
+static int sIterations = ITERATIONS;
+
+
+static void
+usage(void)
+{
+	printf("statbench [-h] [threads [iterations]]\n");
+	exit(1);
+}
+
+
+static void
+create_tree(void)
+{
+	char path[PATH_MAX];
+	int i;
+
+	strlcpy(path, BASE_DIR, sizeof(path));
+	if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+		perror("mkdir");
+		exit(1);
+	}
+
+	for (i = 0; i < DEPTH; i++) {
+		char component[32];
+		snprintf(component, sizeof(component), "/level%d", i);
+		strlcat(path, component, sizeof(path));
+		if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+			perror("mkdir");
+			exit(1);
+		}
+	}
+
+	for (i = 0; i < FILES; i++) {
+		FILE* file;
+		snprintf(sPaths[i], sizeof(sPaths[i]), "%s/file%d", path, i);
+		file = fopen(sPaths[i], "w");
+		if (file == NULL) {
+			perror("fopen");
+			exit(1);
+		}
+		fclose(file);
+	}
+}
+
+
+static void
+remove_tree(void)
+{
+	char path[PATH_MAX];
+	int i;
+
+	for (i = 0; i < FILES; i++)
+		unlink(sPaths[i]);
+
+	for (i = DEPTH; i >= 0; i--) {
+		int level;
+		strlcpy(path, BASE_DIR, sizeof(path));
+		for (level = 0; level < i; level++) {
+			char component[32];
+			snprintf(component, sizeof(component), "/level%d", level);
+			strlcat(path, component, sizeof(path));
+		}
+		rmdir(path);
+	}
+}
+
+
+static void*
+stat_thread(void* cookie)
+{
+	int index = (int)(addr_t)cookie;
+	struct stat st;
+	int i;
+
+	for (i = 0; i < sIterations; i++) {
+		if (stat(sPaths[(index + i) % FILES], &st) != 0) {
+			perror("stat");
+			exit(1);
+		}
+	}
+
+	return NULL;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	pthread_t threads[256];
+	struct timeval before, after;
+	unsigned long elapsed;
+	system_info info;
+	int threadCount;
+	int i;
+
+	get_system_info(&info);
+	threadCount = info.cpu_count;
+
+	if (argc > 1) {
+		if (argv[1][0] == '-')
+			usage();
+		threadCount = atoi(argv[1]);
+	}
+	if (argc > 2)
+		sIterations = atoi(argv[2]);
+	if (argc > 3 || threadCount < 1 || threadCount > 256 || sIterations < 1)
+		usage();
+
+	create_tree();
+
+	// warm up the caches
+	stat_thread(NULL);
+
+	gettimeofday(&before, NULL);
+	for (i = 0; i < threadCount; i++)
+		pthread_create(&threads[i], NULL, &stat_thread, (void*)(addr_t)i);
+	for (i = 0; i < threadCount; i++)
+		pthread_join(threads[i], NULL);
+	gettimeofday(&after, NULL);
+
+	elapsed = 1000000 * (after.tv_sec - before.tv_sec);
+	elapsed += after.tv_usec - before.tv_usec;
+
+	printf("%d threads, %d path components per stat()\n", threadCount,
+		DEPTH + 3);
+	printf("stat time: %lu nanoseconds\n",
+		(unsigned long)(1000ULL * elapsed / sIterations));
+	printf("throughput: %llu stat()s per second\n",
+		1000000ULL * sIterations * threadCount / elapsed);
+
+	remove_tree();
+	return 0;
+}
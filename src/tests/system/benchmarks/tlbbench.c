@@ -0,0 +1,118 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+/*
+ * Measures the cost of TLB misses: a random pointer chase over a large locked
+ * area touches a different page with almost every access. The area is
+ * created once with normal pages, and once with the B_LARGE_PAGES hint.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <OS.h>
+
+#include <vm_defs.h>
+
+#define AREA_SIZE	(256 * 1024 * 1024)
+#define STRIDE		4096
+#define ACCESSES	10000000
+
+
+static void
+usage(void)
+{
+	printf("tlbbench [-h] [size in MB [accesses]]\n");
+	exit(1);
+}
+
+
+static unsigned long
+run_chase(size_t size, uint32 protection, int accesses)
+{
+	struct timeval before, after;
+	size_t count = size / STRIDE;
+	size_t* order;
+	void** base;
+	void** current;
+	area_id area;
+	size_t i;
+	int j;
+
+	area = create_area("tlbbench", (void**)&base, B_ANY_ADDRESS, size,
+		B_FULL_LOCK, protection);
+	if (area < 0) {
+		fprintf(stderr, "create_area: %s\n", strerror(area));
+		exit(1);
+	}
+
+	// link the pages into a random cycle
+	order = malloc(count * sizeof(size_t));
+	if (order == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+	for (i = 0; i < count; i++)
+		order[i] = i;
+	for (i = count - 1; i > 0; i--) {
+		size_t other = ((size_t)rand() * RAND_MAX + rand()) % (i + 1);
+		size_t temp = order[i];
+		order[i] = order[other];
+		order[other] = temp;
+	}
+	for (i = 0; i < count; i++) {
+		base[order[i] * (STRIDE / sizeof(void*))]
+			= &base[order[(i + 1) % count] * (STRIDE / sizeof(void*))];
+	}
+	free(order);
+
+	current = base;
+	gettimeofday(&before, NULL);
+	for (j = 0; j < accesses; j++)
+		current = (void**)*current;
+	gettimeofday(&after, NULL);
+
+	// make sure the loop isn't optimized away
+	if (current == NULL)
+		printf("broken chain\n");
+
+	delete_area(area);
+
+	return 1000000 * (after.tv_sec - before.tv_sec)
+		+ after.tv_usec - before.tv_usec;
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	size_t size = AREA_SIZE;
+	int accesses = ACCESSES;
+	unsigned long normal, large;
+
+	if (argc > 1) {
+		if (argv[1][0] == '-')
+			usage();
+		size = (size_t)atoi(argv[1]) * 1024 * 1024;
+	}
+	if (argc > 2)
+		accesses = atoi(argv[2]);
+	if (argc > 3 || size < 2 * STRIDE || accesses < 1)
+		usage();
+
+	normal = run_chase(size, B_READ_AREA | B_WRITE_AREA, accesses);
+	large = run_chase(size, B_READ_AREA | B_WRITE_AREA | B_LARGE_PAGES,
+		accesses);
+
+	printf("%lu MB area, %d accesses\n", (unsigned long)(size / 1024 / 1024),
+		accesses);
+	printf("normal pages: %lu nanoseconds per access\n",
+		(unsigned long)(1000ULL * normal / accesses));
+	printf("large pages: %lu nanoseconds per access\n",
+		(unsigned long)(1000ULL * large / accesses));
+	return 0;
+}
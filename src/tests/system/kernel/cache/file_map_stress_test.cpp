@@ -0,0 +1,162 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Times random reads through the file map of a heavily fragmented file:
+	every block of the file is its own extent on disk.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+#include <fs_cache.h>
+#include <fs_interface.h>
+
+#include <file_cache.h>
+
+
+#define EXTENT_COUNT	100000
+#define BLOCK_SIZE		4096
+#define READ_SIZE		(16 * BLOCK_SIZE)
+#define READ_COUNT		200000
+#define MAX_VECS		32
+
+
+static uint32 sFileMapCalls;
+
+
+static off_t
+disk_offset_for(off_t offset)
+{
+	// leave a gap behind each block, so that no extents can be merged
+	return (offset / BLOCK_SIZE) * 2 * BLOCK_SIZE + offset % BLOCK_SIZE;
+}
+
+
+static void
+error(const char* message, off_t offset)
+{
+	fprintf(stderr, "ERROR: %s at offset %lld\n", message, offset);
+	exit(1);
+}
+
+
+static bigtime_t
+read_randomly(void* map, off_t fileSize, int32 count)
+{
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < count; i++) {
+		off_t offset = (((off_t)rand() * RAND_MAX + rand())
+			% (fileSize - READ_SIZE)) & ~(off_t)511;
+
+		file_io_vec vecs[MAX_VECS];
+		size_t vecCount = MAX_VECS;
+		status_t status = file_map_translate(map, offset, READ_SIZE, vecs,
+			&vecCount, 0);
+		if (status != B_OK)
+			error(strerror(status), offset);
+
+		off_t length = 0;
+		for (size_t j = 0; j < vecCount; j++) {
+			if (vecs[j].offset != disk_offset_for(offset + length))
+				error("wrong disk offset", offset + length);
+			length += vecs[j].length;
+		}
+		if (length != READ_SIZE)
+			error("wrong length", offset);
+	}
+
+	return system_time() - start;
+}
+
+
+//	#pragma mark - VFS support functions
+
+
+extern "C" status_t
+vfs_get_file_map(struct vnode* vnode, off_t offset, uint32 length,
+	file_io_vec* vecs, size_t* _vecCount)
+{
+	off_t fileSize = (off_t)EXTENT_COUNT * BLOCK_SIZE;
+	size_t count = 0;
+
+	sFileMapCalls++;
+
+	while (count < *_vecCount && offset < fileSize && length > 0) {
+		off_t blockEnd = (offset / BLOCK_SIZE + 1) * BLOCK_SIZE;
+
+		vecs[count].offset = disk_offset_for(offset);
+		vecs[count].length = blockEnd - offset;
+		if (vecs[count].length > length)
+			vecs[count].length = length;
+
+		length -= vecs[count].length;
+		offset = blockEnd;
+		count++;
+	}
+
+	*_vecCount = count;
+	return B_OK;
+}
+
+
+extern "C" status_t
+vfs_lookup_vnode(dev_t mountID, ino_t vnodeID, struct vnode** _vnode)
+{
+	*_vnode = (struct vnode*)mountID;
+	return B_OK;
+}
+
+
+//	#pragma mark -
+
+
+int
+main(int argc, char** argv)
+{
+	int32 readCount = READ_COUNT;
+	if (argc > 1)
+		readCount = atoi(argv[1]);
+
+	file_map_init();
+	srand(42);
+
+	off_t fileSize = (off_t)EXTENT_COUNT * BLOCK_SIZE;
+	void* map = file_map_create(1, 0, fileSize);
+	if (map == NULL) {
+		fprintf(stderr, "Creating file map failed.\n");
+		return 1;
+	}
+
+	// a single access at the end must not map the whole file
+
+	file_io_vec vecs[MAX_VECS];
+	size_t vecCount = MAX_VECS;
+	if (file_map_translate(map, fileSize - BLOCK_SIZE, BLOCK_SIZE, vecs,
+			&vecCount, 0) != B_OK) {
+		error("translate failed", fileSize - BLOCK_SIZE);
+	}
+	printf("%d extents, %lu file system calls for the last block\n",
+		EXTENT_COUNT, (unsigned long)sFileMapCalls);
+	if (sFileMapCalls > 1)
+		error("file map was populated up to the access", fileSize - BLOCK_SIZE);
+
+	bigtime_t cold = read_randomly(map, fileSize, readCount);
+	printf("cold: %ld reads in %lld usecs (%lu file system calls)\n",
+		(long)readCount, cold, (unsigned long)sFileMapCalls);
+
+	sFileMapCalls = 0;
+	bigtime_t warm = read_randomly(map, fileSize, readCount);
+	printf("warm: %ld reads in %lld usecs (%lu file system calls)\n",
+		(long)readCount, warm, (unsigned long)sFileMapCalls);
+
+	file_map_delete(map);
+	return 0;
+}
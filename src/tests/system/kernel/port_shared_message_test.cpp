@@ -0,0 +1,114 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Large port messages written while a reader is waiting are copied by the
+	reader directly from the writer's buffer. This checks that the writer may
+	reuse its buffer as soon as write_port() returns, both when the reader
+	picks up the message right away and when it takes too long.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <OS.h>
+
+
+static const size_t kMessageSize = 200 * 1024;
+static const int32 kIterations = 100;
+
+static port_id sPort;
+static bigtime_t sReadDelay;
+
+
+static void
+fill_buffer(uint8* buffer, size_t size, int32 seed)
+{
+	for (size_t i = 0; i < size; i++)
+		buffer[i] = (uint8)(i * 7 + seed);
+}
+
+
+static status_t
+reader_thread(void*)
+{
+	uint8* buffer = (uint8*)malloc(kMessageSize);
+	uint8* expected = (uint8*)malloc(kMessageSize);
+
+	for (int32 i = 0; i < kIterations; i++) {
+		if (sReadDelay > 0) {
+			port_buffer_size(sPort);
+			snooze(sReadDelay);
+		}
+
+		int32 code;
+		ssize_t bytes = read_port(sPort, &code, buffer, kMessageSize);
+		if (bytes != (ssize_t)kMessageSize) {
+			fprintf(stderr, "read_port() failed: %s\n", strerror(bytes));
+			exit(1);
+		}
+
+		fill_buffer(expected, kMessageSize, code);
+		if (memcmp(buffer, expected, kMessageSize) != 0) {
+			fprintf(stderr, "message %" B_PRId32 " was corrupted\n", code);
+			exit(1);
+		}
+	}
+
+	free(expected);
+	free(buffer);
+	return B_OK;
+}
+
+
+static void
+run_test(const char* name, bigtime_t readDelay)
+{
+	sPort = create_port(1, "shared message test");
+	sReadDelay = readDelay;
+
+	thread_id reader = spawn_thread(reader_thread, "reader",
+		B_NORMAL_PRIORITY, NULL);
+	resume_thread(reader);
+
+	uint8* buffer = (uint8*)malloc(kMessageSize);
+	bigtime_t start = system_time();
+
+	for (int32 i = 0; i < kIterations; i++) {
+		// give the reader a chance to wait for the message
+		snooze(1000);
+
+		fill_buffer(buffer, kMessageSize, i);
+		status_t status = write_port(sPort, i, buffer, kMessageSize);
+		if (status != B_OK) {
+			fprintf(stderr, "write_port() failed: %s\n", strerror(status));
+			exit(1);
+		}
+
+		// the message must not be affected by this anymore
+		memset(buffer, 0xcc, kMessageSize);
+	}
+
+	status_t result;
+	wait_for_thread(reader, &result);
+	bigtime_t elapsed = system_time() - start;
+
+	free(buffer);
+	delete_port(sPort);
+
+	printf("%s: passed, %" B_PRId64 " us per message\n", name,
+		elapsed / kIterations - 1000);
+}
+
+
+int
+main()
+{
+	run_test("waiting reader", 0);
+	run_test("slow reader", 50000);
+	return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2026, Haiku, Inc. All rights reserved.
+ * Distributed under the terms of the MIT License.
+ */
+
+
+/*!	Measures pthread mutexes and condition variables under contention.
+
+	A number of threads repeatedly lock a shared mutex, with and without
+	priority inheritance, and one thread broadcasts on a condition variable
+	with many waiters, which all have to reacquire the mutex afterwards.
+*/
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <OS.h>
+
+
+static const int kMaxThreads = 64;
+static const int kLockIterations = 200000;
+static const int kBroadcastRounds = 2000;
+
+
+struct mutex_test {
+	pthread_mutex_t	mutex;
+	int				iterations;
+	int64			counter;
+};
+
+struct broadcast_test {
+	pthread_mutex_t	mutex;
+	pthread_cond_t	wakeUp;
+	pthread_cond_t	done;
+	int				waiters;
+	int				round;
+	int				finished;
+};
+
+
+static void*
+mutex_thread(void* data)
+{
+	mutex_test* test = (mutex_test*)data;
+
+	for (int i = 0; i < test->iterations; i++) {
+		pthread_mutex_lock(&test->mutex);
+		test->counter++;
+		pthread_mutex_unlock(&test->mutex);
+	}
+
+	return NULL;
+}
+
+
+static void
+run_mutex_test(int threadCount, int protocol)
+{
+	pthread_mutexattr_t attributes;
+	pthread_mutexattr_init(&attributes);
+	if (pthread_mutexattr_setprotocol(&attributes, protocol) != 0) {
+		fprintf(stderr, "protocol %d not supported\n", protocol);
+		exit(1);
+	}
+
+	mutex_test test;
+	pthread_mutex_init(&test.mutex, &attributes);
+	pthread_mutexattr_destroy(&attributes);
+	test.iterations = kLockIterations / threadCount;
+	test.counter = 0;
+
+	pthread_t threads[kMaxThreads];
+	bigtime_t start = system_time();
+
+	for (int i = 0; i < threadCount; i++)
+		pthread_create(&threads[i], NULL, mutex_thread, &test);
+	for (int i = 0; i < threadCount; i++)
+		pthread_join(threads[i], NULL);
+
+	bigtime_t elapsed = system_time() - start;
+	pthread_mutex_destroy(&test.mutex);
+
+	if (test.counter != (int64)test.iterations * threadCount) {
+		fprintf(stderr, "lost updates: %" B_PRId64 " instead of %d\n",
+			test.counter, test.iterations * threadCount);
+		exit(1);
+	}
+
+	printf("mutex (%s), %2d threads: %6" B_PRId64 " ns per lock\n",
+		protocol == PTHREAD_PRIO_INHERIT ? "inherit" : "none   ", threadCount,
+		elapsed * 1000 / (test.iterations * threadCount));
+}
+
+
+static void*
+broadcast_waiter(void* data)
+{
+	broadcast_test* test = (broadcast_test*)data;
+
+	pthread_mutex_lock(&test->mutex);
+	for (int round = 1; round <= kBroadcastRounds; round++) {
+		while (test->round < round)
+			pthread_cond_wait(&test->wakeUp, &test->mutex);
+
+		if (++test->finished == test->waiters)
+			pthread_cond_signal(&test->done);
+	}
+	pthread_mutex_unlock(&test->mutex);
+
+	return NULL;
+}
+
+
+static void
+run_broadcast_test(int waiterCount)
+{
+	broadcast_test test;
+	pthread_mutex_init(&test.mutex, NULL);
+	pthread_cond_init(&test.wakeUp, NULL);
+	pthread_cond_init(&test.done, NULL);
+	test.waiters = waiterCount;
+	test.round = 0;
+	test.finished = 0;
+
+	pthread_t threads[kMaxThreads];
+	for (int i = 0; i < waiterCount; i++)
+		pthread_create(&threads[i], NULL, broadcast_waiter, &test);
+
+	bigtime_t start = system_time();
+
+	pthread_mutex_lock(&test.mutex);
+	for (int round = 1; round <= kBroadcastRounds; round++) {
+		test.finished = 0;
+		test.round = round;
+		pthread_cond_broadcast(&test.wakeUp);
+
+		while (test.finished < waiterCount)
+			pthread_cond_wait(&test.done, &test.mutex);
+	}
+	pthread_mutex_unlock(&test.mutex);
+
+	bigtime_t elapsed = system_time() - start;
+
+	for (int i = 0; i < waiterCount; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_cond_destroy(&test.done);
+	pthread_cond_destroy(&test.wakeUp);
+	pthread_mutex_destroy(&test.mutex);
+
+	printf("broadcast, %2d waiters:     %6" B_PRId64 " us per round\n",
+		waiterCount, elapsed / kBroadcastRounds);
+}
+
+
+int
+main(int argc, char** argv)
+{
+	static const int kThreadCounts[] = {1, 2, 4, 8, 16, 32, 64};
+	static const int kThreadCountsCount
+		= sizeof(kThreadCounts) / sizeof(kThreadCounts[0]);
+
+	for (int i = 0; i < kThreadCountsCount; i++)
+		run_mutex_test(kThreadCounts[i], PTHREAD_PRIO_NONE);
+	for (int i = 0; i < kThreadCountsCount; i++)
+		run_mutex_test(kThreadCounts[i], PTHREAD_PRIO_INHERIT);
+	for (int i = 1; i < kThreadCountsCount; i++)
+		run_broadcast_test(kThreadCounts[i]);
+
+	return 0;
+}
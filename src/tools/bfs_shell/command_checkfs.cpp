@@ -77,6 +77,8 @@ command_checkfs(int argc, const char* const* argv)
 					fssh_dprintf(", names don't match");
 				if ((result.errors & BFS_INVALID_BPLUSTREE) != 0)
 					fssh_dprintf(", invalid b+tree");
+				if ((result.errors & BFS_INVALID_INLINE_DATA) != 0)
+					fssh_dprintf(", invalid inline data");
 				fssh_dprintf("\n");
 			}
 